@@ -331,6 +331,12 @@ inline void from_xtp(const XTPTickByTickStruct &ori, Entrust &des) {
   des.main_seq = ori.entrust.channel_no;
   des.seq = ori.entrust.seq;
 
+  if (ori.entrust.side == '1' || ori.entrust.side == 'B') {
+    des.side = Side::Buy;
+  } else if (ori.entrust.side == '2' || ori.entrust.side == 'S') {
+    des.side = Side::Sell;
+  }
+
   if (ori.entrust.ord_type == '1') {
     des.price_type = PriceType::Any;
   } else if (ori.entrust.ord_type == '2') {
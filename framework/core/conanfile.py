@@ -28,6 +28,7 @@ class KungfuCoreConan(ConanFile):
     generators = "cmake"
     requires = [
         "fmt/8.1.1",
+        "lz4/1.9.4",
         "nlohmann_json/3.11.2",
         "nng/1.5.2",
         "rxcpp/4.1.1",
@@ -79,6 +80,12 @@ class KungfuCoreConan(ConanFile):
     kfc_dir = path.join(dist_dir, "kfc")
     kfs_dir = path.join(dist_dir, "kfs")
 
+    def requirements(self):
+        if environ.get("KUNGFU_BUILD_BENCHMARK"):
+            self.requires("benchmark/1.7.1")
+        if environ.get("KUNGFU_BUILD_TEST"):
+            self.requires("gtest/1.12.1")
+
     def configure(self):
         if tools.detected_os() != "Windows":
             self.settings.compiler.libcxx = "libstdc++"
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef KUNGFU_BENCHMARK_H
+#define KUNGFU_BENCHMARK_H
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+#include <kungfu/yijinjing/practice/apprentice.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif // __linux__
+
+namespace kungfu::bench {
+constexpr int32_t BENCH_MSG_TYPE = 10001;
+
+/**
+ * Locator taking env settings from a map instead of process env, so benchmarks can compare settings side by side.
+ */
+class bench_locator : public yijinjing::data::locator {
+public:
+  bench_locator(const std::string &root, std::unordered_map<std::string, std::string> env)
+      : locator(root), env_(std::move(env)) {}
+
+  [[nodiscard]] bool has_env(const std::string &name) const override { return env_.find(name) != env_.end(); }
+
+  [[nodiscard]] std::string get_env(const std::string &name) const override { return env_.at(name); }
+
+private:
+  const std::unordered_map<std::string, std::string> env_;
+};
+
+/**
+ * Journals, indices and logs of one benchmark under a fresh directory in system temp, removed on destruction.
+ */
+class temp_home {
+public:
+  explicit temp_home(std::unordered_map<std::string, std::string> env = {})
+      : root_(make_root()), locator_(std::make_shared<bench_locator>(root_.string(), std::move(env))) {}
+
+  ~temp_home() {
+    std::error_code ec;
+    std::filesystem::remove_all(root_, ec);
+  }
+
+  [[nodiscard]] const yijinjing::data::locator_ptr &get_locator() const { return locator_; }
+
+  [[nodiscard]] yijinjing::data::location_ptr make_location(longfist::enums::category c, const std::string &group,
+                                                            const std::string &name) const {
+    return yijinjing::data::location::make_shared(longfist::enums::mode::LIVE, c, group, name, locator_);
+  }
+
+private:
+  const std::filesystem::path root_;
+  const yijinjing::data::locator_ptr locator_;
+
+  static std::filesystem::path make_root() {
+    static int count = 0;
+    auto name = fmt::format("kungfu-benchmark-{}-{}", yijinjing::time::now_in_nano(), count++);
+    auto root = std::filesystem::temp_directory_path() / name;
+    std::filesystem::create_directories(root);
+    return root;
+  }
+};
+
+/**
+ * @return resident set size of the process, 0 where it can not be read cheaply
+ */
+inline int64_t resident_bytes() {
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  int64_t size = 0;
+  int64_t resident = 0;
+  statm >> size >> resident;
+  return resident * sysconf(_SC_PAGESIZE);
+#else
+  return 0;
+#endif // __linux__
+}
+
+/**
+ * Publisher for writers with no observer to wake up, keeps notify out of measured frame cost.
+ */
+class null_publisher : public yijinjing::publisher {
+public:
+  bool is_usable() override { return true; }
+
+  void setup() override {}
+
+  int notify() override { return 0; }
+
+  int publish(const std::string &json_message, int flags) override { return 0; }
+};
+
+/**
+ * Apprentice never set up against master, exposes add_location so benchmarks can fake registered locations.
+ */
+class bench_apprentice : public yijinjing::practice::apprentice {
+public:
+  explicit bench_apprentice(yijinjing::data::location_ptr home) : apprentice(std::move(home), false) {}
+
+  using hero::add_location;
+};
+} // namespace kungfu::bench
+
+#endif // KUNGFU_BENCHMARK_H
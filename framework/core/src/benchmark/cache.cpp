@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include "bench.h"
+
+#include <kungfu/yijinjing/cache/backend.h>
+
+using namespace kungfu::longfist::enums;
+using namespace kungfu::longfist::types;
+using namespace kungfu::yijinjing;
+using namespace kungfu::yijinjing::cache;
+
+namespace kungfu::bench {
+namespace {
+constexpr int64_t ROWS_PER_ITERATION = 10000;
+constexpr int64_t BATCH_TIME = time_unit::NANOSECONDS_PER_SECOND; // batches are cut by rows only
+
+StateStoragePtr make_bench_storage(temp_home &home) {
+  auto location = home.make_location(category::SYSTEM, "service", "cached");
+  auto db_file = home.get_locator()->layout_file(location, layout::SQLITE, "bench");
+  auto storage = make_storage_ptr(db_file, longfist::StateDataTypes);
+  storage->pragma.journal_mode(sqlite_orm::journal_mode::WAL);
+  storage->sync_schema();
+  return storage;
+}
+} // namespace
+
+/**
+ * Orders persisted into sqlite row by row, each replace autocommitted on its own as cached did before batching, the
+ * baseline for BM_cache_store.
+ */
+void BM_cache_replace(benchmark::State &state) {
+  temp_home home;
+  auto storage = make_bench_storage(home);
+  Order order = {};
+  order.instrument_id = "600000";
+  order.exchange_id = "SSE";
+  uint64_t order_id = 0;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < ROWS_PER_ITERATION; i++) {
+      order.order_id = ++order_id;
+      storage->replace(order);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * ROWS_PER_ITERATION);
+}
+BENCHMARK(BM_cache_replace)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/**
+ * Orders persisted into sqlite the way cached does, each iteration writes a run of rows and flushes them.
+ */
+void BM_cache_store(benchmark::State &state) {
+  auto batch_rows = state.range(0);
+  auto threaded = state.range(1) != 0;
+  temp_home home;
+  auto storage = make_bench_storage(home);
+  store s(storage, batch_rows, BATCH_TIME, threaded);
+  Order order = {};
+  order.instrument_id = "600000";
+  order.exchange_id = "SSE";
+  uint64_t order_id = 0;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < ROWS_PER_ITERATION; i++) {
+      order.order_id = ++order_id;
+      s.replace(order);
+    }
+    s.flush();
+  }
+  state.SetItemsProcessed(state.iterations() * ROWS_PER_ITERATION);
+}
+BENCHMARK(BM_cache_store)
+    ->ArgsProduct({{1, 100, 1000}, {0, 1}})
+    ->ArgNames({"batch", "threaded"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+/**
+ * Order states fed into a bank the way apprentices keep cached data, updating the given number of orders in turns.
+ */
+void BM_cache_bank(benchmark::State &state) {
+  auto order_count = state.range(0);
+  bank b;
+  Order order = {};
+  order.instrument_id = "600000";
+  order.exchange_id = "SSE";
+  int64_t i = 0;
+  for (auto _ : state) {
+    order.order_id = i++ % order_count + 1;
+    b << kungfu::state<Order>(1, 2, i, order);
+  }
+  benchmark::DoNotOptimize(b[boost::hana::type_c<Order>].size());
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_cache_bank)->RangeMultiplier(16)->Range(16, 1 << 20)->ArgName("orders");
+} // namespace kungfu::bench
@@ -0,0 +1,536 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include "bench.h"
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+
+#include <kungfu/yijinjing/journal/assemble.h>
+#include <kungfu/yijinjing/journal/journal.h>
+#include <kungfu/yijinjing/journal/page.h>
+#include <kungfu/yijinjing/journal/page_archive.h>
+#include <kungfu/yijinjing/journal/page_scanner.h>
+
+using namespace kungfu::longfist::enums;
+using namespace kungfu::longfist::types;
+using namespace kungfu::yijinjing;
+using namespace kungfu::yijinjing::journal;
+
+namespace kungfu::bench {
+namespace {
+struct page_spec {
+  category c;
+  uint32_t dest;
+};
+
+// page_policy decides page size by category and dest if not set: 1MB, 16MB, 128MB
+const page_spec PAGE_SPECS[] = {{category::SYSTEM, 0}, {category::TD, 1}, {category::MD, 0}};
+
+constexpr int64_t ROLL_BYTES = 256 * MB; // start over in a new home before journals fill up temp dir
+constexpr int64_t READ_BYTES = 64 * MB;
+
+writer_ptr make_writer(const temp_home &home, const page_spec &spec, const std::string &name) {
+  auto location = home.make_location(spec.c, "bench", name);
+  return std::make_shared<writer>(location, spec.dest, true, std::make_shared<null_publisher>());
+}
+
+void set_counters(benchmark::State &state, const writer_ptr &w, int64_t frame_size) {
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * frame_size);
+  state.counters["page_size"] = find_page_size(w->get_location(), w->get_dest());
+}
+} // namespace
+
+void BM_journal_write(benchmark::State &state) {
+  auto frame_size = state.range(0);
+  auto &spec = PAGE_SPECS[state.range(1)];
+  std::vector<char> data(frame_size, 'k');
+  auto home = std::make_unique<temp_home>();
+  auto w = make_writer(*home, spec, "write");
+  int64_t written = 0;
+  for (auto _ : state) {
+    w->write_raw(0, BENCH_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), frame_size);
+    if ((written += frame_size) > ROLL_BYTES) {
+      state.PauseTiming();
+      w.reset();
+      home = std::make_unique<temp_home>();
+      w = make_writer(*home, spec, "write");
+      written = 0;
+      state.ResumeTiming();
+    }
+  }
+  set_counters(state, w, frame_size);
+}
+BENCHMARK(BM_journal_write)->ArgsProduct({{32, 256, 2048}, {0, 1, 2}})->ArgNames({"frame", "page"});
+
+/**
+ * Producers on several threads sharing one writer, frames are reserved without lock except on page rollover.
+ * When locked, every write spins on try_lock of a mutex held from open to close, the way writer serialized them before.
+ */
+void BM_journal_write_shared(benchmark::State &state) {
+  static std::unique_ptr<temp_home> home;
+  static writer_ptr w;
+  static std::mutex write_mutex;
+  auto frame_size = state.range(0);
+  auto locked = state.range(1);
+  if (state.thread_index() == 0) {
+    home = std::make_unique<temp_home>();
+    w = make_writer(*home, PAGE_SPECS[1], "shared");
+  }
+  std::vector<char> data(frame_size, 'k');
+  for (auto _ : state) {
+    if (locked) {
+      while (not write_mutex.try_lock()) {
+      }
+      w->write_raw(0, BENCH_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), frame_size);
+      write_mutex.unlock();
+    } else {
+      w->write_raw(0, BENCH_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), frame_size);
+    }
+  }
+  if (state.thread_index() == 0) {
+    w.reset();
+    home.reset();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * frame_size);
+}
+BENCHMARK(BM_journal_write_shared)
+    ->ArgsProduct({{64}, {0, 1}})
+    ->ArgNames({"frame", "locked"})
+    ->ThreadRange(1, 8)
+    ->Iterations(1 << 19)
+    ->UseRealTime();
+
+/**
+ * A basket of order inputs written as one frame each, or as one OrderInputBatch frame when batched.
+ */
+void BM_journal_write_orders(benchmark::State &state) {
+  auto basket = state.range(0);
+  auto batched = state.range(1) != 0;
+  auto home = std::make_unique<temp_home>();
+  auto w = make_writer(*home, PAGE_SPECS[1], "orders");
+  int64_t written = 0;
+  for (auto _ : state) {
+    if (batched) {
+      auto inputs = w->open_array<OrderInput>(0, OrderInputBatch::tag, basket);
+      for (int64_t i = 0; i < basket; i++) {
+        inputs[i] = {};
+        inputs[i].order_id = w->current_element_uid(i);
+        inputs[i].volume = 100;
+      }
+      w->close_data();
+    } else {
+      for (int64_t i = 0; i < basket; i++) {
+        OrderInput &input = w->open_data<OrderInput>(0);
+        input = {};
+        input.order_id = w->current_frame_uid();
+        input.volume = 100;
+        w->close_data();
+      }
+    }
+    if ((written += basket * sizeof(OrderInput)) > ROLL_BYTES) {
+      state.PauseTiming();
+      w.reset();
+      home = std::make_unique<temp_home>();
+      w = make_writer(*home, PAGE_SPECS[1], "orders");
+      written = 0;
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * basket);
+}
+BENCHMARK(BM_journal_write_orders)->ArgsProduct({{10, 100}, {0, 1}})->ArgNames({"basket", "batched"});
+
+void BM_journal_read(benchmark::State &state) {
+  auto frame_size = state.range(0);
+  auto &spec = PAGE_SPECS[state.range(1)];
+  std::vector<char> data(frame_size, 'k');
+  temp_home home;
+  auto w = make_writer(home, spec, "read");
+  for (int64_t i = 0; i < READ_BYTES / frame_size; i++) {
+    w->write_raw(0, BENCH_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), frame_size);
+  }
+  reader r(true);
+  r.join(w->get_location(), spec.dest, 0);
+  for (auto _ : state) {
+    if (not r.data_available()) {
+      state.PauseTiming();
+      r.seek_to_time(0);
+      state.ResumeTiming();
+    }
+    benchmark::DoNotOptimize(r.current_frame()->data_as_bytes()[frame_size - 1]);
+    r.next();
+  }
+  set_counters(state, w, frame_size);
+}
+BENCHMARK(BM_journal_read)->ArgsProduct({{32, 256, 2048}, {0, 1, 2}})->ArgNames({"frame", "page"});
+
+/**
+ * Frames written with or without a CRC32C in their headers, checksum is computed on commit.
+ */
+void BM_journal_write_checksum(benchmark::State &state) {
+  auto frame_size = state.range(0);
+  std::unordered_map<std::string, std::string> env = {{"KF_JOURNAL_CHECKSUM", state.range(1) ? "1" : "0"}};
+  auto &spec = PAGE_SPECS[1];
+  std::vector<char> data(frame_size, 'k');
+  auto home = std::make_unique<temp_home>(env);
+  auto w = make_writer(*home, spec, "checksum");
+  int64_t written = 0;
+  for (auto _ : state) {
+    w->write_raw(0, BENCH_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), frame_size);
+    if ((written += frame_size) > ROLL_BYTES) {
+      state.PauseTiming();
+      w.reset();
+      home = std::make_unique<temp_home>(env);
+      w = make_writer(*home, spec, "checksum");
+      written = 0;
+      state.ResumeTiming();
+    }
+  }
+  set_counters(state, w, frame_size);
+}
+BENCHMARK(BM_journal_write_checksum)->ArgsProduct({{32, 2048}, {0, 1}})->ArgNames({"frame", "checksum"});
+
+/**
+ * Frames with checksums read as they are, or verified by a reader in debug mode.
+ */
+void BM_journal_read_verify(benchmark::State &state) {
+  auto frame_size = state.range(0);
+  auto &spec = PAGE_SPECS[1];
+  std::vector<char> data(frame_size, 'k');
+  temp_home home(std::unordered_map<std::string, std::string>{{"KF_JOURNAL_CHECKSUM", "1"}});
+  auto w = make_writer(home, spec, "verify");
+  for (int64_t i = 0; i < READ_BYTES / frame_size; i++) {
+    w->write_raw(0, BENCH_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), frame_size);
+  }
+  reader r(true);
+  r.set_verify_checksum(state.range(1) != 0);
+  r.join(w->get_location(), spec.dest, 0);
+  for (auto _ : state) {
+    if (not r.data_available()) {
+      state.PauseTiming();
+      r.seek_to_time(0);
+      state.ResumeTiming();
+    }
+    benchmark::DoNotOptimize(r.current_frame()->data_as_bytes()[frame_size - 1]);
+    r.next();
+  }
+  set_counters(state, w, frame_size);
+}
+BENCHMARK(BM_journal_read_verify)->ArgsProduct({{32, 2048}, {0, 1}})->ArgNames({"frame", "verify"});
+
+/**
+ * Pages walked frame by frame after a crash, checksums are verified where pages have them.
+ */
+void BM_journal_scan(benchmark::State &state) {
+  auto &spec = PAGE_SPECS[1];
+  std::vector<char> data(256, 'k');
+  temp_home home(std::unordered_map<std::string, std::string>{{"KF_JOURNAL_CHECKSUM", state.range(0) ? "1" : "0"}});
+  auto w = make_writer(home, spec, "scan");
+  for (int64_t i = 0; i < READ_BYTES / 256; i++) {
+    w->write_raw(0, BENCH_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), data.size());
+  }
+  int64_t bytes = 0;
+  for (auto _ : state) {
+    for (auto &scan : page_scanner::scan_all(w->get_location(), spec.dest, false)) {
+      bytes += scan.end_position;
+    }
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_journal_scan)->Arg(0)->Arg(1)->ArgName("checksum")->Unit(benchmark::kMillisecond);
+
+/**
+ * Latency of the write that rolls over to a new page, with the next page prefaulted in background, or loaded by
+ * the write itself as KF_PAGE_PREFAULT_THRESHOLD is 0. Only that write is timed, counters give its percentiles in ns.
+ */
+void BM_journal_rollover(benchmark::State &state) {
+  auto &spec = PAGE_SPECS[state.range(0)];
+  std::unordered_map<std::string, std::string> env = {};
+  if (state.range(1) == 0) {
+    env.emplace("KF_PAGE_PREFAULT_THRESHOLD", "0");
+  }
+  std::vector<char> data(256, 'k');
+  auto home = std::make_unique<temp_home>(env);
+  auto w = make_writer(*home, spec, "rollover");
+  std::vector<int64_t> latencies = {};
+  int64_t written = 0;
+  for (auto _ : state) {
+    auto page_id = w->get_current_page()->get_page_id();
+    int64_t start_time = 0;
+    while (w->get_current_page()->get_page_id() == page_id) {
+      start_time = time::now_in_nano();
+      w->write_raw(0, BENCH_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), data.size());
+      written += data.size();
+    }
+    auto latency = time::now_in_nano() - start_time;
+    latencies.push_back(latency);
+    state.SetIterationTime(latency / 1e9);
+    if (written > ROLL_BYTES) {
+      w.reset();
+      home = std::make_unique<temp_home>(env);
+      w = make_writer(*home, spec, "rollover");
+      written = 0;
+    }
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p) { return latencies[static_cast<size_t>(p * (latencies.size() - 1))]; };
+  state.counters["p50"] = percentile(0.5);
+  state.counters["p90"] = percentile(0.9);
+  state.counters["p99"] = percentile(0.99);
+  state.counters["max"] = latencies.back();
+  state.counters["page_size"] = find_page_size(w->get_location(), w->get_dest());
+}
+BENCHMARK(BM_journal_rollover)
+    ->ArgsProduct({{0, 1}, {0, 1}})
+    ->ArgNames({"page", "prefault"})
+    ->Iterations(256)
+    ->UseManualTime()
+    ->Unit(benchmark::kMicrosecond);
+
+/**
+ * A feed of small frames into an MD journal under page policies, "md" settings of KF_JOURNAL_POLICY by index:
+ * default, 1MB pages, 16MB pages, transparent huge pages, and locked pages.
+ * Counters show how often pages roll over and how much memory the writer keeps resident.
+ */
+void BM_journal_page_policy(benchmark::State &state) {
+  static const char *SETTINGS[] = {
+      "{}",
+      R"({"md": {"page_size": "1MB"}})",
+      R"({"md": {"page_size": "16MB"}})",
+      R"({"md": {"hugepage": "transparent"}})",
+      R"({"md": {"lock": true}})",
+  };
+  std::unordered_map<std::string, std::string> env = {{"KF_JOURNAL_POLICY", SETTINGS[state.range(0)]}};
+  auto &spec = PAGE_SPECS[2];
+  std::vector<char> data(256, 'k');
+  auto baseline = resident_bytes();
+  auto home = std::make_unique<temp_home>(env);
+  writer_ptr w;
+  try {
+    w = make_writer(*home, spec, "policy");
+  } catch (const journal_error &e) {
+    state.SkipWithError(e.what()); // lock needs RLIMIT_MEMLOCK above the page size
+    return;
+  }
+  int64_t written = 0;
+  int64_t rollovers = 0;
+  for (auto _ : state) {
+    w->write_raw(0, BENCH_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), data.size());
+    if ((written += data.size()) > ROLL_BYTES) {
+      state.PauseTiming();
+      rollovers += w->get_current_page()->get_page_id() - 1;
+      w.reset();
+      home = std::make_unique<temp_home>(env);
+      w = make_writer(*home, spec, "policy");
+      written = 0;
+      state.ResumeTiming();
+    }
+  }
+  rollovers += w->get_current_page()->get_page_id() - 1;
+  set_counters(state, w, data.size());
+  state.counters["rollovers"] = benchmark::Counter(rollovers, benchmark::Counter::kIsRate);
+  state.counters["resident"] = benchmark::Counter(resident_bytes() - baseline, benchmark::Counter::kDefaults,
+                                                  benchmark::Counter::kIs1024);
+}
+BENCHMARK(BM_journal_page_policy)->DenseRange(0, 4)->ArgName("policy");
+
+/**
+ * Reading sealed pages from their page files, or from archives inflated block by block as frames are reached.
+ */
+void BM_journal_read_archived(benchmark::State &state) {
+  auto frame_size = state.range(0);
+  auto archived = state.range(1) != 0;
+  auto &spec = PAGE_SPECS[1];
+  std::vector<char> data(frame_size, 'k');
+  temp_home home;
+  auto w = make_writer(home, spec, "archived");
+  for (int64_t i = 0; i < READ_BYTES / frame_size; i++) {
+    data[i % frame_size] = static_cast<char>(i);
+    w->write_raw(0, BENCH_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), frame_size);
+  }
+  archive_stats stats = {};
+  if (archived) {
+    stats = page_archive::archive_before(w->get_location(), spec.dest, INT64_MAX);
+  }
+  auto r = std::make_unique<reader>(true);
+  r->join(w->get_location(), spec.dest, 0);
+  for (auto _ : state) {
+    if (not r->data_available()) {
+      state.PauseTiming();
+      r = std::make_unique<reader>(true); // drop inflated pages to read the archives cold again
+      r->join(w->get_location(), spec.dest, 0);
+      state.ResumeTiming();
+    }
+    benchmark::DoNotOptimize(r->current_frame()->data_as_bytes()[frame_size - 1]);
+    r->next();
+  }
+  set_counters(state, w, frame_size);
+  state.counters["ratio"] = stats.ratio();
+}
+BENCHMARK(BM_journal_read_archived)->ArgsProduct({{32, 2048}, {0, 1}})->ArgNames({"frame", "archived"});
+
+/**
+ * A day of quotes loaded from journal frame by frame as read_all does, or copied once into records of frame header
+ * and quote as read_array does for the python bindings.
+ */
+void BM_journal_load_quotes(benchmark::State &state) {
+  auto quote_count = state.range(0);
+  auto batched = state.range(1) != 0;
+  auto &spec = PAGE_SPECS[2];
+  constexpr uint32_t record_length = sizeof(frame_header) + sizeof(Quote);
+  temp_home home;
+  auto w = make_writer(home, spec, "quotes");
+  for (int64_t i = 0; i < quote_count; i++) {
+    Quote &quote = w->open_data<Quote>(0);
+    quote = {};
+    quote.data_time = i;
+    quote.last_price = 10 + i % 100 * 0.01;
+    quote.volume = i * 100;
+    w->close_data();
+  }
+  std::vector<char> records = {};
+  for (auto _ : state) {
+    assemble a(w->get_location(), spec.dest);
+    if (batched) {
+      a.copy_frames(Quote::tag, 0, INT64_MAX, record_length, [&](size_t count) {
+        records.resize(count * record_length);
+        return records.data();
+      });
+      benchmark::DoNotOptimize(records.data());
+    } else {
+      auto quotes = a.read_all<Quote>();
+      benchmark::DoNotOptimize(quotes.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * quote_count);
+  state.SetBytesProcessed(state.iterations() * quote_count * record_length);
+}
+BENCHMARK(BM_journal_load_quotes)
+    ->ArgsProduct({{1 << 14, 1 << 17}, {0, 1}})
+    ->ArgNames({"quotes", "batched"})
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * Latency from writing a frame to a reader in the same process seeing it.
+ */
+void BM_journal_round_trip(benchmark::State &state) {
+  auto frame_size = state.range(0);
+  auto &spec = PAGE_SPECS[1];
+  std::vector<char> data(frame_size, 'k');
+  auto home = std::make_unique<temp_home>();
+  auto w = make_writer(*home, spec, "round_trip");
+  auto r = std::make_unique<reader>(true);
+  r->join(w->get_location(), spec.dest, 0);
+  int64_t written = 0;
+  for (auto _ : state) {
+    w->write_raw(0, BENCH_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), frame_size);
+    while (not r->data_available()) {
+    }
+    r->next();
+    if ((written += frame_size) > ROLL_BYTES) {
+      state.PauseTiming();
+      r.reset();
+      w.reset();
+      home = std::make_unique<temp_home>();
+      w = make_writer(*home, spec, "round_trip");
+      r = std::make_unique<reader>(true);
+      r->join(w->get_location(), spec.dest, 0);
+      written = 0;
+      state.ResumeTiming();
+    }
+  }
+  set_counters(state, w, frame_size);
+}
+BENCHMARK(BM_journal_round_trip)->Arg(32)->Arg(256)->Arg(2048)->ArgName("frame");
+
+namespace {
+/**
+ * Merge by scanning every joined journal for the smallest gen_time on each frame, the way reader did before its heap.
+ */
+class linear_merge {
+public:
+  void join(const yijinjing::data::location_ptr &location, uint32_t dest_id) {
+    journals_.emplace_back(location, dest_id, false, true).seek_to_time(0);
+  }
+
+  void seek_to_time(int64_t nanotime) {
+    for (auto &j : journals_) {
+      j.seek_to_time(nanotime);
+    }
+  }
+
+  bool data_available() {
+    current_ = nullptr;
+    for (auto &j : journals_) {
+      if (j.current_frame()->has_data() and
+          (current_ == nullptr or j.current_frame()->gen_time() < current_->current_frame()->gen_time())) {
+        current_ = &j;
+      }
+    }
+    return current_ != nullptr;
+  }
+
+  frame_ptr current_frame() { return current_->current_frame(); }
+
+  void next() { current_->next(); }
+
+private:
+  std::deque<yijinjing::journal::journal> journals_ = {};
+  yijinjing::journal::journal *current_ = nullptr;
+};
+
+template <typename Reader> void merge_frames(benchmark::State &state, Reader &r) {
+  for (auto _ : state) {
+    if (not r.data_available()) {
+      state.PauseTiming();
+      r.seek_to_time(0);
+      state.ResumeTiming();
+    }
+    benchmark::DoNotOptimize(r.current_frame()->gen_time());
+    r.next();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+} // namespace
+
+/**
+ * Reader merging frames by gen_time from journals written in turns, by all of them or only 4 with the rest idle,
+ * against a linear scan of all journals.
+ */
+void BM_journal_merge(benchmark::State &state) {
+  auto journal_count = state.range(0);
+  auto active_count = state.range(1) ? std::min<int64_t>(journal_count, 4) : journal_count;
+  auto linear = state.range(2);
+  auto &spec = PAGE_SPECS[0];
+  constexpr int64_t frame_size = 64;
+  constexpr int64_t frame_count = READ_BYTES / frame_size;
+  std::vector<char> data(frame_size, 'k');
+  temp_home home;
+  std::vector<writer_ptr> writers = {};
+  for (int64_t i = 0; i < journal_count; i++) {
+    writers.push_back(make_writer(home, spec, fmt::format("merge{}", i)));
+  }
+  for (int64_t i = 0; i < frame_count; i++) {
+    writers[i % active_count]->write_raw(0, BENCH_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), frame_size);
+  }
+  if (linear) {
+    linear_merge r;
+    for (auto &w : writers) {
+      r.join(w->get_location(), spec.dest);
+    }
+    merge_frames(state, r);
+  } else {
+    reader r(true);
+    for (auto &w : writers) {
+      r.join(w->get_location(), spec.dest, 0);
+    }
+    merge_frames(state, r);
+  }
+}
+BENCHMARK(BM_journal_merge)
+    ->ArgsProduct({benchmark::CreateRange(1, 1024, 4), {0, 1}, {0, 1}})
+    ->ArgNames({"journals", "idle", "linear"});
+} // namespace kungfu::bench
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include "bench.h"
+
+using namespace kungfu::longfist::enums;
+using namespace kungfu::longfist::types;
+
+namespace kungfu::bench {
+namespace {
+template <typename DataType> DataType make_data() {
+  DataType data = {};
+  if constexpr (size_unfixed_v<DataType>) {
+    // variable-size types are mostly names and tags, use field names as the strings
+    boost::hana::for_each(boost::hana::accessors<DataType>(), [&](auto it) {
+      auto &v = boost::hana::second(it)(data);
+      using V = std::decay_t<decltype(v)>;
+      if constexpr (std::is_same_v<V, std::string>) {
+        v = boost::hana::first(it).c_str();
+      } else if constexpr (std::is_arithmetic_v<V>) {
+        v = 1;
+      }
+    });
+  } else {
+    data.instrument_id = "600000";
+    data.exchange_id = "SSE";
+    data.instrument_type = InstrumentType::Stock;
+  }
+  return data;
+}
+} // namespace
+
+template <typename DataType> void BM_longfist_to_string(benchmark::State &state) {
+  auto data = make_data<DataType>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(data.to_string());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["size"] = data.to_string().length();
+}
+BENCHMARK_TEMPLATE(BM_longfist_to_string, Quote);
+BENCHMARK_TEMPLATE(BM_longfist_to_string, Order);
+BENCHMARK_TEMPLATE(BM_longfist_to_string, Trade);
+BENCHMARK_TEMPLATE(BM_longfist_to_string, Position);
+BENCHMARK_TEMPLATE(BM_longfist_to_string, Config);
+BENCHMARK_TEMPLATE(BM_longfist_to_string, TimeKeyValue);
+BENCHMARK_TEMPLATE(BM_longfist_to_string, StrategyStateUpdate);
+BENCHMARK_TEMPLATE(BM_longfist_to_string, Session);
+BENCHMARK_TEMPLATE(BM_longfist_to_string, Register);
+BENCHMARK_TEMPLATE(BM_longfist_to_string, Location);
+BENCHMARK_TEMPLATE(BM_longfist_to_string, Basket);
+
+template <typename DataType> void BM_longfist_parse(benchmark::State &state) {
+  auto text = make_data<DataType>().to_string();
+  for (auto _ : state) {
+    DataType data(text.c_str(), text.length());
+    benchmark::DoNotOptimize(data);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * int64_t(text.length()));
+  state.counters["size"] = text.length();
+}
+BENCHMARK_TEMPLATE(BM_longfist_parse, Quote);
+BENCHMARK_TEMPLATE(BM_longfist_parse, Order);
+BENCHMARK_TEMPLATE(BM_longfist_parse, Trade);
+BENCHMARK_TEMPLATE(BM_longfist_parse, Position);
+BENCHMARK_TEMPLATE(BM_longfist_parse, Config);
+BENCHMARK_TEMPLATE(BM_longfist_parse, TimeKeyValue);
+BENCHMARK_TEMPLATE(BM_longfist_parse, StrategyStateUpdate);
+BENCHMARK_TEMPLATE(BM_longfist_parse, Session);
+BENCHMARK_TEMPLATE(BM_longfist_parse, Register);
+BENCHMARK_TEMPLATE(BM_longfist_parse, Location);
+BENCHMARK_TEMPLATE(BM_longfist_parse, Basket);
+
+/**
+ * Binary encoding written into journal frames for variable-size types, compare with BM_longfist_to_string.
+ */
+template <typename DataType> void BM_longfist_to_bytes(benchmark::State &state) {
+  auto data = make_data<DataType>();
+  std::vector<char> buffer(data.bytes_length());
+  for (auto _ : state) {
+    data.to_bytes(buffer.data());
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["size"] = buffer.size();
+}
+BENCHMARK_TEMPLATE(BM_longfist_to_bytes, Config);
+BENCHMARK_TEMPLATE(BM_longfist_to_bytes, TimeKeyValue);
+BENCHMARK_TEMPLATE(BM_longfist_to_bytes, StrategyStateUpdate);
+BENCHMARK_TEMPLATE(BM_longfist_to_bytes, Session);
+BENCHMARK_TEMPLATE(BM_longfist_to_bytes, Register);
+BENCHMARK_TEMPLATE(BM_longfist_to_bytes, Location);
+BENCHMARK_TEMPLATE(BM_longfist_to_bytes, Basket);
+
+/**
+ * Decoding as frame data<T>() does, compare with BM_longfist_parse.
+ */
+template <typename DataType> void BM_longfist_parse_bytes(benchmark::State &state) {
+  auto bytes = make_data<DataType>().to_bytes();
+  for (auto _ : state) {
+    DataType data(bytes.data(), bytes.length());
+    benchmark::DoNotOptimize(data);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * int64_t(bytes.length()));
+  state.counters["size"] = bytes.length();
+}
+BENCHMARK_TEMPLATE(BM_longfist_parse_bytes, Config);
+BENCHMARK_TEMPLATE(BM_longfist_parse_bytes, TimeKeyValue);
+BENCHMARK_TEMPLATE(BM_longfist_parse_bytes, StrategyStateUpdate);
+BENCHMARK_TEMPLATE(BM_longfist_parse_bytes, Session);
+BENCHMARK_TEMPLATE(BM_longfist_parse_bytes, Register);
+BENCHMARK_TEMPLATE(BM_longfist_parse_bytes, Location);
+BENCHMARK_TEMPLATE(BM_longfist_parse_bytes, Basket);
+} // namespace kungfu::bench
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include "bench.h"
+
+using namespace kungfu::rx;
+using namespace kungfu::longfist::enums;
+using namespace kungfu::longfist::types;
+using namespace kungfu::yijinjing;
+using namespace kungfu::yijinjing::journal;
+using namespace kungfu::yijinjing::practice;
+
+namespace kungfu::bench {
+namespace {
+class bench_hero : public hero {
+public:
+  explicit bench_hero(const yijinjing::data::location_ptr &home) : hero(std::make_shared<io_device>(home, false, true)) {}
+
+  void react() override {}
+
+  void on_active() override {}
+
+  void on_frame() override {}
+};
+
+// msg types handled by a strategy runner with its bookkeeper and broker client
+const int32_t RUNNER_TAGS[] = {
+    Quote::tag,        Tree::tag,         Entrust::tag,          Transaction::tag,       Order::tag,
+    Trade::tag,        Position::tag,     PositionEnd::tag,      Asset::tag,             AssetMargin::tag,
+    Instrument::tag,   InstrumentKey::tag, OrderInput::tag,      OrderInputBatch::tag,   TradingDay::tag,
+    HistoryOrder::tag, HistoryTrade::tag, OrderActionError::tag, BrokerStateUpdate::tag, Deregister::tag,
+    Register::tag,     Location::tag,     Channel::tag,          Band::tag,              RequestReadFrom::tag,
+};
+
+constexpr int64_t REPLAY_FRAMES = 1 << 16;
+
+/**
+ * Record a trading session, mostly quotes with orders, trades and position updates in between.
+ */
+void record_session(const yijinjing::data::location_ptr &location, int64_t frames) {
+  auto w = std::make_shared<writer>(location, 0, true, std::make_shared<null_publisher>());
+  for (int64_t i = 0; i < frames; i++) {
+    if (i % 20 == 0) {
+      w->write(0, Order{});
+    } else if (i % 40 == 1) {
+      w->write(0, Trade{});
+    } else if (i % 100 == 2) {
+      w->write(0, Position{});
+    } else {
+      w->write(0, Quote{});
+    }
+  }
+}
+} // namespace
+
+/**
+ * Table dispatch of one journal frame with handlers registered for the given number of msg types.
+ */
+void BM_hero_dispatch(benchmark::State &state) {
+  auto handled_types = state.range(0);
+  temp_home home;
+  bench_hero h(home.make_location(category::SYSTEM, "bench", "hero"));
+  int64_t handled = 0;
+  for (int32_t i = 0; i < handled_types; i++) {
+    h.handle(BENCH_MSG_TYPE + i, [&](const event_ptr &event) { handled += event->data_length(); });
+  }
+
+  auto w = std::make_shared<writer>(h.get_home(), 0, true, std::make_shared<null_publisher>());
+  Quote quote = {};
+  w->write(0, quote, BENCH_MSG_TYPE + int32_t(handled_types - 1));
+  reader r(true);
+  r.join(h.get_home(), 0, 0);
+  if (not r.data_available()) {
+    state.SkipWithError("frame not found");
+    return;
+  }
+  event_ptr event = r.current_frame();
+  for (auto _ : state) {
+    h.post(event);
+  }
+  benchmark::DoNotOptimize(handled);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_hero_dispatch)->RangeMultiplier(8)->Range(1, 512)->ArgName("types");
+
+/**
+ * Replay of a recorded session journal through handlers of the msg types a strategy runner handles. With table 0 every
+ * event goes through one rx filter per handler as plain events_ | is(...) handlers did, with 1 through the table.
+ */
+void BM_hero_replay(benchmark::State &state) {
+  auto by_table = state.range(0) != 0;
+  temp_home home;
+  bench_hero h(home.make_location(category::SYSTEM, "bench", "replay"));
+  record_session(h.get_home(), REPLAY_FRAMES);
+  rx::subjects::subject<event_ptr> subject;
+  int64_t handled = 0;
+  for (auto tag : RUNNER_TAGS) {
+    auto handler = [&](const event_ptr &event) { handled += event->data_length(); };
+    if (by_table) {
+      h.handle(tag, handler);
+    } else {
+      subject.get_observable() | is(tag) | $(handler);
+    }
+  }
+  auto subscriber = subject.get_subscriber();
+  int64_t frames = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto r = std::make_shared<reader>(true);
+    r->join(h.get_home(), 0, 0);
+    state.ResumeTiming();
+    while (r->data_available()) {
+      auto event = r->current_frame();
+      if (by_table) {
+        h.post(event);
+      } else {
+        subscriber.on_next(event);
+      }
+      r->next();
+      frames++;
+    }
+  }
+  benchmark::DoNotOptimize(handled);
+  state.SetItemsProcessed(frames);
+}
+BENCHMARK(BM_hero_replay)->Arg(0)->Arg(1)->ArgName("table")->Unit(benchmark::kMillisecond);
+
+/**
+ * Timer wheel holding the given number of pending timers, each iteration moves time to the next deadline, expiring
+ * one timer and adding it back a second later.
+ */
+void BM_timer_wheel(benchmark::State &state) {
+  auto pending = state.range(0);
+  timer_wheel wheel;
+  int64_t now = time::now_in_nano();
+  int64_t fired = 0;
+  timer_callback callback = [&](int64_t deadline) {
+    fired++;
+    wheel.add(deadline + time_unit::NANOSECONDS_PER_SECOND, callback);
+  };
+  auto step = time_unit::NANOSECONDS_PER_SECOND / pending;
+  for (int64_t i = 0; i < pending; i++) {
+    wheel.add(now + step * (i + 1), callback);
+  }
+  for (auto _ : state) {
+    now += step;
+    wheel.advance(now);
+  }
+  benchmark::DoNotOptimize(fired);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_timer_wheel)->RangeMultiplier(16)->Range(16, 1 << 20)->ArgName("pending");
+} // namespace kungfu::bench
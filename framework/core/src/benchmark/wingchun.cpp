@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include "bench.h"
+
+#include <kungfu/wingchun/backtest/matchengine.h>
+#include <kungfu/wingchun/book/bookkeeper.h>
+#include <kungfu/wingchun/service/orderbook.h>
+
+using namespace kungfu::longfist::enums;
+using namespace kungfu::longfist::types;
+using namespace kungfu::wingchun;
+using namespace kungfu::wingchun::backtest;
+using namespace kungfu::wingchun::book;
+using namespace kungfu::wingchun::service;
+
+namespace kungfu::bench {
+namespace {
+constexpr int INSTRUMENT_COUNT = 512;
+constexpr int POSITIONS_PER_BOOK = 16;
+
+std::string instrument_id(int i) { return std::to_string(600000 + i); }
+
+Quote make_quote(int i, double price) {
+  Quote quote = {};
+  quote.instrument_id = instrument_id(i).c_str();
+  quote.exchange_id = "SSE";
+  quote.instrument_type = InstrumentType::Stock;
+  quote.last_price = price;
+  for (int level = 0; level < 10; level++) {
+    quote.bid_price[level] = price - 0.01 * (level + 1);
+    quote.ask_price[level] = price + 0.01 * (level + 1);
+    quote.bid_volume[level] = 1000;
+    quote.ask_volume[level] = 1000;
+  }
+  return quote;
+}
+} // namespace
+
+/**
+ * Quote updates to books of the given number of holders, each holding a few of many instruments quoted in turns.
+ */
+void BM_bookkeeper_quote(benchmark::State &state) {
+  auto holder_count = state.range(0);
+  temp_home home;
+  bench_apprentice app(home.make_location(category::STRATEGY, "bench", "bookkeeper"));
+  broker::PassiveClient client(app);
+  Bookkeeper bookkeeper(app, client);
+  for (int64_t h = 0; h < holder_count; h++) {
+    auto location = home.make_location(category::TD, "bench", fmt::format("account{}", h));
+    app.add_location(0, location);
+    auto book = bookkeeper.get_book(location->uid);
+    for (int k = 0; k < POSITIONS_PER_BOOK; k++) {
+      auto &position = book->get_long_position("SSE", instrument_id((h * 7 + k) % INSTRUMENT_COUNT).c_str());
+      position.volume = 100;
+      position.avg_open_price = 10;
+    }
+  }
+  std::vector<Quote> quotes = {};
+  for (int i = 0; i < INSTRUMENT_COUNT; i++) {
+    quotes.push_back(make_quote(i, 10.5));
+  }
+  int64_t i = 0;
+  for (auto _ : state) {
+    bookkeeper.update_book(i, quotes[i % INSTRUMENT_COUNT]);
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_bookkeeper_quote)->RangeMultiplier(4)->Range(1, 1024)->ArgName("holders");
+
+/**
+ * Books of the given number of stock positions carried over to the next day, checked to keep their volume with
+ * yesterday volume rolled to it, next to a position of a type without accounting method carried unrolled.
+ */
+void BM_bookkeeper_carry_over(benchmark::State &state) {
+  auto position_count = state.range(0);
+  temp_home home;
+  bench_apprentice app(home.make_location(category::STRATEGY, "bench", "bookkeeper"));
+  broker::PassiveClient client(app);
+  Bookkeeper bookkeeper(app, client);
+  CommissionMap commissions = {};
+  InstrumentMap instruments = {};
+  auto make_source = [&](const std::string &name, int64_t count, InstrumentType instrument_type) {
+    auto location = home.make_location(category::TD, "bench", name);
+    app.add_location(0, location);
+    Book source(commissions, instruments);
+    source.asset.holder_uid = location->uid;
+    for (int64_t k = 0; k < count; k++) {
+      auto &position = source.get_long_position("SSE", instrument_id(k % INSTRUMENT_COUNT).c_str());
+      position.instrument_type = instrument_type;
+      position.volume = 100 * (k + 1);
+      position.yesterday_volume = 100 * k;
+    }
+    return source;
+  };
+  auto carried = [&](const Book &source, bool rolled) {
+    auto target = bookkeeper.get_book(source.asset.holder_uid);
+    for (const auto &pair : source.long_positions) {
+      auto it = target->long_positions.find(pair.first);
+      auto yesterday_volume = rolled ? pair.second.volume : pair.second.yesterday_volume;
+      if (it == target->long_positions.end() or it->second.volume != pair.second.volume or
+          it->second.yesterday_volume != yesterday_volume) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  auto unrolled = make_source("unrolled", 1, InstrumentType::Unknown);
+  bookkeeper.carry_over(unrolled, yijinjing::time_unit::NANOSECONDS_PER_DAY);
+  if (not carried(unrolled, false)) {
+    state.SkipWithError("position without accounting method not carried as it is");
+    return;
+  }
+
+  auto source = make_source("account", position_count, InstrumentType::Stock);
+  int64_t day = 1;
+  for (auto _ : state) {
+    bookkeeper.carry_over(source, day++ * yijinjing::time_unit::NANOSECONDS_PER_DAY);
+  }
+  if (not carried(source, true)) {
+    state.SkipWithError("carried position lost its volume or yesterday volume");
+    return;
+  }
+  state.SetItemsProcessed(state.iterations() * position_count);
+}
+BENCHMARK(BM_bookkeeper_carry_over)->RangeMultiplier(8)->Range(1, 512)->ArgName("positions");
+
+/**
+ * Orders kept by a book over the given number of earlier orders, each inserted with its input, then updated once.
+ */
+void BM_book_order(benchmark::State &state) {
+  auto order_count = state.range(0);
+  CommissionMap commissions = {};
+  InstrumentMap instruments = {};
+  Book book(commissions, instruments);
+  OrderInput input = {};
+  input.instrument_id = "600000";
+  input.exchange_id = "SSE";
+  input.limit_price = 10;
+  input.volume = 100;
+  Order order = {};
+  order.instrument_id = input.instrument_id;
+  order.exchange_id = input.exchange_id;
+  uint64_t order_id = 0;
+  auto add_order = [&]() {
+    input.order_id = order.order_id = ++order_id;
+    order.status = OrderStatus::Submitted;
+    book.replace(input);
+    book.replace(order);
+  };
+  for (int64_t i = 0; i < order_count; i++) {
+    add_order();
+  }
+  for (auto _ : state) {
+    add_order();
+    order.status = OrderStatus::Pending;
+    book.replace(order);
+    // drop the oldest to keep the book size
+    book.order_inputs.erase(order_id - order_count);
+    book.orders.erase(order_id - order_count);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_book_order)->RangeMultiplier(16)->Range(16, 1 << 20)->ArgName("orders");
+
+/**
+ * Quotes through the backtest match engine with resting orders that never trade.
+ */
+void BM_match_engine_quote(benchmark::State &state) {
+  auto resting_count = state.range(0);
+  int64_t events = 0;
+  MatchEngine engine({}, [&](const event_ptr &event) { events++; });
+  auto quote = make_quote(0, 10.5);
+  engine.on_quote(0, quote);
+  for (int64_t i = 0; i < resting_count; i++) {
+    OrderInput input = {};
+    input.order_id = i + 1;
+    input.instrument_id = quote.instrument_id;
+    input.exchange_id = quote.exchange_id;
+    input.limit_price = 9;
+    input.volume = 100;
+    input.price_type = PriceType::Limit;
+    input.side = Side::Buy;
+    engine.insert_order(0, 1, 2, input);
+  }
+  int64_t time = 1;
+  for (auto _ : state) {
+    quote.volume += 100;
+    engine.on_quote(time++, quote);
+  }
+  benchmark::DoNotOptimize(events);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_match_engine_quote)->RangeMultiplier(8)->Range(1, 4096)->ArgName("resting");
+
+/**
+ * Aggressive orders filled against quote depth, each followed by the quote that refills it.
+ */
+void BM_match_engine_fill(benchmark::State &state) {
+  int64_t events = 0;
+  MatchEngine engine({}, [&](const event_ptr &event) { events++; });
+  auto quote = make_quote(0, 10.5);
+  OrderInput input = {};
+  input.instrument_id = quote.instrument_id;
+  input.exchange_id = quote.exchange_id;
+  input.limit_price = 11;
+  input.volume = state.range(0);
+  input.price_type = PriceType::Limit;
+  input.side = Side::Buy;
+  int64_t time = 0;
+  for (auto _ : state) {
+    engine.on_quote(time, quote);
+    input.order_id = ++time;
+    engine.insert_order(time, 1, 2, input);
+    engine.advance(time);
+  }
+  benchmark::DoNotOptimize(events);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_match_engine_fill)->Arg(100)->Arg(1000)->Arg(5000)->ArgName("volume");
+
+/**
+ * Tick by tick entrusts over a book of the given number of resting orders, each followed by the transaction that
+ * trades or cancels the oldest order, then a snapshot of the book.
+ */
+void BM_orderbook_tick(benchmark::State &state) {
+  auto resting_count = state.range(0);
+  OrderBook book("SZE", "000001");
+  Entrust entrust = {};
+  entrust.price_type = PriceType::Limit;
+  entrust.volume = 100;
+  Transaction transaction = {};
+  transaction.volume = 100;
+  auto add_order = [&]() {
+    entrust.seq++;
+    entrust.side = entrust.seq % 2 == 0 ? Side::Buy : Side::Sell;
+    entrust.price = entrust.side == Side::Buy ? 10 - 0.01 * (entrust.seq % 50) : 10.01 + 0.01 * (entrust.seq % 50);
+    book.apply(entrust);
+  };
+  for (int64_t i = 0; i < resting_count; i++) {
+    add_order();
+  }
+  for (auto _ : state) {
+    add_order();
+    auto oldest = entrust.seq - resting_count;
+    transaction.bid_no = oldest % 2 == 0 ? oldest : 0;
+    transaction.ask_no = oldest % 2 == 0 ? 0 : oldest;
+    transaction.exec_type = oldest % 3 == 0 ? ExecType::Cancel : ExecType::Trade;
+    transaction.price = 10;
+    book.apply(transaction);
+    benchmark::DoNotOptimize(book.snapshot());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_orderbook_tick)->RangeMultiplier(16)->Range(16, 1 << 16)->ArgName("resting");
+} // namespace kungfu::bench
@@ -433,8 +433,8 @@ void Watcher::on_react() {
 }
 
 void Watcher::on_start() {
-  broker_client_.on_start(events_);
-  basketorder_engine_.on_start(events_);
+  broker_client_.on_start();
+  basketorder_engine_.on_start();
   UpdateBasketOrders(); // refresh basketorders
 
   if (not bypass_trading_data_) {
@@ -445,7 +445,7 @@ void Watcher::on_start() {
   }
 
   if (not bypass_trading_data_) {
-    bookkeeper_.on_start(events_);
+    bookkeeper_.on_start();
     bookkeeper_.guard_positions();
     bookkeeper_.add_book_listener(std::make_shared<BookListener>(*this));
 
@@ -579,7 +579,7 @@ void Watcher::UpdateEventCache(const event_ptr &event) {
     using DataType = typename decltype(+boost::hana::second(it))::type;
     if (DataType::tag == request.msg_type) {
       auto hana_type = boost::hana::type_c<DataType>;
-      using DelMap = std::unordered_map<uint64_t, state<DataType>>;
+      using DelMap = longfist::StateMap<DataType>;
       auto &del_map = const_cast<DelMap &>(data_bank_[hana_type]);
       auto iter = del_map.begin();
       while (iter != del_map.end()) {
@@ -746,9 +746,8 @@ void Watcher::UpdateAsset(const event_ptr &event, uint32_t book_uid) {
 
 void Watcher::UpdateBook(const event_ptr &event, const Quote &quote) {
   auto ledger_uid = ledger_home_location_->uid;
-  for (const auto &item : bookkeeper_.get_books()) {
-    auto &book = item.second;
-    auto holder_uid = book->asset.holder_uid;
+  for (auto holder_uid : bookkeeper_.get_position_holders(quote.exchange_id, quote.instrument_id)) {
+    auto book = bookkeeper_.get_book(holder_uid);
 
     if (holder_uid == ledger_uid) {
       continue;
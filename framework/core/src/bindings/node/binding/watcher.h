@@ -308,7 +308,7 @@ private:
   }
 
   template <typename DataType> void UpdateLedger(const boost::hana::basic_type<DataType> &type) {
-    using DataTypeMap = std::unordered_map<uint64_t, state<DataType>>;
+    using DataTypeMap = longfist::StateMap<DataType>;
     auto &target_map = const_cast<DataTypeMap &>(data_bank_[type]);
     auto iter = target_map.begin();
     while (iter != target_map.end() and target_map.size() > 0) {
@@ -319,7 +319,7 @@ private:
   }
 
   template <typename DataType> void UpdateTradingData(const boost::hana::basic_type<DataType> &type) {
-    using DataTypeMap = std::unordered_map<uint64_t, state<DataType>>;
+    using DataTypeMap = longfist::StateMap<DataType>;
     auto &target_map = const_cast<DataTypeMap &>(data_bank_[type]);
     auto iter = target_map.begin();
     auto count = 0;
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef KUNGFU_PY_LONGFIST_DTYPE_HPP
+#define KUNGFU_PY_LONGFIST_DTYPE_HPP
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <unordered_set>
+
+#include <kungfu/longfist/longfist.h>
+
+namespace kungfu::longfist::pybind {
+namespace py = pybind11;
+
+/**
+ * NumPy format of a fixed size member, char arrays are byte strings, enums are stored as their underlying type.
+ */
+template <typename ValueType> std::string dtype_format() {
+  if constexpr (is_array_v<ValueType>) {
+    using ElementType = typename ValueType::element_type;
+    if constexpr (std::is_same_v<ElementType, char>) {
+      return fmt::format("S{}", ValueType::length);
+    } else {
+      return fmt::format("({},){}", ValueType::length, dtype_format<ElementType>());
+    }
+  } else if constexpr (std::is_enum_v<ValueType>) {
+    return dtype_format<std::underlying_type_t<ValueType>>();
+  } else if constexpr (std::is_same_v<ValueType, bool>) {
+    return "?";
+  } else if constexpr (std::is_same_v<ValueType, char>) {
+    return "S1";
+  } else if constexpr (std::is_floating_point_v<ValueType>) {
+    return fmt::format("<f{}", sizeof(ValueType));
+  } else {
+    return fmt::format("<{}{}", std::is_signed_v<ValueType> ? 'i' : 'u', sizeof(ValueType));
+  }
+}
+
+/**
+ * Fields of a structured dtype, in the layout of the packed longfist types.
+ */
+struct dtype_fields {
+  std::vector<std::string> names = {};
+  std::vector<std::string> formats = {};
+  std::vector<size_t> offsets = {};
+
+  template <typename DataType> void add(size_t base_offset, const std::unordered_set<std::string> &only = {}) {
+    static_assert(size_fixed_v<DataType>);
+    DataType probe = {};
+    auto probe_address = reinterpret_cast<const volatile char *>(&probe);
+    boost::hana::for_each(boost::hana::accessors<DataType>(), [&](auto it) {
+      auto name = std::string(boost::hana::first(it).c_str());
+      auto accessor = boost::hana::second(it);
+      auto pointer = member_pointer_trait<decltype(accessor)>().pointer();
+      using ValueType = std::remove_cv_t<std::remove_reference_t<decltype(probe.*pointer)>>;
+      auto taken = std::find(names.begin(), names.end(), name) != names.end();
+      if ((only.empty() or only.count(name) > 0) and not taken) {
+        auto member_address = reinterpret_cast<const volatile char *>(&(probe.*pointer));
+        names.push_back(name);
+        formats.push_back(dtype_format<ValueType>());
+        offsets.push_back(base_offset + (member_address - probe_address));
+      }
+    });
+  }
+
+  [[nodiscard]] py::dtype make(size_t itemsize) const {
+    py::list py_names, py_formats, py_offsets;
+    for (size_t i = 0; i < names.size(); i++) {
+      py_names.append(names[i]);
+      py_formats.append(formats[i]);
+      py_offsets.append(offsets[i]);
+    }
+    return py::dtype(py_names, py_formats, py_offsets, itemsize);
+  }
+};
+
+/**
+ * @return structured dtype of the fixed size DataType, fields named and placed as the members
+ */
+template <typename DataType> py::dtype make_dtype() {
+  dtype_fields fields = {};
+  fields.add<DataType>(0);
+  return fields.make(sizeof(DataType));
+}
+
+/**
+ * @return structured dtype of whole journal frames of DataType, its members followed by gen_time, trigger_time,
+ * source and dest of the frame header, except those the members already name
+ */
+template <typename DataType> py::dtype make_frame_dtype() {
+  dtype_fields fields = {};
+  fields.add<DataType>(sizeof(types::frame_header));
+  fields.add<types::frame_header>(0, {"gen_time", "trigger_time", "source", "dest"});
+  return fields.make(sizeof(types::frame_header) + sizeof(DataType));
+}
+} // namespace kungfu::longfist::pybind
+
+#endif // KUNGFU_PY_LONGFIST_DTYPE_HPP
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "py-longfist.h"
+#include "py-longfist-dtype.h"
 
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
@@ -85,6 +86,10 @@ template <typename DataType> void bind_data_type(pybind11::module &m_types, cons
 
   py_class.def_property_readonly("__uid__", &DataType::uid);
 
+  if constexpr (size_fixed_v<DataType>) {
+    py_class.def_property_readonly_static("__dtype__", [](const py::object &) { return make_dtype<DataType>(); });
+  }
+
   py_class.def("__repr__", &DataType::to_string);
   py_class.def("__hash__", &DataType::uid);
   py_class.def("__eq__", [&](DataType &a, DataType &b) { return a.uid() == b.uid(); });
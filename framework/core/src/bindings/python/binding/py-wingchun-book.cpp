@@ -60,7 +60,10 @@ public:
 void bind_book(pybind11::module &m) {
   py::bind_map<CommissionMap>(m, "CommissionMap");
   py::bind_map<InstrumentMap>(m, "InstrumentMap");
-  py::bind_map<PositionMap>(m, "PositionMap");
+  // positions are added through Book.get_position and friends, which also index them for quotes of the instrument
+  auto position_map = py::bind_map<PositionMap>(m, "PositionMap");
+  py::delattr(position_map, "__setitem__");
+  py::delattr(position_map, "__delitem__");
   py::bind_map<OrderInputMap>(m, "OrderInputMap");
   py::bind_map<OrderMap>(m, "OrderMap");
   py::bind_map<TradeMap>(m, "TradeMap");
@@ -76,12 +79,16 @@ void bind_book(pybind11::module &m) {
       .def_property_readonly("instruments", &Book::get_instruments)
       .def_property_readonly("commissions", &Book::get_commissions)
       .def("update", &Book::update)
+      .def("find_order", &Book::find_order)
+      .def("find_order_input", &Book::find_order_input)
+      .def("find_trades", &Book::find_trades)
+      .def("list_trades", &Book::list_trades)
       .def("has_long_position", &Book::has_long_position)
       .def("has_short_position", &Book::has_short_position)
       .def("has_position", &Book::has_position)
-      .def("get_long_position", &Book::get_long_position)
-      .def("get_short_position", &Book::get_short_position)
-      .def("get_position", &Book::get_position)
+      .def("get_long_position", &Book::get_long_position, py::return_value_policy::reference)
+      .def("get_short_position", &Book::get_short_position, py::return_value_policy::reference)
+      .def("get_position", &Book::get_position, py::return_value_policy::reference)
       .def("has_position_for", py::overload_cast<const Quote &>(&Book::has_position_for<Quote>, py::const_))
       .def("has_position_for", py::overload_cast<const Tree &>(&Book::has_position_for<Tree>, py::const_))
       .def("has_position_for", py::overload_cast<const OrderInput &>(&Book::has_position_for<OrderInput>, py::const_))
@@ -111,6 +118,7 @@ void bind_book(pybind11::module &m) {
       .def("get_book", &Bookkeeper::get_book)
       .def("get_books", &Bookkeeper::get_books)
       .def("set_accounting_method", &Bookkeeper::set_accounting_method)
-      .def("on_trading_day", &Bookkeeper::on_trading_day);
+      .def("on_trading_day", &Bookkeeper::on_trading_day)
+      .def("carry_over", &Bookkeeper::carry_over);
 }
 } // namespace kungfu::wingchun::pybind
\ No newline at end of file
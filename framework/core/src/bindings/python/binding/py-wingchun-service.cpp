@@ -2,7 +2,10 @@
 
 #include "py-wingchun.h"
 
+#include <pybind11/stl.h>
+
 #include <kungfu/wingchun/service/bar.h>
+#include <kungfu/wingchun/service/depth.h>
 #include <kungfu/wingchun/service/ledger.h>
 
 using namespace kungfu::longfist::enums;
@@ -30,5 +33,17 @@ void bind_service(pybind11::module &m) {
   py::class_<BarGenerator, apprentice, std::shared_ptr<BarGenerator>>(m, "BarGenerator")
       .def(py::init<locator_ptr, mode, bool, std::string &>())
       .def("run", &service::BarGenerator::run);
+
+  py::class_<DepthService, apprentice, std::shared_ptr<DepthService>>(m, "DepthService")
+      .def(py::init<locator_ptr, mode, bool, std::string &>())
+      .def_static("get_snapshot_path", &DepthService::get_snapshot_path, py::arg("locator"),
+                  py::arg("mode") = mode::LIVE)
+      .def("run", &DepthService::run);
+
+  py::class_<DepthSnapshot, std::shared_ptr<DepthSnapshot>>(m, "DepthSnapshot")
+      .def(py::init<const std::string &, bool>(), py::arg("path"), py::arg("writing") = false)
+      .def_property_readonly("size", &DepthSnapshot::size)
+      .def_property_readonly("capacity", &DepthSnapshot::capacity)
+      .def("read", &DepthSnapshot::read, py::arg("exchange_id"), py::arg("instrument_id"));
 }
 } // namespace kungfu::wingchun::pybind
\ No newline at end of file
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "py-yijinjing.h"
+#include "py-longfist-dtype.h"
 
 #include <pybind11/stl.h>
 
@@ -11,6 +12,10 @@
 #include <kungfu/yijinjing/journal/assemble.h>
 #include <kungfu/yijinjing/journal/frame.h>
 #include <kungfu/yijinjing/journal/journal.h>
+#include <kungfu/yijinjing/journal/page_archive.h>
+#include <kungfu/yijinjing/journal/page_index.h>
+#include <kungfu/yijinjing/journal/page_policy.h>
+#include <kungfu/yijinjing/journal/page_scanner.h>
 #include <kungfu/yijinjing/log.h>
 #include <kungfu/yijinjing/nanomsg/socket.h>
 #include <kungfu/yijinjing/practice/apprentice.h>
@@ -139,6 +144,21 @@ public:
 
 template <typename DataType> DataType event_to_data(const event &e) { return e.data<DataType>(); }
 
+/**
+ * Frames of DataType in [from_time, end_time) as a NumPy record array of make_frame_dtype, each frame copied once
+ * from the journal page into the array.
+ */
+template <typename DataType>
+py::array assemble_read_array(assemble &a, const DataType &, int64_t from_time, int64_t end_time) {
+  auto dtype = longfist::pybind::make_frame_dtype<DataType>();
+  py::array records;
+  a.copy_frames(DataType::tag, from_time, end_time, dtype.itemsize(), [&](size_t count) {
+    records = py::array(dtype, static_cast<py::ssize_t>(count));
+    return records.mutable_data();
+  });
+  return records;
+}
+
 void bind(pybind11::module &&m) {
   yijinjing::ensure_sqlite_initilize();
 
@@ -150,6 +170,23 @@ void bind(pybind11::module &&m) {
   m.def("strfnow", &time::strfnow, py::arg("format") = KUNGFU_TIMESTAMP_FORMAT);
 
   m.def("get_page_path", &page::get_page_path);
+  m.def("get_page_index_path", &page_index::get_index_path);
+  m.def("rebuild_page_index", &page_index::rebuild);
+  m.def("archive_pages", &page_archive::archive_before, py::arg("location"), py::arg("dest_id"), py::arg("time"),
+        py::arg("block_size") = page_archive::DEFAULT_BLOCK_SIZE);
+  m.def("scan_pages", &page_scanner::scan_all, py::arg("location"), py::arg("dest_id"), py::arg("repair") = false);
+
+  py::class_<page_policy>(m, "page_policy")
+      .def_readonly("page_size", &page_policy::page_size)
+      .def("to_string", &page_policy::to_string)
+      .def("__repr__", &page_policy::to_string);
+  m.def("find_page_policy", &page_policy::find);
+  m.def("parse_page_policy", py::overload_cast<const std::string &, page_policy>(&page_policy::parse),
+        py::arg("setting"), py::arg("base") = page_policy{});
+  m.def("check_page_policy", &page_policy::check, py::arg("setting"));
+  m.def("reload_page_policy", &page_policy::reload);
+  m.def("get_page_policy_location", &page_policy::make_config_location);
+  m.def("get_thread_setting_location", &io_device::make_thread_config_location);
 
   m.def("thread_id", &util::get_thread_id);
   m.def("in_color_terminal", &util::in_color_terminal);
@@ -185,6 +222,24 @@ void bind(pybind11::module &&m) {
     event_class.def(boost::hana::first(pair).c_str(), &event_to_data<DataType>);
   });
 
+  py::class_<archive_stats>(m, "archive_stats")
+      .def_readonly("pages", &archive_stats::pages)
+      .def_readonly("page_bytes", &archive_stats::page_bytes)
+      .def_readonly("content_bytes", &archive_stats::content_bytes)
+      .def_readonly("archived_bytes", &archive_stats::archived_bytes)
+      .def_property_readonly("ratio", &archive_stats::ratio)
+      .def_property_readonly("read_throughput", &archive_stats::read_throughput);
+
+  py::class_<page_scan>(m, "page_scan")
+      .def_readonly("page_id", &page_scan::page_id)
+      .def_readonly("frames", &page_scan::frames)
+      .def_readonly("end_position", &page_scan::end_position)
+      .def_readonly("last_frame_position", &page_scan::last_frame_position)
+      .def_readonly("sealed", &page_scan::sealed)
+      .def_readonly("damaged", &page_scan::damaged)
+      .def_readonly("repaired", &page_scan::repaired)
+      .def_readonly("error", &page_scan::error);
+
   py::class_<frame, event, frame_ptr>(m, "frame")
       .def_property_readonly("frame_length", &frame::frame_length)
       .def("has_data", &frame::has_data);
@@ -237,6 +292,7 @@ void bind(pybind11::module &&m) {
 
   py::class_<observer, PyObserver, observer_ptr>(m, "observer")
       .def("wait", &observer::wait)
+      .def("set_timeout", &observer::set_timeout, py::arg("timeout"))
       .def("get_notice", &observer::get_notice);
 
   py::class_<reader, reader_ptr>(m, "reader")
@@ -304,6 +360,10 @@ void bind(pybind11::module &&m) {
                        py::arg("data") = DataType{}, py::arg("end_time") = INT64_MAX, py::return_value_policy::move);
     assemble_class.def("read_bytes", py::overload_cast<const DataType &, int64_t>(&assemble::read_bytes<DataType>),
                        py::arg("data") = DataType{}, py::arg("end_time") = INT64_MAX, py::return_value_policy::move);
+    if constexpr (size_fixed_v<DataType>) {
+      assemble_class.def("read_array", &assemble_read_array<DataType>, py::arg("data"), py::arg("from_time") = 0,
+                         py::arg("end_time") = INT64_MAX);
+    }
   });
 
   py::class_<io_device, io_device_ptr>(m, "io_device")
@@ -340,7 +400,7 @@ void bind(pybind11::module &&m) {
 
   py::class_<session_builder, session_finder, std::shared_ptr<session_builder>>(m, "session_builder")
       .def(py::init<io_device_ptr>())
-      .def("rebuild_index_db", &session_builder::rebuild_index_db);
+      .def("rebuild_index_db", &session_builder::rebuild_index_db, py::arg("full") = false);
 
   auto profile_class = py::class_<profile, std::shared_ptr<profile>>(m, "profile");
   profile_class.def(py::init<const locator_ptr &>());
@@ -7,6 +7,7 @@
 #ifndef KUNGFU_COMMON_H
 #define KUNGFU_COMMON_H
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <sstream>
@@ -65,7 +66,7 @@ using namespace boost::hana::literals;
     static constexpr bool has_timestamp = boost::hana::is_just(TIMESTAMP_KEY);                                         \
     static constexpr bool has_data = true;                                                                             \
     NAME(){};                                                                                                          \
-    explicit NAME(const char *address, const uint32_t length) { parse(address, length); };                             \
+    explicit NAME(const char *address, const uint32_t length) { parse_bytes(address, length); };                       \
     explicit NAME(const std::string &text) : NAME(text.c_str(), text.length()){};                                      \
     BOOST_HANA_DEFINE_STRUCT(NAME, __VA_ARGS__);                                                                       \
   }
@@ -317,6 +318,11 @@ template <typename T, typename... Ts> constexpr bool type_belong_to() {
   return boost::hana::fold(check, std::logical_or<>());
 }
 
+/**
+ * Leading byte of binary encoded data, JSON text never starts with a byte below 0x20.
+ */
+static constexpr char DATA_BYTES_VERSION = 1;
+
 template <typename DataType> struct data {
   static constexpr bool reflect = true;
 
@@ -352,6 +358,53 @@ template <typename DataType> struct data {
 
   explicit operator std::string() const { return to_string(); }
 
+  /**
+   * Length of the binary encoding: version byte, then members in declaration order, numbers and arrays as raw bytes,
+   * strings as uint32 length followed by chars.
+   */
+  [[nodiscard]] uint32_t bytes_length() const {
+    uint32_t length = sizeof(DATA_BYTES_VERSION);
+    boost::hana::for_each(boost::hana::accessors<DataType>(), [&, this](auto it) {
+      auto accessor = boost::hana::second(it);
+      length += member_bytes_length(accessor(*reinterpret_cast<const DataType *>(this)));
+    });
+    return length;
+  }
+
+  /**
+   * Encode into address, which must have room for bytes_length().
+   */
+  void to_bytes(char *address) const {
+    *address++ = DATA_BYTES_VERSION;
+    boost::hana::for_each(boost::hana::accessors<DataType>(), [&, this](auto it) {
+      auto accessor = boost::hana::second(it);
+      write_member(address, accessor(*reinterpret_cast<const DataType *>(this)));
+    });
+  }
+
+  [[nodiscard]] std::string to_bytes() const {
+    std::string bytes(bytes_length(), '\0');
+    to_bytes(bytes.data());
+    return bytes;
+  }
+
+  /**
+   * Restore from binary encoding, falls back to JSON for content not led by the version byte, e.g. frames written by
+   * earlier versions or messages from nanomsg.
+   */
+  void parse_bytes(const char *address, const uint32_t length) {
+    if (length == 0 or *address != DATA_BYTES_VERSION) {
+      parse(address, length);
+      return;
+    }
+    auto end = address + length;
+    address++;
+    boost::hana::for_each(boost::hana::accessors<DataType>(), [&, this](auto it) {
+      auto accessor = boost::hana::second(it);
+      read_member(address, end, accessor(*const_cast<DataType *>(reinterpret_cast<const DataType *>(this))));
+    });
+  }
+
   [[nodiscard]] uint64_t uid() const {
     auto primary_keys = boost::hana::transform(DataType::primary_keys, [this](auto pk) {
       auto just = boost::hana::find_if(boost::hana::accessors<DataType>(),
@@ -368,6 +421,55 @@ private:
 
   template <typename V> static std::enable_if_t<not is_numeric_v<V>> init_member(V &) {}
 
+  template <typename V>
+  static std::enable_if_t<is_numeric_v<V> or is_array_v<V>, uint32_t> member_bytes_length(const V &) {
+    return sizeof(V);
+  }
+
+  static uint32_t member_bytes_length(const std::string &v) { return sizeof(uint32_t) + v.length(); }
+
+  template <typename V>
+  static std::enable_if_t<is_numeric_v<V> or is_array_v<V>> write_member(char *&address, const V &v) {
+    memcpy(address, const_cast<const std::remove_volatile_t<V> *>(&v), sizeof(V)); // frame_header has volatile members
+    address += sizeof(V);
+  }
+
+  static void write_member(char *&address, const std::string &v) {
+    uint32_t length = v.length();
+    memcpy(address, &length, sizeof(length));
+    memcpy(address + sizeof(length), v.data(), length);
+    address += sizeof(length) + length;
+  }
+
+  template <typename V>
+  static std::enable_if_t<is_numeric_v<V>> read_member(const char *&address, const char *end, V &v) {
+    check_bytes(address, end, sizeof(V));
+    memcpy(const_cast<std::remove_volatile_t<V> *>(&v), address, sizeof(V)); // frame_header has volatile members
+    address += sizeof(V);
+  }
+
+  template <typename V> static std::enable_if_t<is_array_v<V>> read_member(const char *&address, const char *end, V &v) {
+    check_bytes(address, end, sizeof(v.value));
+    memcpy(v.value, address, sizeof(v.value)); // kungfu::array is not trivially assignable, copy into its storage
+    address += sizeof(v.value);
+  }
+
+  static void read_member(const char *&address, const char *end, std::string &v) {
+    uint32_t length = 0;
+    check_bytes(address, end, sizeof(length));
+    memcpy(&length, address, sizeof(length));
+    address += sizeof(length);
+    check_bytes(address, end, length);
+    v.assign(address, length);
+    address += length;
+  }
+
+  static void check_bytes(const char *address, const char *end, size_t length) {
+    if (end - address < static_cast<std::ptrdiff_t>(length)) {
+      throw std::runtime_error(fmt::format("truncated bytes for {}", DataType::type_name.c_str()));
+    }
+  }
+
   template <typename J, typename V>
   static std::enable_if_t<std::is_arithmetic_v<V> or is_array_of_others_v<V, char>> restore_from_json(J &j, V &v) {
     v = j;
@@ -443,6 +545,55 @@ template <typename DataType> struct typed_event_ptr {
   const event_ptr &operator->() const { return event; }
 };
 
+/**
+ * Element at index of an event whose data is an array of DataType, such as a batch of order inputs, seen as an event
+ * of DataType alone, so that handlers of DataType events take it as is.
+ */
+template <typename DataType> struct element_event : public event {
+  element_event(event_ptr array, uint32_t index) : array_(std::move(array)), index_(index) {}
+
+  [[nodiscard]] int64_t gen_time() const override { return array_->gen_time(); }
+
+  [[nodiscard]] int64_t trigger_time() const override { return array_->trigger_time(); }
+
+  [[nodiscard]] int32_t msg_type() const override { return DataType::tag; }
+
+  [[nodiscard]] uint32_t source() const override { return array_->source(); }
+
+  [[nodiscard]] uint32_t dest() const override { return array_->dest(); }
+
+  [[nodiscard]] uint32_t data_length() const override { return sizeof(DataType); }
+
+  [[nodiscard]] const void *data_address() const override { return data_as_bytes(); }
+
+  [[nodiscard]] const char *data_as_bytes() const override {
+    return array_->data_as_bytes() + sizeof(DataType) * index_;
+  }
+
+  [[nodiscard]] std::string data_as_string() const override { return std::string(data_as_bytes(), data_length()); }
+
+  [[nodiscard]] std::string to_string() const override { return data<DataType>().to_string(); }
+
+private:
+  const event_ptr array_;
+  const uint32_t index_;
+};
+
+/**
+ * Call handler with an element_event for each DataType in the array carried by event.
+ * Elements left all zero are skipped, writer zeroes the ones not written when the array frame can not shrink.
+ */
+template <typename DataType, typename Handler> void for_each_element(const event_ptr &event, Handler &&handler) {
+  auto count = event->data_length() / sizeof(DataType);
+  for (uint32_t index = 0; index < count; index++) {
+    auto bytes = event->data_as_bytes() + sizeof(DataType) * index;
+    if (std::all_of(bytes, bytes + sizeof(DataType), [](char byte) { return byte == 0; })) {
+      continue;
+    }
+    handler(event_ptr(std::make_shared<element_event<DataType>>(event, index)));
+  }
+}
+
 template <typename DataType> struct state {
   uint32_t source;
   uint32_t dest;
@@ -8,6 +8,7 @@
 #define KUNGFU_LONGFIST_H
 
 #include "kungfu/yijinjing/cache/ringqueue.h"
+#include "kungfu/yijinjing/util/flat_map.h"
 #include <kungfu/longfist/types.h>
 #include <unordered_set>
 
@@ -52,6 +53,7 @@ constexpr auto AllTypes = boost::hana::make_map( //
     TYPE_PAIR(StrategyStateUpdate),              //
     TYPE_PAIR(Commission),                       //
     TYPE_PAIR(Session),                          //
+    TYPE_PAIR(JournalIndex),                     //
     TYPE_PAIR(Location),                         //
     TYPE_PAIR(Register),                         //
     TYPE_PAIR(Deregister),                       //
@@ -159,7 +161,8 @@ constexpr auto ProfileDataTypes = boost::hana::make_map( //
 );
 
 constexpr auto SessionDataTypes = boost::hana::make_map( //
-    TYPE_PAIR(Session)                                   //
+    TYPE_PAIR(Session),                                  //
+    TYPE_PAIR(JournalIndex)                              //
 );
 
 constexpr auto StateDataTypes = boost::hana::make_map( //
@@ -214,10 +217,13 @@ constexpr auto build_data_map = [](auto types) {
   return boost::hana::unpack(maps, boost::hana::make_map);
 };
 
+// key = uid of data
+template <typename DataType> using StateMap = yijinjing::util::flat_map<uint64_t, state<DataType>>;
+
 constexpr auto build_state_map = [](auto types) {
   auto maps = boost::hana::transform(boost::hana::values(types), [](auto value) {
     using DataType = typename decltype(+value)::type;
-    return boost::hana::make_pair(value, std::unordered_map<uint64_t, state<DataType>>());
+    return boost::hana::make_pair(value, StateMap<DataType>());
   });
   return boost::hana::unpack(maps, boost::hana::make_map);
 };
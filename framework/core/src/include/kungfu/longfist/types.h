@@ -26,6 +26,7 @@ KF_DEFINE_MARK_TYPE(SessionStart, 10001);
 KF_DEFINE_MARK_TYPE(SessionEnd, 10002);
 KF_DEFINE_MARK_TYPE(BatchOrderBegin, 10016);
 KF_DEFINE_MARK_TYPE(BatchOrderEnd, 10017);
+KF_DEFINE_MARK_TYPE(OrderInputBatch, 10018); // frame data is an array of OrderInput, see writer::open_array
 KF_DEFINE_MARK_TYPE(Time, 10003);
 KF_DEFINE_MARK_TYPE(Ping, 10008);
 KF_DEFINE_MARK_TYPE(Pong, 10009);
@@ -140,6 +141,15 @@ KF_DEFINE_DATA_TYPE(                                                     //
     (uint64_t, data_size)                                                //
 );
 
+KF_DEFINE_DATA_TYPE(                                             //
+    JournalIndex, 10019, PK(location_uid, dest_id), PERPETUAL(), //
+    (uint32_t, location_uid),                                    //
+    (uint32_t, dest_id),                                         //
+    (uint32_t, page_id),                                         // 最后索引的页
+    (int64_t, last_time),                                        // 最后索引的帧时间
+    (uint32_t, last_time_frames)                                 // last_time 时刻已索引的帧数
+);
+
 KF_DEFINE_DATA_TYPE(                                //
     Register, 10011, PK(location_uid), PERPETUAL(), //
     (uint32_t, location_uid),                       //
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef WINGCHUN_BACKTEST_MATCHENGINE_H
+#define WINGCHUN_BACKTEST_MATCHENGINE_H
+
+#include <queue>
+
+#include <kungfu/common.h>
+#include <kungfu/longfist/longfist.h>
+#include <kungfu/wingchun/common.h>
+
+namespace kungfu::wingchun::backtest {
+
+/**
+ * Event made in process by the match engine, carries a copy of its data instead of pointing into a journal frame.
+ */
+template <typename DataType> class SimulatedEvent : public event {
+public:
+  SimulatedEvent(int64_t gen_time, uint32_t source, uint32_t dest, const DataType &data)
+      : gen_time_(gen_time), source_(source), dest_(dest), data_(data) {}
+
+  [[nodiscard]] int64_t gen_time() const override { return gen_time_; }
+
+  [[nodiscard]] int64_t trigger_time() const override { return gen_time_; }
+
+  [[nodiscard]] int32_t msg_type() const override { return DataType::tag; }
+
+  [[nodiscard]] uint32_t source() const override { return source_; }
+
+  [[nodiscard]] uint32_t dest() const override { return dest_; }
+
+  [[nodiscard]] uint32_t data_length() const override { return sizeof(DataType); }
+
+  [[nodiscard]] const void *data_address() const override { return &data_; }
+
+  [[nodiscard]] const char *data_as_bytes() const override { return reinterpret_cast<const char *>(&data_); }
+
+  [[nodiscard]] std::string data_as_string() const override { return data_.to_string(); }
+
+  [[nodiscard]] std::string to_string() const override { return data_.to_string(); }
+
+private:
+  const int64_t gen_time_;
+  const uint32_t source_;
+  const uint32_t dest_;
+  const DataType data_;
+};
+
+enum class QueueModel : int8_t {
+  Optimistic,  // resting orders fill as soon as the market trades at their price
+  Conservative // resting orders wait behind the volume shown at their price when they were accepted
+};
+
+struct MatchSettings {
+  int64_t insert_latency = 0; // nanoseconds for an order to reach the simulated exchange
+  int64_t cancel_latency = 0; // nanoseconds for a cancel to reach the simulated exchange
+  QueueModel queue_model = QueueModel::Conservative;
+};
+
+/**
+ * Simulated exchange matching strategy orders against market data, L1 or the 10 levels depth of Quote.
+ * Time only moves forward with the market data fed in, so results are the same for every run over the same data.
+ * Order and Trade updates are handed to sink as events from the account location to the strategy.
+ */
+class MatchEngine {
+public:
+  typedef std::function<void(const event_ptr &)> Sink;
+
+  MatchEngine(MatchSettings settings, Sink sink);
+
+  virtual ~MatchEngine() = default;
+
+  void insert_order(int64_t trigger_time, uint32_t source, uint32_t dest, const longfist::types::OrderInput &input);
+
+  void cancel_order(int64_t trigger_time, uint32_t source, uint32_t dest, const longfist::types::OrderAction &action);
+
+  /**
+   * Release orders and cancels arrived at the simulated exchange by given time.
+   * @param time simulated time in nano seconds
+   */
+  void advance(int64_t time);
+
+  void on_quote(int64_t time, const longfist::types::Quote &quote);
+
+  void on_transaction(int64_t time, const longfist::types::Transaction &transaction);
+
+  [[nodiscard]] const MatchSettings &get_settings() const { return settings_; }
+
+private:
+  struct Request {
+    int64_t arrive_time;
+    uint64_t seq;
+    uint32_t source;
+    uint32_t dest;
+    bool is_cancel;
+    longfist::types::OrderInput input;
+    longfist::types::OrderAction action;
+  };
+
+  struct RequestLater {
+    bool operator()(const Request &a, const Request &b) const {
+      return a.arrive_time > b.arrive_time or (a.arrive_time == b.arrive_time and a.seq > b.seq);
+    }
+  };
+
+  struct RestingOrder {
+    longfist::types::Order order = {};
+    uint32_t source = 0;
+    uint32_t dest = 0;
+    bool is_buy = false;
+    int64_t queue_ahead = 0; // volume at the same price to trade before this order
+  };
+
+  struct InstrumentBook {
+    longfist::types::Quote quote = {};
+    bool has_quote = false;
+    bool has_transaction = false;
+    std::vector<uint64_t> resting = {}; // order ids in arrival order
+  };
+
+  const MatchSettings settings_;
+  const Sink sink_;
+  std::priority_queue<Request, std::vector<Request>, RequestLater> requests_;
+  uint64_t request_seq_ = 0;
+  uint64_t trade_seq_ = 0;
+  int64_t now_ = 0;
+  bool busy_ = false;
+  std::unordered_map<uint64_t, RestingOrder> orders_ = {}; // key = order_id
+  std::unordered_map<uint32_t, InstrumentBook> books_ = {}; // key = hash_instrument(exchange_id, instrument_id)
+
+  void accept(int64_t time, const Request &request);
+
+  void cancel(int64_t time, const Request &request);
+
+  void take(int64_t time, InstrumentBook &book, RestingOrder &resting, int depth, bool passive);
+
+  void fill(int64_t time, RestingOrder &resting, double price, int64_t volume);
+
+  void update(int64_t time, RestingOrder &resting, longfist::enums::OrderStatus status);
+
+  void reject(int64_t time, RestingOrder &resting, const std::string &error_msg);
+
+  void match_resting(int64_t time, InstrumentBook &book, double trade_price, int64_t trade_volume);
+
+  void remove_finished(InstrumentBook &book);
+
+  [[nodiscard]] static int64_t shown_volume(const longfist::types::Quote &quote, bool is_buy, double price);
+};
+DECLARE_PTR(MatchEngine)
+} // namespace kungfu::wingchun::backtest
+
+#endif // WINGCHUN_BACKTEST_MATCHENGINE_H
@@ -25,7 +25,7 @@ public:
 
   virtual ~BasketOrderEngine() = default;
 
-  void on_start(const rx::connectable_observable<event_ptr> &events);
+  void on_start();
 
   void restore(const yijinjing::cache::bank &state_bank);
 
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef WINGCHUN_ARCHIVE_H
+#define WINGCHUN_ARCHIVE_H
+
+#include <fstream>
+#include <mutex>
+#include <optional>
+
+#include <kungfu/longfist/longfist.h>
+#include <kungfu/wingchun/common.h>
+
+namespace kungfu::wingchun::book {
+FORWARD_DECLARE_CLASS_PTR(OrderArchive)
+
+/**
+ * Append-only file of finished orders moved out of books, with their inputs and trades.
+ * Records are the raw bytes of the fixed-size longfist types, memory holds only an index of file offsets by holder_uid
+ * of the book and order_id. Later records of an order win.
+ * The file is kept across restarts, the index is loaded from it when opened.
+ * Bookkeeper keeps one file per trading day and opens the one of the new day when the day switches, so that orders of
+ * past days neither stay in memory nor shadow new orders taking the same order_id.
+ * Shared by all books of a Bookkeeper, which are updated under locks of their own, so every call is serialized.
+ */
+class OrderArchive {
+public:
+  explicit OrderArchive(const std::string &path);
+
+  /**
+   * Switch to the file at path, the index of the current file is dropped, nothing is done if it is open already.
+   */
+  void open(const std::string &path);
+
+  [[nodiscard]] const std::string &get_path() const;
+
+  /**
+   * Archive a finished order of the book of holder_uid together with its input, if any, and trades.
+   */
+  void archive(uint32_t holder_uid, const longfist::types::OrderInput *input, const longfist::types::Order &order,
+               const std::vector<const longfist::types::Trade *> &trades);
+
+  /**
+   * Append an update of an archived order.
+   */
+  void append(uint32_t holder_uid, const longfist::types::Order &order);
+
+  /**
+   * Append a trade of an archived order, arrived after the order has been moved out, unless archived already.
+   */
+  void append(uint32_t holder_uid, const longfist::types::Trade &trade);
+
+  [[nodiscard]] bool has_order(uint32_t holder_uid, uint64_t order_id) const;
+
+  [[nodiscard]] std::optional<longfist::types::Order> get_order(uint32_t holder_uid, uint64_t order_id);
+
+  [[nodiscard]] std::optional<longfist::types::OrderInput> get_order_input(uint32_t holder_uid, uint64_t order_id);
+
+  /**
+   * @return trades of the order in the order they were archived
+   */
+  [[nodiscard]] std::vector<longfist::types::Trade> get_trades(uint32_t holder_uid, uint64_t order_id);
+
+  /**
+   * @return trades of all archived orders of the book of holder_uid
+   */
+  [[nodiscard]] std::vector<longfist::types::Trade> get_trades(uint32_t holder_uid);
+
+  [[nodiscard]] size_t size() const;
+
+private:
+  struct record_header {
+    int32_t msg_type;
+    uint32_t length;
+    uint32_t holder_uid;
+    uint32_t reserved;
+    int64_t previous; // offset of the previous trade of the same order, -1 for none
+  };
+
+  struct entry {
+    int64_t input = -1;
+    int64_t order = -1;
+    int64_t last_trade = -1;
+  };
+
+  typedef yijinjing::util::flat_map<uint64_t, entry> EntryMap;
+
+  mutable std::mutex mutex_ = {};
+  std::string path_ = {};
+  std::fstream file_;
+  int64_t end_ = 0;
+  yijinjing::util::flat_map<uint32_t, EntryMap> index_ = {};
+
+  [[nodiscard]] const entry *find(uint32_t holder_uid, uint64_t order_id) const;
+
+  [[nodiscard]] std::vector<longfist::types::Trade> read_trades(const entry *e);
+
+  /** build index_ from records in file, a torn record at the end and anything behind it is cut off */
+  void load(const std::string &path);
+
+  template <typename DataType> int64_t write(uint32_t holder_uid, const DataType &data, int64_t previous = -1);
+
+  template <typename DataType> DataType read(int64_t offset, int64_t *previous = nullptr);
+};
+} // namespace kungfu::wingchun::book
+
+#endif // WINGCHUN_ARCHIVE_H
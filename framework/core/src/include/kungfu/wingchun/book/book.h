@@ -7,7 +7,12 @@
 #ifndef WINGCHUN_BOOK_H
 #define WINGCHUN_BOOK_H
 
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+
 #include <kungfu/longfist/longfist.h>
+#include <kungfu/wingchun/book/archive.h>
 #include <kungfu/wingchun/common.h>
 
 namespace kungfu::wingchun::book {
@@ -21,16 +26,33 @@ typedef std::unordered_map<uint32_t, longfist::types::Commission> CommissionMap;
 typedef std::unordered_map<uint32_t, longfist::types::Instrument> InstrumentMap;
 
 // key = hash_instrument(exchange_id, instrument_id)
-typedef std::unordered_map<uint32_t, longfist::types::Position> PositionMap;
+typedef yijinjing::util::flat_map<uint32_t, longfist::types::Position> PositionMap;
+
+/**
+ * holder_uid of books having positions for an instrument, key = hash_instrument(exchange_id, instrument_id).
+ * Holders are handed out as a copy taken under a reader lock, quotes of different books do not wait for each other.
+ */
+class PositionIndex {
+public:
+  void add(uint32_t instrument_key, uint32_t holder_uid);
+
+  void remove(uint32_t instrument_key, uint32_t holder_uid);
+
+  [[nodiscard]] std::vector<uint32_t> get_holders(uint32_t instrument_key) const;
+
+private:
+  mutable std::shared_mutex mutex_ = {};
+  std::unordered_map<uint32_t, std::unordered_set<uint32_t>> holders_ = {};
+};
 
 // key = order_id
-typedef std::unordered_map<uint64_t, longfist::types::OrderInput> OrderInputMap;
+typedef yijinjing::util::flat_map<uint64_t, longfist::types::OrderInput> OrderInputMap;
 
 // key = order_id
-typedef std::unordered_map<uint64_t, longfist::types::Order> OrderMap;
+typedef yijinjing::util::flat_map<uint64_t, longfist::types::Order> OrderMap;
 
 // key = trade_id
-typedef std::unordered_map<uint64_t, longfist::types::Trade> TradeMap;
+typedef yijinjing::util::flat_map<uint64_t, longfist::types::Trade> TradeMap;
 
 struct Book {
   const CommissionMap &commissions;
@@ -42,6 +64,11 @@ struct Book {
   OrderInputMap order_inputs = {};
   OrderMap orders = {};
   TradeMap trades = {};
+  PositionIndex *position_index = nullptr;
+  OrderArchive *order_archive = nullptr;
+  std::deque<std::pair<int64_t, uint64_t>> finished_orders = {}; // (update_time, order_id) in finishing order
+  yijinjing::util::flat_map<uint64_t, std::vector<uint64_t>> order_trades = {}; // trade_ids by order_id, for archiving
+  std::mutex update_mutex = {}; // taken by Bookkeeper while it applies data to this book
 
   Book(const CommissionMap &commissions_ref, const InstrumentMap &instruments_ref);
 
@@ -113,8 +140,30 @@ struct Book {
 
   void replace(const longfist::types::Trade &trade);
 
+  /**
+   * Move finished orders, with their inputs and trades, from the live maps to order_archive once more than max_count
+   * of them are kept or they finished max_age nanoseconds before now, zero disables the limit.
+   */
+  void retain_orders(int64_t now, size_t max_count, int64_t max_age);
+
+  /**
+   * Order kept either in orders or in order_archive, inputs and trades are looked up alike below.
+   */
+  [[nodiscard]] std::optional<longfist::types::Order> find_order(uint64_t order_id) const;
+
+  [[nodiscard]] std::optional<longfist::types::OrderInput> find_order_input(uint64_t order_id) const;
+
+  [[nodiscard]] std::vector<longfist::types::Trade> find_trades(uint64_t order_id) const;
+
+  /**
+   * All trades of the book, the ones in order_archive first.
+   */
+  [[nodiscard]] std::vector<longfist::types::Trade> list_trades() const;
+
   void mirror_position_from(const Book &book);
 
+  void clear_positions();
+
   [[nodiscard]] const InstrumentMap &get_instruments() const { return instruments; }
 
   [[nodiscard]] const CommissionMap &get_commissions() const { return commissions; }
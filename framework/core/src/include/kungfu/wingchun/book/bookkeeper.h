@@ -41,19 +41,35 @@ public:
 
   void drop_book(uint32_t uid);
 
-  [[nodiscard]] const BookMap &get_books() const;
+  /**
+   * Books by location uid, copied under the reader lock of the map so that callers can iterate while books are added
+   * or dropped, the books themselves are shared.
+   */
+  [[nodiscard]] BookMap get_books() const;
+
+  /**
+   * Location uids of books having long or short positions for the instrument, copied when called.
+   */
+  [[nodiscard]] std::vector<uint32_t> get_position_holders(const char *exchange_id, const char *instrument_id) const;
 
   void set_accounting_method(longfist::enums::InstrumentType instrument_type,
                              const AccountingMethod_ptr &accounting_method);
 
   void on_trading_day(int64_t daytime);
 
-  void on_start(const rx::connectable_observable<event_ptr> &events);
+  void on_start();
 
   void on_order_input(int64_t update_time, uint32_t source, uint32_t dest, const longfist::types::OrderInput &input);
 
   void restore(const yijinjing::cache::bank &state_bank);
 
+  /**
+   * Carry asset and positions of a book over to the trading day of daytime, such as the end of day book of the day
+   * before in a multi-day backtest. Positions are rolled to the new day by the accounting methods of their types,
+   * positions of types without a method are carried as they are.
+   */
+  void carry_over(const Book &book, int64_t daytime);
+
   void guard_positions();
 
   void update_book(const event_ptr &event, const longfist::types::InstrumentKey &instrument_key);
@@ -74,8 +90,6 @@ public:
 
   [[nodiscard]] bool is_sync_position() const;
 
-  std::mutex &get_update_book_mutex();
-
   template <typename TradingData, typename ApplyMethod = void (AccountingMethod::*)(Book_ptr, const TradingData &)>
   void update_book(const event_ptr &event, ApplyMethod method) {
     update_book(event->gen_time(), event->source(), event->dest(), event->data<TradingData>(), method);
@@ -83,8 +97,6 @@ public:
 
   template <typename TradingData, typename ApplyMethod = void (AccountingMethod::*)(Book_ptr, const TradingData &)>
   void update_book(int64_t update_time, uint32_t source, uint32_t dest, const TradingData &data, ApplyMethod method) {
-    std::lock_guard<std::mutex> lock(update_book_mutex_);
-
     if (accounting_methods_.find(data.instrument_type) == accounting_methods_.end()) {
       SPDLOG_WARN("accounting method not found for {}: {}", data.type_name.c_str(), data.to_string());
       return;
@@ -92,11 +104,13 @@ public:
     AccountingMethod &accounting_method = *accounting_methods_.at(data.instrument_type);
     auto apply_and_update = [&](uint32_t book_uid) {
       auto book = get_book(book_uid);
+      std::lock_guard<std::mutex> lock(book->update_mutex);
       auto &position = book->get_position_for(data);
       (accounting_method.*method)(book, data);
       position.update_time = update_time;
       book->replace(data);
       book->update(update_time);
+      book->retain_orders(update_time, retain_orders_, retain_time_);
     };
     apply_and_update(source);
     if (dest != yijinjing::data::location::PUBLIC) {
@@ -108,10 +122,7 @@ public:
   template <typename T, typename RouteA = void (Bookkeeper::*)(const T &),
             typename RouteB = void (Bookkeeper::*)(const T &)>
   constexpr decltype(auto) fork(uint32_t dest, RouteA t1, RouteB t2) {
-    return kungfu::rx::$([&, dest, t1, t2](const event_ptr &event) {
-      if (event->msg_type() != T::tag) {
-        return;
-      }
+    return [&, dest, t1, t2](const event_ptr &event) {
       if (event->dest() == dest) {
         auto &data = event->data<T>();
         (this->*t1)(data);
@@ -119,7 +130,7 @@ public:
         auto &data = event->data<T>();
         (this->*t2)(data);
       }
-    });
+    };
   }
 
 private:
@@ -128,20 +139,26 @@ private:
   const bool bypass_quote_;
   QuoteMap quotes_;
 
-  std::mutex update_book_mutex_;
+  mutable std::shared_mutex books_mutex_; // guards books_ only, data is applied to a book under its update_mutex
   bool positions_guarded_ = false;
   CommissionMap commissions_ = {};
   InstrumentMap instruments_ = {};
   BookMap books_ = {};
+  PositionIndex position_index_ = {};
   AccountingMethodMap accounting_methods_ = {};
   std::vector<BookListener_ptr> book_listeners_ = {};
   BookMap books_replica_ = {}; // 暂存从location::SYNC传来的asset和position信息
   bool sync_asset_{};
   bool sync_asset_margin_{};
   bool sync_position_{};
+  OrderArchive_ptr order_archive_ = {};
+  size_t retain_orders_ = 0;
+  int64_t retain_time_ = 0;
 
   Book_ptr make_book(uint32_t location_uid);
 
+  [[nodiscard]] std::string get_archive_path(int64_t daytime) const;
+
   void batch_update_book_by_quote();
 
   void update_instrument(const longfist::types::Instrument &instrument);
@@ -110,7 +110,7 @@ public:
 
   [[maybe_unused]] virtual bool try_sync(int64_t trigger_time, const yijinjing::data::location_ptr &td_location);
 
-  virtual void on_start(const rx::connectable_observable<event_ptr> &events);
+  virtual void on_start();
 
   [[nodiscard]] virtual bool should_connect_md(const yijinjing::data::location_ptr &md_location) const = 0;
 
@@ -256,58 +256,53 @@ static constexpr auto is_md_datatype_v =
     std::is_same_v<DataType, longfist::types::Transaction> or std::is_same_v<DataType, longfist::types::Tree>;
 
 template <typename DataType, std::enable_if_t<is_md_datatype_v<DataType>>...>
-static constexpr auto is_own(const Client &broker_client) {
-  return rx::filter([&](const event_ptr &event) {
-    if (event->msg_type() == DataType::tag) {
-      const DataType &data = event->data<DataType>();
-      if (broker_client.is_custom_subscribed(event->source())) {
-        if ((std::is_same_v<DataType, longfist::types::Quote> &&
-             broker_client.is_custom_subscribed_all(event->source(),
-                                                    kungfu::longfist::enums::SubscribeDataType::Snapshot,
-                                                    data.exchange_id, data.instrument_type)) ||
-            (std::is_same_v<DataType, longfist::types::Tree> &&
-             broker_client.is_custom_subscribed_all(event->source(), kungfu::longfist::enums::SubscribeDataType::Tree,
-                                                    data.exchange_id, data.instrument_type)) ||
-            (std::is_same_v<DataType, longfist::types::Transaction> &&
-             broker_client.is_custom_subscribed_all(event->source(),
-                                                    kungfu::longfist::enums::SubscribeDataType::Transaction,
-                                                    data.exchange_id, data.instrument_type)) ||
-            (std::is_same_v<DataType, longfist::types::Entrust> &&
-             broker_client.is_custom_subscribed_all(event->source(),
-                                                    kungfu::longfist::enums::SubscribeDataType::Entrust,
-                                                    data.exchange_id, data.instrument_type))) {
-          return true;
-        }
-      }
-      if (broker_client.is_subscribed(data.exchange_id, data.instrument_id)) {
+static bool is_own_event(const Client &broker_client, const event_ptr &event) {
+  if (event->msg_type() == DataType::tag) {
+    const DataType &data = event->data<DataType>();
+    if (broker_client.is_custom_subscribed(event->source())) {
+      if ((std::is_same_v<DataType, longfist::types::Quote> &&
+           broker_client.is_custom_subscribed_all(event->source(), kungfu::longfist::enums::SubscribeDataType::Snapshot,
+                                                  data.exchange_id, data.instrument_type)) ||
+          (std::is_same_v<DataType, longfist::types::Tree> &&
+           broker_client.is_custom_subscribed_all(event->source(), kungfu::longfist::enums::SubscribeDataType::Tree,
+                                                  data.exchange_id, data.instrument_type)) ||
+          (std::is_same_v<DataType, longfist::types::Transaction> &&
+           broker_client.is_custom_subscribed_all(event->source(),
+                                                  kungfu::longfist::enums::SubscribeDataType::Transaction,
+                                                  data.exchange_id, data.instrument_type)) ||
+          (std::is_same_v<DataType, longfist::types::Entrust> &&
+           broker_client.is_custom_subscribed_all(event->source(), kungfu::longfist::enums::SubscribeDataType::Entrust,
+                                                  data.exchange_id, data.instrument_type))) {
         return true;
       }
     }
-    return false;
-  });
+    if (broker_client.is_subscribed(data.exchange_id, data.instrument_id)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 template <typename DataType, std::enable_if_t<std::is_same_v<DataType, longfist::types::Register> or
                                               std::is_same_v<DataType, longfist::types::Deregister>>...>
-static constexpr auto is_own(const Client &broker_client) {
-  return rx::filter([&](const event_ptr &event) {
-    if (event->msg_type() == DataType::tag) {
-      const DataType &data = event->data<DataType>();
-      return broker_client.should_connect_md(data.location_uid) or broker_client.should_connect_td(data.location_uid);
-    }
-    return false;
-  });
+static bool is_own_event(const Client &broker_client, const event_ptr &event) {
+  if (event->msg_type() == DataType::tag) {
+    const DataType &data = event->data<DataType>();
+    return broker_client.should_connect_md(data.location_uid) or broker_client.should_connect_td(data.location_uid);
+  }
+  return false;
 }
 
 template <typename DataType, std::enable_if_t<std::is_same_v<DataType, longfist::types::BrokerStateUpdate>>...>
-static constexpr auto is_own(const Client &broker_client) {
-  return rx::filter([&](const event_ptr &event) {
-    if (event->msg_type() == DataType::tag) {
-      //      const DataType &data = event->data<DataType>();
-      return (broker_client.should_connect_md(event->source()) or broker_client.should_connect_td(event->source()));
-    }
-    return false;
-  });
+static bool is_own_event(const Client &broker_client, const event_ptr &event) {
+  if (event->msg_type() == DataType::tag) {
+    return (broker_client.should_connect_md(event->source()) or broker_client.should_connect_td(event->source()));
+  }
+  return false;
+}
+
+template <typename DataType> static constexpr auto is_own(const Client &broker_client) {
+  return rx::filter([&](const event_ptr &event) { return is_own_event<DataType>(broker_client, event); });
 }
 
 } // namespace kungfu::wingchun::broker
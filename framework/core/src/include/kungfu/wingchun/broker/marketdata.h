@@ -67,6 +67,18 @@ protected:
   std::unordered_map<std::string, longfist::types::Instrument> instruments_ = {};
   std::vector<longfist::types::InstrumentKey> instruments_to_subscribe_{};
 };
+
+/**
+ * Service of vendors that derive data from journals of other market data sources, nothing to subscribe.
+ */
+class JournalMarketData : public MarketData {
+public:
+  explicit JournalMarketData(BrokerVendor &vendor) : MarketData(vendor){};
+
+  bool subscribe(const std::vector<longfist::types::InstrumentKey> &instrument_keys) override { return true; }
+
+  bool unsubscribe(const std::vector<longfist::types::InstrumentKey> &instrument_keys) override { return true; }
+};
 } // namespace kungfu::wingchun::broker
 
 #endif // WINGCHUN_MARKETDATA_H
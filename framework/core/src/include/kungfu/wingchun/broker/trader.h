@@ -56,7 +56,12 @@ public:
 
   virtual bool insert_order(const event_ptr &event) = 0;
 
-  virtual bool insert_batch_orders(const event_ptr &event) { return true; }
+  /**
+   * Insert the orders of a batch, found in get_order_inputs() by event->source(). The event is the BatchOrderEnd mark
+   * of a batch of OrderInput frames, or an OrderInputBatch frame that carries all the inputs at once.
+   * By default the inputs of an OrderInputBatch frame are inserted one by one through insert_order.
+   */
+  virtual bool insert_batch_orders(const event_ptr &event);
 
   virtual bool cancel_order(const event_ptr &event) = 0;
 
@@ -128,7 +133,9 @@ private:
   void handle_asset_sync();
   void handle_position_sync();
   void handle_order_input(const event_ptr &event);
+  void handle_order_input_batch(const event_ptr &event);
   void handle_batch_order_tag(const event_ptr &event);
+  bool reject_self_deal(const event_ptr &event);
   bool has_self_deal_risk(const event_ptr &event);
   void recover();
   void deal_write_frame();
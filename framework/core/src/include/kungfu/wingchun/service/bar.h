@@ -7,6 +7,20 @@
 #include <kungfu/wingchun/broker/marketdata.h>
 
 namespace kungfu::wingchun::service {
+/**
+ * @param s time interval such as 30s, 1m, 2h or 1d
+ * @return the interval in nanoseconds
+ */
+int64_t parse_time_interval(const std::string &s);
+
+/**
+ * Bars of several time intervals for every instrument, from quotes or transactions of one or more sources.
+ * Config takes source and time_interval, each a single value, a comma separated list or an array, and optionally
+ * instruments, a list of {exchange_id, instrument_id, source, time_interval} that limits bars to the instruments
+ * listed, with their own source and time_interval where given.
+ * Ticks only update bars of the finest intervals, a bar of an interval that is a multiple of a finer one is merged
+ * from the finer bars as they close.
+ */
 class BarGenerator : public broker::MarketDataVendor {
 public:
   BarGenerator(const yijinjing::data::locator_ptr &locator, longfist::enums::mode m, bool low_latency,
@@ -15,9 +29,37 @@ public:
   void on_start() override;
 
 private:
-  int64_t time_interval_;
-  yijinjing::data::location_ptr source_location_;
-  std::unordered_map<uint32_t, longfist::types::Bar> bars_;
+  struct subscription {
+    std::vector<int64_t> time_intervals = {};
+    uint32_t source_uid = 0; // 0 for any source
+  };
+
+  struct series {
+    int64_t time_interval;
+    int32_t derived_from; // index of the finer series merged into this one, -1 for bars made of ticks
+    longfist::types::Bar bar;
+  };
+
+  struct instrument_bars {
+    uint32_t source_uid = 0;
+    bool by_transaction = false; // once transactions are seen, quotes of the instrument are left out
+    int64_t total_volume = 0;
+    std::vector<series> intervals = {}; // from the finest
+  };
+
+  std::vector<yijinjing::data::location_ptr> source_locations_ = {};
+  subscription default_subscription_ = {};
+  std::unordered_map<uint32_t, subscription> subscriptions_ = {};
+  std::unordered_map<uint32_t, instrument_bars> bars_;
+
+  [[nodiscard]] bool is_source(uint32_t location_uid) const;
+
+  template <typename DataType> instrument_bars *get_bars(const event_ptr &event, const DataType &data);
+
+  template <typename DataType>
+  void update(const event_ptr &event, instrument_bars &bars, const DataType &data, double price, int64_t total_volume);
+
+  void advance(const event_ptr &event, instrument_bars &bars, size_t index, int64_t data_time);
 };
 } // namespace kungfu::wingchun::service
 
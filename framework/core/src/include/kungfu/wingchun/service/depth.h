@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef KF_SERVICE_DEPTH
+#define KF_SERVICE_DEPTH
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include <kungfu/longfist/longfist.h>
+#include <kungfu/wingchun/broker/marketdata.h>
+#include <kungfu/wingchun/service/orderbook.h>
+
+namespace kungfu::wingchun::service {
+/**
+ * Rebuild order books from the tick by tick entrusts and transactions of a market data source.
+ * Every change is written to the DepthSnapshot file at once, and Trees of changed books are published to the public
+ * journal once per time_interval, or on every change when time_interval is 0s.
+ */
+class DepthService : public broker::MarketDataVendor {
+public:
+  DepthService(const yijinjing::data::locator_ptr &locator, longfist::enums::mode m, bool low_latency,
+               const std::string &json_config);
+
+  void on_start() override;
+
+  /**
+   * @return path of the DepthSnapshot file written by the depth service of mode m under locator
+   */
+  static std::string get_snapshot_path(const yijinjing::data::locator_ptr &locator,
+                                       longfist::enums::mode m = longfist::enums::mode::LIVE);
+
+private:
+  int64_t time_interval_ = 0;
+  uint32_t capacity_ = DepthSnapshot::DEFAULT_CAPACITY;
+  yijinjing::data::location_ptr source_location_;
+  DepthSnapshot_ptr snapshot_;
+  std::unordered_map<uint32_t, OrderBook> books_ = {};
+  std::unordered_set<OrderBook *> changed_ = {};
+
+  template <typename DataType> OrderBook &get_book(const DataType &data) {
+    auto instrument_key = hash_instrument(data.exchange_id, data.instrument_id);
+    auto it = books_.find(instrument_key);
+    if (it == books_.end()) {
+      it = books_.try_emplace(instrument_key, data.exchange_id, data.instrument_id).first;
+    }
+    return it->second;
+  }
+
+  void update(int64_t trigger_time, OrderBook &book);
+
+  void publish(int64_t trigger_time);
+};
+} // namespace kungfu::wingchun::service
+
+#endif // KF_SERVICE_DEPTH
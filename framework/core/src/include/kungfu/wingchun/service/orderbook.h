@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef WINGCHUN_ORDERBOOK_H
+#define WINGCHUN_ORDERBOOK_H
+
+#include <atomic>
+#include <map>
+#include <optional>
+
+#include <kungfu/longfist/longfist.h>
+#include <kungfu/wingchun/common.h>
+
+namespace kungfu::wingchun::service {
+/**
+ * Price levels of one instrument rebuilt from tick by tick entrusts and transactions.
+ * Entrusts add orders, transactions take volume off the orders they name by bid_no and ask_no, either traded or
+ * cancelled. Orders are keyed by orig_order_no, or seq where the source leaves it empty, which is what transactions
+ * of SZE refer to. Market orders are tracked but stay off the levels, since they carry no price.
+ */
+class OrderBook {
+public:
+  static constexpr double PRICE_SCALE = 10000;
+
+  OrderBook(const char *exchange_id, const char *instrument_id);
+
+  void apply(const longfist::types::Entrust &entrust);
+
+  void apply(const longfist::types::Transaction &transaction);
+
+  /**
+   * Take reference prices and trading phase from a level 1 quote of the instrument.
+   */
+  void apply(const longfist::types::Quote &quote);
+
+  /**
+   * @return the book as a Tree, with the 10 best levels of each side
+   */
+  const longfist::types::Tree &snapshot();
+
+  [[nodiscard]] size_t order_count() const { return orders_.size(); }
+
+  [[nodiscard]] const std::map<int64_t, int64_t, std::greater<>> &get_bids() const { return bids_; }
+
+  [[nodiscard]] const std::map<int64_t, int64_t> &get_asks() const { return asks_; }
+
+private:
+  struct resting_order {
+    longfist::enums::Side side;
+    int64_t price;
+    int64_t volume;
+  };
+
+  longfist::types::Tree tree_ = {};
+  std::map<int64_t, int64_t, std::greater<>> bids_ = {}; // volume by scaled price, best first
+  std::map<int64_t, int64_t> asks_ = {};
+  yijinjing::util::flat_map<int64_t, resting_order> orders_ = {};
+  double bid_notional_ = 0;
+  double ask_notional_ = 0;
+
+  void update_level(longfist::enums::Side side, int64_t price, int64_t volume);
+
+  void take(int64_t order_no, int64_t volume);
+};
+
+FORWARD_DECLARE_CLASS_PTR(DepthSnapshot)
+
+/**
+ * Latest Tree of every instrument in a file mapped into memory, written by DepthService and read by strategies of
+ * other processes without replaying ticks. Each slot is guarded by a sequence number, odd while being written, readers
+ * retry until they copy a slot with the same even number before and after, up to MAX_READ_RETRIES times.
+ */
+class DepthSnapshot {
+public:
+  static constexpr uint32_t DEFAULT_CAPACITY = 8192;
+
+  /** a slot is rewritten in well under a microsecond, running out of retries means the writer died in the middle */
+  static constexpr uint32_t MAX_READ_RETRIES = 65536;
+
+  /**
+   * Map the snapshot file at path, the writer creates it for capacity instruments and clears it, readers map what the
+   * writer has created and throw wingchun_error if there is none.
+   */
+  DepthSnapshot(const std::string &path, bool writing, uint32_t capacity = DEFAULT_CAPACITY);
+
+  ~DepthSnapshot();
+
+  DepthSnapshot(const DepthSnapshot &) = delete;
+
+  DepthSnapshot &operator=(const DepthSnapshot &) = delete;
+
+  void write(const longfist::types::Tree &tree);
+
+  /**
+   * @return latest Tree of the instrument, empty if the writer has not written it yet, throws wingchun_error if no
+   *         consistent copy is taken in MAX_READ_RETRIES
+   */
+  [[nodiscard]] std::optional<longfist::types::Tree> read(const std::string &exchange_id,
+                                                          const std::string &instrument_id) const;
+
+  [[nodiscard]] uint32_t size() const;
+
+  [[nodiscard]] uint32_t capacity() const;
+
+private:
+  static constexpr uint32_t VERSION = 1;
+
+  struct header {
+    uint32_t version;
+    uint32_t capacity;
+    std::atomic<uint32_t> size;
+  };
+
+  struct alignas(64) slot {
+    std::atomic<uint32_t> sequence;
+    uint32_t instrument_key;
+    longfist::types::Tree tree;
+  };
+
+  const bool writing_;
+  size_t mapped_size_ = 0;
+  uintptr_t address_ = 0;
+  header *header_ = nullptr;
+  slot *slots_ = nullptr;
+  mutable yijinjing::util::flat_map<uint32_t, uint32_t> index_ = {};
+
+  [[nodiscard]] const slot *find(uint32_t instrument_key) const;
+};
+} // namespace kungfu::wingchun::service
+
+#endif // WINGCHUN_ORDERBOOK_H
@@ -7,87 +7,81 @@
 #ifndef WINGCHUN_BACKTEST_H
 #define WINGCHUN_BACKTEST_H
 
-#include <kungfu/wingchun/strategy/context.h>
+#include <kungfu/wingchun/backtest/matchengine.h>
+#include <kungfu/wingchun/strategy/runtime.h>
 
 namespace kungfu::wingchun::strategy {
-class BacktestContext : public Context {
+/**
+ * Context for strategies replaying market data in BACKTEST mode.
+ * Orders go to an in process match engine instead of TD processes. Accounts are BACKTEST mode TD locations, the match
+ * engine writes Order, Trade and OrderActionError frames to their journals as a TD would, read back by the runner at
+ * the simulated time they were made, so bookkeeper, handlers and rx subscribers see them the same way as live ones.
+ * Account journals of an earlier run in the same home are removed on start.
+ * Settings are read from env: KF_BACKTEST_INSERT_LATENCY_US, KF_BACKTEST_CANCEL_LATENCY_US and
+ * KF_BACKTEST_QUEUE_MODEL (optimistic or conservative).
+ */
+class BacktestContext : public RuntimeContext {
 public:
-  BacktestContext() = default;
-  ~BacktestContext() override = default;
+  explicit BacktestContext(yijinjing::practice::apprentice &app, const rx::connectable_observable<event_ptr> &events);
 
-  /**
-   * Get current time in nano seconds.
-   * @return current time in nano seconds
-   */
-  int64_t now() const override;
+  ~BacktestContext() override = default;
 
-  /**
-   * Add one shot timer callback.
-   * @param nanotime when to call in nano seconds
-   * @param callback callback function
-   */
-  void add_timer(int64_t nanotime, const std::function<void(event_ptr)> &callback) override;
+  uint64_t insert_block_message(const std::string &source, const std::string &account, const std::string &opponent_seat,
+                                uint64_t match_number, bool is_specific = false) override;
 
-  /**
-   * Add periodically callback.
-   * @param duration duration in nano seconds
-   * @param callback callback function
-   */
-  void add_time_interval(int64_t duration, const std::function<void(event_ptr)> &callback) override;
+  uint64_t insert_order(const std::string &instrument_id, const std::string &exchange_id, const std::string &source,
+                        const std::string &account, double limit_price, int64_t volume, longfist::enums::PriceType type,
+                        longfist::enums::Side side, longfist::enums::Offset offset,
+                        longfist::enums::HedgeFlag hedge_flag = longfist::enums::HedgeFlag::Speculation,
+                        bool is_swap = false, uint64_t block_id = 0, uint64_t parent_id = 0) override;
 
-  /**
-   * Add account for strategy.
-   * @param source TD group
-   * @param account TD account ID
-   */
-  void add_account(const std::string &source, const std::string &account) override;
+  uint64_t insert_order_input(const std::string &source, const std::string &account,
+                              longfist::types::OrderInput &order_input) override;
 
-  /**
-   * Subscribe market data.
-   * @param source MD group
-   * @param instrument_ids instrument IDs
-   * @param exchange_ids exchange IDs
-   */
-  void subscribe(const std::string &source, const std::vector<std::string> &instrument_ids,
-                 const std::string &exchange_ids) override;
+  std::vector<uint64_t>
+  insert_batch_orders(const std::string &source, const std::string &account,
+                      const std::vector<std::string> &instrument_ids, const std::vector<std::string> &exchange_ids,
+                      std::vector<double> limit_prices, std::vector<int64_t> volumes,
+                      std::vector<longfist::enums::PriceType> types, std::vector<longfist::enums::Side> sides,
+                      std::vector<longfist::enums::Offset> offsets, std::vector<longfist::enums::HedgeFlag> hedge_flags,
+                      std::vector<bool> is_swaps) override;
 
-  /**
-   * Subscribe all from given MD
-   * @param source MD group
-   */
-  void subscribe_all(const std::string &source, uint8_t market_type, uint64_t instrument_type,
-                     uint64_t data_type) override;
+  std::vector<uint64_t> insert_array_orders(const std::string &source, const std::string &account,
+                                            std::vector<longfist::types::OrderInput> &order_inputs) override;
 
-  /**
-   * Insert order.
-   * @param instrument_id instrument ID
-   * @param exchange_id exchange ID
-   * @param account account ID
-   * @param volume trade volume
-   * @param type price type
-   * @param side side
-   * @param offset Deprecated, defaults to longfist::enums::Offset::Open
-   * @param hedge_flag Deprecated, defaults to longfist::enums::HedgeFlag::Speculation
-   * @return inserted order ID
-   */
-  uint64_t insert_order(const std::string &instrument_id, const std::string &exchange_id, const std::string &source,
-                        const std::string &account, double limit_price, int64_t volume, longfist::enums::PriceType type,
-                        longfist::enums::Side side, longfist::enums::Offset offset,
-                        longfist::enums::HedgeFlag hedge_flag, bool is_swap, uint64_t block_id,
-                        uint64_t parent_id) override;
+  uint64_t insert_basket_order(uint64_t basket_id, const std::string &source, const std::string &account,
+                               longfist::enums::Side side, longfist::enums::PriceType price_type,
+                               longfist::enums::PriceLevel price_level, double price_offset = 0,
+                               int64_t volume = 0) override;
 
-  /**
-   * Cancel order.
-   * @param order_id order ID
-   * @return order action ID
-   */
   uint64_t cancel_order(uint64_t order_id) override;
 
+  void req_history_order(const std::string &source, const std::string &account, uint32_t query_num = 0) override;
+
+  void req_history_trade(const std::string &source, const std::string &account, uint32_t query_num = 0) override;
+
   /**
-   * Get current trading day.
-   * @return current trading day
+   * Get match engine.
+   * @return match engine reference
    */
-  int64_t get_trading_day() const override;
+  backtest::MatchEngine &get_match_engine();
+
+protected:
+  void on_start() override;
+
+private:
+  backtest::MatchEngine match_engine_;
+  std::unordered_map<uint32_t, yijinjing::journal::writer_ptr> account_writers_ = {};
+  uint32_t order_seq_ = 0;
+  uint32_t action_seq_ = 0;
+
+  uint64_t submit(uint32_t account_location_uid, longfist::types::OrderInput &input);
+
+  void write_event(const event_ptr &event);
+
+  static void remove_journal(const yijinjing::data::location_ptr &location, uint32_t dest_id);
+
+  static backtest::MatchSettings make_settings(const yijinjing::data::locator_ptr &locator);
 };
 
 DECLARE_PTR(BacktestContext)
@@ -248,6 +248,14 @@ protected:
 
   void send_instrument_keys();
 
+  /**
+   * Write the order inputs made by make_input in one OrderInputBatch frame, notified to the account once.
+   * @return order ids, 0 for those of unknown instrument type which are left out
+   */
+  std::vector<uint64_t>
+  insert_order_batch(const std::string &source, const std::string &account, size_t count,
+                     const std::function<void(size_t, longfist::types::OrderInput &)> &make_input);
+
 private:
   broker::PassiveClient broker_client_;
   book::Bookkeeper bookkeeper_;
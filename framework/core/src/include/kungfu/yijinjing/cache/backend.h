@@ -7,6 +7,11 @@
 #ifndef KUNGFU_CACHE_BACKEND_H
 #define KUNGFU_CACHE_BACKEND_H
 
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
 #include <kungfu/longfist/longfist.h>
 #include <kungfu/yijinjing/cache/runtime.h>
 #include <kungfu/yijinjing/cache/sqlite_orm_ext.h>
@@ -88,8 +93,110 @@ template <typename DataType> struct time_spec<DataType, std::enable_if_t<DataTyp
   };
 };
 
+/**
+ * Writes states into one sqlite db in batches, each batch is one transaction of at most batch_rows rows,
+ * committed at the end of the loop pass that wrote it. Replace statements are prepared once per type and reused.
+ * When threaded, rows are queued and persisted by a dedicated thread, committed no later than batch_time
+ * nanoseconds after they are queued. batch_time has no effect when not threaded.
+ * The queue holds at most MAX_QUEUED_BATCHES batches, replace blocks while it is full, such as when sqlite stalls.
+ */
+class store {
+public:
+  static constexpr size_t MAX_QUEUED_BATCHES = 64;
+
+  store(StateStoragePtr storage, size_t batch_rows, int64_t batch_time, bool threaded);
+
+  ~store();
+
+  template <typename DataType> void replace(const DataType &data) {
+    if (not threaded_) {
+      execute(data);
+      return;
+    }
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    if (queue_.size() >= max_queued_rows_) {
+      queue_cv_.notify_one();
+      queue_space_cv_.wait(lock, [&]() { return stopped_ or queue_.size() < max_queued_rows_; });
+    }
+    queue_.emplace_back([this, data]() { execute(data); });
+    if (queue_.size() >= batch_rows_) {
+      queue_cv_.notify_one();
+    }
+  }
+
+  /**
+   * Run func with exclusive access to the storage, after all rows queued so far have been committed.
+   */
+  template <typename Func> void apply(Func &&func) {
+    std::lock_guard<std::mutex> lock(storage_mutex_);
+    drain();
+    func(storage_);
+  }
+
+  void flush();
+
+  /**
+   * Commit the open transaction unless rows are persisted by the thread, so that the sqlite write lock is not held
+   * while the loop waits for events.
+   */
+  void commit_pending();
+
+private:
+  StateStoragePtr storage_;
+  std::unordered_map<int32_t, std::shared_ptr<void>> statements_ = {};
+  const size_t batch_rows_;
+  const int64_t batch_time_;
+  const bool threaded_;
+  const size_t max_queued_rows_;
+  bool in_transaction_ = false;
+  size_t batch_size_ = 0;
+  std::mutex storage_mutex_;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_cv_;
+  std::condition_variable queue_space_cv_;
+  std::vector<std::function<void()>> queue_ = {};
+  bool stopped_ = false;
+  std::thread thread_;
+
+  template <typename DataType> void execute(const DataType &data) {
+    using statement_type = decltype(storage_->prepare(sqlite_orm::replace(data)));
+    if (not in_transaction_) {
+      storage_->begin_transaction();
+      in_transaction_ = true;
+    }
+    auto &statement = statements_[DataType::tag];
+    if (not statement) {
+      // statements finalize on destruction and must not be moved, construct it in place
+      statement = std::shared_ptr<statement_type>(new statement_type(storage_->prepare(sqlite_orm::replace(data))));
+    } else {
+      sqlite_orm::get<0>(*std::static_pointer_cast<statement_type>(statement)) = data;
+    }
+    storage_->execute(*std::static_pointer_cast<statement_type>(statement));
+    if (++batch_size_ >= batch_rows_) {
+      commit();
+    }
+  }
+
+  void commit();
+
+  void drain();
+
+  void run();
+};
+DECLARE_PTR(store)
+
+/**
+ * Persists states of a location into one sqlite db per dest, options are taken from env:
+ *   KF_CACHE_BATCH_ROWS rows per transaction at most, DEFAULT_BATCH_ROWS by default.
+ *   KF_CACHE_PERSIST_THREAD persists rows in a thread of each store if set to anything but 0.
+ *   KF_CACHE_BATCH_MICROSECONDS time rows wait in the queue at most, only in threaded mode, rows written by the loop
+ *   itself are committed at the end of every loop pass, see commit().
+ */
 class shift {
 public:
+  static constexpr size_t DEFAULT_BATCH_ROWS = 1000;
+  static constexpr int64_t DEFAULT_BATCH_TIME = 10 * time_unit::NANOSECONDS_PER_MILLISECOND;
+
   shift() = default;
 
   explicit shift(yijinjing::data::location_ptr location);
@@ -98,6 +205,13 @@ public:
 
   void ensure_storage(uint32_t dest);
 
+  /**
+   * Commit rows written in this loop pass, call it at the end of every pass.
+   */
+  void commit();
+
+  void flush();
+
   template <typename TargetType> void operator>>(TargetType &target) {
     for (auto dest : location_->locator->list_location_dest_by_db(location_)) {
       ensure_storage(dest);
@@ -105,7 +219,7 @@ public:
     boost::hana::for_each(longfist::StateDataTypes, [&](auto it) {
       using DataType = typename decltype(+boost::hana::second(it))::type;
       for (auto &pair : storage_map_) {
-        restore<DataType>(target, pair.first, pair.second);
+        pair.second->apply([&](auto &storage) { restore<DataType>(target, pair.first, storage); });
       }
     });
   }
@@ -122,18 +236,21 @@ public:
 
   template <typename DataType> void operator-=(const typed_event_ptr<DataType> &event) {
     ensure_storage(event->dest());
-    storage_map_.at(event->dest())->template remove_all<DataType>();
+    storage_map_.at(event->dest())->apply([](auto &storage) { storage->template remove_all<DataType>(); });
   }
 
   template <typename DataType> void operator/=(const typed_event_ptr<DataType> &) {
     for (auto &pair : storage_map_) {
-      pair.second->template remove_all<DataType>();
+      pair.second->apply([](auto &storage) { storage->template remove_all<DataType>(); });
     }
   }
 
 private:
   yijinjing::data::location_ptr location_;
-  std::unordered_map<uint32_t, StateStoragePtr> storage_map_;
+  std::unordered_map<uint32_t, store_ptr> storage_map_;
+  size_t batch_rows_ = DEFAULT_BATCH_ROWS;
+  int64_t batch_time_ = DEFAULT_BATCH_TIME;
+  bool threaded_ = false;
 
   template <typename DataType>
   void restore(yijinjing::journal::writer_ptr &writer, uint32_t dest, StateStoragePtr &storage) {
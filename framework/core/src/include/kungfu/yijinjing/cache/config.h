@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef KUNGFU_CACHE_CONFIG_H
+#define KUNGFU_CACHE_CONFIG_H
+
+#include <optional>
+#include <string>
+
+namespace kungfu::yijinjing::cache {
+/**
+ * Value of the Config of location_uid in a profile db file, for callers that should not include backend.h.
+ * @return empty if the file or the Config does not exist, throws if the file can not be read
+ */
+std::optional<std::string> read_config_value(const std::string &db_file, uint32_t location_uid);
+} // namespace kungfu::yijinjing::cache
+
+#endif // KUNGFU_CACHE_CONFIG_H
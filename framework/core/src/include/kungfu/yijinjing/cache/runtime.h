@@ -33,7 +33,7 @@ public:
   }
 
   template <typename DataType>
-  const std::unordered_map<uint64_t, state<DataType>> &operator[](const boost::hana::basic_type<DataType> &type) const {
+  const longfist::StateMap<DataType> &operator[](const boost::hana::basic_type<DataType> &type) const {
     return state_map_[type];
   }
 
@@ -65,7 +65,7 @@ public:
   }
 
   template <typename DataType>
-  const std::unordered_map<uint64_t, state<DataType>> &operator[](const boost::hana::basic_type<DataType> &type) const {
+  const longfist::StateMap<DataType> &operator[](const boost::hana::basic_type<DataType> &type) const {
     return state_map_[type];
   }
 
@@ -43,13 +43,43 @@ public:
 
 DECLARE_PTR(publisher)
 
+/**
+ * How an observer waits when nothing new comes.
+ */
+enum class wait_strategy : int {
+  spin,       // poll without pause, lowest latency, burns a whole core
+  yield,      // poll, yield the cpu on each idle poll after spin polls
+  spin_block, // poll spin polls in a row, then block until woken
+  block,      // block right away
+};
+
+struct wait_stats {
+  int64_t idle_polls = 0;
+  int64_t yields = 0;
+  int64_t sleeps = 0;
+  int64_t wakeups = 0;        // sleeps ended by a notification rather than timeout
+  int64_t wakeup_latency = 0; // sum of nanoseconds from notification to wakeup
+  int64_t max_wakeup_latency = 0;
+};
+
 class observer : public resource {
 public:
   virtual ~observer() = default;
 
   virtual bool wait() = 0;
 
+  /**
+   * Bound how long the following waits may sleep, for loops with their own deadlines to keep.
+   * @param timeout milliseconds, 0 to poll without sleeping, negative to restore the default
+   */
+  virtual void set_timeout(int timeout) {}
+
   virtual const std::string &get_notice() = 0;
+
+  [[nodiscard]] const wait_stats &get_wait_stats() const { return wait_stats_; }
+
+protected:
+  wait_stats wait_stats_ = {};
 };
 
 DECLARE_PTR(observer)
@@ -49,10 +49,21 @@ public:
 
   void update_session(const journal::frame_ptr &frame);
 
-  [[maybe_unused]] void rebuild_index_db();
+  /**
+   * Write sessions opened or closed since the last flush in one transaction.
+   */
+  void flush();
+
+  /**
+   * Index sessions from master journals, only frames after the last indexed ones unless full is set or nothing has been
+   * indexed yet. Journals of different locations are read in parallel by KF_INDEX_THREADS threads, all cores by
+   * default.
+   */
+  [[maybe_unused]] void rebuild_index_db(bool full = false);
 
 private:
   SessionMap live_sessions_ = {};
+  SessionVector pending_sessions_ = {};
 };
 } // namespace kungfu::yijinjing::index
 
@@ -34,6 +34,33 @@ public:
 
   [[nodiscard]] bool is_low_latency() const { return low_latency_; }
 
+  /**
+   * spin if low latency, block otherwise, unless set to spin, yield, spin_block or block by KF_WAIT_STRATEGY or by
+   * wait_strategy of the thread setting
+   */
+  [[nodiscard]] wait_strategy get_wait_strategy() const { return wait_strategy_; }
+
+  /**
+   * cpus to pin the hero thread to, set by KF_CPU_AFFINITY or by cpu_affinity of the thread setting, empty if not set
+   */
+  [[nodiscard]] const std::string &get_cpu_affinity() const { return cpu_affinity_; }
+
+  /**
+   * scheduler policy of the hero thread, set by KF_SCHED_POLICY or by sched_policy of the thread setting, empty if not
+   * set
+   */
+  [[nodiscard]] const std::string &get_sched_policy() const { return sched_policy_; }
+
+  /**
+   * idle polls before yield or spin_block strategies give up the cpu, set by KF_WAIT_SPIN_POLLS
+   */
+  [[nodiscard]] uint32_t get_spin_polls() const { return spin_polls_; }
+
+  /**
+   * readers check frame checksums before handing frames out, set by KF_JOURNAL_VERIFY for debugging
+   */
+  [[nodiscard]] bool is_verify_checksum() const { return verify_checksum_; }
+
   journal::reader_ptr open_reader_to_subscribe();
 
   [[maybe_unused]] journal::reader_ptr open_reader(const data::location_ptr &location, uint32_t dest_id);
@@ -53,11 +80,23 @@ public:
 
   [[nodiscard]] observer_ptr get_observer() { return observer_; }
 
+  /**
+   * @return location whose Config in profile holds the thread setting, a json object keyed by category or by
+   *         category/group/name, the latter taking over, env KF_CPU_AFFINITY, KF_SCHED_POLICY and KF_WAIT_STRATEGY
+   *         take over both
+   */
+  static data::location_ptr make_thread_config_location(const data::locator_ptr &locator);
+
 protected:
   data::location_ptr home_;
   data::location_ptr live_home_;
   const bool low_latency_;
   const bool lazy_;
+  wait_strategy wait_strategy_;
+  uint32_t spin_polls_;
+  std::string cpu_affinity_ = {};
+  std::string sched_policy_ = {};
+  bool verify_checksum_ = false;
   nanomsg::url_factory_ptr url_factory_;
   publisher_ptr publisher_;
   observer_ptr observer_;
@@ -65,6 +104,10 @@ protected:
 
 DECLARE_PTR(io_device)
 
+wait_strategy parse_wait_strategy(const std::string &name);
+
+std::string get_wait_strategy_name(wait_strategy strategy);
+
 class io_device_master : public io_device {
 public:
   io_device_master(data::location_ptr home, bool low_latency);
@@ -7,6 +7,8 @@
 #ifndef YIJINJING_ASSEMBLE_H
 #define YIJINJING_ASSEMBLE_H
 
+#include <functional>
+
 #include <kungfu/yijinjing/journal/journal.h>
 
 namespace kungfu::yijinjing::journal {
@@ -120,6 +122,15 @@ public:
     return read_headers(T::tag, end_time);
   }
 
+  /**
+   * Copy frames of msg_type with gen_time in [from_time, end_time), frame_header and data as they are in the journal
+   * without checksum, to consecutive records of record_length bytes, frames of other lengths are left out.
+   * The range is read twice, first to count the frames so that alloc(count) is called once for the records.
+   * @return number of records copied, readers are left at end_time
+   */
+  size_t copy_frames(int32_t msg_type, int64_t from_time, int64_t end_time, uint32_t record_length,
+                     const std::function<void *(size_t)> &alloc);
+
   [[maybe_unused]] void seek_to_time(int64_t nano_time);
 
   [[maybe_unused]] [[nodiscard]] const std::vector<reader_ptr> &get_readers() const { return readers_; }
@@ -3,7 +3,11 @@
 #ifndef KUNGFU_YIJINJING_FRAME_H
 #define KUNGFU_YIJINJING_FRAME_H
 
+#include <algorithm>
+#include <atomic>
+
 #include <kungfu/yijinjing/journal/common.h>
+#include <kungfu/yijinjing/util/util.h>
 
 namespace kungfu::yijinjing::journal {
 
@@ -25,6 +29,29 @@ namespace kungfu::yijinjing::journal {
 //     (uint32_t, dest) //
 //);
 
+/** frames of pages with checksum carry a CRC32C right after frame_header, counted in their header_length */
+constexpr uint32_t FRAME_CHECKSUM_LENGTH = sizeof(uint32_t);
+
+/**
+ * frames that take more than one frame uid carry the uid count in the last 8 bytes of their header, counted in their
+ * header_length. It is twice the checksum length so that header_length still tells whether a checksum is there.
+ */
+constexpr uint32_t FRAME_UID_COUNT_LENGTH = sizeof(uint64_t);
+
+/**
+ * Number of frame uids a frame takes from the writer, frames take one, array frames opened by writer::open_array
+ * take one for each element. Page frame numbers in journal, writer cursor and page index all count uids.
+ */
+inline uint32_t get_uid_count(const longfist::types::frame_header &header) {
+  if (header.header_length < sizeof(longfist::types::frame_header) + FRAME_UID_COUNT_LENGTH) {
+    return 1;
+  }
+  uint64_t uid_count;
+  memcpy(&uid_count, reinterpret_cast<const char *>(&header) + header.header_length - FRAME_UID_COUNT_LENGTH,
+         sizeof(uid_count));
+  return std::max<uint32_t>(static_cast<uint32_t>(uid_count), 1);
+}
+
 /**
  * Basic memory unit,
  * holds header / data / errorMsg (if needs)
@@ -32,7 +59,11 @@ namespace kungfu::yijinjing::journal {
 struct frame : event {
   ~frame() override = default;
 
-  [[nodiscard]] bool has_data() const { return header_->length > 0 && header_->msg_type > 0; }
+  [[nodiscard]] bool has_data() const {
+    bool committed = header_->length > 0 && header_->msg_type > 0;
+    std::atomic_thread_fence(std::memory_order_acquire); // pairs with the release fence before writer stores length
+    return committed;
+  }
 
   [[nodiscard]] uintptr_t address() const { return reinterpret_cast<uintptr_t>(header_); }
 
@@ -60,10 +91,46 @@ struct frame : event {
     return reinterpret_cast<char *>(address() + header_length());
   }
 
-  [[nodiscard]] std::string data_as_string() const override { return std::string(data_as_bytes()); }
+  [[nodiscard]] std::string data_as_string() const override { return std::string(data_as_bytes(), data_length()); }
 
   [[nodiscard]] std::string to_string() const override { return std::string(reinterpret_cast<char *>(address())); }
 
+  [[nodiscard]] bool has_checksum() const {
+    auto extended_length = header_length() - sizeof(longfist::types::frame_header);
+    return header_length() > sizeof(longfist::types::frame_header) and
+           extended_length % FRAME_UID_COUNT_LENGTH == FRAME_CHECKSUM_LENGTH;
+  }
+
+  [[nodiscard]] uint32_t checksum() const {
+    uint32_t checksum;
+    memcpy(&checksum, reinterpret_cast<void *>(address() + sizeof(longfist::types::frame_header)), sizeof(checksum));
+    return checksum;
+  }
+
+  /**
+   * CRC32C of the frame length, the rest of the header and the data, length is passed as writer stores it last
+   */
+  [[nodiscard]] uint32_t compute_checksum(uint32_t frame_length) const {
+    auto crc = util::crc32c(&frame_length, sizeof(frame_length));
+    auto header_rest = reinterpret_cast<const void *>(address() + sizeof(header_->length));
+    crc = util::crc32c(header_rest, sizeof(longfist::types::frame_header) - sizeof(header_->length), crc);
+    auto extended_begin = sizeof(longfist::types::frame_header) + FRAME_CHECKSUM_LENGTH;
+    if (header_length() > extended_begin) {
+      crc = util::crc32c(reinterpret_cast<const void *>(address() + extended_begin), header_length() - extended_begin,
+                         crc);
+    }
+    return util::crc32c(data_address(), frame_length - header_length(), crc);
+  }
+
+  /**
+   * @return true if the frame has no checksum or it matches the content
+   */
+  [[nodiscard]] bool verify_checksum() const {
+    return not has_checksum() or checksum() == compute_checksum(frame_length());
+  }
+
+  [[nodiscard]] uint32_t uid_count() const { return get_uid_count(*header_); }
+
   template <typename T> size_t copy_data(const T &data) {
     size_t length = sizeof(T);
     memcpy(const_cast<void *>(data_address()), &data, length);
@@ -81,7 +148,7 @@ private:
 
   void move_to_next() { set_address(address() + frame_length()); }
 
-  void set_header_length() { header_->header_length = sizeof(longfist::types::frame_header); }
+  void set_header_length(uint32_t length) { header_->header_length = length; }
 
   void set_data_length(uint32_t length) { header_->length = header_length() + length; }
 
@@ -95,11 +162,22 @@ private:
 
   void set_dest(uint32_t dest) { header_->dest = dest; }
 
+  void set_uid_count(uint64_t uid_count) {
+    memcpy(reinterpret_cast<void *>(address() + header_length() - FRAME_UID_COUNT_LENGTH), &uid_count,
+           sizeof(uid_count));
+  }
+
+  void set_checksum(uint32_t checksum) {
+    memcpy(reinterpret_cast<void *>(address() + sizeof(longfist::types::frame_header)), &checksum, sizeof(checksum));
+  }
+
   void copy(frame &source) { memcpy(header_, source.header_, source.frame_length()); }
 
   friend class journal;
 
   friend class writer;
+
+  friend class page_scanner;
 };
 } // namespace kungfu::yijinjing::journal
 
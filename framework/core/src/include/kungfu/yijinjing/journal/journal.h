@@ -3,6 +3,9 @@
 #ifndef YIJINJING_JOURNAL_H
 #define YIJINJING_JOURNAL_H
 
+#include <array>
+#include <atomic>
+#include <future>
 #include <mutex>
 
 #include <kungfu/common.h>
@@ -10,6 +13,7 @@
 #include <kungfu/yijinjing/journal/common.h>
 #include <kungfu/yijinjing/journal/frame.h>
 #include <kungfu/yijinjing/journal/page.h>
+#include <kungfu/yijinjing/journal/page_index.h>
 #include <kungfu/yijinjing/time.h>
 
 namespace kungfu::yijinjing::journal {
@@ -51,12 +55,22 @@ private:
   const uint32_t dest_id_;
   const bool is_writing_;
   const bool lazy_;
+  bool checksum_ = false;
   page_ptr page_;
   frame_ptr frame_;
   uint64_t page_frame_nb_;
 
   void load_page(int page_id);
 
+  /** @return false if the current frame has data but its checksum does not match */
+  [[nodiscard]] bool verify_frame() const;
+
+  /** switch to a page which is already loaded */
+  void load_page(const page_ptr &page);
+
+  /** move to the frame recorded by checkpoint, returns false if the checkpoint does not match page content */
+  bool load_checkpoint(const page_checkpoint &checkpoint);
+
   /** load next page, current page will be released if not empty */
   void load_next_page();
 
@@ -69,6 +83,12 @@ class reader {
 public:
   explicit reader(bool lazy) : lazy_(lazy), current_(nullptr){};
 
+  /**
+   * Check frame checksums before they are handed out, a mismatch throws journal_error.
+   * Meant for debugging, io_device turns it on by env KF_JOURNAL_VERIFY.
+   */
+  void set_verify_checksum(bool verify) { verify_checksum_ = verify; }
+
   ~reader();
 
   /**
@@ -97,16 +117,55 @@ public:
   /** seek next frame */
   void next();
 
+  /**
+   * pick the journal whose current frame has the smallest gen_time, O(log N) in the number of journals with data.
+   * Idle journals are polled, one load of the next frame length each, only when the smallest gen_time is not earlier
+   * than the time of the last poll, frames older than that can not be preceded by anything idle journals write later.
+   * Frames written with an explicit gen_time (write_at, copy_frame) are not bound by this and are merged when seen.
+   */
   void sort();
 
 private:
   const bool lazy_;
+  bool verify_checksum_ = false;
   journal *current_;
   std::unordered_map<uint64_t, journal> journals_;
+  /** min-heap on current frame gen_time, holds journals with data except current_ */
+  std::vector<journal *> ready_;
+  /** journals reached the end of written frames, polled by the committed length of their next frame */
+  std::vector<journal *> idle_;
+  /** time of the last poll of idle_, frames they write from then on are stamped no earlier */
+  int64_t watermark_ = 0;
+
+  void settle(journal *j);
+
+  void poll_idle();
+
+  void rebuild();
 };
 
+/**
+ * Journal writer, safe to be shared by multiple producer threads.
+ * Frame space is claimed by an atomic fetch-add on the page cursor, every frame is published by storing its length
+ * last, readers walk frames in address order so they stop at the first frame not committed yet.
+ * Locks are only taken at page boundaries.
+ * gen_time is stamped when the frame is closed, so frames of one producer are in gen_time order by address,
+ * frames of concurrent producers may be out of order by the time between their claim and their commit.
+ * page_index and journal::seek_to_time tolerate disorder within one checkpoint interval.
+ */
 class writer {
 public:
+  /**
+   * fraction of page size, when a page is filled beyond it next page gets allocated and prefaulted in background.
+   * can be overridden by env KF_PAGE_PREFAULT_THRESHOLD, set it to 0 to disable.
+   */
+  static constexpr double DEFAULT_PREFAULT_THRESHOLD = 0.8;
+
+  /**
+   * Pages created by writers carry a CRC32C in every frame if env KF_JOURNAL_CHECKSUM is set to anything but 0.
+   */
+  static constexpr bool DEFAULT_CHECKSUM = false;
+
   writer(const data::location_ptr &location, uint32_t dest_id, bool lazy, publisher_ptr publisher);
 
   [[nodiscard]] const data::location_ptr &get_location() const { return journal_.location_; }
@@ -115,13 +174,26 @@ public:
 
   [[nodiscard]] const journal &get_journal() const { return journal_; }
 
-  [[nodiscard]] const page_ptr get_current_page() const { return journal_.page_; }
+  [[nodiscard]] const page_ptr get_current_page() const;
 
   uint64_t current_frame_uid();
 
+  /**
+   * uid of the element at index of the array frame opened by open_array, current_frame_uid() is the one of index 0.
+   */
+  uint64_t current_element_uid(uint32_t index);
+
   frame_ptr open_frame(int64_t trigger_time, int32_t msg_type, uint32_t length);
 
-  void close_frame(size_t data_length, int64_t gen_time = time::now_in_nano());
+  /**
+   * Open a frame that takes uid_count frame uids, the ones of frames that would follow it are left unused.
+   */
+  frame_ptr open_frame(int64_t trigger_time, int32_t msg_type, uint32_t length, uint32_t uid_count);
+
+  /**
+   * @param gen_time stamped now if 0, set it only for frames taken from other journals or made at simulated time
+   */
+  void close_frame(size_t data_length, int64_t gen_time = 0);
 
   void copy_frame(const frame_ptr &source);
 
@@ -146,6 +218,18 @@ public:
     return const_cast<T &>(frame->template data<T>());
   }
 
+  /**
+   * Open one frame for an array of count T, written in place and notified once by close_data, or by close_frame with
+   * the length of the elements actually written.
+   * Every element takes a frame uid of its own, see current_element_uid, the frame header records how many.
+   * @return pointer to the first element in mmap file
+   */
+  template <typename T>
+  std::enable_if_t<size_fixed_v<T>, T *> open_array(int64_t trigger_time, int32_t msg_type, uint32_t count) {
+    auto frame = open_frame(trigger_time, msg_type, sizeof(T) * count, count);
+    return reinterpret_cast<T *>(const_cast<void *>(frame->data_address()));
+  }
+
   void close_data();
 
   template <typename T>
@@ -157,10 +241,9 @@ public:
 
   template <typename T>
   std::enable_if_t<size_unfixed_v<T>> write(int64_t trigger_time, const T &data, int32_t msg_type = T::tag) {
-    auto s = data.to_string();
-    auto size = s.length();
+    auto size = data.bytes_length();
     auto frame = open_frame(trigger_time, msg_type, size);
-    memcpy(const_cast<void *>(frame->data_address()), s.c_str(), size);
+    data.to_bytes(const_cast<char *>(frame->data_as_bytes()));
     close_frame(size);
   }
 
@@ -175,10 +258,9 @@ public:
 
   template <typename T>
   std::enable_if_t<size_unfixed_v<T>> write_as(int64_t trigger_time, const T &data, uint32_t source, uint32_t dest) {
-    auto s = data.to_string();
-    auto size = s.length();
+    auto size = data.bytes_length();
     auto frame = open_frame(trigger_time, T::tag, size);
-    memcpy(const_cast<void *>(frame->data_address()), s.c_str(), size);
+    data.to_bytes(const_cast<char *>(frame->data_as_bytes()));
     frame->set_source(source);
     frame->set_dest(dest);
     close_frame(size);
@@ -193,22 +275,54 @@ public:
 
   template <typename T>
   [[maybe_unused]] std::enable_if_t<size_unfixed_v<T>> write_at(int64_t gen_time, int64_t trigger_time, const T &data) {
-    auto s = data.to_string();
-    auto size = s.length();
+    auto size = data.bytes_length();
     auto frame = open_frame(trigger_time, T::tag, size);
-    memcpy(const_cast<void *>(frame->data_address()), s.c_str(), size);
+    data.to_bytes(const_cast<char *>(frame->data_as_bytes()));
     close_frame(size, gen_time);
   }
 
 private:
+  /** page being written, cursor packs (frame count << 32 | write position) so both advance in one fetch-add */
+  struct page_slot {
+    page_ptr page = {};
+    std::atomic<uint64_t> cursor = 0;
+    std::atomic<uint32_t> in_flight = 0;
+  };
+
+  /** frame opened by current thread, kept in thread local storage */
+  struct reservation {
+    const writer *owner = nullptr;
+    page_slot *slot = nullptr;
+    frame_ptr frame = {};
+    uint64_t cursor = 0;
+    uint32_t data_length = 0;
+    uint32_t uid_count = 1;
+  };
+
   const uint64_t frame_id_base_;
   journal journal_;
-  std::mutex writer_mtx_ = {};
+  page_index index_;
+  std::array<page_slot, 2> slots_ = {};
+  std::atomic<uint32_t> active_ = 0;
+  std::mutex page_mtx_ = {};
   publisher_ptr publisher_;
-  size_t size_to_write_;
   uint32_t writer_start_time_32int_;
+  uint32_t page_size_; // of new pages by page_policy, found once as it is checked for every frame
+  uint64_t prefault_position_;
+  std::atomic<uint32_t> prefault_page_id_ = 0;
+  std::future<page_ptr> next_page_;
+
+  static thread_local std::vector<reservation> reservations_;
+
+  reservation &reserve(int64_t trigger_time, uint32_t data_length, uint32_t uid_count = 1);
+
+  reservation *find_reservation() const;
+
+  void commit(reservation &r, uint32_t data_length, int64_t gen_time);
+
+  void prefault_next_page(uint32_t page_id);
 
-  void close_page(int64_t trigger_time);
+  void close_page(uint32_t slot_index, uint64_t position, int64_t trigger_time);
 };
 } // namespace kungfu::yijinjing::journal
 #endif // YIJINJING_JOURNAL_H
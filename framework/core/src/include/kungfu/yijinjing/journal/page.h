@@ -5,6 +5,8 @@
 
 #include <kungfu/yijinjing/journal/common.h>
 #include <kungfu/yijinjing/journal/frame.h>
+#include <kungfu/yijinjing/journal/page_archive.h>
+#include <kungfu/yijinjing/journal/page_policy.h>
 
 namespace kungfu::yijinjing::journal {
 
@@ -29,34 +31,73 @@ public:
 
   [[nodiscard]] uint32_t get_page_id() const { return page_id_; }
 
+  [[nodiscard]] uint32_t get_frame_header_length() const { return header_->frame_header_length; }
+
+  /**
+   * frames carry CRC32C checksums if the page was created with them, the flag is the frame header length it records
+   */
+  [[nodiscard]] bool has_checksum() const {
+    return header_->frame_header_length >= sizeof(longfist::types::frame_header) + FRAME_CHECKSUM_LENGTH;
+  }
+
+  [[nodiscard]] bool is_archived() const { return archive_ != nullptr; }
+
   [[nodiscard]] int64_t begin_time() const {
+    ensure_frame(first_frame_address());
     return reinterpret_cast<longfist::types::frame_header *>(first_frame_address())->gen_time;
   }
 
   [[nodiscard]] int64_t end_time() const {
+    ensure_frame(last_frame_address());
     return reinterpret_cast<longfist::types::frame_header *>(last_frame_address())->gen_time;
   }
 
   [[nodiscard]] uintptr_t address() const { return reinterpret_cast<uintptr_t>(header_); }
 
   [[nodiscard]] uintptr_t address_border() const {
-    return address() + header_->page_size - sizeof(longfist::types::frame_header);
+    return address() + header_->page_size - header_->frame_header_length;
   }
 
   [[nodiscard]] uintptr_t first_frame_address() const { return address() + header_->page_header_length; }
 
   [[nodiscard]] uintptr_t last_frame_address() const { return address() + header_->last_frame_position; }
 
+  [[nodiscard]] bool has_data() const {
+    ensure_frame(first_frame_address());
+    auto header = reinterpret_cast<longfist::types::frame_header *>(first_frame_address());
+    return header->length > 0 && header->msg_type > 0;
+  }
+
   [[nodiscard]] bool is_full() const {
+    ensure_frame(last_frame_address());
     return last_frame_address() + reinterpret_cast<longfist::types::frame_header *>(last_frame_address())->length >
            address_border();
   }
 
+  /**
+   * make the frame at address readable, archived pages inflate the block holding it on first use
+   */
+  void ensure_frame(uintptr_t address) const {
+    if (archive_ != nullptr) {
+      archive_->inflate(address - this->address());
+    }
+  }
+
+  /**
+   * load a page, archived pages are read from their archive when the page file is gone, they can not be written
+   * existing pages are mapped with the size in their header, new pages get the size of page_policy
+   * @param checksum frames of the page carry checksums if it is created by this call, existing pages keep theirs
+   */
   static page_ptr load(const data::location_ptr &location, uint32_t dest_id, uint32_t page_id, bool is_writing,
-                       bool lazy);
+                       bool lazy, bool populate = false, bool checksum = false);
 
   static std::string get_page_path(const data::location_ptr &location, uint32_t dest_id, uint32_t page_id);
 
+  /**
+   * @return true if the page file or its archive exists
+   */
+  static bool exists(const data::location_ptr &location, uint32_t dest_id, uint32_t page_id);
+
   static uint32_t find_page_id(const data::location_ptr &location, uint32_t dest_id, int64_t time);
 
 private:
@@ -66,6 +107,7 @@ private:
   const bool lazy_;
   const size_t size_;
   const longfist::types::page_header *header_;
+  std::unique_ptr<page_archive> archive_;
 
   page(data::location_ptr location, uint32_t dest_id, uint32_t page_id, size_t size, bool lazy, uintptr_t address);
 
@@ -74,23 +116,22 @@ private:
    */
   void set_last_frame_position(uint64_t position);
 
+  /**
+   * move last frame position forward only, frames can be committed out of order by concurrent producers
+   */
+  void update_last_frame_position(uint64_t position);
+
   friend class journal;
 
   friend class writer;
 
   friend class reader;
+
+  friend class page_scanner;
 };
 
 inline static uint32_t find_page_size(const data::location_ptr &location, uint32_t dest_id) {
-  if (location->category == longfist::enums::category::MD && dest_id != 1) {
-    return 128 * MB;
-  }
-  if ((location->category == longfist::enums::category::TD ||
-       location->category == longfist::enums::category::STRATEGY) &&
-      dest_id != 0) {
-    return 16 * MB;
-  }
-  return MB;
+  return page_policy::find(location, dest_id).page_size;
 }
 } // namespace kungfu::yijinjing::journal
 
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef YIJINJING_PAGE_ARCHIVE_H
+#define YIJINJING_PAGE_ARCHIVE_H
+
+#include <string>
+#include <vector>
+
+#include <kungfu/yijinjing/journal/common.h>
+#include <kungfu/yijinjing/time.h>
+
+namespace kungfu::yijinjing::journal {
+
+/**
+ * Head of an archived page file, {dest_id:08x}.{page_id}.journal.lz4 next to the page it replaces.
+ * The page content, from the page header to the end of the last frame, is cut into LZ4 blocks at frame boundaries so
+ * that any frame can be read by inflating the one block holding it, the zero fill after the last frame is dropped.
+ * An index of archived_block records follows the header, then the compressed blocks.
+ */
+struct archived_page_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t page_size;
+  uint32_t block_count;
+  uint64_t content_length;
+};
+static_assert(sizeof(archived_page_header) == 24);
+
+struct archived_block {
+  uint64_t offset; // of the compressed bytes in the archive file
+  uint32_t compressed_length;
+  uint32_t content_offset; // in the page
+  uint32_t content_length;
+  uint32_t reserved;
+};
+static_assert(sizeof(archived_block) == 24);
+
+/**
+ * Sizes and timings of archived pages, inflate time is measured by reading every block back before the page is
+ * replaced.
+ */
+struct archive_stats {
+  uint32_t pages = 0;
+  uint64_t page_bytes = 0;
+  uint64_t content_bytes = 0;
+  uint64_t archived_bytes = 0;
+  int64_t deflate_nanos = 0;
+  int64_t inflate_nanos = 0;
+
+  [[nodiscard]] double ratio() const { return archived_bytes == 0 ? 0 : double(page_bytes) / archived_bytes; }
+
+  /**
+   * @return content bytes inflated per second
+   */
+  [[nodiscard]] double read_throughput() const {
+    return inflate_nanos == 0 ? 0 : double(content_bytes) * time_unit::NANOSECONDS_PER_SECOND / inflate_nanos;
+  }
+
+  archive_stats &operator+=(const archive_stats &other);
+};
+
+/**
+ * Archived page content mapped from its file, blocks are inflated into the page buffer the first time a frame in
+ * them is asked for.
+ */
+class page_archive {
+public:
+  static constexpr uint32_t MAGIC = 0x5a4a464b; // KFJZ
+  static constexpr uint32_t DEFAULT_BLOCK_SIZE = 256 * KB;
+  static constexpr const char *SUFFIX = ".lz4";
+
+  page_archive(const std::string &path, uintptr_t content_address);
+
+  ~page_archive();
+
+  [[nodiscard]] const archived_page_header &get_header() const { return *header_; }
+
+  /**
+   * inflate the block holding the frame at position of the page if not done yet
+   */
+  void inflate(uint64_t position);
+
+  /**
+   * inflate all blocks
+   */
+  void inflate_all();
+
+  /**
+   * Deflate page content into the archive format.
+   * @param address address of the page, content_length bytes from it are taken
+   * @param page_size size of the page file
+   * @param block_size blocks end at the first frame boundary past it, a larger frame makes a block of its own
+   * @return bytes of the archive file
+   */
+  static std::string deflate(uintptr_t address, uint64_t content_length, uint32_t page_size,
+                             uint32_t block_size = DEFAULT_BLOCK_SIZE);
+
+  /**
+   * Replace a sealed page, one that ends with a PageEnd frame, by its archive.
+   * The archive is read back and compared with the page before the page file is removed.
+   * @return stats of the page, empty if the page is not sealed or already archived
+   */
+  static archive_stats archive(const data::location_ptr &location, uint32_t dest_id, uint32_t page_id,
+                               uint32_t block_size = DEFAULT_BLOCK_SIZE);
+
+  /**
+   * Archive sealed pages of location and dest_id that end before time, the last page is always left for the writer.
+   */
+  static archive_stats archive_before(const data::location_ptr &location, uint32_t dest_id, int64_t time,
+                                      uint32_t block_size = DEFAULT_BLOCK_SIZE);
+
+  static std::string get_archive_path(const data::location_ptr &location, uint32_t dest_id, uint32_t page_id);
+
+private:
+  const uintptr_t content_address_;
+  size_t file_size_;
+  uintptr_t file_address_;
+  const archived_page_header *header_;
+  const archived_block *blocks_;
+  std::vector<bool> inflated_;
+
+  void inflate_block(uint32_t index);
+};
+} // namespace kungfu::yijinjing::journal
+
+#endif // YIJINJING_PAGE_ARCHIVE_H
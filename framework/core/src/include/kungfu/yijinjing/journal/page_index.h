@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef YIJINJING_PAGE_INDEX_H
+#define YIJINJING_PAGE_INDEX_H
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <optional>
+
+#include <kungfu/yijinjing/journal/common.h>
+#include <kungfu/yijinjing/journal/page.h>
+
+namespace kungfu::yijinjing::journal {
+
+/**
+ * Checkpoint of a frame inside a journal page, one record is written for the first frame of every page,
+ * and one more each time the writer crosses a page_index::CHECKPOINT_INTERVAL boundary inside a page.
+ */
+struct page_checkpoint {
+  uint32_t page_id;
+  uint32_t frame_position;
+  uint32_t page_frame_nb; // frame uids taken in the page before this frame, see get_uid_count
+  uint32_t reserved;
+  int64_t gen_time;
+};
+static_assert(sizeof(page_checkpoint) == 24);
+
+/**
+ * Append-only time index sidecar for journal pages, stored as {dest_id:08x}.index next to the pages.
+ * Writer appends checkpoints as frames are closed, at most one per CHECKPOINT_INTERVAL, and flushes each right away
+ * so that the page being written is indexed as well and survives a crash, readers binary search it to find where to
+ * start scanning.
+ */
+class page_index {
+public:
+  static constexpr uint32_t CHECKPOINT_INTERVAL = MB;
+
+  page_index(data::location_ptr location, uint32_t dest_id);
+
+  ~page_index();
+
+  /**
+   * called by writer after a frame is closed, keeps a checkpoint if needed, safe to call from multiple producers
+   */
+  void on_frame(const page_ptr &page, uintptr_t frame_address, uint64_t page_frame_nb, int64_t gen_time);
+
+  /**
+   * called by writer before it seeks, truncates the index after the last checkpoint matching the pages on disk and
+   * indexes only the frames behind it, or only the last page if none matches
+   */
+  void validate();
+
+  /**
+   * find the checkpoint before the latest one before time, binary searched in the index file without loading it,
+   * gen_time is only ordered up to concurrent producers, see writer, so the scan starts one checkpoint earlier
+   * @return empty if time is not after the second checkpoint or the index can not be trusted, caller should fall back
+   *         to scan pages
+   */
+  static std::optional<page_checkpoint> find(const data::location_ptr &location, uint32_t dest_id, int64_t time);
+
+  /**
+   * find the page to scan from for time, by the same search as find
+   * @return empty if time is 0 or before the index, caller should fall back to list pages
+   */
+  static std::optional<uint32_t> find_page_id(const data::location_ptr &location, uint32_t dest_id, int64_t time);
+
+  /**
+   * regenerate the index from existing pages
+   * @return number of checkpoints written
+   */
+  static size_t rebuild(const data::location_ptr &location, uint32_t dest_id);
+
+  static std::string get_index_path(const data::location_ptr &location, uint32_t dest_id);
+
+private:
+  const data::location_ptr location_;
+  const uint32_t dest_id_;
+  FILE *file_;
+  std::mutex mutex_ = {};
+  std::atomic<uint32_t> last_page_id_;
+  std::atomic<uint64_t> next_position_;
+
+  void append(const page_checkpoint &checkpoint);
+
+  /**
+   * write checkpoints of frames in page from the one at frame_position, which is already indexed, or from the start
+   * if it is 0
+   * @return number of checkpoints written
+   */
+  static size_t index_page(FILE *file, const page_ptr &page, uint32_t frame_position, uint32_t page_frame_nb);
+
+  static size_t count_checkpoints(const std::string &path);
+
+  /**
+   * @return number of checkpoints before time, binary searched in file, or 0 if file can not be read
+   */
+  static size_t count_before(FILE *file, size_t count, int64_t time);
+
+  static bool read_checkpoint(FILE *file, size_t index, page_checkpoint &checkpoint);
+
+  static std::optional<page_checkpoint> read_last(const std::string &path);
+};
+} // namespace kungfu::yijinjing::journal
+
+#endif // YIJINJING_PAGE_INDEX_H
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef YIJINJING_PAGE_POLICY_H
+#define YIJINJING_PAGE_POLICY_H
+
+#include <kungfu/yijinjing/journal/common.h>
+#include <kungfu/yijinjing/util/os.h>
+
+namespace kungfu::yijinjing::journal {
+
+/**
+ * Size and mmap options for pages of a journal.
+ * By default page size is decided by category and dest, 128MB for MD, 16MB for TD and STRATEGY, 1MB for the rest,
+ * pages are not locked, and only non-lazy io devices such as master advise random access.
+ *
+ * Defaults are overridden by the journal policy setting, a JSON object read from env KF_JOURNAL_POLICY, or else from
+ * the Config of location system/journal/policy in the profile. Keys are a category, or category/group/name for one
+ * location which is applied over its category, such as
+ *   {"md": {"page_size": "256MB", "hugepage": "transparent"}, "strategy/default/demo": {"page_size": "1MB"}}
+ * Fields are page_size (bytes, or with KB, MB or GB), hugepage (none, transparent, hugetlb), lock (mlock pages
+ * loaded by writers and non-lazy io devices) and advice (none, normal, random, sequential, willneed).
+ *
+ * Page sizes must be powers of two, under hugetlb multiples of HUGE_PAGE_SIZE as well, sizes not set in the same entry
+ * are rounded up to it. Settings that can not be parsed or resolved are logged and defaults are used instead.
+ *
+ * Pages record their size in the page header, existing pages are loaded with the size they were created with.
+ */
+struct page_policy {
+  static constexpr uint32_t MIN_PAGE_SIZE = 64 * KB;
+  static constexpr uint32_t MAX_PAGE_SIZE = 1024 * MB;
+  static constexpr uint32_t HUGE_PAGE_SIZE = 2 * MB;
+
+  uint32_t page_size = MB;
+  os::mmap_options mmap = {};
+
+  /**
+   * @return JSON object of all fields, in the form parse takes
+   */
+  [[nodiscard]] std::string to_string() const;
+
+  /**
+   * settings are read from the profile once per process, reload() drops them
+   */
+  static page_policy find(const data::location_ptr &location, uint32_t dest_id);
+
+  /**
+   * @param setting JSON object of policy fields, they are taken over base
+   * @return policy checked, throws journal_error for sizes out of range or not a power of two and unknown values
+   */
+  static page_policy parse(const std::string &setting, page_policy base);
+
+  /**
+   * @param setting JSON object of policy fields, taken over the defaults of page_policy
+   */
+  static page_policy parse(const std::string &setting);
+
+  /**
+   * @param setting JSON object of the whole journal policy setting
+   * throws journal_error for keys other than a category or category/group/name, and for entries that do not resolve
+   * over the defaults of every dest of their category, location entries taken over their category entry
+   */
+  static void check(const std::string &setting);
+
+  static void reload();
+
+  /**
+   * @return location whose Config holds the journal policy setting
+   */
+  static data::location_ptr make_config_location(const data::locator_ptr &locator);
+
+  static uint32_t default_page_size(const data::location_ptr &location, uint32_t dest_id);
+};
+} // namespace kungfu::yijinjing::journal
+
+#endif // YIJINJING_PAGE_POLICY_H
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef YIJINJING_PAGE_SCANNER_H
+#define YIJINJING_PAGE_SCANNER_H
+
+#include <kungfu/yijinjing/journal/common.h>
+#include <kungfu/yijinjing/journal/page.h>
+
+namespace kungfu::yijinjing::journal {
+
+/**
+ * Result of scanning one page, frames are good up to end_position.
+ */
+struct page_scan {
+  uint32_t page_id = 0;
+  uint32_t frames = 0;
+  uint64_t end_position = 0;
+  uint64_t last_frame_position = 0;
+  bool sealed = false;
+  bool damaged = false;
+  bool repaired = false;
+  std::string error = {};
+};
+
+/**
+ * Validates journal pages after a crash, frames are walked from the start of a page until the first one that is not
+ * committed, does not fit its page, or fails its checksum on pages with checksum.
+ * Repair clears everything behind the last good frame and points last_frame_position at it.
+ * Only run it on journals that no process is writing.
+ */
+class page_scanner {
+public:
+  static page_scan scan(const data::location_ptr &location, uint32_t dest_id, uint32_t page_id, bool repair);
+
+  /**
+   * scan all pages of location and dest_id, the page index is rebuilt if any page is repaired
+   */
+  static std::vector<page_scan> scan_all(const data::location_ptr &location, uint32_t dest_id, bool repair);
+
+private:
+  /**
+   * @return empty if the frame at position is a good one, otherwise what is wrong with it
+   */
+  static std::string check_frame(const page_ptr &page, uint64_t position);
+};
+} // namespace kungfu::yijinjing::journal
+
+#endif // YIJINJING_PAGE_SCANNER_H
@@ -50,9 +50,15 @@ public:
 
   void request_cached(uint32_t source_id);
 
+  /**
+   * Call callback with a Time event once now reaches nanotime, timers are kept in the wheel driven by the event loop.
+   */
   void add_timer(int64_t nanotime, const std::function<void(const event_ptr &)> &callback);
 
-  void add_time_interval(int64_t nanotime, const std::function<void(const event_ptr &)> &callback);
+  /**
+   * Call callback with a Time event every duration nanoseconds from now on.
+   */
+  void add_time_interval(int64_t duration, const std::function<void(const event_ptr &)> &callback);
 
   virtual void on_trading_day(const event_ptr &event, int64_t daytime);
 
@@ -90,57 +96,6 @@ protected:
 
   void on_write_to_band(const event_ptr &event);
 
-  std::function<rx::observable<event_ptr>(rx::observable<event_ptr>)> timer(int64_t nanotime) {
-    auto writer = get_writer(master_cmd_location_->uid);
-    int32_t timer_usage_count = timer_usage_count_;
-    int64_t duration_ns = nanotime - now();
-    longfist::types::TimeRequest &r = writer->open_data<longfist::types::TimeRequest>(0);
-    r.id = timer_usage_count;
-    r.duration = duration_ns;
-    r.repeat = 1;
-    writer->close_data();
-    timer_checkpoints_[timer_usage_count] = now();
-    timer_usage_count_++;
-    return [&, duration_ns, timer_usage_count](const rx::observable<event_ptr> &src) {
-      return events_ | rx::filter([&, duration_ns, timer_usage_count](const event_ptr &event) {
-               return (event->msg_type() == longfist::types::Time::tag &&
-                       event->gen_time() > timer_checkpoints_[timer_usage_count] + duration_ns);
-             }) |
-             rx::first();
-    };
-  }
-
-  template <typename Duration, typename Enabled = rx::is_duration<Duration>>
-  std::function<rx::observable<event_ptr>(rx::observable<event_ptr>)> time_interval(Duration &&d) {
-    auto duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
-    auto writer = get_writer(master_cmd_location_->uid);
-    int32_t timer_usage_count = timer_usage_count_;
-    longfist::types::TimeRequest &r = writer->open_data<longfist::types::TimeRequest>(0);
-    r.id = timer_usage_count;
-    r.duration = duration_ns;
-    r.repeat = 1;
-    writer->close_data();
-    timer_checkpoints_[timer_usage_count] = now();
-    timer_usage_count_++;
-    return [&, duration_ns, timer_usage_count](const rx::observable<event_ptr> &src) {
-      return events_ | rx::filter([&, duration_ns, timer_usage_count](const event_ptr &event) {
-               if (event->msg_type() == longfist::types::Time::tag &&
-                   event->gen_time() > timer_checkpoints_[timer_usage_count] + duration_ns) {
-                 auto writer = get_writer(master_cmd_location_->uid);
-                 longfist::types::TimeRequest &r = writer->open_data<longfist::types::TimeRequest>(0);
-                 r.id = timer_usage_count;
-                 r.duration = duration_ns;
-                 r.repeat = 1;
-                 writer->close_data();
-                 timer_checkpoints_[timer_usage_count] = now();
-                 return true;
-               } else {
-                 return false;
-               }
-             });
-    };
-  }
-
   template <typename Duration, typename Enabled = rx::is_duration<Duration>>
   std::function<rx::observable<event_ptr>(rx::observable<event_ptr>)> timeout(Duration &&d) {
     auto duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
@@ -188,6 +143,11 @@ private:
 
   void expect_start();
 
+  /** ask master for a Time frame at nanotime, it wakes the loop up if blocked waiting */
+  void request_wakeup(int64_t nanotime);
+
+  [[nodiscard]] event_ptr make_time_event(int64_t deadline) const;
+
   template <typename DataType> void do_read_from(const event_ptr &event, uint32_t dest_id) {
     const DataType &request = event->data<DataType>();
     reader_->join(get_location(request.source_id), dest_id, request.from_time);
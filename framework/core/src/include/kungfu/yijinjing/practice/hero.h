@@ -7,11 +7,15 @@
 #ifndef KUNGFU_HERO_H
 #define KUNGFU_HERO_H
 
+#include <ctime>
+#include <deque>
+
 #include <kungfu/longfist/longfist.h>
 #include <kungfu/yijinjing/index/session.h>
 #include <kungfu/yijinjing/io.h>
 #include <kungfu/yijinjing/journal/journal.h>
 #include <kungfu/yijinjing/log.h>
+#include <kungfu/yijinjing/practice/timer.h>
 #include <kungfu/yijinjing/time.h>
 
 #ifndef KUNGFU_SETUP_LOG
@@ -28,6 +32,8 @@ inline yijinjing::data::location_ptr make_system_location(const std::string &gro
 
 typedef std::unordered_map<uint32_t, yijinjing::journal::writer_ptr> WriterMap;
 
+typedef std::function<void(const event_ptr &)> event_handler;
+
 class hero : public resource {
 public:
   explicit hero(yijinjing::io_device_ptr io_device);
@@ -125,6 +131,23 @@ public:
 
   const rx::connectable_observable<event_ptr> &get_events() const;
 
+  /**
+   * Register handler for events of the given msg_type, found by one table lookup per event instead of pushing every
+   * event through a filter per handler as events_ | is(...) does.
+   * Table handlers are called in registration order, before any rx subscriber of events_ sees the event.
+   * Plain rx handlers used to run in subscription order, the ones left on events_ still see events in the same
+   * order relative to table handlers: they take msg types no table handler takes (TimeReset, RequestStart,
+   * RequestStop, custom data), or frames before table handlers of them exist (state feed before start, runner
+   * prepare), or were subscribed after the table handlers anyway (master and cached frame feeds, self Register).
+   * Handlers added while dispatching take effect from the next event.
+   */
+  void handle(int32_t msg_type, const event_handler &handler);
+
+  /**
+   * Dispatch an event made in process, without a journal frame, to handlers registered by handle().
+   */
+  void post(const event_ptr &event);
+
 protected:
   int64_t begin_time_;
   int64_t end_time_;
@@ -135,6 +158,8 @@ protected:
   std::unordered_map<uint32_t, yijinjing::data::location_ptr> locations_ = {};
   std::unordered_map<uint32_t, longfist::types::Register> registry_ = {};
   rx::connectable_observable<event_ptr> events_ = {};
+  std::unordered_map<int32_t, std::deque<event_handler>> handlers_ = {};
+  timer_wheel timers_; // advanced by the loop to now before each frame gets dispatched
 
   const yijinjing::data::location_ptr master_home_location_;
   const yijinjing::data::location_ptr master_cmd_location_;
@@ -192,6 +217,11 @@ protected:
   };
 
   static constexpr auto feed_state_data = [](const event_ptr &event, auto &receiver) {
+    if (event->msg_type() == longfist::types::OrderInputBatch::tag) {
+      for_each_element<longfist::types::OrderInput>(
+          event, [&](const event_ptr &element) { receiver << typed_event_ptr<longfist::types::OrderInput>(element); });
+      return;
+    }
     boost::hana::for_each(longfist::StateDataTypes, [&](auto it) {
       using DataType = typename decltype(+boost::hana::second(it))::type;
       if (DataType::tag == event->msg_type()) {
@@ -201,6 +231,11 @@ protected:
   };
 
   static constexpr auto feed_trading_data = [](const event_ptr &event, auto &receiver) {
+    if (event->msg_type() == longfist::types::OrderInputBatch::tag) {
+      for_each_element<longfist::types::OrderInput>(
+          event, [&](const event_ptr &element) { receiver << typed_event_ptr<longfist::types::OrderInput>(element); });
+      return;
+    }
     boost::hana::for_each(longfist::TradingDataTypes, [&](auto it) {
       using DataType = typename decltype(+boost::hana::second(it))::type;
       if (DataType::tag == event->msg_type()) {
@@ -220,6 +255,16 @@ private:
 
   bool drain(const rx::subscriber<event_ptr> &sb);
 
+  void dispatch(const event_ptr &event);
+
+  void advance_timers();
+
+  /** pin the event loop thread and set its scheduler class by KF_CPU_AFFINITY and KF_SCHED_POLICY */
+  void setup_thread();
+
+  /** cpu usage and observer wait stats of the run, tells how well the wait strategy fits this process */
+  void report_wait_stats(int64_t run_time, std::clock_t run_clock) const;
+
   template <typename T>
   std::enable_if_t<T::reflect> do_require_read_from(yijinjing::journal::writer_ptr &&writer, int64_t trigger_time,
                                                     uint32_t dest_id, uint32_t source_id, int64_t from_time) {
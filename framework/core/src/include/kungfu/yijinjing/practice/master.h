@@ -14,13 +14,6 @@
 
 namespace kungfu::yijinjing::practice {
 
-struct timer_task {
-  int64_t checkpoint;
-  int64_t duration;
-  int64_t repeat_limit;
-  int64_t repeat_count;
-};
-
 class master : public hero {
 public:
   explicit master(yijinjing::data::location_ptr home, bool low_latency = false);
@@ -61,9 +54,11 @@ private:
   profile profile_;
 
   std::unordered_map<uint32_t, uint32_t> app_cmd_locations_ = {};
-  std::unordered_map<uint32_t, std::unordered_map<int32_t, timer_task>> timer_tasks_ = {};
+  std::unordered_map<uint32_t, std::unordered_map<int32_t, uint64_t>> timer_tasks_ = {}; // app -> request id -> timer
+
+  void schedule_timer_task(uint32_t app_id, int32_t task_id, int64_t deadline, int64_t duration, int64_t repeat);
 
-  void handle_timer_tasks();
+  void cancel_timer_tasks(uint32_t app_id);
 
   void try_add_location(int64_t trigger_time, const data::location_ptr &app_location);
 
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef KUNGFU_YIJINJING_TIMER_H
+#define KUNGFU_YIJINJING_TIMER_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace kungfu::yijinjing::practice {
+
+typedef std::function<void(int64_t deadline)> timer_callback;
+
+/**
+ * Hierarchical timing wheel keyed on nanosecond deadlines, with O(1) add, cancel and expire.
+ * Time is whatever the owner passes to advance, the hero loop passes its now so timers behave the same in live, replay
+ * and backtest. Deadlines are rounded up to ticks of 2^tick_bits nanoseconds, a timer never fires before its deadline
+ * and fires at most one tick after it.
+ */
+class timer_wheel {
+public:
+  explicit timer_wheel(int tick_bits = 10);
+
+  /**
+   * Schedule callback to be called by advance once time reaches deadline, deadlines already passed fire on next tick.
+   * @return id to cancel the timer with
+   */
+  uint64_t add(int64_t deadline, timer_callback callback);
+
+  /**
+   * @return false if the timer has fired or been cancelled already
+   */
+  bool cancel(uint64_t id);
+
+  /**
+   * Move time forward to now, calling callbacks of timers due in deadline order, those of one tick in adding order.
+   * Callbacks are free to add or cancel timers.
+   */
+  void advance(int64_t now);
+
+  [[nodiscard]] size_t size() const { return count_; }
+
+  [[nodiscard]] bool empty() const { return count_ == 0; }
+
+private:
+  static constexpr int LEVELS = 6;
+  static constexpr int SLOT_BITS = 8;
+  static constexpr int SLOTS = 1 << SLOT_BITS;
+  static constexpr int SLOT_MASK = SLOTS - 1;
+  static constexpr uint32_t NIL = UINT32_MAX;
+
+  struct node {
+    int64_t deadline = 0;
+    int64_t tick = 0;
+    timer_callback callback = {};
+    uint32_t generation = 0;
+    uint32_t prev = NIL;
+    uint32_t next = NIL;
+    int level = -1; // -1 when not scheduled
+    int slot = 0;
+  };
+
+  struct slot_list {
+    uint32_t head = NIL;
+    uint32_t tail = NIL;
+  };
+
+  struct level {
+    std::array<slot_list, SLOTS> slots = {};
+    std::array<uint64_t, SLOTS / 64> occupied = {};
+    size_t count = 0;
+  };
+
+  const int tick_bits_;
+  int64_t current_ = 0; // last tick processed
+  size_t count_ = 0;
+  std::array<level, LEVELS> levels_ = {};
+  std::vector<node> nodes_ = {};
+  std::vector<uint32_t> free_ = {};
+
+  [[nodiscard]] int64_t to_tick(int64_t deadline) const;
+
+  [[nodiscard]] int64_t next_tick() const;
+
+  void place(uint32_t index);
+
+  void unlink(uint32_t index);
+
+  void release(uint32_t index);
+
+  void cascade(int level, int slot);
+
+  void expire(int slot);
+};
+} // namespace kungfu::yijinjing::practice
+#endif // KUNGFU_YIJINJING_TIMER_H
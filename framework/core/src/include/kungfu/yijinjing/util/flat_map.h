@@ -0,0 +1,383 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef KUNGFU_YIJINJING_FLAT_MAP_H
+#define KUNGFU_YIJINJING_FLAT_MAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace kungfu::yijinjing::util {
+
+/**
+ * Open-addressing hash map with robin hood probing, a drop-in for the std::unordered_map uses across books and banks.
+ * Buckets are 8 bytes of hash and index into a dense array of entries, lookups probe contiguous memory and iteration
+ * walks the dense array. Entries live in chunks that are never moved, so references to values stay valid until the
+ * entry is erased, like those of std::unordered_map; book positions and bank states are handed out by reference.
+ * Erasing moves the last entry into the erased position, iterators other than the one returned by erase are
+ * invalidated, erasing while iterating with it = map.erase(it) still visits every entry once.
+ */
+template <typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class flat_map {
+public:
+  typedef Key key_type;
+  typedef T mapped_type;
+  typedef std::pair<const Key, T> value_type;
+  typedef size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef Hash hasher;
+  typedef KeyEqual key_equal;
+  typedef value_type &reference;
+  typedef const value_type &const_reference;
+
+  template <bool Const> class basic_iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef typename flat_map::value_type value_type;
+    typedef typename flat_map::difference_type difference_type;
+    typedef std::conditional_t<Const, const value_type, value_type> *pointer;
+    typedef std::conditional_t<Const, const value_type, value_type> &reference;
+
+    basic_iterator() = default;
+
+    basic_iterator(const flat_map *map, size_t index) : map_(map), index_(index) {}
+
+    template <bool C = Const, typename = std::enable_if_t<C>>
+    basic_iterator(const basic_iterator<false> &other) : map_(other.map_), index_(other.index_) {}
+
+    reference operator*() const { return *map_->entries_[index_]; }
+
+    pointer operator->() const { return map_->entries_[index_]; }
+
+    basic_iterator &operator++() {
+      index_++;
+      return *this;
+    }
+
+    basic_iterator operator++(int) {
+      auto it = *this;
+      index_++;
+      return it;
+    }
+
+    friend bool operator==(const basic_iterator &a, const basic_iterator &b) { return a.index_ == b.index_; }
+
+    friend bool operator!=(const basic_iterator &a, const basic_iterator &b) { return a.index_ != b.index_; }
+
+  private:
+    const flat_map *map_ = nullptr;
+    size_t index_ = 0;
+
+    friend class flat_map;
+    friend class basic_iterator<true>;
+  };
+
+  typedef basic_iterator<false> iterator;
+  typedef basic_iterator<true> const_iterator;
+
+  flat_map() = default;
+
+  flat_map(std::initializer_list<value_type> values) {
+    for (auto &value : values) {
+      insert(value);
+    }
+  }
+
+  flat_map(const flat_map &other) : hash_(other.hash_), equal_(other.equal_) {
+    reserve(other.size());
+    for (auto *entry : other.entries_) {
+      insert(*entry);
+    }
+  }
+
+  flat_map(flat_map &&other) noexcept { swap(other); }
+
+  ~flat_map() { destroy_entries(); }
+
+  flat_map &operator=(const flat_map &other) {
+    if (this != &other) {
+      flat_map copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
+
+  flat_map &operator=(flat_map &&other) noexcept {
+    flat_map moved(std::move(other));
+    swap(moved);
+    return *this;
+  }
+
+  void swap(flat_map &other) noexcept {
+    std::swap(hash_, other.hash_);
+    std::swap(equal_, other.equal_);
+    buckets_.swap(other.buckets_);
+    entries_.swap(other.entries_);
+    chunks_.swap(other.chunks_);
+    free_.swap(other.free_);
+    std::swap(chunk_used_, other.chunk_used_);
+    std::swap(chunk_size_, other.chunk_size_);
+  }
+
+  [[nodiscard]] size_t size() const { return entries_.size(); }
+
+  [[nodiscard]] bool empty() const { return entries_.empty(); }
+
+  iterator begin() { return {this, 0}; }
+
+  iterator end() { return {this, entries_.size()}; }
+
+  const_iterator begin() const { return {this, 0}; }
+
+  const_iterator end() const { return {this, entries_.size()}; }
+
+  const_iterator cbegin() const { return begin(); }
+
+  const_iterator cend() const { return end(); }
+
+  iterator find(const Key &key) { return {this, find_entry(key)}; }
+
+  const_iterator find(const Key &key) const { return {this, find_entry(key)}; }
+
+  [[nodiscard]] size_t count(const Key &key) const { return find_entry(key) != entries_.size() ? 1 : 0; }
+
+  [[nodiscard]] bool contains(const Key &key) const { return find_entry(key) != entries_.size(); }
+
+  T &at(const Key &key) {
+    auto index = find_entry(key);
+    if (index == entries_.size()) {
+      throw std::out_of_range("flat_map::at");
+    }
+    return entries_[index]->second;
+  }
+
+  const T &at(const Key &key) const { return const_cast<flat_map *>(this)->at(key); }
+
+  T &operator[](const Key &key) { return try_emplace(key).first->second; }
+
+  template <typename... Args> std::pair<iterator, bool> try_emplace(const Key &key, Args &&...args) {
+    auto hash = hash_of(key);
+    auto index = find_entry(key, hash);
+    if (index != entries_.size()) {
+      return {{this, index}, false};
+    }
+    return {{this, add_entry(hash, key, std::forward<Args>(args)...)}, true};
+  }
+
+  template <typename... Args> std::pair<iterator, bool> emplace(Args &&...args) {
+    value_type value(std::forward<Args>(args)...);
+    return try_emplace(value.first, std::move(value.second));
+  }
+
+  std::pair<iterator, bool> insert(const value_type &value) { return try_emplace(value.first, value.second); }
+
+  template <typename M> std::pair<iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+    auto result = try_emplace(key, std::forward<M>(obj));
+    if (not result.second) {
+      result.first->second = std::forward<M>(obj);
+    }
+    return result;
+  }
+
+  size_t erase(const Key &key) {
+    auto index = find_entry(key);
+    if (index == entries_.size()) {
+      return 0;
+    }
+    remove_entry(index);
+    return 1;
+  }
+
+  iterator erase(const_iterator it) {
+    remove_entry(it.index_);
+    return {this, it.index_};
+  }
+
+  iterator erase(iterator it) { return erase(const_iterator(it)); }
+
+  void clear() {
+    for (auto *entry : entries_) {
+      entry->~value_type();
+      free_.push_back(entry);
+    }
+    entries_.clear();
+    std::fill(buckets_.begin(), buckets_.end(), bucket{});
+  }
+
+  void reserve(size_t count) {
+    entries_.reserve(count);
+    if (count > capacity()) {
+      rehash(bucket_count_for(count));
+    }
+  }
+
+private:
+  static constexpr uint32_t EMPTY = UINT32_MAX;
+  static constexpr size_t MIN_BUCKETS = 8;
+  static constexpr size_t MAX_CHUNK_SIZE = 1024;
+
+  struct bucket {
+    uint32_t hash = 0;
+    uint32_t index = EMPTY;
+  };
+
+  struct chunk_deleter {
+    void operator()(value_type *chunk) const { ::operator delete(chunk, std::align_val_t(alignof(value_type))); }
+  };
+
+  Hash hash_ = {};
+  KeyEqual equal_ = {};
+  std::vector<bucket> buckets_ = {};
+  std::vector<value_type *> entries_ = {};
+  std::vector<std::unique_ptr<value_type, chunk_deleter>> chunks_ = {};
+  std::vector<value_type *> free_ = {};
+  size_t chunk_used_ = 0;
+  size_t chunk_size_ = 0;
+
+  [[nodiscard]] uint32_t hash_of(const Key &key) const {
+    // std::hash of integers is the identity, mix it so that sequential ids spread over buckets
+    auto h = uint64_t(hash_(key)) * 0x9E3779B97F4A7C15ull;
+    return uint32_t(h >> 32u);
+  }
+
+  [[nodiscard]] size_t capacity() const { return buckets_.size() * 7 / 8; }
+
+  [[nodiscard]] static size_t bucket_count_for(size_t count) {
+    size_t buckets = MIN_BUCKETS;
+    while (buckets * 7 / 8 < count) {
+      buckets <<= 1u;
+    }
+    return buckets;
+  }
+
+  [[nodiscard]] size_t distance(size_t position, uint32_t hash) const {
+    return (position - hash) & (buckets_.size() - 1);
+  }
+
+  [[nodiscard]] size_t find_entry(const Key &key) const { return empty() ? 0 : find_entry(key, hash_of(key)); }
+
+  [[nodiscard]] size_t find_entry(const Key &key, uint32_t hash) const {
+    if (buckets_.empty()) {
+      return entries_.size();
+    }
+    auto mask = buckets_.size() - 1;
+    for (size_t position = hash & mask, probed = 0;; position = (position + 1) & mask, probed++) {
+      auto &b = buckets_[position];
+      if (b.index == EMPTY or probed > distance(position, b.hash)) {
+        return entries_.size();
+      }
+      if (b.hash == hash and equal_(entries_[b.index]->first, key)) {
+        return b.index;
+      }
+    }
+  }
+
+  [[nodiscard]] size_t find_bucket(uint32_t hash, uint32_t index) const {
+    auto mask = buckets_.size() - 1;
+    auto position = hash & mask;
+    while (buckets_[position].index != index) {
+      position = (position + 1) & mask;
+    }
+    return position;
+  }
+
+  void place(bucket b) {
+    auto mask = buckets_.size() - 1;
+    for (size_t position = b.hash & mask, probed = 0;; position = (position + 1) & mask, probed++) {
+      auto &slot = buckets_[position];
+      if (slot.index == EMPTY) {
+        slot = b;
+        return;
+      }
+      auto slot_distance = distance(position, slot.hash);
+      if (slot_distance < probed) {
+        std::swap(slot, b);
+        probed = slot_distance;
+      }
+    }
+  }
+
+  void rehash(size_t bucket_count) {
+    buckets_.assign(bucket_count, bucket{});
+    for (size_t index = 0; index < entries_.size(); index++) {
+      place({hash_of(entries_[index]->first), uint32_t(index)});
+    }
+  }
+
+  value_type *allocate() {
+    if (not free_.empty()) {
+      auto *slot = free_.back();
+      free_.pop_back();
+      return slot;
+    }
+    if (chunks_.empty() or chunk_used_ == chunk_size_) {
+      // chunks double up to a cap, small maps of many books stay small and large ones do not allocate per entry
+      auto size = chunks_.empty() ? size_t(4) : std::min(chunk_size_ * 2, MAX_CHUNK_SIZE);
+      auto *chunk = static_cast<value_type *>(
+          ::operator new(sizeof(value_type) * size, std::align_val_t(alignof(value_type))));
+      chunks_.emplace_back(chunk);
+      chunk_size_ = size;
+      chunk_used_ = 0;
+    }
+    return chunks_.back().get() + chunk_used_++;
+  }
+
+  template <typename... Args> size_t add_entry(uint32_t hash, const Key &key, Args &&...args) {
+    if (entries_.size() + 1 > capacity()) {
+      rehash(bucket_count_for(entries_.size() + 1));
+    }
+    if (entries_.size() == entries_.capacity()) {
+      entries_.reserve(std::max(MIN_BUCKETS, entries_.size() * 2)); // push_back below must not throw
+    }
+    auto *slot = allocate();
+    try {
+      new (slot) value_type(std::piecewise_construct, std::forward_as_tuple(key),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+    } catch (...) {
+      free_.push_back(slot);
+      throw;
+    }
+    auto index = entries_.size();
+    entries_.push_back(slot);
+    place({hash, uint32_t(index)});
+    return index;
+  }
+
+  void remove_entry(size_t index) {
+    auto mask = buckets_.size() - 1;
+    auto position = find_bucket(hash_of(entries_[index]->first), index);
+    // backward shift deletion, entries after the removed one move one bucket closer to home
+    for (auto next = (position + 1) & mask;
+         buckets_[next].index != EMPTY and distance(next, buckets_[next].hash) > 0; next = (next + 1) & mask) {
+      buckets_[position] = buckets_[next];
+      position = next;
+    }
+    buckets_[position] = {};
+    auto *entry = entries_[index];
+    auto last = entries_.size() - 1;
+    if (index != last) {
+      buckets_[find_bucket(hash_of(entries_[last]->first), last)].index = uint32_t(index);
+      entries_[index] = entries_[last];
+    }
+    entries_.pop_back();
+    entry->~value_type();
+    free_.push_back(entry);
+  }
+
+  void destroy_entries() {
+    for (auto *entry : entries_) {
+      entry->~value_type();
+    }
+    entries_.clear();
+  }
+};
+} // namespace kungfu::yijinjing::util
+#endif // KUNGFU_YIJINJING_FLAT_MAP_H
@@ -7,6 +7,7 @@
 #ifndef KUNGFU_YIJINJING_OS_H
 #define KUNGFU_YIJINJING_OS_H
 
+#include <cstdint>
 #include <string>
 
 #ifdef _WINDOWS
@@ -17,16 +18,81 @@
 #endif
 
 namespace kungfu::yijinjing::os {
+/**
+ * access pattern of a mapping told to the kernel by madvise, none leaves the kernel default
+ */
+enum class mmap_advice { none, normal, random, sequential, willneed };
+
+/**
+ * huge pages of a mapping, transparent asks for THP by madvise(MADV_HUGEPAGE) and is taken by file systems that
+ * support it such as tmpfs, hugetlb maps with MAP_HUGETLB and needs the file on a hugetlbfs mount
+ */
+enum class mmap_hugepage { none, transparent, hugetlb };
+
+/**
+ * hugepage only works on linux, options are ignored on windows
+ */
+struct mmap_options {
+  mmap_advice advice = mmap_advice::none;
+  mmap_hugepage hugepage = mmap_hugepage::none;
+  bool lock = false;
+};
+
 /**
  * load mmap buffer, return address of the file-mapped memory
  * whether to write has to be specified in "is_writing"
- * buffer memory is locked if not lazy
+ * file blocks are allocated and pages are faulted in ahead if populate, to keep first touches off the hot path
+ * @param options advice and huge pages are applied to the mapping, throws journal_error if lock is set but refused
  * @return the address of mapped memory
  */
-uintptr_t load_mmap_buffer(const std::string &path, size_t size, bool is_writing = false, bool lazy = true);
+uintptr_t load_mmap_buffer(const std::string &path, size_t size, bool is_writing = false, bool lazy = true,
+                           bool populate = false, const mmap_options &options = {});
 
 bool release_mmap_buffer(uintptr_t address, [[maybe_unused]] size_t size, bool lazy);
 
+/**
+ * reserve zero filled memory backed by no file, pages are only committed when touched
+ * @return the address of the memory
+ */
+uintptr_t load_anonymous_buffer(size_t size);
+
+bool release_anonymous_buffer(uintptr_t address, [[maybe_unused]] size_t size);
+
+/**
+ * whether futex_wait/futex_wake work on this platform, they are only available on linux
+ */
+bool futex_supported();
+
+/**
+ * block while the 32 bits word at address still equals expected, the word can live in memory shared by processes
+ * @return false if timed out or not supported, true if woken up or the word has already changed
+ */
+bool futex_wait(uint32_t *address, uint32_t expected, int timeout_ms);
+
+/**
+ * wake up all waiters blocked on the word at address
+ */
+void futex_wake(uint32_t *address);
+
+/**
+ * pin the calling thread to cpus listed like "2,4-7", throws yijinjing_error if the list can not be parsed
+ * @return false if not supported or refused by the system
+ */
+bool set_cpu_affinity(const std::string &cpus);
+
+/**
+ * set scheduler class of the calling thread, policy is one of other, batch, idle, fifo, rr, written as "fifo:50" to
+ * give the priority for realtime classes, throws yijinjing_error if the policy is unknown
+ * @return false if not supported or refused by the system, realtime classes usually need CAP_SYS_NICE
+ */
+bool set_scheduler(const std::string &policy);
+
+/**
+ * tell the cpu the caller is spinning on memory written by another core, pause on x86 and yield on arm, nothing
+ * elsewhere
+ */
+void cpu_pause();
+
 [[maybe_unused]] void disable_os_signals_handler();
 
 void handle_os_signals(void *hero);
@@ -23,6 +23,15 @@ uint32_t hash_32(const unsigned char *key, int32_t length, uint32_t seed = KUNGF
 
 uint32_t hash_str_32(const std::string &key, uint32_t seed = KUNGFU_HASH_SEED);
 
+/**
+ * CRC32C (Castagnoli), with SSE 4.2 or ARMv8 CRC instructions when the CPU has them
+ * @param data content to be checked
+ * @param length length of data
+ * @param crc result of the content before data, to checksum discontiguous pieces
+ * @return crc result
+ */
+uint32_t crc32c(const void *data, size_t length, uint32_t crc = 0);
+
 void color_print(const std::string &level, const std::string &log);
 
 bool in_color_terminal();
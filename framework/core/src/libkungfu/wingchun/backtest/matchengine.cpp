@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+
+#include <kungfu/wingchun/backtest/matchengine.h>
+
+using namespace kungfu::longfist::enums;
+using namespace kungfu::longfist::types;
+
+namespace kungfu::wingchun::backtest {
+constexpr int DEPTH_LEVELS = 10;
+constexpr int BEST5_LEVELS = 5;
+
+namespace {
+bool is_buy_side(Side side) { return side == Side::Buy or side == Side::MarginTrade or side == Side::RepayStock; }
+
+bool is_sell_side(Side side) { return side == Side::Sell or side == Side::ShortSell or side == Side::RepayMargin; }
+
+int market_depth(PriceType price_type) {
+  return price_type == PriceType::FakBest5 or price_type == PriceType::ReverseBest ? BEST5_LEVELS : DEPTH_LEVELS;
+}
+} // namespace
+
+MatchEngine::MatchEngine(MatchSettings settings, Sink sink) : settings_(settings), sink_(std::move(sink)) {}
+
+void MatchEngine::insert_order(int64_t trigger_time, uint32_t source, uint32_t dest, const OrderInput &input) {
+  requests_.push({trigger_time + settings_.insert_latency, request_seq_++, source, dest, false, input, {}});
+}
+
+void MatchEngine::cancel_order(int64_t trigger_time, uint32_t source, uint32_t dest, const OrderAction &action) {
+  requests_.push({trigger_time + settings_.cancel_latency, request_seq_++, source, dest, true, {}, action});
+}
+
+void MatchEngine::advance(int64_t time) {
+  now_ = std::max(now_, time);
+  if (busy_) {
+    return; // requests made by callbacks while matching are picked up by the outer call
+  }
+  busy_ = true;
+  while (not requests_.empty() and requests_.top().arrive_time <= now_) {
+    auto request = requests_.top();
+    requests_.pop();
+    if (request.is_cancel) {
+      cancel(request.arrive_time, request);
+    } else {
+      accept(request.arrive_time, request);
+    }
+  }
+  busy_ = false;
+}
+
+void MatchEngine::on_quote(int64_t time, const Quote &quote) {
+  advance(time);
+  busy_ = true;
+  auto &book = books_[hash_instrument(quote.exchange_id, quote.instrument_id)];
+  auto traded = book.has_quote ? quote.volume - book.quote.volume : 0;
+  book.quote = quote;
+  book.has_quote = true;
+  for (size_t i = 0; i < book.resting.size(); i++) {
+    auto &resting = orders_.at(book.resting[i]);
+    auto &order = resting.order;
+    auto best = resting.is_buy ? quote.ask_price[0] : quote.bid_price[0];
+    auto crossed = resting.is_buy ? is_less_equal(best, order.limit_price) : is_greater_equal(best, order.limit_price);
+    crossed = crossed and is_valid_price(best);
+    if (not is_final_status(order.status) and crossed) {
+      take(time, book, resting, DEPTH_LEVELS, true);
+    }
+  }
+  if (not book.has_transaction and traded > 0 and is_valid_price(quote.last_price)) {
+    match_resting(time, book, quote.last_price, traded); // no tick by tick data, infer trades from volume growth
+  }
+  remove_finished(book);
+  busy_ = false;
+  advance(time);
+}
+
+void MatchEngine::on_transaction(int64_t time, const Transaction &transaction) {
+  advance(time);
+  if (transaction.exec_type == ExecType::Cancel or not is_valid_price(transaction.price)) {
+    return;
+  }
+  busy_ = true;
+  auto &book = books_[hash_instrument(transaction.exchange_id, transaction.instrument_id)];
+  book.has_transaction = true;
+  match_resting(time, book, transaction.price, transaction.volume);
+  remove_finished(book);
+  busy_ = false;
+  advance(time);
+}
+
+void MatchEngine::accept(int64_t time, const Request &request) {
+  auto &input = request.input;
+  auto &book = books_[hash_instrument(input.exchange_id, input.instrument_id)];
+  auto &resting = orders_.insert_or_assign(input.order_id, RestingOrder{}).first->second;
+  auto &order = resting.order;
+  order_from_input(input, order);
+  order.insert_time = input.insert_time;
+  if (book.has_quote) {
+    order.trading_day = book.quote.trading_day;
+  }
+  resting.source = request.dest;
+  resting.dest = request.source;
+  resting.is_buy = is_buy_side(input.side);
+
+  if (not resting.is_buy and not is_sell_side(input.side)) {
+    reject(time, resting, "side not supported by backtest");
+  } else if (input.volume <= 0) {
+    reject(time, resting, "invalid volume");
+  } else if (input.price_type == PriceType::Limit and not is_valid_price(input.limit_price)) {
+    reject(time, resting, "invalid limit price");
+  } else {
+    update(time, resting, OrderStatus::Submitted);
+  }
+  if (is_final_status(order.status)) {
+    orders_.erase(input.order_id);
+    return;
+  }
+
+  auto &quote = book.quote;
+  auto limited = input.price_type == PriceType::Limit;
+  if (input.price_type == PriceType::ForwardBest) {
+    auto own_best = resting.is_buy ? quote.bid_price[0] : quote.ask_price[0];
+    if (book.has_quote and is_valid_price(own_best)) {
+      order.limit_price = own_best;
+      limited = true;
+    }
+  }
+  if (input.price_type == PriceType::Fok) {
+    int64_t available = 0;
+    for (int i = 0; book.has_quote and i < DEPTH_LEVELS; i++) {
+      available += resting.is_buy ? quote.ask_volume[i] : quote.bid_volume[i];
+    }
+    if (available < order.volume_left) {
+      update(time, resting, OrderStatus::Cancelled);
+      orders_.erase(input.order_id);
+      return;
+    }
+  }
+  if (input.price_type != PriceType::ForwardBest) {
+    take(time, book, resting, limited ? DEPTH_LEVELS : market_depth(input.price_type), false);
+  }
+
+  auto rests = limited or (input.price_type == PriceType::ReverseBest and order.volume_left < order.volume);
+  if (order.volume_left > 0 and rests and input.time_condition != TimeCondition::IOC) {
+    resting.queue_ahead =
+        settings_.queue_model == QueueModel::Conservative ? shown_volume(quote, resting.is_buy, order.limit_price) : 0;
+    book.resting.push_back(order.order_id);
+    return;
+  }
+  if (order.volume_left > 0) {
+    auto traded = order.volume_left < order.volume;
+    update(time, resting, traded ? OrderStatus::PartialFilledNotActive : OrderStatus::Cancelled);
+  }
+  orders_.erase(input.order_id);
+}
+
+void MatchEngine::cancel(int64_t time, const Request &request) {
+  auto &action = request.action;
+  auto it = orders_.find(action.order_id);
+  if (it == orders_.end() or is_final_status(it->second.order.status)) {
+    OrderActionError error = {};
+    error.order_id = action.order_id;
+    error.order_action_id = action.order_action_id;
+    error.error_id = -1;
+    error.error_msg = "order not found or already finished";
+    error.insert_time = time;
+    sink_(std::make_shared<SimulatedEvent<OrderActionError>>(time, request.dest, request.source, error));
+    return;
+  }
+  auto &resting = it->second;
+  auto &order = resting.order;
+  auto traded = order.volume_left < order.volume;
+  update(time, resting, traded ? OrderStatus::PartialFilledNotActive : OrderStatus::Cancelled);
+  remove_finished(books_[hash_instrument(order.exchange_id, order.instrument_id)]);
+}
+
+void MatchEngine::take(int64_t time, InstrumentBook &book, RestingOrder &resting, int depth, bool passive) {
+  if (not book.has_quote) {
+    return;
+  }
+  auto &order = resting.order;
+  auto limited = order.price_type == PriceType::Limit or order.price_type == PriceType::ForwardBest or passive;
+  auto &prices = resting.is_buy ? book.quote.ask_price : book.quote.bid_price;
+  auto &volumes = resting.is_buy ? book.quote.ask_volume : book.quote.bid_volume;
+  for (int i = 0; i < depth and order.volume_left > 0; i++) {
+    double price = prices[i];
+    if (not is_valid_price(price) or volumes[i] <= 0) {
+      break;
+    }
+    if (limited and (resting.is_buy ? is_greater(price, order.limit_price) : is_less(price, order.limit_price))) {
+      break;
+    }
+    auto volume = std::min(order.volume_left, volumes[i]);
+    volumes[i] -= volume; // depth taken is gone until next quote
+    fill(time, resting, passive ? order.limit_price : price, volume);
+  }
+}
+
+void MatchEngine::fill(int64_t time, RestingOrder &resting, double price, int64_t volume) {
+  auto &order = resting.order;
+  order.volume_left -= volume;
+
+  Trade trade = {};
+  trade_from_order(order, trade);
+  trade.trade_id = uint64_t(resting.source) << 32u | ++trade_seq_;
+  trade.trade_time = time;
+  trade.trading_day = order.trading_day;
+  trade.price = price;
+  trade.volume = volume;
+  // accounting expects positions updated by trade before order turns final
+  sink_(std::make_shared<SimulatedEvent<Trade>>(time, resting.source, resting.dest, trade));
+  update(time, resting, order.volume_left > 0 ? OrderStatus::PartialFilledActive : OrderStatus::Filled);
+}
+
+void MatchEngine::update(int64_t time, RestingOrder &resting, OrderStatus status) {
+  resting.order.status = status;
+  resting.order.update_time = time;
+  sink_(std::make_shared<SimulatedEvent<Order>>(time, resting.source, resting.dest, resting.order));
+}
+
+void MatchEngine::reject(int64_t time, RestingOrder &resting, const std::string &error_msg) {
+  resting.order.error_id = -1;
+  resting.order.error_msg = error_msg.c_str();
+  update(time, resting, OrderStatus::Error);
+}
+
+void MatchEngine::match_resting(int64_t time, InstrumentBook &book, double trade_price, int64_t trade_volume) {
+  // one trade has a buyer and a seller, each side of resting orders gets the traded volume once
+  int64_t volume_left[2] = {trade_volume, trade_volume};
+  for (auto order_id : book.resting) {
+    auto &resting = orders_.at(order_id);
+    auto &order = resting.order;
+    auto &left = volume_left[resting.is_buy ? 0 : 1];
+    if (is_final_status(order.status) or left <= 0) {
+      continue;
+    }
+    double price = order.limit_price;
+    auto through = resting.is_buy ? is_greater(price, trade_price) : is_less(price, trade_price);
+    if (not through and not is_equal(price, trade_price)) {
+      continue;
+    }
+    if (not through) {
+      auto consumed = std::min(resting.queue_ahead, left);
+      resting.queue_ahead -= consumed;
+      left -= consumed;
+    }
+    auto volume = std::min(order.volume_left, left);
+    if (volume > 0) {
+      left -= volume;
+      fill(time, resting, price, volume);
+    }
+  }
+}
+
+void MatchEngine::remove_finished(InstrumentBook &book) {
+  auto finished = [&](uint64_t order_id) {
+    auto it = orders_.find(order_id);
+    if (it != orders_.end() and is_final_status(it->second.order.status)) {
+      orders_.erase(it);
+      return true;
+    }
+    return it == orders_.end();
+  };
+  book.resting.erase(std::remove_if(book.resting.begin(), book.resting.end(), finished), book.resting.end());
+}
+
+int64_t MatchEngine::shown_volume(const Quote &quote, bool is_buy, double price) {
+  for (int i = 0; i < DEPTH_LEVELS; i++) {
+    if (is_equal(is_buy ? quote.bid_price[i] : quote.ask_price[i], price)) {
+      return is_buy ? quote.bid_volume[i] : quote.ask_volume[i];
+    }
+  }
+  return 0;
+}
+} // namespace kungfu::wingchun::backtest
@@ -13,13 +13,16 @@ using namespace kungfu::yijinjing::util;
 namespace kungfu::wingchun::basketorder {
 BasketOrderEngine::BasketOrderEngine(apprentice &app) : app_(app) {}
 
-void BasketOrderEngine::on_start(const rx::connectable_observable<event_ptr> &events) {
+void BasketOrderEngine::on_start() {
   restore(app_.get_state_bank());
 
-  events | is(BasketOrder::tag) | $$(on_basket_order(event->trigger_time(), event->data<BasketOrder>()));
-  events | is(Order::tag) | $$(update_basket_order(event->trigger_time(), event->data<Order>()));
-  events | is(Basket::tag) | $$(update_basket(event->data<Basket>()));
-  events | is(BasketInstrument::tag) | $$(update_basket_instrument(event->data<BasketInstrument>()));
+  app_.handle(BasketOrder::tag,
+              [&](const event_ptr &event) { on_basket_order(event->trigger_time(), event->data<BasketOrder>()); });
+  app_.handle(Order::tag,
+              [&](const event_ptr &event) { update_basket_order(event->trigger_time(), event->data<Order>()); });
+  app_.handle(Basket::tag, [&](const event_ptr &event) { update_basket(event->data<Basket>()); });
+  app_.handle(BasketInstrument::tag,
+              [&](const event_ptr &event) { update_basket_instrument(event->data<BasketInstrument>()); });
 }
 
 void BasketOrderEngine::restore(const cache::bank &state_bank) {
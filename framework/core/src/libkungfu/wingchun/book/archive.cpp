@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <filesystem>
+
+#include <kungfu/wingchun/book/archive.h>
+
+using namespace kungfu::longfist::types;
+
+namespace kungfu::wingchun::book {
+OrderArchive::OrderArchive(const std::string &path) { open(path); }
+
+void OrderArchive::open(const std::string &path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (path == path_ and file_.is_open()) {
+    return;
+  }
+  if (file_.is_open()) {
+    file_.close();
+  }
+  index_.clear();
+  end_ = 0;
+  path_ = path;
+  std::ofstream(path, std::ios::app | std::ios::binary).close(); // create if missing, keep what was archived before
+  file_.open(path, std::ios::in | std::ios::out | std::ios::binary);
+  if (not file_.is_open()) {
+    throw wingchun_error(fmt::format("can not open order archive {}", path));
+  }
+  load(path);
+  size_t count = 0;
+  for (const auto &pair : index_) {
+    count += pair.second.size();
+  }
+  SPDLOG_INFO("loaded {} archived orders from {}", count, path);
+}
+
+const std::string &OrderArchive::get_path() const { return path_; }
+
+void OrderArchive::archive(uint32_t holder_uid, const OrderInput *input, const Order &order,
+                           const std::vector<const Trade *> &trades) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &e = index_[holder_uid][order.order_id];
+  if (input != nullptr) {
+    e.input = write(holder_uid, *input);
+  }
+  e.order = write(holder_uid, order);
+  for (auto *trade : trades) {
+    e.last_trade = write(holder_uid, *trade, e.last_trade);
+  }
+}
+
+void OrderArchive::append(uint32_t holder_uid, const Order &order) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  index_[holder_uid][order.order_id].order = write(holder_uid, order);
+}
+
+void OrderArchive::append(uint32_t holder_uid, const Trade &trade) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &e = index_[holder_uid][trade.order_id];
+  for (auto offset = e.last_trade; offset >= 0;) {
+    if (read<Trade>(offset, &offset).trade_id == trade.trade_id) {
+      return;
+    }
+  }
+  e.last_trade = write(holder_uid, trade, e.last_trade);
+}
+
+bool OrderArchive::has_order(uint32_t holder_uid, uint64_t order_id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto e = find(holder_uid, order_id);
+  return e != nullptr and e->order >= 0;
+}
+
+std::optional<Order> OrderArchive::get_order(uint32_t holder_uid, uint64_t order_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto e = find(holder_uid, order_id);
+  if (e == nullptr or e->order < 0) {
+    return std::nullopt;
+  }
+  return read<Order>(e->order);
+}
+
+std::optional<OrderInput> OrderArchive::get_order_input(uint32_t holder_uid, uint64_t order_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto e = find(holder_uid, order_id);
+  if (e == nullptr or e->input < 0) {
+    return std::nullopt;
+  }
+  return read<OrderInput>(e->input);
+}
+
+std::vector<Trade> OrderArchive::get_trades(uint32_t holder_uid, uint64_t order_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return read_trades(find(holder_uid, order_id));
+}
+
+std::vector<Trade> OrderArchive::get_trades(uint32_t holder_uid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<Trade> trades = {};
+  auto holder_it = index_.find(holder_uid);
+  if (holder_it == index_.end()) {
+    return trades;
+  }
+  for (const auto &pair : holder_it->second) {
+    auto order_trades = read_trades(&pair.second);
+    trades.insert(trades.end(), order_trades.begin(), order_trades.end());
+  }
+  return trades;
+}
+
+size_t OrderArchive::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t size = 0;
+  for (const auto &pair : index_) {
+    size += pair.second.size();
+  }
+  return size;
+}
+
+const OrderArchive::entry *OrderArchive::find(uint32_t holder_uid, uint64_t order_id) const {
+  auto holder_it = index_.find(holder_uid);
+  if (holder_it == index_.end()) {
+    return nullptr;
+  }
+  auto it = holder_it->second.find(order_id);
+  return it == holder_it->second.end() ? nullptr : &it->second;
+}
+
+void OrderArchive::load(const std::string &path) {
+  file_.seekg(0, std::ios::end);
+  int64_t size = file_.tellg();
+  record_header header = {};
+  while (end_ + int64_t(sizeof(header)) <= size) {
+    file_.seekg(end_);
+    file_.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (not file_ or end_ + int64_t(sizeof(header) + header.length) > size) {
+      break;
+    }
+    auto &entries = index_[header.holder_uid];
+    if (header.msg_type == OrderInput::tag and header.length == sizeof(OrderInput)) {
+      entries[read<OrderInput>(end_).order_id].input = end_;
+    } else if (header.msg_type == Order::tag and header.length == sizeof(Order)) {
+      entries[read<Order>(end_).order_id].order = end_;
+    } else if (header.msg_type == Trade::tag and header.length == sizeof(Trade)) {
+      entries[read<Trade>(end_).order_id].last_trade = end_;
+    } else {
+      break;
+    }
+    end_ += sizeof(header) + header.length;
+  }
+  file_.clear();
+  if (end_ < size) {
+    SPDLOG_WARN("order archive {} truncated at {} of {} bytes, torn or unknown record", path, end_, size);
+    file_.close();
+    std::filesystem::resize_file(path, end_);
+    file_.open(path, std::ios::in | std::ios::out | std::ios::binary);
+  }
+}
+
+std::vector<Trade> OrderArchive::read_trades(const entry *e) {
+  std::vector<Trade> trades = {};
+  for (auto offset = e == nullptr ? -1 : e->last_trade; offset >= 0;) {
+    trades.push_back(read<Trade>(offset, &offset));
+  }
+  std::reverse(trades.begin(), trades.end());
+  return trades;
+}
+
+template <typename DataType> int64_t OrderArchive::write(uint32_t holder_uid, const DataType &data, int64_t previous) {
+  record_header header = {DataType::tag, sizeof(DataType), holder_uid, 0, previous};
+  auto offset = end_;
+  file_.seekp(offset);
+  file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file_.write(reinterpret_cast<const char *>(&data), sizeof(DataType));
+  if (not file_) {
+    throw wingchun_error(fmt::format("failed to archive {} at {}", DataType::type_name.c_str(), offset));
+  }
+  end_ += sizeof(header) + sizeof(DataType);
+  return offset;
+}
+
+template <typename DataType> DataType OrderArchive::read(int64_t offset, int64_t *previous) {
+  record_header header = {};
+  DataType data = {};
+  file_.seekg(offset);
+  file_.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (not file_ or header.msg_type != DataType::tag or header.length != sizeof(DataType)) {
+    throw wingchun_error(fmt::format("corrupted archive record of {} at {}", DataType::type_name.c_str(), offset));
+  }
+  file_.read(reinterpret_cast<char *>(&data), sizeof(DataType));
+  if (previous != nullptr) {
+    *previous = header.previous;
+  }
+  return data;
+}
+} // namespace kungfu::wingchun::book
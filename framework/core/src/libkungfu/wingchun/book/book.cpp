@@ -6,6 +6,7 @@
 
 #include <kungfu/wingchun/book/book.h>
 
+#include <algorithm>
 #include <utility>
 
 using namespace kungfu::rx;
@@ -16,6 +17,25 @@ using namespace kungfu::yijinjing;
 using namespace kungfu::yijinjing::data;
 
 namespace kungfu::wingchun::book {
+void PositionIndex::add(uint32_t instrument_key, uint32_t holder_uid) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  holders_[instrument_key].insert(holder_uid);
+}
+
+void PositionIndex::remove(uint32_t instrument_key, uint32_t holder_uid) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  auto it = holders_.find(instrument_key);
+  if (it != holders_.end() and it->second.erase(holder_uid) > 0 and it->second.empty()) {
+    holders_.erase(it);
+  }
+}
+
+std::vector<uint32_t> PositionIndex::get_holders(uint32_t instrument_key) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  auto it = holders_.find(instrument_key);
+  return it == holders_.end() ? std::vector<uint32_t>{} : std::vector<uint32_t>(it->second.begin(), it->second.end());
+}
+
 Book::Book(const CommissionMap &commissions_ref, const InstrumentMap &instruments_ref)
     : commissions(commissions_ref), instruments(instruments_ref) {}
 
@@ -23,6 +43,9 @@ double Book::get_frozen_price(uint64_t order_id) {
   if (orders.find(order_id) != orders.end()) {
     return orders.at(order_id).frozen_price;
   }
+  if (order_archive != nullptr and order_archive->has_order(asset.holder_uid, order_id)) {
+    return order_archive->get_order(asset.holder_uid, order_id)->frozen_price;
+  }
   return 0;
 }
 
@@ -91,6 +114,9 @@ Position &Book::get_position(Direction direction, const char *exchange_id, const
     position.holder_uid = asset.holder_uid;
     position.ledger_category = asset.ledger_category;
     position.direction = direction;
+    if (position_index != nullptr) {
+      position_index->add(position_id, asset.holder_uid);
+    }
   }
   return position;
 }
@@ -154,11 +180,122 @@ void Book::update(int64_t update_time) {
   asset_margin.short_market_value = short_market_value;
 }
 
-void Book::replace(const OrderInput &input) { order_inputs.insert_or_assign(input.order_id, input); }
+void Book::replace(const OrderInput &input) {
+  if (order_archive != nullptr and order_archive->has_order(asset.holder_uid, input.order_id)) {
+    order_inputs.erase(input.order_id);
+    return;
+  }
+  order_inputs.insert_or_assign(input.order_id, input);
+}
 
-void Book::replace(const Order &order) { orders.insert_or_assign(order.order_id, order); }
+void Book::replace(const Order &order) {
+  if (order_archive != nullptr and order_archive->has_order(asset.holder_uid, order.order_id)) {
+    // late updates of orders moved out already, accounting may have put it back to orders
+    order_archive->append(asset.holder_uid, order);
+    orders.erase(order.order_id);
+    return;
+  }
+  auto it = orders.find(order.order_id);
+  auto finished_before = it != orders.end() and is_final_status(it->second.status);
+  orders.insert_or_assign(order.order_id, order);
+  if (order_archive != nullptr and is_final_status(order.status) and not finished_before) {
+    finished_orders.emplace_back(order.update_time, order.order_id); // venues may send final updates more than once
+  }
+}
 
-void Book::replace(const Trade &trade) { trades.insert_or_assign(trade.trade_id, trade); }
+void Book::replace(const Trade &trade) {
+  if (order_archive != nullptr and order_archive->has_order(asset.holder_uid, trade.order_id)) {
+    order_archive->append(asset.holder_uid, trade);
+    trades.erase(trade.trade_id);
+    return;
+  }
+  trades.insert_or_assign(trade.trade_id, trade);
+  if (order_archive != nullptr) {
+    auto &trade_ids = order_trades[trade.order_id];
+    if (std::find(trade_ids.begin(), trade_ids.end(), trade.trade_id) == trade_ids.end()) {
+      trade_ids.push_back(trade.trade_id);
+    }
+  }
+}
+
+void Book::retain_orders(int64_t now, size_t max_count, int64_t max_age) {
+  if (order_archive == nullptr) {
+    return;
+  }
+  auto expired = [&](const std::pair<int64_t, uint64_t> &finished) {
+    return (max_count > 0 and finished_orders.size() > max_count) or
+           (max_age > 0 and finished.first <= now - max_age);
+  };
+  while (not finished_orders.empty() and expired(finished_orders.front())) {
+    auto order_id = finished_orders.front().second;
+    finished_orders.pop_front();
+    auto order_it = orders.find(order_id);
+    if (order_it == orders.end()) {
+      continue; // finished more than once
+    }
+    auto input_it = order_inputs.find(order_id);
+    auto trade_ids_it = order_trades.find(order_id);
+    std::vector<const Trade *> order_trade_list = {};
+    if (trade_ids_it != order_trades.end()) {
+      for (auto trade_id : trade_ids_it->second) {
+        auto trade_it = trades.find(trade_id);
+        if (trade_it != trades.end()) {
+          order_trade_list.push_back(&trade_it->second);
+        }
+      }
+    }
+    auto *input = input_it == order_inputs.end() ? nullptr : &input_it->second;
+    order_archive->archive(asset.holder_uid, input, order_it->second, order_trade_list);
+    if (trade_ids_it != order_trades.end()) {
+      for (auto trade_id : trade_ids_it->second) {
+        trades.erase(trade_id);
+      }
+      order_trades.erase(order_id);
+    }
+    order_inputs.erase(order_id);
+    orders.erase(order_id);
+  }
+}
+
+std::optional<Order> Book::find_order(uint64_t order_id) const {
+  auto it = orders.find(order_id);
+  if (it != orders.end()) {
+    return it->second;
+  }
+  return order_archive == nullptr ? std::nullopt : order_archive->get_order(asset.holder_uid, order_id);
+}
+
+std::optional<OrderInput> Book::find_order_input(uint64_t order_id) const {
+  auto it = order_inputs.find(order_id);
+  if (it != order_inputs.end()) {
+    return it->second;
+  }
+  return order_archive == nullptr ? std::nullopt : order_archive->get_order_input(asset.holder_uid, order_id);
+}
+
+std::vector<Trade> Book::find_trades(uint64_t order_id) const {
+  std::vector<Trade> result = {};
+  if (order_archive != nullptr) {
+    result = order_archive->get_trades(asset.holder_uid, order_id);
+  }
+  for (const auto &pair : trades) {
+    if (pair.second.order_id == order_id) {
+      result.push_back(pair.second);
+    }
+  }
+  return result;
+}
+
+std::vector<Trade> Book::list_trades() const {
+  std::vector<Trade> result = {};
+  if (order_archive != nullptr) {
+    result = order_archive->get_trades(asset.holder_uid);
+  }
+  for (const auto &pair : trades) {
+    result.push_back(pair.second);
+  }
+  return result;
+}
 
 void Book::mirror_position_from(const Book &book) {
   auto mirror_position = [&](const PositionMap &source_map) {
@@ -167,10 +304,23 @@ void Book::mirror_position_from(const Book &book) {
     }
   };
 
-  long_positions.clear();
-  short_positions.clear();
+  clear_positions();
   mirror_position(book.long_positions);
   mirror_position(book.short_positions);
 }
 
+void Book::clear_positions() {
+  if (position_index != nullptr) {
+    auto unindex = [&](const PositionMap &positions) {
+      for (auto &pair : positions) {
+        position_index->remove(pair.first, asset.holder_uid);
+      }
+    };
+    unindex(long_positions);
+    unindex(short_positions);
+  }
+  long_positions.clear();
+  short_positions.clear();
+}
+
 } // namespace kungfu::wingchun::book
\ No newline at end of file
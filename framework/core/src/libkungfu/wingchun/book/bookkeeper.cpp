@@ -27,20 +27,60 @@ Bookkeeper::Bookkeeper(apprentice &app, broker::Client &broker_client, bool bypa
   sync_position_ = skip_sync_position == nullptr;
   SPDLOG_DEBUG("sync_asset_: {}, sync_asset_margin_: {}, sync_position_: {}", sync_asset_, sync_asset_margin_,
                sync_position_);
+  char *retain_orders = std::getenv("KF_BOOK_RETAIN_ORDERS");
+  char *retain_seconds = std::getenv("KF_BOOK_RETAIN_SECONDS");
+  retain_orders_ = retain_orders == nullptr ? 0 : std::stoul(retain_orders);
+  retain_time_ = retain_seconds == nullptr ? 0 : std::stol(retain_seconds) * time_unit::NANOSECONDS_PER_SECOND;
+  if (retain_orders_ > 0 or retain_time_ > 0) {
+    order_archive_ = std::make_shared<OrderArchive>(get_archive_path(app_.get_trading_day()));
+    SPDLOG_INFO("books retain {} finished orders for {}s, 0 for no limit", retain_orders_,
+                retain_time_ / time_unit::NANOSECONDS_PER_SECOND);
+  }
 }
 
-bool Bookkeeper::has_book(uint32_t location_uid) { return books_.find(location_uid) != books_.end(); }
+bool Bookkeeper::has_book(uint32_t location_uid) {
+  std::shared_lock<std::shared_mutex> lock(books_mutex_);
+  return books_.find(location_uid) != books_.end();
+}
 
-void Bookkeeper::drop_book(uint32_t uid) { books_.erase(uid); }
+void Bookkeeper::drop_book(uint32_t uid) {
+  std::unique_lock<std::shared_mutex> lock(books_mutex_);
+  auto it = books_.find(uid);
+  if (it != books_.end()) {
+    std::lock_guard<std::mutex> book_lock(it->second->update_mutex);
+    it->second->clear_positions();
+    it->second->position_index = nullptr;
+    books_.erase(it);
+  }
+}
 
 Book_ptr Bookkeeper::get_book(uint32_t location_uid) {
-  if (books_.find(location_uid) == books_.end()) {
-    books_.emplace(location_uid, make_book(location_uid));
+  {
+    std::shared_lock<std::shared_mutex> lock(books_mutex_);
+    auto it = books_.find(location_uid);
+    if (it != books_.end()) {
+      return it->second;
+    }
+  }
+  std::unique_lock<std::shared_mutex> lock(books_mutex_);
+  auto it = books_.find(location_uid);
+  if (it == books_.end()) {
+    auto book = make_book(location_uid);
+    book->position_index = &position_index_;
+    book->order_archive = order_archive_.get();
+    it = books_.emplace(location_uid, book).first;
   }
-  return books_.at(location_uid);
+  return it->second;
+}
+
+BookMap Bookkeeper::get_books() const {
+  std::shared_lock<std::shared_mutex> lock(books_mutex_);
+  return books_;
 }
 
-const BookMap &Bookkeeper::get_books() const { return books_; }
+std::vector<uint32_t> Bookkeeper::get_position_holders(const char *exchange_id, const char *instrument_id) const {
+  return position_index_.get_holders(hash_instrument(exchange_id, instrument_id));
+}
 
 void Bookkeeper::set_accounting_method(InstrumentType instrument_type, const AccountingMethod_ptr &accounting_method) {
   accounting_methods_.emplace(instrument_type, accounting_method);
@@ -48,7 +88,7 @@ void Bookkeeper::set_accounting_method(InstrumentType instrument_type, const Acc
 
 void Bookkeeper::on_trading_day(int64_t daytime) {
   auto trading_day = time::strftime(daytime, KUNGFU_TRADING_DAY_FORMAT);
-  for (const auto &book_pair : books_) {
+  for (const auto &book_pair : get_books()) {
     const auto &book = book_pair.second;
     strcpy(book->asset.trading_day, trading_day.c_str());
     for (auto &pos_pair : book->long_positions) {
@@ -58,24 +98,44 @@ void Bookkeeper::on_trading_day(int64_t daytime) {
       pos_pair.second.trading_day = book->asset.trading_day;
     }
   }
+  if (order_archive_) {
+    // order ids may be taken again on a new day, archives of past days are left on disk for lookup by hand
+    order_archive_->open(get_archive_path(daytime));
+  }
 }
 
-void Bookkeeper::on_start(const rx::connectable_observable<event_ptr> &events) {
+void Bookkeeper::on_start() {
   restore(app_.get_state_bank());
   on_trading_day(app_.get_trading_day());
 
-  events | is(Instrument::tag) | $$(update_instrument(event->data<Instrument>()));
-  events | is_own<Quote>(broker_client_) | $$(try_update_book(event, event->data<Quote>()));
-  events | is(InstrumentKey::tag) | $$(update_book(event, event->data<InstrumentKey>()));
-  events | is(OrderInput::tag) | $$(update_book<OrderInput>(event, &AccountingMethod::apply_order_input));
-  events | is(Order::tag) | $$(update_book<Order>(event, &AccountingMethod::apply_order));
-  events | is(Trade::tag) | $$(update_book<Trade>(event, &AccountingMethod::apply_trade));
-  events | fork<Asset>(location::SYNC, &Bookkeeper::try_sync_asset, &Bookkeeper::try_update_asset);
-  events | fork<AssetMargin>(location::SYNC, &Bookkeeper::try_sync_asset_margin, &Bookkeeper::try_update_asset_margin);
-  events | fork<Position>(location::SYNC, &Bookkeeper::try_sync_position, &Bookkeeper::try_update_position);
-  events | fork<PositionEnd>(location::SYNC, &Bookkeeper::try_sync_position_end, &Bookkeeper::try_update_position_end);
-  events | is(TradingDay::tag) | $$(on_trading_day(event->data<TradingDay>().timestamp));
-  events | is(ResetBookRequest::tag) | $$(drop_book(event->source()));
+  app_.handle(Instrument::tag, [&](const event_ptr &event) { update_instrument(event->data<Instrument>()); });
+  app_.handle(Quote::tag, [&](const event_ptr &event) {
+    if (is_own_event<Quote>(broker_client_, event)) {
+      try_update_book(event, event->data<Quote>());
+    }
+  });
+  app_.handle(InstrumentKey::tag,
+              [&](const event_ptr &event) { update_book(event, event->data<InstrumentKey>()); });
+  app_.handle(OrderInput::tag, [&](const event_ptr &event) {
+    update_book<OrderInput>(event, &AccountingMethod::apply_order_input);
+  });
+  app_.handle(OrderInputBatch::tag, [&](const event_ptr &event) {
+    for_each_element<OrderInput>(event, [&](const event_ptr &element) {
+      update_book<OrderInput>(element, &AccountingMethod::apply_order_input);
+    });
+  });
+  app_.handle(Order::tag, [&](const event_ptr &event) { update_book<Order>(event, &AccountingMethod::apply_order); });
+  app_.handle(Trade::tag, [&](const event_ptr &event) { update_book<Trade>(event, &AccountingMethod::apply_trade); });
+  app_.handle(Asset::tag, fork<Asset>(location::SYNC, &Bookkeeper::try_sync_asset, &Bookkeeper::try_update_asset));
+  app_.handle(AssetMargin::tag, fork<AssetMargin>(location::SYNC, &Bookkeeper::try_sync_asset_margin,
+                                                  &Bookkeeper::try_update_asset_margin));
+  app_.handle(Position::tag,
+              fork<Position>(location::SYNC, &Bookkeeper::try_sync_position, &Bookkeeper::try_update_position));
+  app_.handle(PositionEnd::tag, fork<PositionEnd>(location::SYNC, &Bookkeeper::try_sync_position_end,
+                                                  &Bookkeeper::try_update_position_end));
+  app_.handle(TradingDay::tag,
+              [&](const event_ptr &event) { on_trading_day(event->data<TradingDay>().timestamp); });
+  app_.handle(ResetBookRequest::tag, [&](const event_ptr &event) { drop_book(event->source()); });
 
   if (bypass_quote_) {
     app_.add_time_interval(yijinjing::time_unit::NANOSECONDS_PER_SECOND * 15,
@@ -93,8 +153,6 @@ void Bookkeeper::batch_update_book_by_quote() {
   quotes_.clear();
 }
 
-std::mutex &Bookkeeper::get_update_book_mutex() { return update_book_mutex_; }
-
 void Bookkeeper::try_update_position_end(const PositionEnd &position_end) {
   get_book(position_end.holder_uid)->update(app_.now());
 }
@@ -118,10 +176,7 @@ void Bookkeeper::restore(const cache::bank &state_bank) {
     if (not app_.has_location(position.holder_uid)) {
       continue;
     }
-    auto book = get_book(position.holder_uid);
-    auto is_long = position.direction == longfist::enums::Direction::Long;
-    auto &positions = is_long ? book->long_positions : book->short_positions;
-    positions[hash_instrument(position.exchange_id, position.instrument_id)] = position;
+    get_book(position.holder_uid)->get_position_for(position.direction, position) = position;
   }
   for (auto &pair : state_bank[boost::hana::type_c<Asset>]) {
     auto &state = pair.second;
@@ -145,6 +200,60 @@ void Bookkeeper::restore(const cache::bank &state_bank) {
   }
 }
 
+void Bookkeeper::carry_over(const Book &book, int64_t daytime) {
+  auto holder_uid = book.asset.holder_uid;
+  if (not app_.has_location(holder_uid)) {
+    SPDLOG_WARN("carry over skipped book of unknown holder {:08x}", holder_uid);
+    return;
+  }
+  auto target = get_book(holder_uid);
+  std::lock_guard<std::mutex> lock(target->update_mutex);
+  target->asset = book.asset;
+  target->asset_margin = book.asset_margin;
+  for (const auto *positions : {&book.long_positions, &book.short_positions}) {
+    for (const auto &position_pair : *positions) {
+      const auto &position = position_pair.second;
+      if (accounting_methods_.find(position.instrument_type) == accounting_methods_.end()) {
+        SPDLOG_WARN("carry over {}.{} unrolled, no accounting method for instrument type {}", position.instrument_id,
+                    position.exchange_id, str_from_instrument_type(position.instrument_type));
+        target->get_position_for(position.direction, position) = position;
+      }
+    }
+  }
+  for (const auto &pair : accounting_methods_) {
+    // roll positions of one instrument type at a time, methods of other types would misprice them
+    auto day_book = std::make_shared<Book>(commissions_, instruments_);
+    auto carry = [&](const PositionMap &positions) {
+      for (const auto &position_pair : positions) {
+        const auto &position = position_pair.second;
+        if (position.instrument_type == pair.first) {
+          day_book->get_position_for(position.direction, position) = position;
+        }
+      }
+    };
+    carry(book.long_positions);
+    carry(book.short_positions);
+    if (day_book->long_positions.empty() and day_book->short_positions.empty()) {
+      continue;
+    }
+    day_book->asset = target->asset;
+    day_book->asset_margin = target->asset_margin;
+    pair.second->apply_trading_day(day_book, daytime);
+    target->asset = day_book->asset;
+    target->asset_margin = day_book->asset_margin;
+    for (auto *positions : {&day_book->long_positions, &day_book->short_positions}) {
+      for (const auto &position_pair : *positions) {
+        const auto &position = position_pair.second;
+        target->get_position_for(position.direction, position) = position;
+      }
+    }
+  }
+  auto trading_day = time::strftime(daytime, KUNGFU_TRADING_DAY_FORMAT);
+  strcpy(target->asset.trading_day, trading_day.c_str());
+  strcpy(target->asset_margin.trading_day, trading_day.c_str());
+  target->update(daytime);
+}
+
 void Bookkeeper::guard_positions() { positions_guarded_ = true; }
 
 Book_ptr Bookkeeper::make_book(uint32_t location_uid) {
@@ -162,6 +271,11 @@ Book_ptr Bookkeeper::make_book(uint32_t location_uid) {
   return book;
 }
 
+std::string Bookkeeper::get_archive_path(int64_t daytime) const {
+  auto archive_dir = app_.get_locator()->layout_dir(app_.get_home(), layout::JOURNAL);
+  return fmt::format("{}/bookkeeper.{}.archive", archive_dir, time::strftime(daytime, KUNGFU_TRADING_DAY_FORMAT));
+}
+
 void Bookkeeper::update_instrument(const longfist::types::Instrument &instrument) {
   auto pair = instruments_.try_emplace(hash_instrument(instrument.exchange_id, instrument.instrument_id), instrument);
   if (not pair.second) {
@@ -187,9 +301,10 @@ void Bookkeeper::update_instrument(const longfist::types::Instrument &instrument
 }
 
 void Bookkeeper::update_book(const event_ptr &event, const InstrumentKey &instrument_key) {
-  std::lock_guard<std::mutex> lock(update_book_mutex_);
   broker_client_.subscribe(instrument_key);
-  get_book(event->source())->ensure_position(instrument_key);
+  auto book = get_book(event->source());
+  std::lock_guard<std::mutex> lock(book->update_mutex);
+  book->ensure_position(instrument_key);
 }
 
 void Bookkeeper::try_update_book(const event_ptr &event, const Quote &quote) {
@@ -204,13 +319,22 @@ void Bookkeeper::try_update_book(const event_ptr &event, const Quote &quote) {
 }
 
 void Bookkeeper::update_book(int64_t trigger_time, const Quote &quote) {
-  std::lock_guard<std::mutex> lock(update_book_mutex_);
   if (accounting_methods_.find(quote.instrument_type) == accounting_methods_.end()) {
     return;
   }
   auto accounting_method = accounting_methods_.at(quote.instrument_type);
-  for (auto &item : books_) {
-    auto &book = item.second;
+  // only books holding the instrument are locked, one at a time, quotes never wait on updates of other books
+  for (auto holder_uid : get_position_holders(quote.exchange_id, quote.instrument_id)) {
+    Book_ptr book;
+    {
+      std::shared_lock<std::shared_mutex> books_lock(books_mutex_);
+      auto it = books_.find(holder_uid);
+      if (it == books_.end()) {
+        continue; // dropped since holders were copied
+      }
+      book = it->second;
+    }
+    std::lock_guard<std::mutex> lock(book->update_mutex);
     auto has_long_position = book->has_long_position_for(quote);
     auto has_short_position = book->has_short_position_for(quote);
     if (has_long_position or has_short_position) {
@@ -22,8 +22,10 @@ namespace kungfu::wingchun::broker {
 BrokerVendor::BrokerVendor(location_ptr location, bool low_latency) : apprentice(std::move(location), low_latency) {}
 
 void BrokerVendor::on_start() {
-  events_ | is(RequestWriteTo::tag, RequestReadFrom::tag, RequestReadFromPublic::tag, RequestReadFromSync::tag) |
-      $$(notify_broker_state());
+  for (auto msg_type :
+       {RequestWriteTo::tag, RequestReadFrom::tag, RequestReadFromPublic::tag, RequestReadFromSync::tag}) {
+    handle(msg_type, [&](const event_ptr &event) { notify_broker_state(); });
+  }
 }
 
 void BrokerVendor::on_exit() {
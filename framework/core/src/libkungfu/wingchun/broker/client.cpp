@@ -142,11 +142,13 @@ void Client::sync(int64_t trigger_time, const yijinjing::data::location_ptr &td_
   return true;
 }
 
-void Client::on_start(const rx::connectable_observable<event_ptr> &events) {
-  events | is(Register::tag) | $$(connect(event, event->data<Register>()));
-  events | is(Band::tag) | $$(connect(event, event->data<Band>()));
-  events | is(BrokerStateUpdate::tag) | $$(update_broker_state(event, event->data<BrokerStateUpdate>()));
-  events | is(Deregister::tag) | $$(update_broker_state(event, event->data<Deregister>()));
+void Client::on_start() {
+  app_.handle(Register::tag, [&](const event_ptr &event) { connect(event, event->data<Register>()); });
+  app_.handle(Band::tag, [&](const event_ptr &event) { connect(event, event->data<Band>()); });
+  app_.handle(BrokerStateUpdate::tag,
+              [&](const event_ptr &event) { update_broker_state(event, event->data<BrokerStateUpdate>()); });
+  app_.handle(Deregister::tag,
+              [&](const event_ptr &event) { update_broker_state(event, event->data<Deregister>()); });
 }
 
 void Client::connect(const event_ptr &event, const Register &register_data) {
@@ -22,13 +22,15 @@ void MarketDataVendor::set_service(MarketData_ptr service) { service_ = std::mov
 
 void MarketDataVendor::on_react() {
   BrokerVendor::on_react();
-  events_ | is(Instrument::tag) | $$(service_->update_instrument(event->data<Instrument>()));
+  handle(Instrument::tag, [&](const event_ptr &event) { service_->update_instrument(event->data<Instrument>()); });
 }
 
 void MarketDataVendor::on_start() {
   BrokerVendor::on_start();
-  events_ | is(CustomSubscribe::tag) | $$(service_->subscribe_custom(event->data<CustomSubscribe>()));
-  events_ | is(InstrumentKey::tag) | $$(service_->add_instrument_key(event->data<InstrumentKey>()));
+  handle(CustomSubscribe::tag,
+         [&](const event_ptr &event) { service_->subscribe_custom(event->data<CustomSubscribe>()); });
+  handle(InstrumentKey::tag,
+         [&](const event_ptr &event) { service_->add_instrument_key(event->data<InstrumentKey>()); });
   events_ | is_custom() | $$(service_->on_custom_event(event));
   service_->on_start();
 
@@ -4,6 +4,8 @@
 // Created by Keren Dong on 2019-06-20.
 //
 
+#include <iterator>
+
 #include <kungfu/common.h>
 #include <kungfu/wingchun/broker/trader.h>
 #include <kungfu/yijinjing/journal/assemble.h>
@@ -24,31 +26,34 @@ TraderVendor::TraderVendor(locator_ptr locator, const std::string &group, const
 void TraderVendor::set_service(Trader_ptr service) { service_ = std::move(service); }
 
 void TraderVendor::react() {
-  events_ | skip_until(events_ | is(RequestStart::tag)) | is(OrderInput::tag) | $$(service_->handle_order_input(event));
   events_ | skip_until(events_ | is(RequestStart::tag)) | is_custom() | $$(service_->on_custom_event(event));
   apprentice::react();
 }
 
 void TraderVendor::on_react() {
-  events_ | is(ResetBookRequest::tag) |
-      $([&](const event_ptr &event) { get_writer(location::PUBLIC)->mark(now(), ResetBookRequest::tag); });
+  handle(ResetBookRequest::tag,
+         [&](const event_ptr &event) { get_writer(location::PUBLIC)->mark(now(), ResetBookRequest::tag); });
 }
 
 void TraderVendor::on_start() {
   BrokerVendor::on_start();
 
-  events_ | is(BlockMessage::tag) | $$(service_->insert_block_message(event));
-  events_ | is(OrderAction::tag) | $$(service_->cancel_order(event));
-  events_ | is(AssetRequest::tag) | $$(service_->req_account());
-  events_ | is(OrderTradeRequest::tag) | $$(service_->req_order_trade());
-  events_ | is(Deregister::tag) | $$(service_->on_strategy_exit(event));
-  events_ | is(TimeKeyValue::tag) | $$(service_->on_time_key_value(event));
-  events_ | is(PositionRequest::tag) | $$(service_->req_position());
-  events_ | is(RequestHistoryOrder::tag) | $$(service_->req_history_order(event));
-  events_ | is(RequestHistoryTrade::tag) | $$(service_->req_history_trade(event));
-  events_ | is(AssetSync::tag) | $$(service_->handle_asset_sync());
-  events_ | is(PositionSync::tag) | $$(service_->handle_position_sync());
-  events_ | is(BatchOrderBegin::tag, BatchOrderEnd::tag) | $$(service_->handle_batch_order_tag(event));
+  // order inputs are only taken after start, once orders have been recovered
+  handle(OrderInput::tag, [&](const event_ptr &event) { service_->handle_order_input(event); });
+  handle(OrderInputBatch::tag, [&](const event_ptr &event) { service_->handle_order_input_batch(event); });
+  handle(BlockMessage::tag, [&](const event_ptr &event) { service_->insert_block_message(event); });
+  handle(OrderAction::tag, [&](const event_ptr &event) { service_->cancel_order(event); });
+  handle(AssetRequest::tag, [&](const event_ptr &event) { service_->req_account(); });
+  handle(OrderTradeRequest::tag, [&](const event_ptr &event) { service_->req_order_trade(); });
+  handle(Deregister::tag, [&](const event_ptr &event) { service_->on_strategy_exit(event); });
+  handle(TimeKeyValue::tag, [&](const event_ptr &event) { service_->on_time_key_value(event); });
+  handle(PositionRequest::tag, [&](const event_ptr &event) { service_->req_position(); });
+  handle(RequestHistoryOrder::tag, [&](const event_ptr &event) { service_->req_history_order(event); });
+  handle(RequestHistoryTrade::tag, [&](const event_ptr &event) { service_->req_history_trade(event); });
+  handle(AssetSync::tag, [&](const event_ptr &event) { service_->handle_asset_sync(); });
+  handle(PositionSync::tag, [&](const event_ptr &event) { service_->handle_position_sync(); });
+  handle(BatchOrderBegin::tag, [&](const event_ptr &event) { service_->handle_batch_order_tag(event); });
+  handle(BatchOrderEnd::tag, [&](const event_ptr &event) { service_->handle_batch_order_tag(event); });
 
   service_->recover();
   service_->on_recover();
@@ -191,15 +196,22 @@ bool Trader::has_self_deal_risk(const event_ptr &event) {
   return false;
 }
 
+bool Trader::reject_self_deal(const event_ptr &event) {
+  if (not has_self_deal_risk(event)) {
+    return false;
+  }
+  Order &order = get_writer(event->source())->open_data<Order>();
+  order_from_input(event->data<OrderInput>(), order);
+  order.status = OrderStatus::Error;
+  strncpy(order.error_msg, "该委托存在自成交风险,已拒绝下单", ERROR_MSG_LEN);
+  order.insert_time = event->gen_time();
+  order.update_time = event->gen_time();
+  get_writer(event->source())->close_data();
+  return true;
+}
+
 void Trader::handle_order_input(const event_ptr &event) {
-  if (has_self_deal_risk(event)) {
-    Order &order = get_writer(event->source())->open_data<Order>();
-    order_from_input(event->data<OrderInput>(), order);
-    order.status = OrderStatus::Error;
-    strncpy(order.error_msg, "该委托存在自成交风险,已拒绝下单", ERROR_MSG_LEN);
-    order.insert_time = event->gen_time();
-    order.update_time = event->gen_time();
-    get_writer(event->source())->close_data();
+  if (reject_self_deal(event)) {
     return;
   }
 
@@ -212,6 +224,25 @@ void Trader::handle_order_input(const event_ptr &event) {
   }
 }
 
+void Trader::handle_order_input_batch(const event_ptr &event) {
+  auto &inputs = order_inputs_.try_emplace(event->source()).first->second;
+  if (self_deal_detect_) {
+    for_each_element<OrderInput>(event, [&](const event_ptr &element) {
+      if (not reject_self_deal(element)) {
+        inputs.push_back(element->data<OrderInput>());
+      }
+    });
+  } else {
+    auto first = reinterpret_cast<const OrderInput *>(event->data_address());
+    auto last = first + event->data_length() / sizeof(OrderInput);
+    std::copy_if(first, last, std::back_inserter(inputs), [](const OrderInput &input) { return input.order_id != 0; });
+  }
+  if (not inputs.empty()) {
+    insert_batch_orders(event);
+  }
+  clear_order_inputs(event->source());
+}
+
 void Trader::handle_batch_order_tag(const event_ptr &event) {
   if (event->msg_type() == BatchOrderBegin::tag) {
     batch_status_.insert_or_assign(event->source(), true);
@@ -222,6 +253,23 @@ void Trader::handle_batch_order_tag(const event_ptr &event) {
   }
 }
 
+bool Trader::insert_batch_orders(const event_ptr &event) {
+  if (event->msg_type() != OrderInputBatch::tag) {
+    return true;
+  }
+  /// inputs keep the batch order, self deal rejected ones are already left out
+  auto &inputs = order_inputs_.try_emplace(event->source()).first->second;
+  auto accepted = inputs.begin();
+  bool result = true;
+  for_each_element<OrderInput>(event, [&](const event_ptr &element) {
+    if (accepted != inputs.end() and element->data<OrderInput>().order_id == accepted->order_id) {
+      result = insert_order(element) and result;
+      accepted++;
+    }
+  });
+  return result;
+}
+
 bool Trader::insert_block_message(const event_ptr &event) {
   const BlockMessage &msg = event->data<BlockMessage>();
   return block_messages_.try_emplace(msg.block_id, msg).second;
@@ -283,17 +331,22 @@ void Trader::deal_read_frame() {
   int64_t count = 0;
   while (asb_read.data_available()) {
     const auto &frame = asb_read.current_frame();
-    if (frame->msg_type() == OrderInput::tag) {
-      const OrderInput &order_input = frame->data<OrderInput>();
-      if (orders_.find(order_input.order_id) == orders_.end()) {
-        if (has_writer(frame->source())) {
-          Order &order = get_writer(frame->source())->open_data<Order>();
-          order_from_input(order_input, order);
-          order.status = OrderStatus::Lost;
-          order.update_time = time::now_in_nano();
-          get_writer(frame->source())->close_data();
-        }
+    auto write_lost = [&](const OrderInput &order_input) {
+      auto written = order_input.order_id != 0; // zeroed tail of a batch not shrunk
+      if (written and orders_.find(order_input.order_id) == orders_.end() and has_writer(frame->source())) {
+        Order &order = get_writer(frame->source())->open_data<Order>();
+        order_from_input(order_input, order);
+        order.status = OrderStatus::Lost;
+        order.update_time = time::now_in_nano();
+        get_writer(frame->source())->close_data();
       }
+    };
+    if (frame->msg_type() == OrderInput::tag) {
+      write_lost(frame->data<OrderInput>());
+    }
+    if (frame->msg_type() == OrderInputBatch::tag) {
+      auto first = reinterpret_cast<const OrderInput *>(frame->data_address());
+      std::for_each(first, first + frame->data_length() / sizeof(OrderInput), write_lost);
     }
     asb_read.next();
     ++count;
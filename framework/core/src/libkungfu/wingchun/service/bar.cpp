@@ -1,4 +1,3 @@
-
 #include <kungfu/wingchun/common.h>
 #include <kungfu/wingchun/service/bar.h>
 #include <kungfu/yijinjing/log.h>
@@ -13,7 +12,7 @@ using namespace kungfu::yijinjing;
 using namespace kungfu::yijinjing::data;
 
 namespace kungfu::wingchun::service {
-static int64_t parse_time_interval(const std::string &s) {
+int64_t parse_time_interval(const std::string &s) {
   std::regex r("[0-9]+");
   std::smatch m;
   std::regex_search(s, m, r);
@@ -34,79 +33,225 @@ static int64_t parse_time_interval(const std::string &s) {
   }
 }
 
+static std::vector<std::string> parse_list(const nlohmann::json &value) {
+  std::vector<std::string> list = {};
+  if (value.is_array()) {
+    for (const auto &item : value) {
+      list.push_back(item);
+    }
+    return list;
+  }
+  std::stringstream ss(value.get<std::string>());
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (not item.empty()) {
+      list.push_back(item);
+    }
+  }
+  return list;
+}
+
+static std::vector<int64_t> parse_time_intervals(const nlohmann::json &value) {
+  std::vector<int64_t> time_intervals = {};
+  for (const auto &s : parse_list(value)) {
+    auto time_interval = parse_time_interval(s);
+    if (time_interval <= 0) {
+      throw std::runtime_error("invalid time_interval: " + s);
+    }
+    time_intervals.push_back(time_interval);
+  }
+  std::sort(time_intervals.begin(), time_intervals.end());
+  time_intervals.erase(std::unique(time_intervals.begin(), time_intervals.end()), time_intervals.end());
+  return time_intervals;
+}
+
+static void reset_bar(Bar &bar, int64_t time_interval, int64_t data_time, int64_t total_volume) {
+  bar.start_time = data_time - data_time % time_interval;
+  bar.end_time = bar.start_time + time_interval;
+  bar.tick_count = 0;
+  bar.start_volume = total_volume;
+  bar.volume = 0;
+  bar.high = 0;
+  bar.low = 0;
+  bar.open = 0;
+  bar.close = 0;
+}
+
+static void merge_bar(Bar &bar, const Bar &finer) {
+  if (bar.tick_count == 0) {
+    bar.open = finer.open;
+    bar.high = finer.high;
+    bar.low = finer.low;
+  }
+  bar.trading_day = finer.trading_day;
+  bar.high = std::max(bar.high, finer.high);
+  bar.low = std::min(bar.low, finer.low);
+  bar.close = finer.close;
+  bar.volume += finer.volume;
+  bar.tick_count += finer.tick_count;
+}
+
 BarGenerator::BarGenerator(const locator_ptr &locator, mode m, bool low_latency, const std::string &json_config)
-    : MarketDataVendor(locator, "bar", "bar", low_latency),
-      time_interval_(kungfu::yijinjing::time_unit::NANOSECONDS_PER_MINUTE) {
+    : MarketDataVendor(locator, "bar", "bar", low_latency) {
   log::copy_log_settings(get_home(), "bar");
   auto config = nlohmann::json::parse(json_config);
-  auto source = config["source"];
-  source_location_ = location::make_shared(m, category::MD, source, source, get_locator());
+  auto add_source = [&](const std::string &source) {
+    auto source_location = location::make_shared(m, category::MD, source, source, get_locator());
+    if (not is_source(source_location->uid)) {
+      source_locations_.push_back(source_location);
+    }
+    return source_location->uid;
+  };
+  for (const auto &source : parse_list(config["source"])) {
+    add_source(source);
+  }
+  default_subscription_.time_intervals = {time_unit::NANOSECONDS_PER_MINUTE};
   if (config.find("time_interval") != config.end()) {
-    time_interval_ = parse_time_interval(config["time_interval"]);
+    default_subscription_.time_intervals = parse_time_intervals(config["time_interval"]);
+  }
+  if (config.find("instruments") != config.end()) {
+    for (const auto &item : config["instruments"]) {
+      std::string exchange_id = item["exchange_id"];
+      std::string instrument_id = item["instrument_id"];
+      auto subscription = default_subscription_;
+      if (item.find("source") != item.end()) {
+        subscription.source_uid = add_source(item["source"]);
+      }
+      if (item.find("time_interval") != item.end()) {
+        subscription.time_intervals = parse_time_intervals(item["time_interval"]);
+      }
+      subscriptions_.insert_or_assign(hash_instrument(exchange_id.c_str(), instrument_id.c_str()), subscription);
+    }
   }
+  set_service(std::make_shared<JournalMarketData>(*this));
 }
 
 void BarGenerator::on_start() {
   MarketDataVendor::on_start();
   get_service()->update_broker_state(BrokerState::Ready);
 
-  events_ | is(Register::tag) | $([&](const event_ptr &event) {
+  handle(Register::tag, [&](const event_ptr &event) {
     auto register_data = event->data<Register>();
-    if (register_data.location_uid == source_location_->uid) {
-      request_read_from_public(now(), source_location_->uid, now());
+    if (is_source(register_data.location_uid)) {
+      request_read_from_public(now(), register_data.location_uid, now());
     }
   });
 
-  events_ | is(Quote::tag) | $([&](const event_ptr &event) {
-    const auto &quote = event->data<Quote>();
-    auto instrument_key = hash_instrument(quote.exchange_id, quote.instrument_id);
-    auto pair = bars_.try_emplace(instrument_key);
-    auto &bar = pair.first->second;
-    if (pair.second) {
-      strncpy(bar.instrument_id, quote.instrument_id, INSTRUMENT_ID_LEN);
-      strncpy(bar.exchange_id, quote.exchange_id, EXCHANGE_ID_LEN);
-      bar.start_time = event->gen_time() - event->gen_time() % time_interval_;
-      bar.end_time = bar.start_time + time_interval_;
-    }
-    if (quote.data_time >= bar.start_time && quote.data_time <= bar.end_time) {
-      if (bar.tick_count == 0) {
-        bar.high = quote.last_price;
-        bar.low = quote.last_price;
-        bar.open = quote.last_price;
-        bar.close = quote.last_price;
-        bar.start_volume = quote.volume;
-      }
-      bar.tick_count++;
-      bar.volume = quote.volume - bar.start_volume;
-      bar.high = std::max(bar.high, quote.last_price);
-      bar.low = std::min(bar.low, quote.last_price);
-      bar.close = quote.last_price;
-    }
-    if (quote.data_time >= bar.end_time) {
-      get_writer(location::PUBLIC)->write(event->gen_time(), bar);
-      bar.start_time = bar.end_time;
-      while (bar.start_time + time_interval_ < quote.data_time) {
-        bar.start_time += time_interval_;
-      }
-      bar.end_time = bar.start_time + time_interval_;
-      if (bar.start_time <= quote.data_time) {
-        bar.tick_count = 1;
-        bar.start_volume = quote.volume;
-        bar.volume = 0;
-        bar.high = quote.last_price;
-        bar.low = quote.last_price;
-        bar.open = quote.last_price;
-        bar.close = quote.last_price;
-      } else {
-        bar.tick_count = 0;
-        bar.start_volume = 0;
-        bar.volume = 0;
-        bar.high = 0;
-        bar.low = 0;
-        bar.open = 0;
-        bar.close = 0;
+  handle(Band::tag, [&](const event_ptr &event) {
+    auto band = event->data<Band>();
+    for (const auto &source_location : source_locations_) {
+      if (band.source_id == source_location->uid) {
+        request_read_from_source_to_dest(now(), source_location, band.dest_id);
       }
     }
   });
+
+  handle(Quote::tag, [&](const event_ptr &event) {
+    const auto &quote = event->data<Quote>();
+    auto bars = get_bars(event, quote);
+    if (bars != nullptr and not bars->by_transaction) {
+      bars->total_volume = bars->total_volume == 0 ? quote.volume : bars->total_volume;
+      update(event, *bars, quote, quote.last_price, quote.volume);
+    }
+  });
+
+  handle(Transaction::tag, [&](const event_ptr &event) {
+    const auto &transaction = event->data<Transaction>();
+    auto bars = get_bars(event, transaction);
+    if (bars != nullptr and transaction.exec_type == ExecType::Trade) {
+      bars->by_transaction = true;
+      update(event, *bars, transaction, transaction.price, bars->total_volume + transaction.volume);
+    }
+  });
+}
+
+bool BarGenerator::is_source(uint32_t location_uid) const {
+  return std::any_of(source_locations_.begin(), source_locations_.end(),
+                     [&](const auto &source_location) { return source_location->uid == location_uid; });
+}
+
+template <typename DataType>
+BarGenerator::instrument_bars *BarGenerator::get_bars(const event_ptr &event, const DataType &data) {
+  auto instrument_key = hash_instrument(data.exchange_id, data.instrument_id);
+  auto it = bars_.find(instrument_key);
+  if (it == bars_.end()) {
+    auto subscription_it = subscriptions_.find(instrument_key);
+    auto listed = subscription_it != subscriptions_.end();
+    auto subscribed = subscriptions_.empty() or listed;
+    const auto &subscription = listed ? subscription_it->second : default_subscription_;
+    it = bars_.try_emplace(instrument_key).first;
+    auto &bars = it->second;
+    bars.source_uid = subscription.source_uid;
+    for (size_t i = 0; subscribed and i < subscription.time_intervals.size(); i++) {
+      auto time_interval = subscription.time_intervals[i];
+      auto &s = bars.intervals.emplace_back(series{time_interval, -1, {}});
+      for (int32_t j = i - 1; j >= 0 and s.derived_from < 0; j--) {
+        s.derived_from = time_interval % subscription.time_intervals[j] == 0 ? j : -1;
+      }
+      s.bar.instrument_id = data.instrument_id;
+      s.bar.exchange_id = data.exchange_id;
+      s.bar.instrument_type = data.instrument_type;
+    }
+  }
+  auto &bars = it->second;
+  auto from_source = bars.source_uid == 0 or bars.source_uid == event->source();
+  return from_source and not bars.intervals.empty() ? &bars : nullptr;
+}
+
+template <typename DataType>
+void BarGenerator::update(const event_ptr &event, instrument_bars &bars, const DataType &data, double price,
+                          int64_t total_volume) {
+  for (size_t i = 0; i < bars.intervals.size(); i++) {
+    auto &s = bars.intervals[i];
+    if (s.derived_from < 0 and s.bar.end_time == 0) {
+      reset_bar(s.bar, s.time_interval, data.data_time, bars.total_volume);
+    }
+    if (s.derived_from < 0) {
+      advance(event, bars, i, data.data_time);
+    }
+  }
+  bars.total_volume = total_volume;
+  for (auto &s : bars.intervals) {
+    auto &bar = s.bar;
+    if (s.derived_from >= 0 or data.data_time < bar.start_time) {
+      continue; // merged from finer bars, or a late tick of a bar already closed
+    }
+    if (bar.tick_count == 0) {
+      bar.open = price;
+      bar.high = price;
+      bar.low = price;
+    }
+    bar.trading_day = data.trading_day;
+    bar.tick_count++;
+    bar.volume = bars.total_volume - bar.start_volume;
+    bar.high = std::max(bar.high, price);
+    bar.low = std::min(bar.low, price);
+    bar.close = price;
+  }
+}
+
+void BarGenerator::advance(const event_ptr &event, instrument_bars &bars, size_t index, int64_t data_time) {
+  auto &s = bars.intervals[index];
+  if (data_time < s.bar.end_time) {
+    return;
+  }
+  auto closed = s.bar;
+  if (closed.tick_count > 0) {
+    get_writer(location::PUBLIC)->write(event->gen_time(), closed);
+  }
+  reset_bar(s.bar, s.time_interval, data_time, bars.total_volume);
+  for (size_t i = index + 1; i < bars.intervals.size(); i++) {
+    auto &coarser = bars.intervals[i];
+    if (coarser.derived_from != int32_t(index)) {
+      continue;
+    }
+    if (coarser.bar.end_time == 0) {
+      reset_bar(coarser.bar, coarser.time_interval, closed.start_time, closed.start_volume);
+    }
+    if (closed.tick_count > 0) {
+      merge_bar(coarser.bar, closed);
+    }
+    advance(event, bars, i, data_time);
+  }
 }
 } // namespace kungfu::wingchun::service
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <kungfu/wingchun/common.h>
+#include <kungfu/wingchun/service/bar.h>
+#include <kungfu/wingchun/service/depth.h>
+#include <kungfu/yijinjing/log.h>
+
+using namespace kungfu::longfist::types;
+using namespace kungfu::longfist::enums;
+using namespace kungfu::wingchun::broker;
+using namespace kungfu::yijinjing;
+using namespace kungfu::yijinjing::data;
+
+namespace kungfu::wingchun::service {
+DepthService::DepthService(const locator_ptr &locator, mode m, bool low_latency, const std::string &json_config)
+    : MarketDataVendor(locator, "depth", "depth", low_latency) {
+  log::copy_log_settings(get_home(), "depth");
+  auto config = nlohmann::json::parse(json_config);
+  auto source = config["source"];
+  source_location_ = location::make_shared(m, category::MD, source, source, get_locator());
+  if (config.find("time_interval") != config.end()) {
+    time_interval_ = parse_time_interval(config["time_interval"]);
+  }
+  if (config.find("capacity") != config.end()) {
+    capacity_ = config["capacity"];
+  }
+  set_service(std::make_shared<JournalMarketData>(*this));
+}
+
+std::string DepthService::get_snapshot_path(const locator_ptr &locator, mode m) {
+  auto location = location::make_shared(m, category::MD, "depth", "depth", locator);
+  return fmt::format("{}/depth.snapshot", locator->layout_dir(location, layout::JOURNAL));
+}
+
+void DepthService::on_start() {
+  MarketDataVendor::on_start();
+  snapshot_ = std::make_shared<DepthSnapshot>(get_snapshot_path(get_locator(), source_location_->mode), true,
+                                             capacity_);
+  get_service()->update_broker_state(BrokerState::Ready);
+
+  handle(Register::tag, [&](const event_ptr &event) {
+    auto register_data = event->data<Register>();
+    if (register_data.location_uid == source_location_->uid) {
+      request_read_from_public(now(), source_location_->uid, now());
+    }
+  });
+
+  handle(Band::tag, [&](const event_ptr &event) {
+    auto band = event->data<Band>();
+    if (band.source_id == source_location_->uid) {
+      request_read_from_source_to_dest(now(), source_location_, band.dest_id);
+    }
+  });
+
+  handle(Quote::tag, [&](const event_ptr &event) {
+    const auto &quote = event->data<Quote>();
+    auto &book = get_book(quote);
+    book.apply(quote);
+    update(event->gen_time(), book);
+  });
+
+  handle(Entrust::tag, [&](const event_ptr &event) {
+    const auto &entrust = event->data<Entrust>();
+    auto &book = get_book(entrust);
+    book.apply(entrust);
+    update(event->gen_time(), book);
+  });
+
+  handle(Transaction::tag, [&](const event_ptr &event) {
+    const auto &transaction = event->data<Transaction>();
+    auto &book = get_book(transaction);
+    book.apply(transaction);
+    update(event->gen_time(), book);
+  });
+
+  if (time_interval_ > 0) {
+    add_time_interval(time_interval_, [&](const event_ptr &event) { publish(event->gen_time()); });
+  }
+}
+
+void DepthService::update(int64_t trigger_time, OrderBook &book) {
+  const auto &tree = book.snapshot();
+  snapshot_->write(tree);
+  if (time_interval_ > 0) {
+    changed_.insert(&book);
+  } else {
+    get_writer(location::PUBLIC)->write(trigger_time, tree);
+  }
+}
+
+void DepthService::publish(int64_t trigger_time) {
+  auto writer = get_writer(location::PUBLIC);
+  for (auto book : changed_) {
+    writer->write(trigger_time, book->snapshot());
+  }
+  changed_.clear();
+}
+} // namespace kungfu::wingchun::service
@@ -30,23 +30,36 @@ void Ledger::on_trading_day(const event_ptr &event, int64_t daytime) { bookkeepe
 book::Bookkeeper &Ledger::get_bookkeeper() { return bookkeeper_; }
 
 void Ledger::on_start() {
-  broker_client_.on_start(events_);
-  bookkeeper_.on_start(events_);
+  broker_client_.on_start();
+  bookkeeper_.on_start();
   bookkeeper_.guard_positions();
 
-  events_ | is(BrokerStateUpdate::tag) | $$(update_broker_state_map(event->source(), event->data<BrokerStateUpdate>()));
-  events_ | is(Deregister::tag) | $$(update_broker_state_map(event->source(), event->data<Deregister>()));
-  events_ | is(OrderInput::tag) | $$(update_order_stat(event, event->data<OrderInput>()));
-  events_ | is(Order::tag) | $$(update_order_stat(event, event->data<Order>()));
-  events_ | is(Trade::tag) | $$(update_order_stat(event, event->data<Trade>()));
-  events_ | is(Channel::tag) | $$(inspect_channel(event->gen_time(), event->data<Channel>()));
-  events_ | is(KeepPositionsRequest::tag) | $$(keep_positions(event->gen_time(), event->source()));
-  events_ | is(RebuildPositionsRequest::tag) | $$(rebuild_positions(event->gen_time(), event->source()));
-  events_ | is(MirrorPositionsRequest::tag) | $$(bookkeeper_.mirror_positions(event->gen_time(), event->source()));
-  events_ | is(BrokerStateRequest::tag) | $$(write_broker_state(event->gen_time(), event->source()));
-  events_ | is(AssetRequest::tag) | $$(write_book_reset(event->gen_time(), event->source()));
-  events_ | is(PositionRequest::tag) | $$(write_strategy_data(event->gen_time(), event->source()));
-  events_ | is(PositionEnd::tag) | $$(update_account_book(event->gen_time(), event->data<PositionEnd>().holder_uid));
+  handle(BrokerStateUpdate::tag,
+         [&](const event_ptr &event) { update_broker_state_map(event->source(), event->data<BrokerStateUpdate>()); });
+  handle(Deregister::tag,
+         [&](const event_ptr &event) { update_broker_state_map(event->source(), event->data<Deregister>()); });
+  handle(OrderInput::tag, [&](const event_ptr &event) { update_order_stat(event, event->data<OrderInput>()); });
+  handle(OrderInputBatch::tag, [&](const event_ptr &event) {
+    for_each_element<OrderInput>(
+        event, [&](const event_ptr &element) { update_order_stat(element, element->data<OrderInput>()); });
+  });
+  handle(Order::tag, [&](const event_ptr &event) { update_order_stat(event, event->data<Order>()); });
+  handle(Trade::tag, [&](const event_ptr &event) { update_order_stat(event, event->data<Trade>()); });
+  handle(Channel::tag, [&](const event_ptr &event) { inspect_channel(event->gen_time(), event->data<Channel>()); });
+  handle(KeepPositionsRequest::tag,
+         [&](const event_ptr &event) { keep_positions(event->gen_time(), event->source()); });
+  handle(RebuildPositionsRequest::tag,
+         [&](const event_ptr &event) { rebuild_positions(event->gen_time(), event->source()); });
+  handle(MirrorPositionsRequest::tag,
+         [&](const event_ptr &event) { bookkeeper_.mirror_positions(event->gen_time(), event->source()); });
+  handle(BrokerStateRequest::tag,
+         [&](const event_ptr &event) { write_broker_state(event->gen_time(), event->source()); });
+  handle(AssetRequest::tag, [&](const event_ptr &event) { write_book_reset(event->gen_time(), event->source()); });
+  handle(PositionRequest::tag,
+         [&](const event_ptr &event) { write_strategy_data(event->gen_time(), event->source()); });
+  handle(PositionEnd::tag, [&](const event_ptr &event) {
+    update_account_book(event->gen_time(), event->data<PositionEnd>().holder_uid);
+  });
 
   if (bookkeeper_.is_sync_asset() or bookkeeper_.is_sync_asset_margin()) {
     add_time_interval(time_unit::NANOSECONDS_PER_MINUTE,
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cmath>
+#include <filesystem>
+
+#include <kungfu/wingchun/service/orderbook.h>
+#include <kungfu/yijinjing/util/os.h>
+
+using namespace kungfu::longfist::enums;
+using namespace kungfu::longfist::types;
+using namespace kungfu::yijinjing;
+
+namespace kungfu::wingchun::service {
+static int64_t scale_price(double price) { return std::llround(price * OrderBook::PRICE_SCALE); }
+
+static double unscale_price(int64_t price) { return double(price) / OrderBook::PRICE_SCALE; }
+
+OrderBook::OrderBook(const char *exchange_id, const char *instrument_id) {
+  strncpy(tree_.exchange_id, exchange_id, EXCHANGE_ID_LEN);
+  strncpy(tree_.instrument_id, instrument_id, INSTRUMENT_ID_LEN);
+}
+
+void OrderBook::apply(const Entrust &entrust) {
+  if (entrust.side != Side::Buy and entrust.side != Side::Sell) {
+    return;
+  }
+  auto order_no = entrust.orig_order_no != 0 ? entrust.orig_order_no : entrust.seq;
+  auto it = orders_.find(order_no);
+  if (it != orders_.end()) {
+    take(order_no, it->second.volume); // replaced by a later entrust of the same number
+  }
+  int64_t price = 0;
+  if (entrust.price_type == PriceType::Limit) {
+    price = scale_price(entrust.price);
+  }
+  if (entrust.price_type == PriceType::ForwardBest) {
+    price = entrust.side == Side::Buy ? (bids_.empty() ? 0 : bids_.begin()->first)
+                                      : (asks_.empty() ? 0 : asks_.begin()->first);
+  }
+  orders_.insert_or_assign(order_no, resting_order{entrust.side, price, entrust.volume});
+  update_level(entrust.side, price, entrust.volume);
+  tree_.data_time = entrust.data_time;
+  tree_.trading_day = entrust.trading_day;
+  tree_.instrument_type = entrust.instrument_type;
+}
+
+void OrderBook::apply(const Transaction &transaction) {
+  take(transaction.bid_no, transaction.volume);
+  take(transaction.ask_no, transaction.volume);
+  tree_.data_time = transaction.data_time;
+  tree_.trading_day = transaction.trading_day;
+  if (transaction.exec_type == ExecType::Cancel) {
+    return;
+  }
+  tree_.trade_num++;
+  tree_.volume += transaction.volume;
+  tree_.turnover += transaction.price * double(transaction.volume);
+  tree_.last_price = transaction.price;
+  if (tree_.open_price == 0) {
+    tree_.open_price = transaction.price;
+    tree_.high_price = transaction.price;
+    tree_.low_price = transaction.price;
+  }
+  tree_.high_price = std::max(tree_.high_price, transaction.price);
+  tree_.low_price = std::min(tree_.low_price, transaction.price);
+}
+
+void OrderBook::apply(const Quote &quote) {
+  tree_.instrument_type = quote.instrument_type;
+  tree_.pre_close_price = quote.pre_close_price;
+  tree_.upper_limit_price = quote.upper_limit_price;
+  tree_.lower_limit_price = quote.lower_limit_price;
+  tree_.close_price = quote.close_price;
+  tree_.trading_phase_code = quote.trading_phase_code;
+}
+
+const Tree &OrderBook::snapshot() {
+  auto fill = [](const auto &levels, auto &prices, auto &volumes) {
+    size_t i = 0;
+    for (auto it = levels.begin(); i < prices.size(); i++) {
+      prices[i] = it == levels.end() ? 0 : unscale_price(it->first);
+      volumes[i] = it == levels.end() ? 0 : it->second;
+      it = it == levels.end() ? it : std::next(it);
+    }
+  };
+  fill(bids_, tree_.bid_price, tree_.bid_volume);
+  fill(asks_, tree_.ask_price, tree_.ask_volume);
+  tree_.bid_depth = bids_.size();
+  tree_.ask_depth = asks_.size();
+  tree_.bid_weighted_avg_price = tree_.total_bid_volume > 0 ? bid_notional_ / double(tree_.total_bid_volume) : 0;
+  tree_.ask_weighted_avg_price = tree_.total_ask_volume > 0 ? ask_notional_ / double(tree_.total_ask_volume) : 0;
+  return tree_;
+}
+
+void OrderBook::update_level(Side side, int64_t price, int64_t volume) {
+  if (price <= 0 or volume == 0) {
+    return;
+  }
+  auto update = [&](auto &levels, double &notional) {
+    auto &level = levels[price];
+    level += volume;
+    if (level <= 0) {
+      levels.erase(price);
+    }
+    notional += unscale_price(price) * double(volume);
+  };
+  if (side == Side::Buy) {
+    update(bids_, bid_notional_);
+    tree_.total_bid_volume += volume;
+  } else {
+    update(asks_, ask_notional_);
+    tree_.total_ask_volume += volume;
+  }
+}
+
+void OrderBook::take(int64_t order_no, int64_t volume) {
+  auto it = order_no == 0 ? orders_.end() : orders_.find(order_no);
+  if (it == orders_.end()) {
+    return; // aggressive orders of SSE trade before their remains are entrusted
+  }
+  auto &order = it->second;
+  auto taken = std::min(volume, order.volume);
+  update_level(order.side, order.price, -taken);
+  order.volume -= taken;
+  if (order.volume <= 0) {
+    orders_.erase(it);
+  }
+}
+
+DepthSnapshot::DepthSnapshot(const std::string &path, bool writing, uint32_t capacity) : writing_(writing) {
+  if (writing) {
+    mapped_size_ = sizeof(header) + sizeof(slot) * capacity;
+  } else if (std::filesystem::exists(path) and std::filesystem::file_size(path) >= sizeof(header)) {
+    mapped_size_ = std::filesystem::file_size(path);
+  } else {
+    throw wingchun_error(fmt::format("no depth snapshot at {}", path));
+  }
+  address_ = os::load_mmap_buffer(path, mapped_size_, writing);
+  header_ = reinterpret_cast<header *>(address_);
+  slots_ = reinterpret_cast<slot *>(address_ + sizeof(header));
+  if (writing) {
+    memset(reinterpret_cast<void *>(address_), 0, mapped_size_);
+    header_->version = VERSION;
+    header_->capacity = capacity;
+    header_->size.store(0, std::memory_order_release);
+  } else if (header_->version != VERSION or sizeof(header) + sizeof(slot) * header_->capacity > mapped_size_) {
+    os::release_mmap_buffer(address_, mapped_size_, true);
+    throw wingchun_error(fmt::format("incompatible depth snapshot at {}", path));
+  }
+}
+
+DepthSnapshot::~DepthSnapshot() { os::release_mmap_buffer(address_, mapped_size_, true); }
+
+void DepthSnapshot::write(const Tree &tree) {
+  assert(writing_);
+  auto instrument_key = hash_instrument(tree.exchange_id, tree.instrument_id);
+  auto it = index_.find(instrument_key);
+  if (it == index_.end()) {
+    auto size = header_->size.load(std::memory_order_relaxed);
+    if (size >= header_->capacity) {
+      SPDLOG_WARN("depth snapshot is full of {} instruments, {}@{} left out", size, tree.instrument_id.value,
+                  tree.exchange_id.value);
+      return;
+    }
+    auto &s = slots_[size];
+    s.instrument_key = instrument_key;
+    memcpy(&s.tree, &tree, sizeof(Tree));
+    index_.emplace(instrument_key, size);
+    header_->size.store(size + 1, std::memory_order_release); // published with its content
+    return;
+  }
+  auto &s = slots_[it->second];
+  auto sequence = s.sequence.load(std::memory_order_relaxed);
+  s.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(&s.tree, &tree, sizeof(Tree));
+  s.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+std::optional<Tree> DepthSnapshot::read(const std::string &exchange_id, const std::string &instrument_id) const {
+  auto s = find(hash_instrument(exchange_id.c_str(), instrument_id.c_str()));
+  if (s == nullptr) {
+    return std::nullopt;
+  }
+  Tree tree = {};
+  for (uint32_t retry = 0; retry < MAX_READ_RETRIES; retry++) {
+    auto sequence = s->sequence.load(std::memory_order_acquire);
+    if (sequence & 1u) {
+      os::cpu_pause();
+      continue;
+    }
+    memcpy(&tree, &s->tree, sizeof(Tree));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s->sequence.load(std::memory_order_relaxed) == sequence) {
+      return tree;
+    }
+    os::cpu_pause();
+  }
+  throw wingchun_error(fmt::format("depth snapshot of {}@{} kept being written", instrument_id, exchange_id));
+}
+
+uint32_t DepthSnapshot::size() const { return header_->size.load(std::memory_order_acquire); }
+
+uint32_t DepthSnapshot::capacity() const { return header_->capacity; }
+
+const DepthSnapshot::slot *DepthSnapshot::find(uint32_t instrument_key) const {
+  auto size = std::min(header_->size.load(std::memory_order_acquire), header_->capacity);
+  auto it = index_.find(instrument_key);
+  if (it != index_.end() and it->second < size and slots_[it->second].instrument_key == instrument_key) {
+    return &slots_[it->second];
+  }
+  // not seen yet, or the writer has started over
+  for (uint32_t i = 0; i < size; i++) {
+    if (slots_[i].instrument_key == instrument_key) {
+      index_.insert_or_assign(instrument_key, i);
+      return &slots_[i];
+    }
+  }
+  return nullptr;
+}
+} // namespace kungfu::wingchun::service
@@ -4,24 +4,200 @@
 // Created by Keren Dong on 2020/7/20.
 //
 
+#include <filesystem>
+
 #include <kungfu/wingchun/strategy/backtest.h>
+#include <kungfu/yijinjing/journal/page.h>
+#include <kungfu/yijinjing/journal/page_archive.h>
+#include <kungfu/yijinjing/journal/page_index.h>
+#include <kungfu/yijinjing/log.h>
+#include <kungfu/yijinjing/time.h>
+
+using namespace kungfu::yijinjing::practice;
+using namespace kungfu::longfist::types;
+using namespace kungfu::longfist::enums;
+using namespace kungfu::yijinjing;
+using namespace kungfu::yijinjing::data;
+using namespace kungfu::yijinjing::journal;
+using namespace kungfu::wingchun::backtest;
 
 namespace kungfu::wingchun::strategy {
-int64_t BacktestContext::now() const { return 0; }
-void BacktestContext::add_timer(int64_t nanotime, const std::function<void(event_ptr)> &callback) {}
-void BacktestContext::add_time_interval(int64_t duration, const std::function<void(event_ptr)> &callback) {}
-void BacktestContext::add_account(const std::string &source, const std::string &account) {}
-void BacktestContext::subscribe(const std::string &source, const std::vector<std::string> &instrument_ids,
-                                const std::string &exchange_ids) {}
-void BacktestContext::subscribe_all(const std::string &source, uint8_t market_type, uint64_t instrument_type,
-                                    uint64_t data_type) {}
+
+BacktestContext::BacktestContext(apprentice &app, const rx::connectable_observable<event_ptr> &events)
+    : RuntimeContext(app, events),
+      match_engine_(make_settings(app.get_locator()), [this](const event_ptr &event) { write_event(event); }) {}
+
+void BacktestContext::on_start() {
+  RuntimeContext::on_start();
+  auto home_uid = app_.get_home_uid();
+  for (const auto &pair : list_accounts()) {
+    auto &location = pair.second;
+    if (account_writers_.find(location->uid) != account_writers_.end()) {
+      continue; // listed by hashed account too
+    }
+    remove_journal(location, home_uid);
+    account_writers_.emplace(location->uid, app_.get_io_device()->open_writer_at(location, home_uid));
+    app_.get_reader()->join(location, home_uid, now());
+  }
+  app_.handle(Quote::tag, [&](const event_ptr &event) {
+    match_engine_.on_quote(event->gen_time(), event->data<Quote>());
+  });
+  app_.handle(Transaction::tag, [&](const event_ptr &event) {
+    match_engine_.on_transaction(event->gen_time(), event->data<Transaction>());
+  });
+  app_.handle(Entrust::tag, [&](const event_ptr &event) { match_engine_.advance(event->gen_time()); });
+  app_.handle(Tree::tag, [&](const event_ptr &event) { match_engine_.advance(event->gen_time()); });
+}
+
+uint64_t BacktestContext::insert_block_message(const std::string &source, const std::string &account,
+                                               const std::string &opponent_seat, uint64_t match_number,
+                                               bool is_specific) {
+  SPDLOG_ERROR("block message is not supported by backtest");
+  return 0;
+}
+
 uint64_t BacktestContext::insert_order(const std::string &instrument_id, const std::string &exchange_id,
                                        const std::string &source, const std::string &account, double limit_price,
-                                       int64_t volume, longfist::enums::PriceType type, longfist::enums::Side side,
-                                       longfist::enums::Offset offset, longfist::enums::HedgeFlag hedge_flag,
+                                       int64_t volume, PriceType type, Side side, Offset offset, HedgeFlag hedge_flag,
                                        bool is_swap, uint64_t block_id, uint64_t parent_id) {
+  OrderInput input = {};
+  strcpy(input.instrument_id, instrument_id.c_str());
+  strcpy(input.exchange_id, exchange_id.c_str());
+  input.limit_price = limit_price;
+  input.frozen_price = limit_price;
+  input.volume = volume;
+  input.price_type = type;
+  input.side = side;
+  input.offset = offset;
+  input.hedge_flag = hedge_flag;
+  input.block_id = block_id;
+  input.parent_id = parent_id;
+  input.is_swap = is_swap;
+  return submit(get_td_location_uid(source, account), input);
+}
+
+uint64_t BacktestContext::insert_order_input(const std::string &source, const std::string &account,
+                                             OrderInput &order_input) {
+  return submit(get_td_location_uid(source, account), order_input);
+}
+
+std::vector<uint64_t> BacktestContext::insert_batch_orders(
+    const std::string &source, const std::string &account, const std::vector<std::string> &instrument_ids,
+    const std::vector<std::string> &exchange_ids, std::vector<double> limit_prices, std::vector<int64_t> volumes,
+    std::vector<PriceType> types, std::vector<Side> sides, std::vector<Offset> offsets,
+    std::vector<HedgeFlag> hedge_flags, std::vector<bool> is_swaps) {
+  std::vector<uint64_t> order_ids{};
+  bool flag = instrument_ids.size() == exchange_ids.size() and //
+              instrument_ids.size() == limit_prices.size() and //
+              instrument_ids.size() == volumes.size() and      //
+              instrument_ids.size() == types.size() and        //
+              instrument_ids.size() == sides.size() and        //
+              instrument_ids.size() == offsets.size() and      //
+              instrument_ids.size() == hedge_flags.size() and  //
+              instrument_ids.size() == is_swaps.size();
+  if (not flag) {
+    SPDLOG_ERROR("Batch size not equals!");
+    return order_ids;
+  }
+  for (int i = 0; i < instrument_ids.size(); ++i) {
+    order_ids.push_back(insert_order(instrument_ids.at(i), exchange_ids.at(i), source, account, limit_prices.at(i),
+                                     volumes.at(i), types.at(i), sides.at(i), offsets.at(i), hedge_flags.at(i),
+                                     is_swaps.at(i)));
+  }
+  return order_ids;
+}
+
+std::vector<uint64_t> BacktestContext::insert_array_orders(const std::string &source, const std::string &account,
+                                                           std::vector<OrderInput> &order_inputs) {
+  std::vector<uint64_t> order_ids{};
+  for (OrderInput &input : order_inputs) {
+    input.order_id = 0;
+    order_ids.push_back(insert_order_input(source, account, input));
+  }
+  return order_ids;
+}
+
+uint64_t BacktestContext::insert_basket_order(uint64_t basket_id, const std::string &source,
+                                              const std::string &account, Side side, PriceType price_type,
+                                              PriceLevel price_level, double price_offset, int64_t volume) {
+  SPDLOG_ERROR("basket order is not supported by backtest");
   return 0;
 }
-uint64_t BacktestContext::cancel_order(uint64_t order_id) { return 0; }
-int64_t BacktestContext::get_trading_day() const { return 0; }
+
+uint64_t BacktestContext::cancel_order(uint64_t order_id) {
+  uint32_t account_location_uid = (order_id >> 32u) xor (app_.get_home_uid());
+  if (list_accounts().find(account_location_uid) == list_accounts().end()) {
+    SPDLOG_ERROR("invalid order_id {:16x}", order_id);
+    return 0;
+  }
+  OrderAction action = {};
+  action.order_action_id = uint64_t(account_location_uid xor app_.get_home_uid()) << 32u | ++action_seq_;
+  action.order_id = order_id;
+  action.action_flag = OrderActionFlag::Cancel;
+  match_engine_.cancel_order(now(), app_.get_home_uid(), account_location_uid, action);
+  match_engine_.advance(now());
+  return action.order_action_id;
+}
+
+void BacktestContext::req_history_order(const std::string &source, const std::string &account, uint32_t query_num) {}
+
+void BacktestContext::req_history_trade(const std::string &source, const std::string &account, uint32_t query_num) {}
+
+MatchEngine &BacktestContext::get_match_engine() { return match_engine_; }
+
+uint64_t BacktestContext::submit(uint32_t account_location_uid, OrderInput &input) {
+  input.instrument_type = get_instrument_type(input.exchange_id, input.instrument_id);
+  if (input.instrument_type == InstrumentType::Unknown) {
+    SPDLOG_ERROR("unsupported instrument type {} of {}.{}", str_from_instrument_type(input.instrument_type),
+                 input.instrument_id, input.exchange_id);
+    return 0;
+  }
+  // same layout as live order ids, so cancel_order and bookkeeper can find the account from it
+  auto order_id = uint64_t(account_location_uid xor app_.get_home_uid()) << 32u | ++order_seq_;
+  input.order_id = input.order_id == 0 ? order_id : input.order_id;
+  input.insert_time = now();
+  if (not is_bypass_accounting()) {
+    get_bookkeeper().on_order_input(now(), app_.get_home_uid(), account_location_uid, input);
+  }
+  match_engine_.insert_order(now(), app_.get_home_uid(), account_location_uid, input);
+  match_engine_.advance(now());
+  return input.order_id;
+}
+
+void BacktestContext::write_event(const event_ptr &event) {
+  auto it = account_writers_.find(event->source());
+  if (it == account_writers_.end()) {
+    SPDLOG_ERROR("no journal for simulated account {:08x}", event->source());
+    return;
+  }
+  auto &writer = it->second;
+  auto frame = writer->open_frame(event->trigger_time(), event->msg_type(), event->data_length());
+  memcpy(const_cast<void *>(frame->data_address()), event->data_address(), event->data_length());
+  writer->close_frame(event->data_length(), event->gen_time()); // simulated time, frames merge with market data by it
+}
+
+void BacktestContext::remove_journal(const location_ptr &location, uint32_t dest_id) {
+  for (auto page_id : location->locator->list_page_id(location, dest_id)) {
+    std::filesystem::remove(page::get_page_path(location, dest_id, page_id));
+    std::filesystem::remove(page_archive::get_archive_path(location, dest_id, page_id));
+  }
+  std::filesystem::remove(page_index::get_index_path(location, dest_id));
+}
+
+MatchSettings BacktestContext::make_settings(const locator_ptr &locator) {
+  MatchSettings settings = {};
+  if (locator->has_env("KF_BACKTEST_INSERT_LATENCY_US")) {
+    settings.insert_latency =
+        std::stoll(locator->get_env("KF_BACKTEST_INSERT_LATENCY_US")) * time_unit::NANOSECONDS_PER_MICROSECOND;
+  }
+  if (locator->has_env("KF_BACKTEST_CANCEL_LATENCY_US")) {
+    settings.cancel_latency =
+        std::stoll(locator->get_env("KF_BACKTEST_CANCEL_LATENCY_US")) * time_unit::NANOSECONDS_PER_MICROSECOND;
+  }
+  if (locator->has_env("KF_BACKTEST_QUEUE_MODEL")) {
+    auto optimistic = locator->get_env("KF_BACKTEST_QUEUE_MODEL") == "optimistic";
+    settings.queue_model = optimistic ? QueueModel::Optimistic : QueueModel::Conservative;
+  }
+  return settings;
+}
 } // namespace kungfu::wingchun::strategy
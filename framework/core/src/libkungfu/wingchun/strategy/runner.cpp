@@ -4,6 +4,7 @@
 // Created by Keren Dong on 2019-06-20.
 //
 
+#include <kungfu/wingchun/strategy/backtest.h>
 #include <kungfu/wingchun/strategy/runner.h>
 
 using namespace kungfu::rx;
@@ -24,7 +25,12 @@ Runner::~Runner() { context_.reset(); }
 
 RuntimeContext_ptr Runner::get_context() const { return context_; }
 
-RuntimeContext_ptr Runner::make_context() { return std::make_shared<RuntimeContext>(*this, events_); }
+RuntimeContext_ptr Runner::make_context() {
+  if (get_home()->mode == mode::BACKTEST) {
+    return std::make_shared<BacktestContext>(*this, events_);
+  }
+  return std::make_shared<RuntimeContext>(*this, events_);
+}
 
 void Runner::add_strategy(const Strategy_ptr &strategy) { strategies_.push_back(strategy); }
 
@@ -43,7 +49,9 @@ void Runner::react() {
   apprentice::react();
 }
 
-void Runner::on_react() { events_ | is(Channel::tag) | $$(inspect_channel(event)); }
+void Runner::on_react() {
+  handle(Channel::tag, [&](const event_ptr &event) { inspect_channel(event); });
+}
 
 void Runner::inspect_channel(const event_ptr &event) {
   auto channel = event->data<Channel>();
@@ -59,6 +67,11 @@ void Runner::inspect_channel(const event_ptr &event) {
 
 void Runner::on_start() {
   pre_start();
+  if (get_home()->mode == mode::BACKTEST) {
+    for (const auto &pair : context_->list_accounts()) {
+      add_location(now(), pair.second); // simulated orders and trades come from account locations
+    }
+  }
   enable(*context_);
   context_->get_bookkeeper().add_book_listener(std::make_shared<BookListener>(*this));
   events_ | take_until(events_ | filter([&](auto e) { return started_; })) | $$(prepare(event));
@@ -78,37 +91,64 @@ void Runner::post_start() {
     return; // safe guard for live mode, in that case we will run truly when prepare process is done.
   }
 
-  events_ | is_own<Quote>(context_->get_broker_client()) |
-      $$(invoke(&Strategy::on_quote, event->data<Quote>(), get_location(event->source())));
-  events_ | is_own<Tree>(context_->get_broker_client()) |
-      $$(invoke(&Strategy::on_tree, event->data<Tree>(), get_location(event->source())));
-  events_ | is_own<Entrust>(context_->get_broker_client()) |
-      $$(invoke(&Strategy::on_entrust, event->data<Entrust>(), get_location(event->source())));
-  events_ | is_own<Transaction>(context_->get_broker_client()) |
-      $$(invoke(&Strategy::on_transaction, event->data<Transaction>(), get_location(event->source())));
-  events_ | is(Order::tag) | $$(invoke(&Strategy::on_order, event->data<Order>(), get_location(event->source())));
-  events_ | is(Trade::tag) | $$(invoke(&Strategy::on_trade, event->data<Trade>(), get_location(event->source())));
+  handle(Quote::tag, [&](const event_ptr &event) {
+    if (is_own_event<Quote>(context_->get_broker_client(), event)) {
+      invoke(&Strategy::on_quote, event->data<Quote>(), get_location(event->source()));
+    }
+  });
+  handle(Tree::tag, [&](const event_ptr &event) {
+    if (is_own_event<Tree>(context_->get_broker_client(), event)) {
+      invoke(&Strategy::on_tree, event->data<Tree>(), get_location(event->source()));
+    }
+  });
+  handle(Entrust::tag, [&](const event_ptr &event) {
+    if (is_own_event<Entrust>(context_->get_broker_client(), event)) {
+      invoke(&Strategy::on_entrust, event->data<Entrust>(), get_location(event->source()));
+    }
+  });
+  handle(Transaction::tag, [&](const event_ptr &event) {
+    if (is_own_event<Transaction>(context_->get_broker_client(), event)) {
+      invoke(&Strategy::on_transaction, event->data<Transaction>(), get_location(event->source()));
+    }
+  });
+  handle(Order::tag, [&](const event_ptr &event) {
+    invoke(&Strategy::on_order, event->data<Order>(), get_location(event->source()));
+  });
+  handle(Trade::tag, [&](const event_ptr &event) {
+    invoke(&Strategy::on_trade, event->data<Trade>(), get_location(event->source()));
+  });
   events_ | is_custom() |
       $$(invoke(&Strategy::on_custom_data, event->msg_type(),
                 {event->data_as_bytes(), event->data_as_bytes() + event->data_length()}, event->data_length(),
                 get_location(event->source())));
-  events_ | is(HistoryOrder::tag) |
-      $$(invoke(&Strategy::on_history_order, event->data<HistoryOrder>(), get_location(event->source())));
-  events_ | is(HistoryTrade::tag) |
-      $$(invoke(&Strategy::on_history_trade, event->data<HistoryTrade>(), get_location(event->source())));
-  events_ | is(RequestHistoryOrderError::tag) |
-      $$(invoke(&Strategy::on_req_history_order_error, event->data<RequestHistoryOrderError>(),
-                get_location(event->source())));
-  events_ | is(RequestHistoryTradeError::tag) |
-      $$(invoke(&Strategy::on_req_history_trade_error, event->data<RequestHistoryTradeError>(),
-                get_location(event->source())));
-  events_ | is(OrderActionError::tag) |
-      $$(invoke(&Strategy::on_order_action_error, event->data<OrderActionError>(), get_location(event->source())));
-  events_ | is_own<Deregister>(context_->get_broker_client()) |
-      $$(invoke(&Strategy::on_deregister, event->data<Deregister>(), get_location(event->source())));
-  events_ | is_own<BrokerStateUpdate>(context_->get_broker_client()) |
-      $$(invoke(&Strategy::on_broker_state_change, event->data<BrokerStateUpdate>(),
-                get_location(event->data<BrokerStateUpdate>().location_uid)));
+  handle(HistoryOrder::tag, [&](const event_ptr &event) {
+    invoke(&Strategy::on_history_order, event->data<HistoryOrder>(), get_location(event->source()));
+  });
+  handle(HistoryTrade::tag, [&](const event_ptr &event) {
+    invoke(&Strategy::on_history_trade, event->data<HistoryTrade>(), get_location(event->source()));
+  });
+  handle(RequestHistoryOrderError::tag, [&](const event_ptr &event) {
+    invoke(&Strategy::on_req_history_order_error, event->data<RequestHistoryOrderError>(),
+           get_location(event->source()));
+  });
+  handle(RequestHistoryTradeError::tag, [&](const event_ptr &event) {
+    invoke(&Strategy::on_req_history_trade_error, event->data<RequestHistoryTradeError>(),
+           get_location(event->source()));
+  });
+  handle(OrderActionError::tag, [&](const event_ptr &event) {
+    invoke(&Strategy::on_order_action_error, event->data<OrderActionError>(), get_location(event->source()));
+  });
+  handle(Deregister::tag, [&](const event_ptr &event) {
+    if (is_own_event<Deregister>(context_->get_broker_client(), event)) {
+      invoke(&Strategy::on_deregister, event->data<Deregister>(), get_location(event->source()));
+    }
+  });
+  handle(BrokerStateUpdate::tag, [&](const event_ptr &event) {
+    if (is_own_event<BrokerStateUpdate>(context_->get_broker_client(), event)) {
+      invoke(&Strategy::on_broker_state_change, event->data<BrokerStateUpdate>(),
+             get_location(event->data<BrokerStateUpdate>().location_uid));
+    }
+  });
 
   invoke(&Strategy::post_start);
   SPDLOG_INFO("strategy {} started", get_io_device()->get_home()->name);
@@ -28,11 +28,11 @@ RuntimeContext::RuntimeContext(apprentice &app, const rx::connectable_observable
 }
 
 void RuntimeContext::on_start() {
-  broker_client_.on_start(events_);
+  broker_client_.on_start();
   if (not is_bypass_accounting()) {
-    bookkeeper_.on_start(events_);
+    bookkeeper_.on_start();
   }
-  basketorder_engine_.on_start(events_);
+  basketorder_engine_.on_start();
 }
 
 int64_t RuntimeContext::now() const { return app_.now(); }
@@ -53,7 +53,9 @@ void RuntimeContext::add_account(const std::string &source, const std::string &a
   }
 
   auto home = app_.get_io_device()->get_home();
-  auto account_location = location::make_shared(mode::LIVE, category::TD, source, account, home->locator);
+  // simulated accounts of backtest write their own journals, apart from live ones
+  auto account_mode = home->mode == mode::BACKTEST ? mode::BACKTEST : mode::LIVE;
+  auto account_location = location::make_shared(account_mode, category::TD, source, account, home->locator);
   if (home->mode == mode::LIVE and not app_.has_location(account_location->uid)) {
     SPDLOG_ERROR(fmt::format("invalid account {}_{}", source, account));
   }
@@ -190,38 +192,79 @@ std::vector<uint64_t> RuntimeContext::insert_batch_orders(
     return order_ids;
   }
 
-  auto account_location_uid = get_td_location_uid(source, account);
-  auto writer = app_.get_writer(account_location_uid);
-  writer->mark(time::now_in_nano(), BatchOrderBegin::tag);
+  return insert_order_batch(source, account, instrument_ids.size(), [&](size_t i, OrderInput &input) {
+    strcpy(input.instrument_id, instrument_ids.at(i).c_str());
+    strcpy(input.exchange_id, exchange_ids.at(i).c_str());
+    input.limit_price = limit_prices.at(i);
+    input.frozen_price = limit_prices.at(i);
+    input.volume = volumes.at(i);
+    input.price_type = types.at(i);
+    input.side = sides.at(i);
+    input.offset = offsets.at(i);
+    input.hedge_flag = hedge_flags.at(i);
+    input.is_swap = is_swaps.at(i);
+  });
+}
 
-  for (int i = 0; i < instrument_ids.size(); ++i) {
-    uint64_t order_id =
-        insert_order(instrument_ids.at(i), exchange_ids.at(i), source, account, limit_prices.at(i), volumes.at(i),
-                     types.at(i), sides.at(i), offsets.at(i), hedge_flags.at(i), is_swaps.at(i));
-    order_ids.push_back(order_id);
+std::vector<uint64_t> RuntimeContext::insert_array_orders(const std::string &source, const std::string &account,
+                                                          std::vector<longfist::types::OrderInput> &order_inputs) {
+  auto order_ids = insert_order_batch(source, account, order_inputs.size(), [&](size_t i, OrderInput &input) {
+    const OrderInput &order_input = order_inputs.at(i);
+    input.instrument_id = order_input.instrument_id;
+    input.exchange_id = order_input.exchange_id;
+    input.limit_price = order_input.limit_price;
+    input.frozen_price = order_input.limit_price;
+    input.volume = order_input.volume;
+    input.price_type = order_input.price_type;
+    input.side = order_input.side;
+    input.offset = order_input.offset;
+    input.hedge_flag = order_input.hedge_flag;
+    input.is_swap = order_input.is_swap;
+  });
+  for (size_t i = 0; i < order_ids.size(); i++) {
+    order_inputs.at(i).order_id = order_ids.at(i);
   }
-
-  writer->mark(time::now_in_nano(), BatchOrderEnd::tag);
-  writer->close_data();
   return order_ids;
 }
 
-std::vector<uint64_t> RuntimeContext::insert_array_orders(const std::string &source, const std::string &account,
-                                                          std::vector<longfist::types::OrderInput> &order_inputs) {
-  std::vector<uint64_t> order_ids{};
+std::vector<uint64_t>
+RuntimeContext::insert_order_batch(const std::string &source, const std::string &account, size_t count,
+                                   const std::function<void(size_t, longfist::types::OrderInput &)> &make_input) {
+  std::vector<uint64_t> order_ids(count, 0);
+  if (count == 0) {
+    return order_ids;
+  }
   auto account_location_uid = get_td_location_uid(source, account);
+  auto insert_time = time::now_in_nano();
+  if (not broker_client_.is_ready(account_location_uid)) {
+    SPDLOG_ERROR("account {} not ready", td_locations_.at(account_location_uid)->uname);
+    return order_ids;
+  }
   auto writer = app_.get_writer(account_location_uid);
-  writer->mark(time::now_in_nano(), BatchOrderBegin::tag);
-
-  for (const OrderInput &input : order_inputs) {
-    uint64_t order_id =
-        insert_order(input.instrument_id, input.exchange_id, source, account, input.limit_price, input.volume,
-                     input.price_type, input.side, input.offset, input.hedge_flag, input.is_swap);
-    order_ids.push_back(order_id);
+  page_ptr page = writer->get_current_page(); // prevent that page released after close_frame before on_order_input
+  OrderInput *inputs = writer->open_array<OrderInput>(app_.now(), OrderInputBatch::tag, count);
+  uint32_t size = 0;
+  for (size_t i = 0; i < count; i++) {
+    OrderInput &input = inputs[size];
+    input = {};
+    make_input(i, input);
+    input.instrument_type = get_instrument_type(input.exchange_id, input.instrument_id);
+    if (input.instrument_type == InstrumentType::Unknown) {
+      SPDLOG_ERROR("unsupported instrument type {} of {}.{}", str_from_instrument_type(input.instrument_type),
+                   input.instrument_id, input.exchange_id);
+      continue;
+    }
+    input.order_id = writer->current_element_uid(size);
+    input.insert_time = insert_time;
+    order_ids.at(i) = input.order_id;
+    size++;
+  }
+  writer->close_frame(sizeof(OrderInput) * size);
+  if (not is_bypass_accounting()) {
+    for (uint32_t i = 0; i < size; i++) {
+      bookkeeper_.on_order_input(app_.now(), app_.get_home_uid(), account_location_uid, inputs[i]);
+    }
   }
-
-  writer->mark(time::now_in_nano(), BatchOrderEnd::tag);
-  writer->close_data();
   return order_ids;
 }
 
@@ -7,9 +7,99 @@
 #include <kungfu/yijinjing/cache/backend.h>
 
 namespace kungfu::yijinjing::cache {
-shift::shift(yijinjing::data::location_ptr location) : location_(std::move(location)), storage_map_() {}
+store::store(StateStoragePtr storage, size_t batch_rows, int64_t batch_time, bool threaded)
+    : storage_(std::move(storage)), batch_rows_(std::max<size_t>(batch_rows, 1)), batch_time_(batch_time),
+      threaded_(threaded), max_queued_rows_(batch_rows_ * MAX_QUEUED_BATCHES) {
+  if (threaded_) {
+    thread_ = std::thread([this]() { run(); });
+  }
+}
+
+store::~store() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      stopped_ = true;
+    }
+    queue_cv_.notify_one();
+    queue_space_cv_.notify_all();
+    thread_.join();
+  }
+  try {
+    flush();
+  } catch (const std::exception &e) {
+    SPDLOG_ERROR("failed to commit cached states {}", e.what());
+  }
+}
+
+void store::flush() {
+  std::lock_guard<std::mutex> lock(storage_mutex_);
+  drain();
+}
+
+void store::commit_pending() {
+  if (not threaded_) {
+    commit();
+  }
+}
+
+void store::commit() {
+  if (in_transaction_) {
+    storage_->commit(); // stays in transaction if it throws, next commit retries
+    in_transaction_ = false;
+    batch_size_ = 0;
+  }
+}
+
+void store::drain() {
+  std::vector<std::function<void()>> batch;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    batch.swap(queue_);
+  }
+  queue_space_cv_.notify_all();
+  for (auto &execute : batch) {
+    try {
+      execute();
+    } catch (const std::exception &e) {
+      SPDLOG_ERROR("failed to persist cached state {}", e.what());
+    }
+  }
+  commit();
+}
+
+void store::run() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_cv_.wait_for(lock, std::chrono::nanoseconds(batch_time_),
+                         [&]() { return stopped_ or queue_.size() >= batch_rows_; });
+      if (stopped_) {
+        return; // rows left are flushed by destructor
+      }
+    }
+    try {
+      flush();
+    } catch (const std::exception &e) {
+      SPDLOG_ERROR("failed to commit cached states {}", e.what());
+    }
+  }
+}
+
+shift::shift(yijinjing::data::location_ptr location) : location_(std::move(location)), storage_map_() {
+  auto locator = location_->locator;
+  if (locator->has_env("KF_CACHE_BATCH_ROWS")) {
+    batch_rows_ = std::stoul(locator->get_env("KF_CACHE_BATCH_ROWS"));
+  }
+  if (locator->has_env("KF_CACHE_BATCH_MICROSECONDS")) {
+    batch_time_ = std::stoll(locator->get_env("KF_CACHE_BATCH_MICROSECONDS")) * time_unit::NANOSECONDS_PER_MICROSECOND;
+  }
+  threaded_ = locator->has_env("KF_CACHE_PERSIST_THREAD") and locator->get_env("KF_CACHE_PERSIST_THREAD") != "0";
+}
 
-shift::shift(const shift &copy) : location_(copy.location_), storage_map_(copy.storage_map_) {}
+shift::shift(const shift &copy)
+    : location_(copy.location_), storage_map_(copy.storage_map_), batch_rows_(copy.batch_rows_),
+      batch_time_(copy.batch_time_), threaded_(copy.threaded_) {}
 
 void shift::ensure_storage(uint32_t dest) {
   if (storage_map_.find(dest) != storage_map_.end()) {
@@ -20,6 +110,18 @@ void shift::ensure_storage(uint32_t dest) {
   auto storage = make_storage_ptr(db_file, longfist::StateDataTypes);
   storage->pragma.journal_mode(sqlite_orm::journal_mode::WAL);
   storage->sync_schema();
-  storage_map_.emplace(dest, storage);
+  storage_map_.emplace(dest, std::make_shared<store>(storage, batch_rows_, batch_time_, threaded_));
+}
+
+void shift::commit() {
+  for (auto &pair : storage_map_) {
+    pair.second->commit_pending();
+  }
+}
+
+void shift::flush() {
+  for (auto &pair : storage_map_) {
+    pair.second->flush();
+  }
 }
 } // namespace kungfu::yijinjing::cache
@@ -28,10 +28,11 @@ cached::cached(locator_ptr locator, mode m, bool low_latency)
 }
 
 void cached::on_react() {
-  events_ | is(Location::tag) | $$(on_location(event));
-  events_ | is(Register::tag) | $$(register_triggger_clear_cache_shift(event->data<Register>()));
-  events_ | is(Register::tag) | $$(register_trigger_listen_public(event->gen_time(), event->data<Register>()));
-  events_ | is(RequestCached::tag) | $([&](const event_ptr &event) {
+  handle(Location::tag, [&](const event_ptr &event) { on_location(event); });
+  handle(Register::tag, [&](const event_ptr &event) { register_triggger_clear_cache_shift(event->data<Register>()); });
+  handle(Register::tag,
+         [&](const event_ptr &event) { register_trigger_listen_public(event->gen_time(), event->data<Register>()); });
+  handle(RequestCached::tag, [&](const event_ptr &event) {
     auto source_id = event->source();
 
     SPDLOG_INFO("get RequestCached from {}", get_location_uname(source_id));
@@ -62,8 +63,8 @@ void cached::on_react() {
 }
 
 void cached::on_start() {
-  events_ | is(Channel::tag) | $$(inspect_channel(event->gen_time(), event->data<Channel>()));
-  events_ | is(CacheReset::tag) | $$(on_cache_reset(event));
+  handle(Channel::tag, [&](const event_ptr &event) { inspect_channel(event->gen_time(), event->data<Channel>()); });
+  handle(CacheReset::tag, [&](const event_ptr &event) { on_cache_reset(event); });
   events_ | instanceof <journal::frame>() | filter([&](const event_ptr &event) {
                          auto source_id = event->source();
                          return source_id != master_home_location_->uid and source_id != master_cmd_location_->uid;
@@ -96,7 +97,7 @@ void cached::handle_cached_feeds(int store_volume_every_loop) {
     using DataType = typename decltype(+boost::hana::second(it))::type;
     auto hana_type = boost::hana::type_c<DataType>;
 
-    using FeedMap = std::unordered_map<uint64_t, state<DataType>>;
+    using FeedMap = longfist::StateMap<DataType>;
     auto &feed_map = const_cast<FeedMap &>(feed_bank_[hana_type]);
 
     if (feed_map.size() != 0) {
@@ -124,6 +125,13 @@ void cached::handle_cached_feeds(int store_volume_every_loop) {
       }
     }
   });
+  for (auto &pair : app_cache_shift_) {
+    try {
+      pair.second.commit();
+    } catch (const std::exception &e) {
+      SPDLOG_ERROR("Unexpected exception by commit cached feeds {}", e.what());
+    }
+  }
 }
 
 void cached::handle_profile_feeds(int store_volume_every_loop) {
@@ -132,7 +140,7 @@ void cached::handle_profile_feeds(int store_volume_every_loop) {
     using DataType = typename decltype(+boost::hana::second(it))::type;
     auto hana_type = boost::hana::type_c<DataType>;
 
-    using FeedMap = std::unordered_map<uint64_t, state<DataType>>;
+    using FeedMap = longfist::StateMap<DataType>;
     auto &feed_map = const_cast<FeedMap &>(profile_bank_[hana_type]);
 
     if (feed_map.size() != 0) {
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <filesystem>
+
+#include <kungfu/yijinjing/cache/backend.h>
+#include <kungfu/yijinjing/cache/config.h>
+
+namespace kungfu::yijinjing::cache {
+std::optional<std::string> read_config_value(const std::string &db_file, uint32_t location_uid) {
+  if (not std::filesystem::exists(db_file)) {
+    return std::nullopt;
+  }
+  auto storage = make_storage_ptr(db_file, longfist::ProfileDataTypes);
+  auto config = storage->get_pointer<longfist::types::Config>(location_uid);
+  return config ? std::optional<std::string>(config->value) : std::nullopt;
+}
+} // namespace kungfu::yijinjing::cache
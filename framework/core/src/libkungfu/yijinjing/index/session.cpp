@@ -4,7 +4,10 @@
 // Created by Keren Dong on 2020/3/27.
 //
 
+#include <atomic>
 #include <fstream>
+#include <thread>
+
 #include <kungfu/yijinjing/index/session.h>
 
 using namespace sqlite_orm;
@@ -62,6 +65,7 @@ session_builder::session_builder(const io_device_ptr &io_device) : session_finde
 }
 
 int64_t session_builder::find_last_active_time(const data::location_ptr &source_location) {
+  flush();
   return session_finder::find_last_active_time(source_location);
 }
 
@@ -78,7 +82,7 @@ Session &session_builder::open_session(const location_ptr &source_location, int6
   session.begin_time = time;
   session.end_time = 0;
   session.update_time = time;
-  session_storage_->replace(session);
+  pending_sessions_.push_back(session);
   return session;
 }
 
@@ -90,7 +94,7 @@ void session_builder::close_session(const location_ptr &source_location, int64_t
   auto &session = live_sessions_.at(source_location->uid);
   session.end_time = time;
   session.update_time = time;
-  session_storage_->replace(session);
+  pending_sessions_.push_back(session);
 }
 
 SessionMap &session_builder::close_all_sessions(int64_t time) {
@@ -98,8 +102,9 @@ SessionMap &session_builder::close_all_sessions(int64_t time) {
     auto &session = pair.second;
     session.end_time = time;
     session.update_time = time;
-    session_storage_->replace(session);
+    pending_sessions_.push_back(session);
   }
+  flush();
   return live_sessions_;
 }
 
@@ -113,55 +118,176 @@ void session_builder::update_session(const frame_ptr &frame) {
   session.data_size += frame->frame_length();
 }
 
-[[maybe_unused]] void session_builder::rebuild_index_db() {
+void session_builder::flush() {
+  if (pending_sessions_.empty()) {
+    return;
+  }
+  session_storage_->transaction([&] {
+    for (const auto &session : pending_sessions_) {
+      session_storage_->replace(session);
+    }
+    return true;
+  });
+  pending_sessions_.clear();
+}
+
+namespace {
+/**
+ * Journals of one master command location, all about the session of one app, or of master itself.
+ */
+struct session_journals {
+  location_ptr journal_location;
+  location_ptr session_location;
+  std::unordered_map<uint32_t, JournalIndex> indices = {};
+  std::optional<Session> session = {}; // latest session indexed before
+  SessionVector sessions = {};
+};
+
+void index_sessions(const io_device_ptr &io_device, session_journals &journals) {
+  auto reader = io_device->open_reader_to_subscribe();
+  std::unordered_map<uint32_t, uint32_t> skip_frames = {};
+  for (auto &[dest_id, index] : journals.indices) {
+    // seek skips frames at the given time, step back one nanosecond and skip the ones indexed instead
+    reader->join(journals.journal_location, dest_id, index.last_time > 0 ? index.last_time - 1 : 0);
+    skip_frames.emplace(dest_id, index.last_time_frames);
+  }
+  auto session_uid = journals.session_location->uid;
+  auto &session = journals.session;
+  while (reader->data_available()) {
+    auto page = reader->current_page();
+    auto frame = reader->current_frame();
+    auto gen_time = frame->gen_time();
+    auto &index = journals.indices.at(page->get_dest_id());
+    auto &skip = skip_frames.at(page->get_dest_id());
+    if (gen_time == index.last_time and skip > 0) {
+      skip--;
+      reader->next();
+      continue;
+    }
+    index.last_time_frames = gen_time == index.last_time ? index.last_time_frames + 1 : 1;
+    index.last_time = gen_time;
+    index.page_id = page->get_page_id();
+    skip = 0;
+
+    if (frame->msg_type() == SessionStart::tag) {
+      if (session.has_value()) {
+        journals.sessions.push_back(session.value());
+      }
+      session = Session{};
+      session->location_uid = session_uid;
+      session->category = journals.session_location->category;
+      session->group = journals.session_location->group;
+      session->name = journals.session_location->name;
+      session->mode = journals.session_location->mode;
+      session->begin_time = gen_time;
+      session->update_time = gen_time;
+    } else if (frame->msg_type() == SessionEnd::tag and session.has_value()) {
+      session->end_time = gen_time;
+      session->update_time = gen_time;
+    } else if (frame->source() == session_uid and session.has_value()) {
+      session->update_time = gen_time;
+      session->frame_count++;
+      session->data_size += frame->frame_length();
+    }
+    reader->next();
+  }
+  if (session.has_value()) {
+    journals.sessions.push_back(session.value());
+  }
+}
+
+size_t get_index_threads(size_t journals_count) {
+  auto threads = std::getenv("KF_INDEX_THREADS");
+  size_t count = threads == nullptr ? std::thread::hardware_concurrency() : std::stoul(threads);
+  return std::max<size_t>(1, std::min(count, journals_count));
+}
+} // namespace
+
+[[maybe_unused]] void session_builder::rebuild_index_db(bool full) {
+  flush();
   std::unordered_map<std::string, location_ptr> formatstr_to_locations = {};
   auto locator = io_device_->get_locator();
-  auto reader = io_device_->open_reader_to_subscribe();
-  for (const auto &location : locator->list_locations("*", "*", "*", "*")) {
-    SPDLOG_TRACE("investigating journal for [{:08x}] {}", location->uid, location->uname);
-
+  auto locations = locator->list_locations("*", "*", "*", "*");
+  for (const auto &location : locations) {
     if (location->category != category::SYSTEM or location->group != "master") {
       formatstr_to_locations.emplace(fmt::format("{:08x}", location->uid), location);
     }
-
     if (location->category == category::SYSTEM and location->group == "master" and location->name == "master") {
       formatstr_to_locations.emplace(location->name, location);
     }
+  }
 
-    for (const auto dest_uid : locator->list_location_dest(location)) {
-      reader->join(location, dest_uid, 0);
-    }
+  std::unordered_map<uint64_t, JournalIndex> last_indices = {};
+  for (const auto &index : session_storage_->get_all<JournalIndex>()) {
+    last_indices.emplace(uint64_t(index.location_uid) << 32u | index.dest_id, index);
   }
+  full = full or last_indices.empty();
 
-  session_storage_->remove_all<Session>();
-  while (reader->data_available()) {
-    auto location = reader->current_page()->get_location();
-    std::string uid_str = location->name;
-    auto frame = reader->current_frame();
-    if (formatstr_to_locations.find(uid_str) == formatstr_to_locations.end()) {
-      reader->next();
+  // sessions are told by the command journals master keeps for each app, named by app uid, and by its own journal
+  std::vector<session_journals> all_journals = {};
+  for (const auto &location : locations) {
+    auto it = formatstr_to_locations.find(location->name);
+    if (location->category != category::SYSTEM or location->group != "master" or
+        it == formatstr_to_locations.end()) {
       continue;
     }
-
-    try {
-      if (frame->msg_type() == SessionStart::tag) {
-        open_session(formatstr_to_locations.at(uid_str), frame->gen_time());
-      } else if (frame->msg_type() == SessionEnd::tag) {
-        close_session(formatstr_to_locations.at(uid_str), frame->gen_time());
-      } else if (location->category != category::SYSTEM or location->group != "master") {
-        update_session(frame);
-      } else if (location->category == category::SYSTEM and location->group == "master" and
-                 location->name == "master") {
-        update_session(frame);
+    SPDLOG_TRACE("investigating journal for [{:08x}] {}", location->uid, location->uname);
+    auto &journals = all_journals.emplace_back(session_journals{location, it->second});
+    for (const auto dest_id : locator->list_location_dest(location)) {
+      auto last_index = last_indices.find(uint64_t(location->uid) << 32u | dest_id);
+      if (not full and last_index != last_indices.end()) {
+        journals.indices.emplace(dest_id, last_index->second);
+        continue;
       }
-    } catch (const std::exception &ex) {
-      SPDLOG_ERROR("problematic frame at {}, {}, {}", location->uname, formatstr_to_locations.at(uid_str)->uname,
-                   ex.what());
+      JournalIndex index = {};
+      index.location_uid = location->uid;
+      index.dest_id = dest_id;
+      journals.indices.emplace(dest_id, index);
     }
-    reader->next();
+    if (not full) {
+      auto range = where(eq(&Session::location_uid, it->second->uid));
+      auto sessions = session_storage_->get_all<Session>(range, order_by(&Session::begin_time).desc(), limit(1));
+      journals.session = sessions.empty() ? std::nullopt : std::optional<Session>(sessions.front());
+    }
+  }
+
+  std::atomic<size_t> next_journals = 0;
+  std::vector<std::thread> threads = {};
+  std::vector<std::exception_ptr> errors(get_index_threads(all_journals.size()));
+  for (size_t t = 0; t < errors.size(); t++) {
+    threads.emplace_back([&, t] {
+      try {
+        for (auto i = next_journals++; i < all_journals.size(); i = next_journals++) {
+          index_sessions(io_device_, all_journals[i]);
+        }
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
   }
-  for (const auto &pair : live_sessions_) {
-    session_storage_->replace(pair.second);
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
   }
+
+  session_storage_->transaction([&] {
+    if (full) {
+      session_storage_->remove_all<Session>();
+      session_storage_->remove_all<JournalIndex>();
+    }
+    for (const auto &journals : all_journals) {
+      for (const auto &session : journals.sessions) {
+        session_storage_->replace(session);
+      }
+      for (const auto &pair : journals.indices) {
+        session_storage_->replace(pair.second);
+      }
+    }
+    return true;
+  });
 }
-} // namespace kungfu::yijinjing::index
\ No newline at end of file
+} // namespace kungfu::yijinjing::index
@@ -1,13 +1,21 @@
 // SPDX-License-Identifier: Apache-2.0
 
+#include <atomic>
+#include <chrono>
+
 #include <kungfu/common.h>
+#include <kungfu/yijinjing/cache/config.h>
 #include <kungfu/yijinjing/io.h>
 #include <kungfu/yijinjing/log.h>
 #include <kungfu/yijinjing/time.h>
+#include <kungfu/yijinjing/util/os.h>
 
 #define SETUP_TIMEOUT 50
 #define DEFAULT_RECV_TIMEOUT 100
 #define DEFAULT_NOTICE_TIMEOUT 1000
+#define DOORBELL_FILE_SIZE 4096
+#define DEFAULT_SPIN_POLLS 10000
+#define MESSAGE_TRANSIT_TIMEOUT 1000000 // ns to wait for a message rung on doorbell but not in socket yet
 
 using namespace kungfu::longfist;
 using namespace kungfu::longfist::enums;
@@ -30,14 +38,84 @@ public:
   }
 };
 
+/**
+ * Shared memory notification channel, sits next to master sockets.
+ * Each direction has a sequence counter, ringing bumps it and only makes a futex wake syscall when some consumer went to
+ * sleep since last wake, so that a burst of frames costs at most one wakeup per waiting consumer.
+ * Messages published through sockets are also counted, a consumer woken by the ring of a message which has not
+ * arrived in its socket yet waits for it, instead of sleeping until the next ring.
+ */
+class doorbell {
+public:
+  /** UP: apps to master, DOWN: master to apps */
+  enum class direction : int { UP, DOWN };
+
+  doorbell(const std::string &path, direction d)
+      : address_(os::load_mmap_buffer(path, DOORBELL_FILE_SIZE, true, true)),
+        slot_(reinterpret_cast<slot *>(address_) + static_cast<int>(d)) {}
+
+  ~doorbell() { os::release_mmap_buffer(address_, DOORBELL_FILE_SIZE, true); }
+
+  void ring(bool message = false) {
+    if (message) {
+      slot_->messages.fetch_add(1, std::memory_order_release);
+    }
+    slot_->sequence.fetch_add(1);
+    if (slot_->sleepers.load() > 0 and slot_->sleepers.exchange(0) > 0) {
+      slot_->wake_time.store(steady_now(), std::memory_order_relaxed);
+      os::futex_wake(reinterpret_cast<uint32_t *>(&slot_->sequence));
+    }
+  }
+
+  /** returns true if rung after seen, and moves seen to the latest */
+  bool poll(uint32_t &seen) const {
+    auto sequence = slot_->sequence.load(std::memory_order_acquire);
+    if (sequence == seen) {
+      return false;
+    }
+    seen = sequence;
+    return true;
+  }
+
+  [[nodiscard]] uint32_t messages() const { return slot_->messages.load(std::memory_order_acquire); }
+
+  /** @return nanoseconds between the wake call and waking up, -1 if not woken by a ring */
+  int64_t sleep(uint32_t seen, int timeout_ms) {
+    slot_->sleepers.fetch_add(1);
+    if (slot_->sequence.load() != seen or
+        not os::futex_wait(reinterpret_cast<uint32_t *>(&slot_->sequence), seen, timeout_ms)) {
+      return -1;
+    }
+    auto latency = steady_now() - slot_->wake_time.load(std::memory_order_relaxed);
+    // wake time of an earlier ring if the sequence moved before going to sleep
+    return latency >= 0 and latency < int64_t(timeout_ms) * time_unit::NANOSECONDS_PER_MILLISECOND ? latency : -1;
+  }
+
+private:
+  struct alignas(64) slot {
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> sleepers;
+    std::atomic<uint32_t> messages;
+    std::atomic<int64_t> wake_time; // steady clock is shared by processes, unlike time::now_in_nano
+  };
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) and std::atomic<uint32_t>::is_always_lock_free);
+  static_assert(sizeof(slot) * 2 <= DOORBELL_FILE_SIZE);
+
+  const uintptr_t address_;
+  slot *slot_;
+
+  static int64_t steady_now() { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+};
+
 class nanomsg_resource : public resource {
 protected:
-  nanomsg_resource(const io_device &io_device, bool low_latency, protocol p)
+  nanomsg_resource(const io_device &io_device, bool low_latency, bool with_doorbell, protocol p, doorbell::direction d)
       : io_device_(io_device), low_latency_(low_latency),
         location_(std::make_shared<data::location>(longfist::enums::mode::LIVE, longfist::enums::category::SYSTEM,
                                                    "master", "master", io_device_.get_home()->locator)),
         bind_path_(io_device_.get_url_factory()->make_path_bind(location_, p)),
-        connect_path_(io_device_.get_url_factory()->make_path_connect(location_, p)), socket_(p) {}
+        connect_path_(io_device_.get_url_factory()->make_path_connect(location_, p)), socket_(p),
+        doorbell_(make_doorbell(with_doorbell, d)) {}
 
   const io_device &io_device_;
   const bool low_latency_;
@@ -45,28 +123,51 @@ protected:
   const std::string bind_path_;
   const std::string connect_path_;
   nanomsg::socket socket_;
+  std::unique_ptr<doorbell> doorbell_;
+
+private:
+  std::unique_ptr<doorbell> make_doorbell(bool enabled, doorbell::direction d) {
+    if (not enabled or not os::futex_supported()) {
+      return nullptr;
+    }
+    return std::make_unique<doorbell>(location_->locator->layout_file(location_, layout::NANOMSG, "doorbell"), d);
+  }
 };
 
 class nanomsg_publisher : public publisher, protected nanomsg_resource {
 public:
-  nanomsg_publisher(const io_device &io_device, bool low_latency, protocol p)
-      : nanomsg_resource(io_device, low_latency, p) {}
+  // publishers always ring, low latency ones too, observers of other wait strategies may sleep on the doorbell
+  nanomsg_publisher(const io_device &io_device, bool low_latency, protocol p, doorbell::direction d)
+      : nanomsg_resource(io_device, low_latency, true, p, d) {}
 
   ~nanomsg_publisher() override { socket_.close(); }
 
   void setup() override {}
 
-  int notify() override { return low_latency_ ? 0 : publish("{}"); }
+  int notify() override {
+    if (doorbell_) {
+      doorbell_->ring(); // cheap unless someone sleeps, observers may block whatever this process does
+      return 0;
+    }
+    if (low_latency_) {
+      return 0;
+    }
+    return publish("{}");
+  }
 
   int publish(const std::string &json_message, int flags = NN_DONTWAIT) override {
-    return socket_.send(json_message, flags);
+    auto rc = socket_.send(json_message, flags);
+    if (doorbell_ and rc > 0) {
+      doorbell_->ring(true); // wake up observers blocked on doorbell to pick the message
+    }
+    return rc;
   }
 };
 
 class nanomsg_publisher_master : public nanomsg_publisher {
 public:
   nanomsg_publisher_master(const io_device &io_device, bool low_latency)
-      : nanomsg_publisher(io_device, low_latency, protocol::PUBLISH) {
+      : nanomsg_publisher(io_device, low_latency, protocol::PUBLISH, doorbell::direction::DOWN) {
     socket_.bind(bind_path_);
   }
 
@@ -76,7 +177,7 @@ public:
 class nanomsg_publisher_client : public nanomsg_publisher {
 public:
   nanomsg_publisher_client(const io_device &io_device, bool low_latency)
-      : nanomsg_publisher(io_device, low_latency, protocol::PUSH) {
+      : nanomsg_publisher(io_device, low_latency, protocol::PUSH, doorbell::direction::UP) {
     socket_.connect(connect_path_);
   }
 
@@ -94,31 +195,139 @@ public:
 
 class nanomsg_observer : public observer, protected nanomsg_resource {
 public:
-  nanomsg_observer(const io_device &io_device, bool low_latency, protocol p)
-      : nanomsg_resource(io_device, low_latency, p), recv_flags_(low_latency ? NN_DONTWAIT : 0) {
+  nanomsg_observer(const io_device &io_device, wait_strategy strategy, protocol p, doorbell::direction d)
+      : nanomsg_resource(io_device, strategy == wait_strategy::spin, strategy != wait_strategy::spin, p, d),
+        strategy_(strategy), spin_polls_(io_device.get_spin_polls()), default_timeout_(DEFAULT_RECV_TIMEOUT),
+        timeout_(DEFAULT_RECV_TIMEOUT), notice_(&socket_.last_message()) {
     socket_.setsockopt_int(NN_SOL_SOCKET, NN_RCVTIMEO, DEFAULT_RECV_TIMEOUT);
+    if (doorbell_) {
+      doorbell_->poll(seen_);
+      messages_seen_ = doorbell_->messages();
+    }
   }
 
   ~nanomsg_observer() override { socket_.close(); }
 
   void setup() override {
-    if (not low_latency_) {
+    if (strategy_ != wait_strategy::spin) {
       socket_.setsockopt_int(NN_SOL_SOCKET, NN_RCVTIMEO, DEFAULT_NOTICE_TIMEOUT);
+      default_timeout_ = DEFAULT_NOTICE_TIMEOUT;
+      timeout_ = DEFAULT_NOTICE_TIMEOUT;
+    }
+  }
+
+  void set_timeout(int timeout) override {
+    auto bounded = timeout < 0 ? default_timeout_ : std::min(timeout, default_timeout_);
+    if (bounded == timeout_) {
+      return;
     }
+    if (bounded > 0) {
+      socket_.setsockopt_int(NN_SOL_SOCKET, NN_RCVTIMEO, bounded);
+    }
+    timeout_ = bounded;
   }
 
-  bool wait() override { return socket_.recv(recv_flags_) > 0; }
+  bool wait() override {
+    if (take_message() or take_ring()) {
+      idle_polls_ = 0;
+      return true;
+    }
+    wait_stats_.idle_polls++;
+    switch (strategy_) {
+    case wait_strategy::spin:
+      return false;
+    case wait_strategy::yield:
+      if (++idle_polls_ > spin_polls_) {
+        wait_stats_.yields++;
+        std::this_thread::yield();
+      }
+      return false;
+    case wait_strategy::spin_block:
+      if (++idle_polls_ <= spin_polls_) {
+        return false;
+      }
+      break;
+    case wait_strategy::block:
+      break;
+    }
+    return timeout_ > 0 and sleep();
+  }
 
-  const std::string &get_notice() override { return socket_.last_message(); }
+  const std::string &get_notice() override { return *notice_; }
 
 private:
-  int recv_flags_;
+  inline static const std::string ring_notice_ = "{}";
+  const wait_strategy strategy_;
+  const uint32_t spin_polls_;
+  uint32_t idle_polls_ = 0;
+  int default_timeout_;
+  int timeout_;
+  uint32_t seen_ = 0;
+  uint32_t messages_seen_ = 0;
+  const std::string *notice_;
+
+  bool take_message() {
+    if (receive()) {
+      return true;
+    }
+    // counted after sent, so taken ones may run ahead of the count for a moment
+    if (not doorbell_ or static_cast<int32_t>(doorbell_->messages() - messages_seen_) <= 0) {
+      return false;
+    }
+    // rung for a message still in transit, the ring alone would be taken and the message left until the next one
+    auto deadline = time::now_in_nano() + MESSAGE_TRANSIT_TIMEOUT;
+    while (time::now_in_nano() < deadline) {
+      std::this_thread::yield();
+      if (receive()) {
+        return true;
+      }
+    }
+    messages_seen_ = doorbell_->messages(); // dropped by socket, or sent before this observer connected
+    return false;
+  }
+
+  bool receive() {
+    if (socket_.recv(NN_DONTWAIT) > 0) {
+      notice_ = &socket_.last_message();
+      messages_seen_++;
+      return true;
+    }
+    return false;
+  }
+
+  // messages go first, a ring not taken yet stays pending for the next wait
+  bool take_ring() {
+    if (doorbell_ and doorbell_->poll(seen_)) {
+      notice_ = &ring_notice_;
+      return true;
+    }
+    return false;
+  }
+
+  bool sleep() {
+    wait_stats_.sleeps++;
+    if (not doorbell_) {
+      if (socket_.recv(0) > 0) {
+        notice_ = &socket_.last_message();
+        wait_stats_.wakeups++;
+        return true;
+      }
+      return false;
+    }
+    auto latency = doorbell_->sleep(seen_, timeout_);
+    if (latency >= 0) {
+      wait_stats_.wakeups++;
+      wait_stats_.wakeup_latency += latency;
+      wait_stats_.max_wakeup_latency = std::max(wait_stats_.max_wakeup_latency, latency);
+    }
+    return take_message() or take_ring();
+  }
 };
 
 class nanomsg_observer_master : public nanomsg_observer {
 public:
-  nanomsg_observer_master(const io_device &io_device, bool low_latency)
-      : nanomsg_observer(io_device, low_latency, protocol::PULL) {
+  nanomsg_observer_master(const io_device &io_device, wait_strategy strategy)
+      : nanomsg_observer(io_device, strategy, protocol::PULL, doorbell::direction::UP) {
     socket_.bind(bind_path_);
   }
 
@@ -127,8 +336,8 @@ public:
 
 class nanomsg_observer_client : public nanomsg_observer {
 public:
-  nanomsg_observer_client(const io_device &io_device, bool low_latency)
-      : nanomsg_observer(io_device, low_latency, protocol::SUBSCRIBE) {
+  nanomsg_observer_client(const io_device &io_device, wait_strategy strategy)
+      : nanomsg_observer(io_device, strategy, protocol::SUBSCRIBE, doorbell::direction::DOWN) {
     socket_.connect(connect_path_);
     socket_.setsockopt_str(NN_SUB, NN_SUB_SUBSCRIBE, "");
   }
@@ -136,21 +345,104 @@ public:
   bool is_usable() override { return socket_.recv(0) > 0; }
 };
 
+wait_strategy parse_wait_strategy(const std::string &name) {
+  static const std::unordered_map<std::string, wait_strategy> strategies = {{"spin", wait_strategy::spin},
+                                                                            {"yield", wait_strategy::yield},
+                                                                            {"spin_block", wait_strategy::spin_block},
+                                                                            {"block", wait_strategy::block}};
+  auto it = strategies.find(name);
+  if (it == strategies.end()) {
+    throw yijinjing_error(fmt::format("unknown wait strategy {}", name));
+  }
+  return it->second;
+}
+
+std::string get_wait_strategy_name(wait_strategy strategy) {
+  switch (strategy) {
+  case wait_strategy::spin:
+    return "spin";
+  case wait_strategy::yield:
+    return "yield";
+  case wait_strategy::spin_block:
+    return "spin_block";
+  case wait_strategy::block:
+    return "block";
+  default:
+    return "unknown";
+  }
+}
+
+namespace {
+/// entries of the thread setting in profile which apply to home, category ones overridden by category/group/name ones
+nlohmann::json read_thread_setting(const data::location_ptr &home) {
+  auto &locator = home->locator;
+  // same file as practice::profile
+  auto etc_location = location::make_shared(mode::LIVE, category::SYSTEM, "etc", "kungfu", locator);
+  auto db_file = locator->layout_file(etc_location, layout::SQLITE, "config");
+  auto result = nlohmann::json::object();
+  try {
+    auto value = cache::read_config_value(db_file, io_device::make_thread_config_location(locator)->uid);
+    auto setting = value.has_value() ? nlohmann::json::parse(value.value()) : nlohmann::json::object();
+    auto category_name = get_category_name(home->category);
+    for (auto &key : {category_name, fmt::format("{}/{}/{}", category_name, home->group, home->name)}) {
+      if (setting.contains(key) and setting[key].is_object()) {
+        result.update(setting[key]);
+      }
+    }
+  } catch (const std::exception &e) {
+    SPDLOG_WARN("thread setting in {} not taken: {}", db_file, e.what());
+  }
+  return result;
+}
+} // namespace
+
 io_device::io_device(data::location_ptr home, const bool low_latency, const bool lazy)
-    : home_(std::move(home)), low_latency_(low_latency), lazy_(lazy) {
+    : home_(std::move(home)), low_latency_(low_latency), lazy_(lazy),
+      wait_strategy_(low_latency ? wait_strategy::spin : wait_strategy::block), spin_polls_(DEFAULT_SPIN_POLLS) {
   if (spdlog::default_logger()->name().empty()) {
     yijinjing::log::setup_log(home_, home_->name);
   }
+  auto &locator = home_->locator;
   ensure_sqlite_initilize();
 
+  // read once before the loop, env takes over profile
+  auto setting = read_thread_setting(home_);
+  auto get_setting = [&](const std::string &env, const std::string &key) -> std::string {
+    if (locator->has_env(env)) {
+      return locator->get_env(env);
+    }
+    return setting.contains(key) and setting[key].is_string() ? setting[key].get<std::string>() : "";
+  };
+  auto strategy = get_setting("KF_WAIT_STRATEGY", "wait_strategy");
+  if (not strategy.empty()) {
+    wait_strategy_ = parse_wait_strategy(strategy);
+  }
+  cpu_affinity_ = get_setting("KF_CPU_AFFINITY", "cpu_affinity");
+  sched_policy_ = get_setting("KF_SCHED_POLICY", "sched_policy");
+  if (locator->has_env("KF_WAIT_SPIN_POLLS")) {
+    spin_polls_ = std::stoul(locator->get_env("KF_WAIT_SPIN_POLLS"));
+  }
+  if (locator->has_env("KF_JOURNAL_VERIFY")) {
+    verify_checksum_ = locator->get_env("KF_JOURNAL_VERIFY") != "0";
+  }
+
   live_home_ = location::make_shared(mode::LIVE, home_->category, home_->group, home_->name, home_->locator);
   url_factory_ = std::make_shared<ipc_url_factory>();
 }
 
-reader_ptr io_device::open_reader_to_subscribe() { return std::make_shared<reader>(lazy_); }
+location_ptr io_device::make_thread_config_location(const data::locator_ptr &locator) {
+  return location::make_shared(mode::LIVE, category::SYSTEM, "practice", "thread", locator);
+}
+
+reader_ptr io_device::open_reader_to_subscribe() {
+  auto r = std::make_shared<reader>(lazy_);
+  r->set_verify_checksum(verify_checksum_);
+  return r;
+}
 
 [[maybe_unused]] reader_ptr io_device::open_reader(const data::location_ptr &location, uint32_t dest_id) {
   auto r = std::make_shared<reader>(lazy_);
+  r->set_verify_checksum(verify_checksum_);
   r->join(location, dest_id, 0);
   return r;
 }
@@ -185,7 +477,7 @@ writer_ptr io_device::open_writer_at(const data::location_ptr &location, uint32_
 io_device_master::io_device_master(data::location_ptr home, bool low_latency)
     : io_device(std::move(home), low_latency, false) {
   publisher_ = std::make_shared<nanomsg_publisher_master>(*this, is_low_latency());
-  observer_ = std::make_shared<nanomsg_observer_master>(*this, is_low_latency());
+  observer_ = std::make_shared<nanomsg_observer_master>(*this, get_wait_strategy());
 }
 
 io_device_client::io_device_client(data::location_ptr home, bool low_latency)
@@ -193,14 +485,14 @@ io_device_client::io_device_client(data::location_ptr home, bool low_latency)
 
 bool io_device_client::is_usable() {
   nanomsg_publisher_client publisher(*this, false);
-  nanomsg_observer_client observer(*this, false);
+  nanomsg_observer_client observer(*this, wait_strategy::block);
   std::this_thread::sleep_for(std::chrono::milliseconds(SETUP_TIMEOUT));
   return publisher.is_usable() and observer.is_usable();
 }
 
 void io_device_client::setup() {
   publisher_ = std::make_shared<nanomsg_publisher_client>(*this, is_low_latency());
-  observer_ = std::make_shared<nanomsg_observer_client>(*this, is_low_latency());
+  observer_ = std::make_shared<nanomsg_observer_client>(*this, get_wait_strategy());
   std::this_thread::sleep_for(std::chrono::milliseconds(SETUP_TIMEOUT));
 }
 } // namespace kungfu::yijinjing
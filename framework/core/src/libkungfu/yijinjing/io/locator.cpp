@@ -8,6 +8,7 @@
 #include <cstdlib>
 #include <kungfu/common.h>
 #include <kungfu/yijinjing/common.h>
+#include <kungfu/yijinjing/journal/page_archive.h>
 #include <regex>
 
 namespace kungfu::yijinjing::data {
@@ -113,14 +114,16 @@ std::vector<uint32_t> locator::list_page_id(const location_ptr &location, uint32
   std::vector<uint32_t> result = {};
   auto dest_id_str = fmt::format("{:08x}", dest_id);
   auto dir = fs::path(layout_dir(location, es::layout::JOURNAL));
-  for (auto &it : fs::recursive_directory_iterator(dir)) {
-    auto basename = it.path().stem();
-    if (it.is_regular_file() and it.path().extension() == ".journal" and basename.stem() == dest_id_str) {
+  for (auto &it : fs::directory_iterator(dir)) { // pages and their archives are all right in the journal directory
+    auto path = it.path().extension() == journal::page_archive::SUFFIX ? it.path().stem() : it.path();
+    auto basename = path.stem();
+    if (it.is_regular_file() and path.extension() == ".journal" and basename.stem() == dest_id_str) {
       auto index = std::atoi(basename.extension().string().c_str() + 1);
       result.push_back(index);
     }
   }
   std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end()); // archived while listing
   return result;
 }
 
@@ -152,9 +155,10 @@ std::vector<location_ptr> locator::list_locations(const std::string &category, c
 std::vector<uint32_t> locator::list_location_dest(const location_ptr &location) const {
   std::unordered_set<uint32_t> set = {};
   auto dir = fs::path(layout_dir(location, es::layout::JOURNAL));
-  for (auto &it : fs::recursive_directory_iterator(dir)) {
-    auto basename = it.path().stem();
-    if (it.is_regular_file() and it.path().extension() == ".journal") {
+  for (auto &it : fs::directory_iterator(dir)) { // pages and their archives are all right in the journal directory
+    auto path = it.path().extension() == journal::page_archive::SUFFIX ? it.path().stem() : it.path();
+    auto basename = path.stem();
+    if (it.is_regular_file() and path.extension() == ".journal") {
       set.emplace(std::stoul(basename.stem(), nullptr, 16));
     }
   }
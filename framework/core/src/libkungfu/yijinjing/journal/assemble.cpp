@@ -250,6 +250,32 @@ std::vector<std::pair<longfist::types::frame_header, std::vector<uint8_t>>> asse
   return v;
 }
 
+size_t assemble::copy_frames(int32_t msg_type, int64_t from_time, int64_t end_time, uint32_t record_length,
+                             const std::function<void *(size_t)> &alloc) {
+  constexpr uint32_t header_length = sizeof(frame_header);
+  auto selected = [&]() {
+    return current_frame()->msg_type() == msg_type and current_frame()->data_length() + header_length == record_length;
+  };
+  size_t count = 0;
+  seek_to_time(from_time - 1);
+  while (data_available() and current_frame()->gen_time() < end_time) {
+    count += selected();
+    next();
+  }
+  auto records = static_cast<char *>(alloc(count));
+  size_t copied = 0;
+  seek_to_time(from_time - 1);
+  while (copied < count and data_available() and current_frame()->gen_time() < end_time) {
+    if (selected()) {
+      auto record = records + copied++ * record_length;
+      memcpy(record, reinterpret_cast<void *>(current_frame()->address()), header_length); // without checksum
+      memcpy(record + header_length, current_frame()->data_address(), record_length - header_length);
+    }
+    next();
+  }
+  return copied;
+}
+
 void assemble::disjoin(uint32_t location_uid) {
   for (auto &reader : readers_) {
     reader->disjoin(location_uid);
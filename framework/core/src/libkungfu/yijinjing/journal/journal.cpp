@@ -19,14 +19,17 @@ void journal::next() {
   if (frame_->msg_type() == longfist::types::PageEnd::tag) {
     load_next_page();
   } else {
+    page_frame_nb_ += frame_->uid_count();
     frame_->move_to_next();
-    page_frame_nb_++;
+    page_->ensure_frame(frame_->address());
   }
 }
 
 void journal::seek_to_time(int64_t nanotime) {
-  int page_id = page::find_page_id(location_, dest_id_, nanotime);
-  load_page(page_id);
+  auto checkpoint = page_index::find(location_, dest_id_, nanotime);
+  if (not checkpoint.has_value() or not load_checkpoint(checkpoint.value())) {
+    load_page(page::find_page_id(location_, dest_id_, nanotime));
+  }
   while (page_->is_full() && page_->end_time() <= nanotime) {
     load_next_page();
   }
@@ -37,11 +40,39 @@ void journal::seek_to_time(int64_t nanotime) {
 
 void journal::load_page(int page_id) {
   if (page_.get() == nullptr or page_->get_page_id() != page_id) {
-    page_ = page::load(location_, dest_id_, page_id, is_writing_, lazy_);
+    page_ = page::load(location_, dest_id_, page_id, is_writing_, lazy_, false, checksum_);
   }
+  page_->ensure_frame(page_->first_frame_address());
+  frame_->set_address(page_->first_frame_address());
+  page_frame_nb_ = 0u;
+}
+
+void journal::load_page(const page_ptr &page) {
+  page_ = page;
   frame_->set_address(page_->first_frame_address());
   page_frame_nb_ = 0u;
 }
 
+bool journal::load_checkpoint(const page_checkpoint &checkpoint) {
+  if (not page::exists(location_, dest_id_, checkpoint.page_id)) {
+    return false;
+  }
+  load_page(checkpoint.page_id);
+  auto address = page_->address() + checkpoint.frame_position;
+  if (address < page_->first_frame_address() or address >= page_->address_border()) {
+    return false;
+  }
+  page_->ensure_frame(address);
+  auto header = reinterpret_cast<longfist::types::frame_header *>(address);
+  if (header->length == 0 or header->msg_type <= 0 or header->gen_time != checkpoint.gen_time) {
+    return false;
+  }
+  frame_->set_address(address);
+  page_frame_nb_ = checkpoint.page_frame_nb;
+  return true;
+}
+
+bool journal::verify_frame() const { return not frame_->has_data() or frame_->verify_checksum(); }
+
 void journal::load_next_page() { load_page(page_->get_page_id() + 1); }
 } // namespace kungfu::yijinjing::journal
\ No newline at end of file
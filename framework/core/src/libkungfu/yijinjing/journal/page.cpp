@@ -1,7 +1,12 @@
 // SPDX-License-Identifier: Apache-2.0
 
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+
 #include <kungfu/common.h>
 #include <kungfu/yijinjing/journal/page.h>
+#include <kungfu/yijinjing/journal/page_index.h>
 #include <kungfu/yijinjing/util/os.h>
 
 namespace kungfu::yijinjing::journal {
@@ -15,7 +20,9 @@ page::page(data::location_ptr location, uint32_t dest_id, const uint32_t page_id
 }
 
 page::~page() {
-  if (not os::release_mmap_buffer(address(), size_, lazy_)) {
+  auto released = archive_ != nullptr ? os::release_anonymous_buffer(address(), size_)
+                                      : os::release_mmap_buffer(address(), size_, lazy_);
+  if (not released) {
     SPDLOG_ERROR("can not release page {}/{:08x}.{}.journal", location_->uname, dest_id_, page_id_);
   }
 }
@@ -24,11 +31,88 @@ void page::set_last_frame_position(uint64_t position) {
   const_cast<page_header *>(header_)->last_frame_position = position;
 }
 
+void page::update_last_frame_position(uint64_t position) {
+  // header is packed, but the field sits at an 8 bytes aligned offset of the page-aligned mapping
+  auto field = reinterpret_cast<uint64_t *>(address() + offsetof(page_header, last_frame_position));
+  std::atomic_ref<uint64_t> last_frame_position(*field);
+  auto current = last_frame_position.load(std::memory_order_relaxed);
+  while (current < position and
+         not last_frame_position.compare_exchange_weak(current, position, std::memory_order_release)) {
+  }
+}
+
+static void check_header(const data::location_ptr &location, const std::string &path, const page_header *header,
+                         uint32_t page_size, uint32_t dest_id, uint32_t page_id) {
+  if (header->version != __JOURNAL_VERSION__) {
+    uint32_t v = header->version;
+    throw journal_error(fmt::format("{} version mismatch, required {}, found {}", path, __JOURNAL_VERSION__, v));
+  }
+  if (header->page_header_length != sizeof(page_header)) {
+    uint32_t l = header->page_header_length;
+    throw journal_error(fmt::format("{} header length mismatch, required {}, found {}", path, sizeof(page_header), l));
+  }
+  if (header->frame_header_length != sizeof(frame_header) and
+      header->frame_header_length != sizeof(frame_header) + FRAME_CHECKSUM_LENGTH) {
+    uint32_t l = header->frame_header_length;
+    throw journal_error(fmt::format("{} unknown frame header length {}", path, l));
+  }
+  if (header->page_size != page_size) {
+    uint32_t s = header->page_size;
+    throw journal_error(
+        fmt::format("page size mismatch, required {}, found {}, location {}, path {}, dest_id {}, page_id {}",
+                    page_size, s, location->uname, path, dest_id, page_id));
+  }
+}
+
+/**
+ * @return page size recorded in the header of an existing page or archive, 0 if there is none yet
+ */
+template <typename Header> static uint32_t read_page_size(const std::string &path) {
+  Header header = {};
+  std::ifstream file(path, std::ios::binary);
+  if (not file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+    return 0;
+  }
+  return header.page_size;
+}
+
 page_ptr page::load(const data::location_ptr &location, uint32_t dest_id, uint32_t page_id, bool is_writing,
-                    bool lazy) {
-  uint32_t page_size = find_page_size(location, dest_id);
+                    bool lazy, bool populate, bool checksum) {
+  auto policy = page_policy::find(location, dest_id);
   std::string path = get_page_path(location, dest_id, page_id);
-  uintptr_t address = os::load_mmap_buffer(path, page_size, is_writing, lazy);
+  std::string archive_path = page_archive::get_archive_path(location, dest_id, page_id);
+
+  if (not std::filesystem::exists(path) and std::filesystem::exists(archive_path)) {
+    if (is_writing) {
+      throw journal_error("unable to write archived page " + archive_path);
+    }
+    uint32_t page_size = read_page_size<archived_page_header>(archive_path);
+    if (page_size < sizeof(page_header)) {
+      throw journal_error("unable to read archived page " + archive_path);
+    }
+    uintptr_t address = os::load_anonymous_buffer(page_size);
+    std::unique_ptr<page_archive> archive;
+    try {
+      archive = std::make_unique<page_archive>(archive_path, address);
+    } catch (const journal_error &e) {
+      os::release_anonymous_buffer(address, page_size);
+      throw;
+    }
+    auto result = std::shared_ptr<page>(new page(location, dest_id, page_id, page_size, lazy, address));
+    result->archive_ = std::move(archive);
+    result->archive_->inflate(0);
+    check_header(location, archive_path, result->header_, page_size, dest_id, page_id);
+    return result;
+  }
+
+  uint32_t page_size = read_page_size<page_header>(path);
+  page_size = page_size > 0 ? page_size : policy.page_size;
+  auto options = policy.mmap;
+  options.lock &= is_writing or not lazy;
+  if (not lazy and options.advice == os::mmap_advice::none) {
+    options.advice = os::mmap_advice::random; // the way master always mapped pages
+  }
+  uintptr_t address = os::load_mmap_buffer(path, page_size, is_writing, lazy, populate, options);
 
   // SPDLOG_TRACE("load page {}/{:08x}.{}.journal", location->uname, dest_id, page_id);
   // SPDLOG_TRACE("page_size {}, address {}", page_size, address);
@@ -42,24 +126,10 @@ page_ptr page::load(const data::location_ptr &location, uint32_t dest_id, uint32
     header->version = __JOURNAL_VERSION__;
     header->page_header_length = sizeof(page_header);
     header->page_size = page_size;
-    header->frame_header_length = sizeof(frame_header);
+    header->frame_header_length = sizeof(frame_header) + (checksum ? FRAME_CHECKSUM_LENGTH : 0);
     header->last_frame_position = header->page_header_length;
   }
-
-  if (header->version != __JOURNAL_VERSION__) {
-    uint32_t v = header->version;
-    throw journal_error(fmt::format("{} version mismatch, required {}, found {}", path, __JOURNAL_VERSION__, v));
-  }
-  if (header->page_header_length != sizeof(page_header)) {
-    uint32_t l = header->page_header_length;
-    throw journal_error(fmt::format("{} header length mismatch, required {}, found {}", path, sizeof(page_header), l));
-  }
-  if (header->page_size != page_size) {
-    uint32_t s = header->page_size;
-    throw journal_error(
-        fmt::format("page size mismatch, required {}, found {}, location {}, path {}, dest_id {}, page_id {}",
-                    page_size, s, location->uname, path, dest_id, page_id));
-  }
+  check_header(location, path, header, page_size, dest_id, page_id);
 
   return std::shared_ptr<page>(new page(location, dest_id, page_id, page_size, lazy, address));
 }
@@ -69,7 +139,17 @@ std::string page::get_page_path(const data::location_ptr &location, uint32_t des
   return location->locator->layout_file(location, longfist::enums::layout::JOURNAL, page_name);
 }
 
+bool page::exists(const data::location_ptr &location, uint32_t dest_id, uint32_t page_id) {
+  return std::filesystem::exists(get_page_path(location, dest_id, page_id)) or
+         std::filesystem::exists(page_archive::get_archive_path(location, dest_id, page_id));
+}
+
 uint32_t page::find_page_id(const data::location_ptr &location, uint32_t dest_id, int64_t time) {
+  auto indexed = page_index::find_page_id(location, dest_id, time);
+  if (indexed.has_value()) {
+    return indexed.value();
+  }
+  // time is before the index or the journal is not indexed, list and scan pages back from the last one
   std::vector<uint32_t> page_ids = location->locator->list_page_id(location, dest_id);
   if (page_ids.empty()) {
     return 1;
@@ -78,7 +158,9 @@ uint32_t page::find_page_id(const data::location_ptr &location, uint32_t dest_id
     return page_ids.front();
   }
   for (int i = static_cast<int>(page_ids.size()) - 1; i >= 0; i--) {
-    if (page::load(location, dest_id, page_ids[i], false, true)->begin_time() < time) {
+    // skip pages allocated ahead by writer, they have no frame yet
+    auto page = page::load(location, dest_id, page_ids[i], false, true);
+    if (page->has_data() and page->begin_time() < time) {
       return page_ids[i];
     }
   }
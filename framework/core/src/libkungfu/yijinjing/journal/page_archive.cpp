@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <lz4.h>
+
+#include <kungfu/common.h>
+#include <kungfu/yijinjing/journal/page.h>
+#include <kungfu/yijinjing/journal/page_archive.h>
+#include <kungfu/yijinjing/time.h>
+#include <kungfu/yijinjing/util/os.h>
+
+namespace kungfu::yijinjing::journal {
+using namespace longfist::types;
+namespace fs = std::filesystem;
+
+archive_stats &archive_stats::operator+=(const archive_stats &other) {
+  pages += other.pages;
+  page_bytes += other.page_bytes;
+  content_bytes += other.content_bytes;
+  archived_bytes += other.archived_bytes;
+  deflate_nanos += other.deflate_nanos;
+  inflate_nanos += other.inflate_nanos;
+  return *this;
+}
+
+page_archive::page_archive(const std::string &path, uintptr_t content_address)
+    : content_address_(content_address), file_size_(fs::file_size(path)), file_address_(0), header_(nullptr),
+      blocks_(nullptr) {
+  if (file_size_ < sizeof(archived_page_header)) {
+    throw journal_error("archived page too short " + path);
+  }
+  file_address_ = os::load_mmap_buffer(path, file_size_, false, true);
+  header_ = reinterpret_cast<const archived_page_header *>(file_address_);
+  blocks_ = reinterpret_cast<const archived_block *>(file_address_ + sizeof(archived_page_header));
+  auto index_end = sizeof(archived_page_header) + uint64_t(header_->block_count) * sizeof(archived_block);
+  if (header_->magic != MAGIC or index_end > file_size_ or header_->content_length > header_->page_size) {
+    os::release_mmap_buffer(file_address_, file_size_, true);
+    throw journal_error("invalid archived page " + path);
+  }
+  inflated_.resize(header_->block_count, false);
+}
+
+page_archive::~page_archive() {
+  if (not os::release_mmap_buffer(file_address_, file_size_, true)) {
+    SPDLOG_ERROR("can not release archived page at {}", file_address_);
+  }
+}
+
+void page_archive::inflate(uint64_t position) {
+  if (position >= header_->content_length) {
+    return; // zero fill after the last frame
+  }
+  auto end = blocks_ + header_->block_count;
+  auto it = std::upper_bound(blocks_, end, position,
+                             [](uint64_t p, const archived_block &block) { return p < block.content_offset; });
+  auto index = static_cast<uint32_t>(it - blocks_) - 1;
+  if (not inflated_[index]) {
+    inflate_block(index);
+  }
+}
+
+void page_archive::inflate_all() {
+  for (uint32_t index = 0; index < header_->block_count; index++) {
+    if (not inflated_[index]) {
+      inflate_block(index);
+    }
+  }
+}
+
+void page_archive::inflate_block(uint32_t index) {
+  const auto &block = blocks_[index];
+  if (block.offset + block.compressed_length > file_size_ or
+      uint64_t(block.content_offset) + block.content_length > header_->page_size) {
+    throw journal_error(fmt::format("archived block {} out of range", index));
+  }
+  auto source = reinterpret_cast<const char *>(file_address_ + block.offset);
+  auto target = reinterpret_cast<char *>(content_address_ + block.content_offset);
+  auto length = LZ4_decompress_safe(source, target, block.compressed_length, block.content_length);
+  if (length != int(block.content_length)) {
+    throw journal_error(fmt::format("corrupted archived block {}, inflated {} of {}", index, length,
+                                    block.content_length));
+  }
+  inflated_[index] = true;
+}
+
+std::string page_archive::deflate(uintptr_t address, uint64_t content_length, uint32_t page_size,
+                                  uint32_t block_size) {
+  auto page_header_length = reinterpret_cast<const page_header *>(address)->page_header_length;
+  std::vector<archived_block> blocks = {};
+  uint64_t block_begin = 0;
+  uint64_t position = page_header_length;
+  while (position < content_length) {
+    auto frame_length = reinterpret_cast<const frame_header *>(address + position)->length;
+    if (frame_length == 0) {
+      throw journal_error(fmt::format("empty frame at {} before the last one", position));
+    }
+    position += frame_length;
+    if (position - block_begin >= block_size or position >= content_length) {
+      auto block_end = std::min(position, content_length);
+      blocks.push_back({0, 0, static_cast<uint32_t>(block_begin), static_cast<uint32_t>(block_end - block_begin), 0});
+      block_begin = block_end;
+    }
+  }
+
+  archived_page_header header = {MAGIC, __JOURNAL_VERSION__, page_size, static_cast<uint32_t>(blocks.size()),
+                                 content_length};
+  auto index_length = sizeof(archived_page_header) + blocks.size() * sizeof(archived_block);
+  std::string archived(index_length, '\0');
+  for (auto &block : blocks) {
+    auto bound = LZ4_compressBound(static_cast<int>(block.content_length));
+    block.offset = archived.size();
+    archived.resize(block.offset + bound);
+    auto source = reinterpret_cast<const char *>(address + block.content_offset);
+    auto length = LZ4_compress_default(source, archived.data() + block.offset, block.content_length, bound);
+    if (length <= 0) {
+      throw journal_error(fmt::format("unable to deflate page block at {}", block.content_offset));
+    }
+    block.compressed_length = length;
+    archived.resize(block.offset + length);
+  }
+  memcpy(archived.data(), &header, sizeof(archived_page_header));
+  memcpy(archived.data() + sizeof(archived_page_header), blocks.data(), blocks.size() * sizeof(archived_block));
+  return archived;
+}
+
+archive_stats page_archive::archive(const data::location_ptr &location, uint32_t dest_id, uint32_t page_id,
+                                    uint32_t block_size) {
+  archive_stats stats = {};
+  auto path = page::get_page_path(location, dest_id, page_id);
+  if (not fs::exists(path)) {
+    return stats;
+  }
+  auto archive_path = get_archive_path(location, dest_id, page_id);
+  auto temp_path = archive_path + ".tmp";
+  {
+    auto source = page::load(location, dest_id, page_id, false, true);
+    auto last_frame = reinterpret_cast<const frame_header *>(source->last_frame_address());
+    if (not source->has_data() or last_frame->msg_type != PageEnd::tag) {
+      return stats; // still being written
+    }
+    auto content_length = source->last_frame_address() - source->address() + last_frame->length;
+
+    auto deflate_begin = time::now_in_nano();
+    auto archived = deflate(source->address(), content_length, source->get_page_size(), block_size);
+    stats.deflate_nanos = time::now_in_nano() - deflate_begin;
+    {
+      std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+      file.write(archived.data(), static_cast<std::streamsize>(archived.size()));
+      if (not file) {
+        throw journal_error("unable to write archived page " + temp_path);
+      }
+    }
+
+    auto buffer = os::load_anonymous_buffer(source->get_page_size());
+    auto inflate_begin = time::now_in_nano();
+    bool matched = false;
+    try {
+      page_archive readback(temp_path, buffer);
+      readback.inflate_all();
+      stats.inflate_nanos = time::now_in_nano() - inflate_begin;
+      matched = memcmp(reinterpret_cast<void *>(buffer), reinterpret_cast<void *>(source->address()),
+                       content_length) == 0;
+    } catch (const journal_error &e) {
+      SPDLOG_ERROR("unable to read back archived page {}: {}", temp_path, e.what());
+    }
+    os::release_anonymous_buffer(buffer, source->get_page_size());
+    if (not matched) {
+      fs::remove(temp_path);
+      throw journal_error("archived page does not match " + path);
+    }
+
+    stats.pages = 1;
+    stats.page_bytes = source->get_page_size();
+    stats.content_bytes = content_length;
+    stats.archived_bytes = archived.size();
+  }
+  fs::rename(temp_path, archive_path);
+  fs::remove(path);
+  SPDLOG_INFO("archived {} at ratio {:.1f}", path, stats.ratio());
+  return stats;
+}
+
+archive_stats page_archive::archive_before(const data::location_ptr &location, uint32_t dest_id, int64_t time,
+                                           uint32_t block_size) {
+  archive_stats stats = {};
+  auto page_ids = location->locator->list_page_id(location, dest_id);
+  for (size_t i = 0; i + 1 < page_ids.size(); i++) {
+    auto page_id = page_ids[i];
+    if (not fs::exists(page::get_page_path(location, dest_id, page_id))) {
+      continue;
+    }
+    if (page::load(location, dest_id, page_id, false, true)->end_time() >= time) {
+      break;
+    }
+    stats += archive(location, dest_id, page_id, block_size);
+  }
+  return stats;
+}
+
+std::string page_archive::get_archive_path(const data::location_ptr &location, uint32_t dest_id, uint32_t page_id) {
+  return page::get_page_path(location, dest_id, page_id) + SUFFIX;
+}
+} // namespace kungfu::yijinjing::journal
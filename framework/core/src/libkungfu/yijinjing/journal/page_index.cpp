@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <filesystem>
+
+#include <kungfu/common.h>
+#include <kungfu/yijinjing/journal/page_index.h>
+
+namespace kungfu::yijinjing::journal {
+using namespace longfist::types;
+namespace fs = std::filesystem;
+
+namespace {
+bool frame_has_data(const frame_header *header) { return header->length > 0 && header->msg_type > 0; }
+
+bool match_checkpoint(const data::location_ptr &location, uint32_t dest_id, const page_checkpoint &checkpoint) {
+  if (not page::exists(location, dest_id, checkpoint.page_id)) {
+    return false;
+  }
+  auto page = page::load(location, dest_id, checkpoint.page_id, false, true);
+  if (checkpoint.frame_position < page->first_frame_address() - page->address() or
+      page->address() + checkpoint.frame_position >= page->address_border()) {
+    return false;
+  }
+  page->ensure_frame(page->address() + checkpoint.frame_position);
+  auto header = reinterpret_cast<frame_header *>(page->address() + checkpoint.frame_position);
+  return frame_has_data(header) and header->gen_time == checkpoint.gen_time;
+}
+} // namespace
+
+page_index::page_index(data::location_ptr location, uint32_t dest_id)
+    : location_(std::move(location)), dest_id_(dest_id), file_(nullptr), last_page_id_(0), next_position_(0) {}
+
+page_index::~page_index() {
+  if (file_ != nullptr) {
+    std::fclose(file_);
+  }
+}
+
+void page_index::on_frame(const page_ptr &page, uintptr_t frame_address, uint64_t page_frame_nb, int64_t gen_time) {
+  auto page_id = page->get_page_id();
+  uint64_t position = frame_address - page->address();
+  if (page_id == last_page_id_.load(std::memory_order_relaxed) and
+      position < next_position_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (page_id < last_page_id_) {
+    return; // late commit to a page already rolled over
+  }
+  if (page_id > last_page_id_) {
+    last_page_id_ = page_id;
+    next_position_ = 0;
+  }
+  if (position < next_position_) {
+    return;
+  }
+  next_position_ = (position / CHECKPOINT_INTERVAL + 1) * CHECKPOINT_INTERVAL;
+  append({page_id, static_cast<uint32_t>(position), static_cast<uint32_t>(page_frame_nb), 0, gen_time});
+}
+
+void page_index::validate() {
+  auto path = get_index_path(location_, dest_id_);
+  if (file_ != nullptr) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+  std::error_code error = {};
+  auto size = fs::exists(path) ? fs::file_size(path, error) : 0;
+  size_t count = error ? 0 : size / sizeof(page_checkpoint);
+  // pages are only listed when the index does not tell, listing walks the whole journal directory
+  std::optional<std::vector<uint32_t>> page_ids = {};
+  auto list_page_id = [&]() -> const std::vector<uint32_t> & {
+    if (not page_ids.has_value()) {
+      page_ids = location_->locator->list_page_id(location_, dest_id_);
+    }
+    return page_ids.value();
+  };
+  // checkpoints are appended in page order, those left behind by a crash or by pages rewritten since are at the tail,
+  // binary search the last one matching the pages, checkpoints of pages removed at the front are kept as they are,
+  // journal::seek_to_time falls back to scan pages for them
+  auto keep = [&](const page_checkpoint &checkpoint) {
+    if (page::exists(location_, dest_id_, checkpoint.page_id)) {
+      return match_checkpoint(location_, dest_id_, checkpoint);
+    }
+    return not list_page_id().empty() and checkpoint.page_id < list_page_id().front();
+  };
+  size_t valid = 0;
+  std::optional<page_checkpoint> last = {};
+  FILE *file = count == 0 ? nullptr : std::fopen(path.c_str(), "rb");
+  if (file != nullptr) {
+    size_t high = count;
+    page_checkpoint checkpoint = {};
+    while (valid < high) {
+      size_t middle = valid + (high - valid) / 2;
+      if (read_checkpoint(file, middle, checkpoint) and keep(checkpoint)) {
+        valid = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    if (valid > 0 and read_checkpoint(file, valid - 1, checkpoint)) {
+      last = checkpoint;
+    }
+    std::fclose(file);
+  }
+  if (valid * sizeof(page_checkpoint) != size) {
+    fs::resize_file(path, valid * sizeof(page_checkpoint), error);
+    SPDLOG_INFO("truncated page index for {}/{:08x} to {} of {} checkpoints", location_->uname, dest_id_, valid,
+                count);
+  }
+
+  file_ = std::fopen(path.c_str(), "ab");
+  if (file_ == nullptr) {
+    throw journal_error("unable to open page index " + path);
+  }
+  // index only pages after the last valid checkpoint, or the last page if there is none,
+  // times before the first checkpoint are found by scanning pages
+  size_t appended = 0;
+  if (last.has_value() and page::exists(location_, dest_id_, last->page_id)) {
+    auto page = page::load(location_, dest_id_, last->page_id, false, true);
+    appended += index_page(file_, page, last->frame_position, last->page_frame_nb);
+    // pages behind are numbered on, stop at the first one missing
+    for (auto page_id = last->page_id + 1; page::exists(location_, dest_id_, page_id); page_id++) {
+      appended += index_page(file_, page::load(location_, dest_id_, page_id, false, true), 0, 0);
+    }
+  } else {
+    for (auto page_id : list_page_id()) {
+      if (last.has_value() ? page_id > last->page_id : page_id == list_page_id().back()) {
+        appended += index_page(file_, page::load(location_, dest_id_, page_id, false, true), 0, 0);
+      }
+    }
+  }
+  std::fflush(file_);
+  if (appended > 0) {
+    SPDLOG_INFO("indexed {} checkpoints of {}/{:08x} behind {} valid ones", appended, location_->uname, dest_id_,
+                valid);
+    last = read_last(path);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  last_page_id_ = 0;
+  next_position_ = 0;
+  if (last.has_value()) {
+    last_page_id_ = last->page_id;
+    next_position_ = (last->frame_position / CHECKPOINT_INTERVAL + 1) * CHECKPOINT_INTERVAL;
+  }
+}
+
+std::optional<page_checkpoint> page_index::find(const data::location_ptr &location, uint32_t dest_id, int64_t time) {
+  auto path = get_index_path(location, dest_id);
+  FILE *file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return std::nullopt;
+  }
+  std::optional<page_checkpoint> result = {};
+  page_checkpoint checkpoint = {};
+  size_t low = time == 0 ? 0 : count_before(file, count_checkpoints(path), time);
+  // one more checkpoint back, frames of concurrent producers right before the one found may be later than time,
+  // none found means time is before the index, which may start at any page
+  if (low > 1 and read_checkpoint(file, low - 2, checkpoint)) {
+    result = checkpoint;
+  }
+  std::fclose(file);
+  return result;
+}
+
+std::optional<uint32_t> page_index::find_page_id(const data::location_ptr &location, uint32_t dest_id, int64_t time) {
+  auto path = get_index_path(location, dest_id);
+  FILE *file = time == 0 ? nullptr : std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return std::nullopt;
+  }
+  std::optional<uint32_t> result = {};
+  page_checkpoint checkpoint = {};
+  size_t low = count_before(file, count_checkpoints(path), time);
+  // every page starts with a checkpoint, the page of the one found, or of the one before it as find does, holds the
+  // frames right before time
+  if (low > 0 and read_checkpoint(file, low > 1 ? low - 2 : 0, checkpoint) and
+      page::exists(location, dest_id, checkpoint.page_id)) {
+    result = checkpoint.page_id;
+  }
+  std::fclose(file);
+  return result;
+}
+
+size_t page_index::rebuild(const data::location_ptr &location, uint32_t dest_id) {
+  auto path = get_index_path(location, dest_id);
+  FILE *file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    throw journal_error("unable to open page index " + path);
+  }
+  size_t count = 0;
+  for (auto page_id : location->locator->list_page_id(location, dest_id)) {
+    count += index_page(file, page::load(location, dest_id, page_id, false, true), 0, 0);
+  }
+  std::fclose(file);
+  return count;
+}
+
+size_t page_index::index_page(FILE *file, const page_ptr &page, uint32_t frame_position, uint32_t page_frame_nb) {
+  size_t count = 0;
+  // frame at frame_position is already in the index unless the page is indexed from its start
+  uint64_t next_position = frame_position == 0 ? 0 : (frame_position / CHECKPOINT_INTERVAL + 1) * CHECKPOINT_INTERVAL;
+  auto address = frame_position == 0 ? page->first_frame_address() : page->address() + frame_position;
+  while (address < page->address_border()) {
+    page->ensure_frame(address);
+    auto header = reinterpret_cast<frame_header *>(address);
+    if (not frame_has_data(header)) {
+      break;
+    }
+    uint64_t position = address - page->address();
+    if (position >= next_position) {
+      page_checkpoint checkpoint = {page->get_page_id(), static_cast<uint32_t>(position), page_frame_nb, 0,
+                                    header->gen_time};
+      std::fwrite(&checkpoint, sizeof(page_checkpoint), 1, file);
+      next_position = (position / CHECKPOINT_INTERVAL + 1) * CHECKPOINT_INTERVAL;
+      count++;
+    }
+    address += header->length;
+    page_frame_nb += get_uid_count(*header);
+  }
+  return count;
+}
+
+std::string page_index::get_index_path(const data::location_ptr &location, uint32_t dest_id) {
+  auto dir = location->locator->layout_dir(location, longfist::enums::layout::JOURNAL);
+  return (fs::path(dir) / fmt::format("{:08x}.index", dest_id)).string();
+}
+
+void page_index::append(const page_checkpoint &checkpoint) {
+  if (file_ == nullptr) {
+    return;
+  }
+  // one checkpoint per interval at most, flushed right away so that readers and a restart after a crash see it
+  std::fwrite(&checkpoint, sizeof(page_checkpoint), 1, file_);
+  std::fflush(file_);
+}
+
+size_t page_index::count_checkpoints(const std::string &path) {
+  std::error_code error = {};
+  auto size = fs::file_size(path, error);
+  return error ? 0 : size / sizeof(page_checkpoint); // ignore partially written tail
+}
+
+size_t page_index::count_before(FILE *file, size_t count, int64_t time) {
+  // binary search in place, the index can be large for busy journals
+  page_checkpoint checkpoint = {};
+  size_t low = 0;
+  size_t high = count;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (not read_checkpoint(file, middle, checkpoint)) {
+      return 0;
+    } else if (checkpoint.gen_time < time) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool page_index::read_checkpoint(FILE *file, size_t index, page_checkpoint &checkpoint) {
+  return std::fseek(file, static_cast<long>(index * sizeof(page_checkpoint)), SEEK_SET) == 0 and
+         std::fread(&checkpoint, sizeof(page_checkpoint), 1, file) == 1;
+}
+
+std::optional<page_checkpoint> page_index::read_last(const std::string &path) {
+  std::error_code error = {};
+  auto size = fs::file_size(path, error);
+  if (error or size == 0 or size % sizeof(page_checkpoint) != 0) {
+    return std::nullopt;
+  }
+  FILE *file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return std::nullopt;
+  }
+  page_checkpoint checkpoint = {};
+  auto found = read_checkpoint(file, size / sizeof(page_checkpoint) - 1, checkpoint);
+  std::fclose(file);
+  return found ? std::optional(checkpoint) : std::nullopt;
+}
+} // namespace kungfu::yijinjing::journal
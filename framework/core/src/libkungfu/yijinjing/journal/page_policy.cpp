@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <mutex>
+
+#include <kungfu/common.h>
+#include <kungfu/yijinjing/cache/config.h>
+#include <kungfu/yijinjing/journal/page_policy.h>
+
+using namespace kungfu::longfist;
+using namespace kungfu::longfist::enums;
+using namespace kungfu::longfist::types;
+
+namespace kungfu::yijinjing::journal {
+namespace {
+const std::vector<std::pair<std::string, os::mmap_hugepage>> HUGEPAGE_NAMES = {
+    {"none", os::mmap_hugepage::none},
+    {"transparent", os::mmap_hugepage::transparent},
+    {"hugetlb", os::mmap_hugepage::hugetlb},
+};
+
+const std::vector<std::pair<std::string, os::mmap_advice>> ADVICE_NAMES = {
+    {"none", os::mmap_advice::none},     {"normal", os::mmap_advice::normal},
+    {"random", os::mmap_advice::random}, {"sequential", os::mmap_advice::sequential},
+    {"willneed", os::mmap_advice::willneed},
+};
+
+std::mutex settings_mutex;
+std::unordered_map<std::string, nlohmann::json> settings = {}; // by env value or profile db file
+
+uint32_t parse_size(const nlohmann::json &value) {
+  if (value.is_number_unsigned()) {
+    auto number = value.get<uint64_t>();
+    if (number > UINT32_MAX) {
+      throw journal_error(fmt::format("invalid page size {}, larger than {}", number, UINT32_MAX));
+    }
+    return static_cast<uint32_t>(number);
+  }
+  if (not value.is_string()) {
+    throw journal_error(fmt::format("invalid page size {}", value.dump()));
+  }
+  auto text = value.get<std::string>();
+  size_t end = 0;
+  uint64_t number = 0;
+  try {
+    number = std::stoull(text, &end);
+  } catch (const std::exception &) {
+    throw journal_error(fmt::format("invalid page size {}", text));
+  }
+  auto unit = text.substr(end);
+  uint64_t scale = unit.empty() or unit == "B" ? 1 : unit == "KB" ? KB : unit == "MB" ? MB : unit == "GB" ? MB * KB : 0;
+  if (scale == 0 or number * scale > UINT32_MAX) {
+    throw journal_error(fmt::format("invalid page size {}", text));
+  }
+  return static_cast<uint32_t>(number * scale);
+}
+
+template <typename Value> std::string get_name(Value value, const std::vector<std::pair<std::string, Value>> &names) {
+  auto it = std::find_if(names.begin(), names.end(), [&](auto &pair) { return pair.second == value; });
+  return it->first;
+}
+
+template <typename Value>
+Value parse_name(const nlohmann::json &value, const std::vector<std::pair<std::string, Value>> &names) {
+  auto text = value.get<std::string>();
+  auto it = std::find_if(names.begin(), names.end(), [&](auto &pair) { return pair.first == text; });
+  if (it == names.end()) {
+    throw journal_error(fmt::format("invalid page policy value {}", text));
+  }
+  return it->second;
+}
+
+page_policy parse_setting(const nlohmann::json &setting, page_policy policy) {
+  auto sized = setting.contains("page_size");
+  if (sized) {
+    policy.page_size = parse_size(setting["page_size"]);
+  }
+  if (setting.contains("hugepage")) {
+    policy.mmap.hugepage = parse_name(setting["hugepage"], HUGEPAGE_NAMES);
+  }
+  if (setting.contains("lock")) {
+    policy.mmap.lock = setting["lock"].get<bool>();
+  }
+  if (setting.contains("advice")) {
+    policy.mmap.advice = parse_name(setting["advice"], ADVICE_NAMES);
+  }
+  auto granularity = policy.mmap.hugepage == os::mmap_hugepage::hugetlb ? page_policy::HUGE_PAGE_SIZE : 4 * KB;
+  if (not sized) {
+    // sizes taken over from defaults or the category are not chosen along with hugepage, round them up
+    policy.page_size = (policy.page_size + granularity - 1) / granularity * granularity;
+  }
+  if (policy.page_size < page_policy::MIN_PAGE_SIZE or policy.page_size > page_policy::MAX_PAGE_SIZE or
+      policy.page_size % granularity != 0) {
+    throw journal_error(fmt::format("page size {} not in [{}, {}] or not a multiple of {}", policy.page_size,
+                                    page_policy::MIN_PAGE_SIZE, page_policy::MAX_PAGE_SIZE, granularity));
+  }
+  if ((policy.page_size & (policy.page_size - 1)) != 0) {
+    throw journal_error(fmt::format("page size {} is not a power of two", policy.page_size));
+  }
+  return policy;
+}
+
+uint32_t get_default_page_size(category c, uint32_t dest_id) {
+  if (c == category::MD && dest_id != 1) {
+    return 128 * MB;
+  }
+  if ((c == category::TD || c == category::STRATEGY) && dest_id != 0) {
+    return 16 * MB;
+  }
+  return MB;
+}
+
+page_policy resolve(const nlohmann::json &setting, const std::string &category_name, const std::string &location_name,
+                    uint32_t page_size) {
+  page_policy policy = {};
+  policy.page_size = page_size;
+  for (auto &key : {category_name, location_name}) {
+    if (setting.contains(key)) {
+      policy = parse_setting(setting[key], policy);
+    }
+  }
+  return policy;
+}
+
+nlohmann::json read_profile_setting(const std::string &db_file, const data::locator_ptr &locator) {
+  try {
+    auto value = cache::read_config_value(db_file, page_policy::make_config_location(locator)->uid);
+    return value.has_value() ? nlohmann::json::parse(value.value()) : nlohmann::json::object();
+  } catch (const std::exception &e) {
+    SPDLOG_WARN("journal policy in {} not taken: {}", db_file, e.what());
+    return nlohmann::json::object();
+  }
+}
+
+nlohmann::json read_env_setting(const std::string &value) {
+  try {
+    return nlohmann::json::parse(value);
+  } catch (const std::exception &e) {
+    SPDLOG_WARN("journal policy of env KF_JOURNAL_POLICY not taken: {}", e.what());
+    return nlohmann::json::object();
+  }
+}
+
+nlohmann::json get_setting(const data::locator_ptr &locator) {
+  auto from_env = locator->has_env("KF_JOURNAL_POLICY");
+  std::string key = from_env ? locator->get_env("KF_JOURNAL_POLICY") : "";
+  if (not from_env) {
+    // same file as practice::profile
+    auto etc_location = std::make_shared<data::location>(mode::LIVE, category::SYSTEM, "etc", "kungfu", locator);
+    key = locator->layout_file(etc_location, layout::SQLITE, "config");
+  }
+  std::lock_guard<std::mutex> lock(settings_mutex);
+  auto it = settings.find(key);
+  if (it == settings.end()) {
+    it = settings.emplace(key, from_env ? read_env_setting(key) : read_profile_setting(key, locator)).first;
+  }
+  return it->second;
+}
+} // namespace
+
+page_policy page_policy::find(const data::location_ptr &location, uint32_t dest_id) {
+  auto setting = get_setting(location->locator);
+  auto category_name = get_category_name(location->category);
+  auto location_name = fmt::format("{}/{}/{}", category_name, location->group, location->name);
+  auto page_size = default_page_size(location, dest_id);
+  try {
+    return resolve(setting, category_name, location_name, page_size);
+  } catch (const std::exception &e) {
+    SPDLOG_WARN("journal policy of {}/{:08x} not taken, using defaults: {}", location_name, dest_id, e.what());
+    page_policy policy = {};
+    policy.page_size = page_size;
+    return policy;
+  }
+}
+
+std::string page_policy::to_string() const {
+  nlohmann::json setting = {{"page_size", page_size},
+                            {"hugepage", get_name(mmap.hugepage, HUGEPAGE_NAMES)},
+                            {"lock", mmap.lock},
+                            {"advice", get_name(mmap.advice, ADVICE_NAMES)}};
+  return setting.dump();
+}
+
+page_policy page_policy::parse(const std::string &setting, page_policy base) {
+  return parse_setting(nlohmann::json::parse(setting), base);
+}
+
+page_policy page_policy::parse(const std::string &setting) { return parse(setting, page_policy{}); }
+
+void page_policy::check(const std::string &setting) {
+  auto entries = nlohmann::json::parse(setting);
+  if (not entries.is_object()) {
+    throw journal_error(fmt::format("journal policy {} is not an object", setting));
+  }
+  for (auto &item : entries.items()) {
+    auto &key = item.key();
+    auto category_name = key.substr(0, key.find('/'));
+    auto c = get_category_by_name(category_name);
+    auto slashes = std::count(key.begin(), key.end(), '/');
+    auto named = slashes == 2 and key.find("//") == std::string::npos and key.back() != '/';
+    if (get_category_name(c) != category_name or (slashes != 0 and not named)) {
+      throw journal_error(fmt::format("journal policy key {} is neither a category nor category/group/name", key));
+    }
+    // dest 0 and 1 have their own defaults, 2 stands for any other dest
+    for (uint32_t dest_id : {0, 1, 2}) {
+      try {
+        resolve(entries, category_name, key, get_default_page_size(c, dest_id));
+      } catch (const std::exception &e) {
+        throw journal_error(fmt::format("journal policy of {} for dest {}: {}", key, dest_id, e.what()));
+      }
+    }
+  }
+}
+
+void page_policy::reload() {
+  std::lock_guard<std::mutex> lock(settings_mutex);
+  settings.clear();
+}
+
+data::location_ptr page_policy::make_config_location(const data::locator_ptr &locator) {
+  return std::make_shared<data::location>(mode::LIVE, category::SYSTEM, "journal", "policy", locator);
+}
+
+uint32_t page_policy::default_page_size(const data::location_ptr &location, uint32_t dest_id) {
+  return get_default_page_size(location->category, dest_id);
+}
+} // namespace kungfu::yijinjing::journal
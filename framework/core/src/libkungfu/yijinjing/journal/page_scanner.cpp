@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <filesystem>
+
+#include <kungfu/common.h>
+#include <kungfu/yijinjing/journal/page_index.h>
+#include <kungfu/yijinjing/journal/page_scanner.h>
+
+namespace kungfu::yijinjing::journal {
+using namespace longfist::types;
+
+namespace {
+bool is_clear(uintptr_t begin, uintptr_t end) {
+  return std::all_of(reinterpret_cast<const char *>(begin), reinterpret_cast<const char *>(end),
+                     [](char c) { return c == 0; });
+}
+} // namespace
+
+std::string page_scanner::check_frame(const page_ptr &page, uint64_t position) {
+  auto address = page->address() + position;
+  auto header = reinterpret_cast<const frame_header *>(address);
+  uint32_t header_length = header->header_length;
+  uint32_t length = header->length;
+  int32_t msg_type = header->msg_type;
+  auto frame_header_length = page->get_frame_header_length();
+  if (header_length != frame_header_length and header_length != frame_header_length + FRAME_UID_COUNT_LENGTH) {
+    return fmt::format("header length {} at {}", header_length, position);
+  }
+  if (length < header_length or position + length > page->get_page_size()) {
+    return fmt::format("frame length {} at {}", length, position);
+  }
+  if (msg_type <= 0) {
+    return fmt::format("msg type {} at {}", msg_type, position);
+  }
+  frame f;
+  f.set_address(address);
+  if (not f.verify_checksum()) {
+    return fmt::format("checksum mismatch at {}", position);
+  }
+  return {};
+}
+
+page_scan page_scanner::scan(const data::location_ptr &location, uint32_t dest_id, uint32_t page_id, bool repair) {
+  page_scan result = {};
+  result.page_id = page_id;
+  auto writable = repair and std::filesystem::exists(page::get_page_path(location, dest_id, page_id));
+  auto page = page::load(location, dest_id, page_id, writable, true);
+  auto page_end = page->address() + page->get_page_size();
+
+  uint64_t position = page->first_frame_address() - page->address();
+  uint64_t last_position = position;
+  while (position + sizeof(frame_header) <= page->get_page_size()) {
+    page->ensure_frame(page->address() + position);
+    auto header = reinterpret_cast<const frame_header *>(page->address() + position);
+    if (header->length == 0) {
+      break; // end of committed frames, anything behind is checked below
+    }
+    result.error = check_frame(page, position);
+    if (not result.error.empty()) {
+      break;
+    }
+    result.frames++;
+    last_position = position;
+    position += header->length;
+    if (header->msg_type == PageEnd::tag) {
+      result.sealed = true;
+      break;
+    }
+  }
+  result.end_position = position;
+  result.last_frame_position = last_position;
+
+  auto recorded_position = page->last_frame_address() - page->address();
+  if (page->is_archived()) {
+    // archives hold nothing past the last frame, they were verified against their pages
+    result.damaged = not result.error.empty() or recorded_position != last_position;
+    return result;
+  }
+  auto tail = std::min<uint64_t>(position, page->get_page_size());
+  if (result.error.empty() and not is_clear(page->address() + tail, page_end)) {
+    result.error = fmt::format("uncommitted bytes after {}", tail);
+  }
+  result.damaged = not result.error.empty() or recorded_position != last_position;
+  if (result.damaged and writable) {
+    memset(reinterpret_cast<void *>(page->address() + tail), 0, page_end - page->address() - tail);
+    page->set_last_frame_position(last_position);
+    result.repaired = true;
+    SPDLOG_WARN("repaired {}: {}, truncated at {}", page::get_page_path(location, dest_id, page_id), result.error,
+                tail);
+  }
+  return result;
+}
+
+std::vector<page_scan> page_scanner::scan_all(const data::location_ptr &location, uint32_t dest_id, bool repair) {
+  std::vector<page_scan> results = {};
+  bool repaired = false;
+  for (auto page_id : location->locator->list_page_id(location, dest_id)) {
+    results.push_back(scan(location, dest_id, page_id, repair));
+    repaired |= results.back().repaired;
+  }
+  if (repaired) {
+    page_index::rebuild(location, dest_id);
+  }
+  return results;
+}
+} // namespace kungfu::yijinjing::journal
@@ -1,5 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
+#include <algorithm>
+
 #include <kungfu/yijinjing/journal/journal.h>
 #include <kungfu/yijinjing/journal/page.h>
 #include <kungfu/yijinjing/time.h>
@@ -7,11 +9,17 @@
 namespace kungfu::yijinjing::journal {
 reader::~reader() { journals_.clear(); }
 
+namespace {
+bool later(journal *a, journal *b) { return a->current_frame()->gen_time() > b->current_frame()->gen_time(); }
+} // namespace
+
 void reader::join(const data::location_ptr &location, uint32_t dest_id, const int64_t from_time) {
   auto key = static_cast<uint64_t>(location->uid) << 32u | static_cast<uint64_t>(dest_id);
   auto result = journals_.try_emplace(key, location, dest_id, false, lazy_);
   if (result.second) {
-    journals_.at(key).seek_to_time(from_time);
+    auto &journal = result.first->second;
+    journal.seek_to_time(from_time);
+    settle(&journal);
   }
   if (current_ == nullptr) {
     sort(); // do not sort if current_ is set (because we could be in process of reading)
@@ -27,20 +35,15 @@ void reader::disjoin(const uint32_t location_uid) {
     }
   }
   current_ = nullptr;
+  rebuild();
   sort();
 }
 
 void reader::disjoin_channel(uint32_t location_uid, uint32_t dest_id) {
   auto key = static_cast<uint64_t>(location_uid) << 32u | static_cast<uint64_t>(dest_id);
-  for (auto it = journals_.begin(); it != journals_.end();) {
-    if (it->first != key) {
-      it++;
-    } else {
-      journals_.erase(it);
-      break; // only one journal erased
-    }
-  }
+  journals_.erase(key); // only one journal erased
   current_ = nullptr;
+  rebuild();
   sort();
 }
 
@@ -53,6 +56,8 @@ void reader::seek_to_time(int64_t nanotime) {
   for (auto &pair : journals_) {
     pair.second.seek_to_time(nanotime);
   }
+  current_ = nullptr;
+  rebuild();
   sort();
 }
 
@@ -64,14 +69,60 @@ void reader::next() {
 }
 
 void reader::sort() {
-  int64_t min_time = time::now_in_nano();
-  for (auto &pair : journals_) {
-    auto &journal = pair.second;
-    auto &frame = journal.current_frame();
-    if (frame->has_data() && frame->gen_time() <= min_time) {
-      min_time = frame->gen_time();
-      current_ = &journal;
+  int64_t now = time::now_in_nano();
+  if (current_ != nullptr) {
+    settle(current_); // current_ is kept out of heap while being read, put it back with its new gen_time
+    current_ = nullptr;
+  }
+  // an idle journal was seen without data at or after watermark_ and frames are stamped when committed, so its next
+  // frame can not be earlier than watermark_, heap top earlier than that is served without looking at idle journals
+  if (ready_.empty() or ready_.front()->current_frame()->gen_time() >= watermark_) {
+    watermark_ = now;
+    poll_idle();
+  }
+  if (not ready_.empty() and ready_.front()->current_frame()->gen_time() <= now) {
+    std::pop_heap(ready_.begin(), ready_.end(), later);
+    current_ = ready_.back();
+    ready_.pop_back();
+    if (verify_checksum_ and not current_->verify_frame()) {
+      auto position = current_->frame_->address() - current_->page_->address();
+      throw journal_error(fmt::format("checksum mismatch at {}/{:08x}.{} position {}", current_->location_->uname,
+                                      current_->dest_id_, current_->page_->get_page_id(), position));
     }
   }
 }
-} // namespace kungfu::yijinjing::journal
\ No newline at end of file
+
+void reader::settle(journal *j) {
+  if (j->current_frame()->has_data()) {
+    ready_.push_back(j);
+    std::push_heap(ready_.begin(), ready_.end(), later);
+  } else {
+    idle_.push_back(j);
+  }
+}
+
+void reader::poll_idle() {
+  for (size_t i = 0; i < idle_.size();) {
+    auto j = idle_[i];
+    // one load of the next frame length for most idle journals, has_data only once something got written
+    if (j->current_frame()->frame_length() != 0 and j->current_frame()->has_data()) {
+      ready_.push_back(j);
+      std::push_heap(ready_.begin(), ready_.end(), later);
+      idle_[i] = idle_.back();
+      idle_.pop_back();
+    } else {
+      i++;
+    }
+  }
+}
+
+void reader::rebuild() {
+  ready_.clear();
+  idle_.clear();
+  for (auto &pair : journals_) {
+    auto journal = &pair.second;
+    (journal->current_frame()->has_data() ? ready_ : idle_).push_back(journal);
+  }
+  std::make_heap(ready_.begin(), ready_.end(), later);
+}
+} // namespace kungfu::yijinjing::journal
@@ -1,5 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
+#include <algorithm>
+
 #include <kungfu/common.h>
 #include <kungfu/longfist/longfist.h>
 #include <kungfu/yijinjing/common.h>
@@ -10,71 +12,87 @@ using namespace longfist::types;
 
 constexpr uint32_t PAGE_ID_TRANC = 0xFFFF0000;
 constexpr uint32_t FRAME_ID_TRANC = 0x0000FFFF;
+constexpr uint64_t CURSOR_FRAME_NB_ONE = uint64_t(1) << 32u;
+constexpr uint64_t CURSOR_POSITION_MASK = 0x00000000FFFFFFFF;
+constexpr int64_t WAIT_TIMEOUT = 30 * time_unit::NANOSECONDS_PER_SECOND;
+
+thread_local std::vector<writer::reservation> writer::reservations_ = {};
 
 writer::writer(const data::location_ptr &location, uint32_t dest_id, bool lazy, publisher_ptr publisher)
     : frame_id_base_(uint64_t(location->uid xor dest_id) << 32u), journal_(location, dest_id, true, lazy),
-      publisher_(std::move(publisher)), size_to_write_(0),
+      index_(location, dest_id), publisher_(std::move(publisher)),
       writer_start_time_32int_(time::nano_hashed(time::now_in_nano())) {
+  auto threshold = DEFAULT_PREFAULT_THRESHOLD;
+  if (location->locator->has_env("KF_PAGE_PREFAULT_THRESHOLD")) {
+    threshold = std::stod(location->locator->get_env("KF_PAGE_PREFAULT_THRESHOLD"));
+  }
+  page_size_ = find_page_size(location, dest_id);
+  prefault_position_ = threshold > 0 ? static_cast<uint64_t>(threshold * page_size_) : UINT64_MAX;
+  journal_.checksum_ = DEFAULT_CHECKSUM;
+  if (location->locator->has_env("KF_JOURNAL_CHECKSUM")) {
+    journal_.checksum_ = location->locator->get_env("KF_JOURNAL_CHECKSUM") != "0";
+  }
+  index_.validate();
   journal_.seek_to_time(time::now_in_nano());
+
+  auto &page = journal_.page_;
+  auto address = journal_.frame_->address();
+  // a non-empty header at the end means producers died between reserving and committing frames,
+  // clear the rest of the page so that readers never step into frames committed behind the gap.
+  if (reinterpret_cast<frame_header *>(address)->header_length != 0) {
+    memset(reinterpret_cast<void *>(address), 0, page->address() + page->get_page_size() - address);
+  }
+  slots_[0].page = page;
+  slots_[0].cursor = journal_.page_frame_nb_ << 32u | (address - page->address());
 }
 
-uint64_t writer::current_frame_uid() {
-  uint32_t page_part = (journal_.page_->page_id_ << 16u) & PAGE_ID_TRANC;
-  uint32_t frame_part = journal_.page_frame_nb_ & FRAME_ID_TRANC;
+uint64_t writer::current_frame_uid() { return current_element_uid(0); }
+
+uint64_t writer::current_element_uid(uint32_t index) {
+  auto r = find_reservation();
+  auto &slot = r != nullptr ? *r->slot : slots_[active_.load(std::memory_order_acquire)];
+  auto cursor = r != nullptr ? r->cursor : slot.cursor.load(std::memory_order_relaxed);
+  uint32_t page_part = (slot.page->page_id_ << 16u) & PAGE_ID_TRANC;
+  uint32_t frame_part = ((cursor >> 32u) + index) & FRAME_ID_TRANC;
   // frame_id_base is used for get account id while canceling order
   return frame_id_base_ | ((page_part | frame_part) xor writer_start_time_32int_);
 }
 
+const page_ptr writer::get_current_page() const {
+  auto r = find_reservation();
+  return r != nullptr ? r->slot->page : slots_[active_.load(std::memory_order_acquire)].page;
+}
+
 frame_ptr writer::open_frame(int64_t trigger_time, int32_t msg_type, uint32_t data_length) {
-  assert(sizeof(frame_header) + data_length + sizeof(frame_header) <= journal_.page_->get_page_size());
-  int64_t start_time = time::now_in_nano();
-  while (not writer_mtx_.try_lock()) {
-    if (time::now_in_nano() - start_time > 30 * time_unit::NANOSECONDS_PER_SECOND) {
-      throw journal_error("Can not lock writer for " + journal_.location_->uname);
-    }
-  }
-  if (journal_.current_frame()->address() + sizeof(frame_header) + data_length >= journal_.page_->address_border()) {
-    close_page(trigger_time);
-  }
-  auto frame = journal_.current_frame();
-  frame->set_header_length();
+  return open_frame(trigger_time, msg_type, data_length, 1);
+}
+
+frame_ptr writer::open_frame(int64_t trigger_time, int32_t msg_type, uint32_t data_length, uint32_t uid_count) {
+  auto &frame = reserve(trigger_time, data_length, std::max<uint32_t>(uid_count, 1)).frame;
   frame->set_trigger_time(trigger_time);
   frame->set_msg_type(msg_type);
   frame->set_source(journal_.location_->uid);
   frame->set_dest(journal_.dest_id_);
-  size_to_write_ = data_length;
   return frame;
 }
 
 void writer::close_frame(size_t data_length, int64_t gen_time) {
-  assert(size_to_write_ >= data_length);
-  auto frame = journal_.current_frame();
-  auto next_frame_address = frame->address() + frame->header_length() + data_length;
-  assert(next_frame_address < journal_.page_->address_border());
-  memset(reinterpret_cast<void *>(next_frame_address), 0, sizeof(frame_header));
-  frame->set_gen_time(gen_time);
-  frame->set_data_length(data_length);
-  size_to_write_ = 0;
-  journal_.page_->set_last_frame_position(frame->address() - journal_.page_->address());
-  journal_.next();
-  writer_mtx_.unlock();
-  publisher_->notify();
+  auto r = find_reservation();
+  if (r == nullptr) {
+    throw journal_error("no frame opened to close for " + journal_.location_->uname);
+  }
+  commit(*r, data_length, gen_time);
 }
 
 void writer::copy_frame(const frame_ptr &source) {
-  assert(source->frame_length() + sizeof(frame_header) <= journal_.page_->get_page_size());
-  if (journal_.current_frame()->address() + source->frame_length() >= journal_.page_->address_border()) {
-    close_page(yijinjing::time::now_in_nano());
-  }
-
-  auto frame = journal_.current_frame();
-  frame->copy(*source);
-
-  auto next_frame_address = frame->address() + frame->header_length() + frame->data_length();
-  memset(reinterpret_cast<void *>(next_frame_address), 0, sizeof(frame_header));
-  journal_.page_->set_last_frame_position(frame->address() - journal_.page_->address());
-  journal_.next();
-  publisher_->notify();
+  auto &r = reserve(source->trigger_time(), source->data_length(), source->uid_count());
+  auto &frame = r.frame;
+  frame->set_trigger_time(source->trigger_time());
+  frame->set_msg_type(source->msg_type());
+  frame->set_source(source->source());
+  frame->set_dest(source->dest());
+  memcpy(const_cast<void *>(frame->data_address()), source->data_address(), source->data_length());
+  commit(r, source->data_length(), source->gen_time());
 }
 
 void writer::mark(int64_t trigger_time, int32_t msg_type) {
@@ -100,23 +118,184 @@ void writer::mark(int64_t trigger_time, int32_t msg_type) {
   close_frame(length);
 }
 
-void writer::close_data() { close_frame(size_to_write_); }
+void writer::close_data() {
+  auto r = find_reservation();
+  if (r == nullptr) {
+    throw journal_error("no data opened to close for " + journal_.location_->uname);
+  }
+  commit(*r, r->data_length, 0);
+}
+
+writer::reservation &writer::reserve(int64_t trigger_time, uint32_t data_length, uint32_t uid_count) {
+  if (find_reservation() != nullptr) {
+    throw journal_error("frame already opened in this thread for " + journal_.location_->uname);
+  }
+  auto free = std::find_if(reservations_.begin(), reservations_.end(), [](auto &r) { return r.owner == nullptr; });
+  auto &r = free != reservations_.end() ? *free : reservations_.emplace_back();
+  if (not r.frame) {
+    r.frame = std::shared_ptr<frame>(new frame());
+  }
+
+  int64_t start_time = time::now_in_nano();
+  auto check_timeout = [&]() {
+    if (time::now_in_nano() - start_time > WAIT_TIMEOUT) {
+      throw journal_error("Can not reserve frame for " + journal_.location_->uname);
+    }
+  };
+  while (true) {
+    auto index = active_.load(std::memory_order_acquire);
+    auto &slot = slots_[index];
+    slot.in_flight.fetch_add(1, std::memory_order_acq_rel);
+    if (active_.load(std::memory_order_acquire) != index) {
+      slot.in_flight.fetch_sub(1, std::memory_order_release);
+      continue;
+    }
+    auto &page = slot.page;
+    auto header_length = page->get_frame_header_length() + (uid_count > 1 ? FRAME_UID_COUNT_LENGTH : 0);
+    uint32_t frame_length = header_length + data_length;
+    // the frame has to fit in an empty page along with the page end frame behind it
+    if (sizeof(page_header) + frame_length + page->get_frame_header_length() > page->get_page_size()) {
+      slot.in_flight.fetch_sub(1, std::memory_order_release);
+      throw journal_error(
+          fmt::format("frame of {} bytes does not fit in page for {}", frame_length, journal_.location_->uname));
+    }
+    auto cursor = slot.cursor.fetch_add(uid_count * CURSOR_FRAME_NB_ONE | frame_length, std::memory_order_acq_rel);
+    auto position = cursor & CURSOR_POSITION_MASK;
+    auto border = page->address_border() - page->address();
+    if (position + frame_length < border) {
+      r.owner = this;
+      r.slot = &slot;
+      r.cursor = cursor;
+      r.data_length = data_length;
+      r.uid_count = uid_count;
+      r.frame->set_address(page->address() + position);
+      r.frame->set_header_length(header_length);
+      if (uid_count > 1) {
+        r.frame->set_uid_count(uid_count);
+      }
+      return r;
+    }
+    if (position < border) {
+      close_page(index, position, trigger_time); // first one run over the border closes page
+    } else {
+      while (active_.load(std::memory_order_acquire) == index) {
+        check_timeout();
+      }
+    }
+    slot.in_flight.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+writer::reservation *writer::find_reservation() const {
+  auto it = std::find_if(reservations_.begin(), reservations_.end(), [&](auto &r) { return r.owner == this; });
+  return it == reservations_.end() ? nullptr : &(*it);
+}
+
+void writer::commit(reservation &r, uint32_t data_length, int64_t gen_time) {
+  assert(data_length <= r.data_length);
+  auto &slot = *r.slot;
+  auto &page = slot.page;
+  auto &frame = r.frame;
+  if (data_length < r.data_length) {
+    // give back the unused tail if no frame has been reserved after this one, otherwise keep it as padding,
+    // the header right behind must be cleared before it is handed out, or readers might take stale bytes as a frame
+    memset(reinterpret_cast<void *>(frame->address() + frame->header_length() + data_length), 0,
+           std::min<size_t>(sizeof(frame_header), r.data_length - data_length));
+    // uids of elements not written are given back as well, elements of an array are of the same length
+    uint64_t uid_count = r.uid_count;
+    if (uid_count > 1) {
+      uid_count = std::max<uint64_t>(uint64_t(data_length) * r.uid_count / r.data_length, 1);
+    }
+    uint64_t expected = r.cursor + r.uid_count * CURSOR_FRAME_NB_ONE + frame->header_length() + r.data_length;
+    uint64_t desired = r.cursor + uid_count * CURSOR_FRAME_NB_ONE + frame->header_length() + data_length;
+    if (slot.cursor.compare_exchange_strong(expected, desired, std::memory_order_acq_rel)) {
+      if (r.uid_count > 1) {
+        frame->set_uid_count(uid_count); // as the cursor took them, get_uid_count reads it back
+      }
+    } else {
+      // frames reserved behind, the tail stays in the frame zeroed, readers of arrays skip zeroed elements
+      memset(reinterpret_cast<void *>(frame->address() + frame->header_length() + data_length), 0,
+             r.data_length - data_length);
+      data_length = r.data_length;
+    }
+  }
+  gen_time = gen_time != 0 ? gen_time : time::now_in_nano();
+  frame->set_gen_time(gen_time);
+  if (frame->has_checksum()) {
+    frame->set_checksum(frame->compute_checksum(frame->header_length() + data_length));
+  }
+  std::atomic_thread_fence(std::memory_order_release); // frame content must be visible before its length
+  frame->set_data_length(data_length);
+
+  auto position = frame->address() - page->address();
+  auto page_id = page->get_page_id();
+  page->update_last_frame_position(position);
+  index_.on_frame(page, frame->address(), r.cursor >> 32u, gen_time);
+  slot.in_flight.fetch_sub(1, std::memory_order_release);
+  r.owner = nullptr;
+  r.slot = nullptr;
+
+  if (position >= prefault_position_ and prefault_page_id_.load(std::memory_order_relaxed) <= page_id) {
+    prefault_next_page(page_id);
+  }
+  publisher_->notify();
+}
+
+void writer::prefault_next_page(uint32_t page_id) {
+  std::unique_lock<std::mutex> lock(page_mtx_, std::try_to_lock);
+  if (not lock.owns_lock() or next_page_.valid() or prefault_page_id_ > page_id) {
+    return;
+  }
+  auto location = journal_.location_;
+  auto dest_id = journal_.dest_id_;
+  auto lazy = journal_.lazy_;
+  auto checksum = journal_.checksum_;
+  prefault_page_id_ = page_id + 1;
+  next_page_ = std::async(std::launch::async,
+                          [=]() { return page::load(location, dest_id, page_id + 1, true, lazy, true, checksum); });
+}
 
-void writer::close_page(int64_t trigger_time) {
-  page_ptr last_page = journal_.page_;
-  journal_.load_next_page();
+void writer::close_page(uint32_t slot_index, uint64_t position, int64_t trigger_time) {
+  int64_t start_time = time::now_in_nano();
+  std::lock_guard<std::mutex> lock(page_mtx_);
+  auto &slot = slots_[slot_index];
+  auto &next = slots_[slot_index ^ 1u];
+  auto last_page = slot.page;
+  auto next_page_id = last_page->get_page_id() + 1;
+  page_ptr page = next_page_.valid() ? next_page_.get() : page_ptr{}; // prefaulted in background, just swap it in
+  if (not page or page->get_page_id() != next_page_id) {
+    page = page::load(journal_.location_, journal_.dest_id_, next_page_id, true, journal_.lazy_, false,
+                      journal_.checksum_);
+  }
+  // the other slot still holds the page before last, wait for its producers to finish
+  while (next.in_flight.load(std::memory_order_acquire) != 0) {
+    if (time::now_in_nano() - start_time > WAIT_TIMEOUT) {
+      throw journal_error("Can not roll over page for " + journal_.location_->uname);
+    }
+  }
+  next.page = page;
+  next.cursor.store(page->first_frame_address() - page->address(), std::memory_order_relaxed);
+  journal_.load_page(page);
+  prefault_page_id_ = std::max(prefault_page_id_.load(), next_page_id);
 
   frame last_page_frame;
-  last_page_frame.set_address(last_page->last_frame_address());
-  last_page_frame.move_to_next();
-  last_page_frame.set_header_length();
+  last_page_frame.set_address(last_page->address() + position);
+  last_page_frame.set_header_length(last_page->get_frame_header_length());
   last_page_frame.set_trigger_time(trigger_time);
   last_page_frame.set_msg_type(longfist::types::PageEnd::tag);
   last_page_frame.set_source(journal_.location_->uid);
   last_page_frame.set_dest(journal_.dest_id_);
   last_page_frame.set_gen_time(time::now_in_nano());
+  if (last_page_frame.has_checksum()) {
+    last_page_frame.set_checksum(last_page_frame.compute_checksum(last_page_frame.header_length()));
+  }
+  std::atomic_thread_fence(std::memory_order_release);
   last_page_frame.set_data_length(0);
-  last_page->set_last_frame_position(last_page_frame.address() - last_page->address());
+  last_page->update_last_frame_position(position);
+
+  active_.store(slot_index ^ 1u, std::memory_order_release);
+  SPDLOG_DEBUG("{}/{:08x} rolled over to page {} in {} ns", journal_.location_->uname, journal_.dest_id_,
+               next_page_id, time::now_in_nano() - start_time);
 }
 
 } // namespace kungfu::yijinjing::journal
@@ -17,6 +17,41 @@ using namespace kungfu::yijinjing::data;
 using namespace std::chrono;
 
 namespace kungfu::yijinjing::practice {
+namespace {
+/**
+ * Time event handed to timer callbacks, made in process when a timer expires.
+ */
+class time_event : public event {
+public:
+  time_event(int64_t gen_time, int64_t deadline, uint32_t home_uid)
+      : gen_time_(gen_time), deadline_(deadline), home_uid_(home_uid) {}
+
+  [[nodiscard]] int64_t gen_time() const override { return gen_time_; }
+
+  [[nodiscard]] int64_t trigger_time() const override { return deadline_; }
+
+  [[nodiscard]] int32_t msg_type() const override { return Time::tag; }
+
+  [[nodiscard]] uint32_t source() const override { return home_uid_; }
+
+  [[nodiscard]] uint32_t dest() const override { return home_uid_; }
+
+  [[nodiscard]] uint32_t data_length() const override { return 0; }
+
+  [[nodiscard]] const void *data_address() const override { return nullptr; }
+
+  [[nodiscard]] const char *data_as_bytes() const override { return nullptr; }
+
+  [[nodiscard]] std::string data_as_string() const override { return {}; }
+
+  [[nodiscard]] std::string to_string() const override { return {}; }
+
+private:
+  const int64_t gen_time_;
+  const int64_t deadline_;
+  const uint32_t home_uid_;
+};
+} // namespace
 
 apprentice::apprentice(location_ptr home, bool low_latency)
     : hero(std::make_shared<io_device_client>(home, low_latency)), trading_day_(time::today_start()) {}
@@ -112,52 +147,36 @@ void apprentice::request_cached(uint32_t source_id) {
 }
 
 void apprentice::add_timer(int64_t nanotime, const std::function<void(const event_ptr &)> &callback) {
-  events_ | timer(nanotime) |
-      $([&, callback](const event_ptr &event) {
-        // try {
-        callback(event);
-        // } catch (const std::exception &e) {
-        //   SPDLOG_ERROR("Unexpected exception by timer {}", e.what());
-        // }
-      }
-        // [&](std::exception_ptr e) {
-        //   try {
-        //     std::rethrow_exception(e);
-        //   } catch (const rx::empty_error &ex) {
-        //     SPDLOG_WARN("{}", ex.what());
-        //   } catch (const std::exception &ex) {
-        //     SPDLOG_WARN("Unexpected exception by timer{}", ex.what());
-        //   }
-        // }
-      );
+  timers_.add(nanotime, [this, callback](int64_t deadline) { callback(make_time_event(deadline)); });
+  request_wakeup(nanotime);
 }
 
 void apprentice::add_time_interval(int64_t duration, const std::function<void(const event_ptr &)> &callback) {
-  events_ | time_interval(std::chrono::nanoseconds(duration)) | $([&, callback](const event_ptr &event) {
-    // try {
-    callback(event);
-    // } catch (const std::exception &e) {
-    //   SPDLOG_ERROR("Unexpected exception by time_interval {}", e.what());
-    // }
+  auto deadline = now() + duration;
+  timers_.add(deadline, [this, duration, callback](int64_t deadline) {
+    add_time_interval(duration, callback); // next round counts from now, no catching up after time jumps
+    callback(make_time_event(deadline));
   });
+  request_wakeup(deadline);
 }
 
 void apprentice::on_trading_day(const event_ptr &event, int64_t daytime) {}
 
 void apprentice::react() {
   events_ | is(TimeReset::tag) | first() | $$(reset_time(event->data<TimeReset>()));
-  events_ | is(Location::tag) | $$(add_location(event->gen_time(), event->data<Location>()));
-  events_ | is(Register::tag) | $$(on_register(event->trigger_time(), event->data<Register>()));
-  events_ | is(Deregister::tag) | $$(on_deregister(event));
-  events_ | is(RequestReadFrom::tag) | $$(on_read_from(event));
-  events_ | is(CachedReadyToRead::tag) | $$(on_cached_ready_to_read());
-  events_ | is(RequestReadFromPublic::tag) | $$(on_read_from_public(event));
-  events_ | is(RequestReadFromSync::tag) | $$(on_read_from_sync(event));
-  events_ | is(RequestWriteTo::tag) | $$(on_write_to(event));
-  events_ | is(RequestWriteToBand::tag) | $$(on_write_to_band(event));
-  events_ | is(Channel::tag) | $$(register_channel(event->gen_time(), event->data<Channel>()));
-  events_ | is(Band::tag) | $$(register_band(event->gen_time(), event->data<Band>()));
-  events_ | is(TradingDay::tag) | $$(on_trading_day(event, event->data<TradingDay>().timestamp));
+  handle(Location::tag, [&](const event_ptr &event) { add_location(event->gen_time(), event->data<Location>()); });
+  handle(Register::tag, [&](const event_ptr &event) { on_register(event->trigger_time(), event->data<Register>()); });
+  handle(Deregister::tag, [&](const event_ptr &event) { on_deregister(event); });
+  handle(RequestReadFrom::tag, [&](const event_ptr &event) { on_read_from(event); });
+  handle(CachedReadyToRead::tag, [&](const event_ptr &event) { on_cached_ready_to_read(); });
+  handle(RequestReadFromPublic::tag, [&](const event_ptr &event) { on_read_from_public(event); });
+  handle(RequestReadFromSync::tag, [&](const event_ptr &event) { on_read_from_sync(event); });
+  handle(RequestWriteTo::tag, [&](const event_ptr &event) { on_write_to(event); });
+  handle(RequestWriteToBand::tag, [&](const event_ptr &event) { on_write_to_band(event); });
+  handle(Channel::tag, [&](const event_ptr &event) { register_channel(event->gen_time(), event->data<Channel>()); });
+  handle(Band::tag, [&](const event_ptr &event) { register_band(event->gen_time(), event->data<Band>()); });
+  handle(TradingDay::tag,
+         [&](const event_ptr &event) { on_trading_day(event, event->data<TradingDay>().timestamp); });
   events_ | is(RequestStop::tag) | to(get_home_uid()) | $$(signal_stop());
   events_ | take_until(events_ | is(RequestStart::tag)) | $$(feed_state_data(event, state_bank_));
 
@@ -224,6 +243,22 @@ void apprentice::react() {
 
 void apprentice::on_active() {}
 
+void apprentice::request_wakeup(int64_t nanotime) {
+  if (get_io_device()->get_home()->mode != mode::LIVE or not has_writer(master_cmd_location_->uid)) {
+    return; // frames move time forward when not live
+  }
+  auto writer = get_writer(master_cmd_location_->uid);
+  TimeRequest &r = writer->open_data<TimeRequest>(0);
+  r.id = timer_usage_count_++;
+  r.duration = nanotime - now();
+  r.repeat = 1;
+  writer->close_data();
+}
+
+event_ptr apprentice::make_time_event(int64_t deadline) const {
+  return std::make_shared<time_event>(now(), deadline, get_home_uid());
+}
+
 void apprentice::on_frame() {}
 
 void apprentice::on_react() {}
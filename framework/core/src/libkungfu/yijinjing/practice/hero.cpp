@@ -68,9 +68,13 @@ void hero::step() {
 void hero::run() {
   SPDLOG_INFO("[{:08x}] {} running", get_home_uid(), get_home_uname());
   SPDLOG_TRACE("from {} until {}", time::strftime(begin_time_), time::strftime(end_time_));
+  setup_thread();
   setup();
   continual_ = true;
+  auto run_time = time::now_in_nano();
+  auto run_clock = std::clock();
   events_.connect(cs_);
+  report_wait_stats(run_time, run_clock);
   on_exit();
   SPDLOG_INFO("[{:08x}] {} done", get_home_uid(), get_home_uname());
 }
@@ -328,6 +332,26 @@ void hero::require_write_to_band(int64_t trigger_time, uint32_t source_id,
   writer->write(trigger_time, msg);
 }
 
+void hero::handle(int32_t msg_type, const event_handler &handler) { handlers_[msg_type].push_back(handler); }
+
+void hero::post(const event_ptr &event) { dispatch(event); }
+
+void hero::dispatch(const event_ptr &event) {
+  auto it = handlers_.find(event->msg_type());
+  if (it == handlers_.end()) {
+    return;
+  }
+  // deque keeps running handlers in place when new ones get pushed back during dispatch
+  auto &handlers = it->second;
+  for (size_t i = 0, size = handlers.size(); i < size; i++) {
+    try {
+      handlers[i](event);
+    } catch (...) {
+      interrupt_on_error(std::current_exception()); // same as rx subscribers registered by $()
+    }
+  }
+}
+
 void hero::produce(const rx::subscriber<event_ptr> &sb) {
   try {
     do {
@@ -344,13 +368,19 @@ void hero::produce(const rx::subscriber<event_ptr> &sb) {
 }
 
 bool hero::drain(const rx::subscriber<event_ptr> &sb) {
-  if (io_device_->get_home()->mode == mode::LIVE and io_device_->get_observer()->wait()) {
-    const std::string &notice = io_device_->get_observer()->get_notice();
+  if (io_device_->get_home()->mode == mode::LIVE) {
+    auto notified = io_device_->get_observer()->wait();
     now_ = time::now_in_nano();
-    if (notice.length() > 2) {
-      sb.on_next(std::make_shared<nanomsg_json>(notice));
-    } else {
-      on_notify();
+    advance_timers();
+    if (notified) {
+      const std::string &notice = io_device_->get_observer()->get_notice();
+      if (notice.length() > 2) {
+        event_ptr event = std::make_shared<nanomsg_json>(notice);
+        dispatch(event);
+        sb.on_next(event);
+      } else {
+        on_notify();
+      }
     }
   }
   while (live_ and reader_->data_available()) {
@@ -359,6 +389,8 @@ bool hero::drain(const rx::subscriber<event_ptr> &sb) {
       if (frame_time > now_) {
         now_ = frame_time;
       }
+      advance_timers();
+      dispatch(reader_->current_frame());
       sb.on_next(reader_->current_frame());
       on_frame();
       reader_->next();
@@ -374,6 +406,49 @@ bool hero::drain(const rx::subscriber<event_ptr> &sb) {
   return true;
 }
 
+void hero::advance_timers() {
+  try {
+    timers_.advance(now_);
+  } catch (...) {
+    interrupt_on_error(std::current_exception()); // same as handlers called by dispatch
+  }
+}
+
+void hero::setup_thread() {
+  auto &cpus = io_device_->get_cpu_affinity();
+  if (not cpus.empty()) {
+    if (os::set_cpu_affinity(cpus)) {
+      SPDLOG_INFO("pinned to cpu {}", cpus);
+    } else {
+      SPDLOG_WARN("failed to pin to cpu {}", cpus);
+    }
+  }
+  auto &policy = io_device_->get_sched_policy();
+  if (not policy.empty()) {
+    if (os::set_scheduler(policy)) {
+      SPDLOG_INFO("scheduled by {}", policy);
+    } else {
+      SPDLOG_WARN("failed to set scheduler {}", policy);
+    }
+  }
+  SPDLOG_INFO("wait strategy {}", get_wait_strategy_name(io_device_->get_wait_strategy()));
+}
+
+void hero::report_wait_stats(int64_t run_time, std::clock_t run_clock) const {
+  auto observer = io_device_->get_observer();
+  if (not observer) {
+    return;
+  }
+  auto &stats = observer->get_wait_stats();
+  auto wall_ns = std::max<int64_t>(time::now_in_nano() - run_time, 1);
+  auto cpu_ns = double(std::clock() - run_clock) / CLOCKS_PER_SEC * time_unit::NANOSECONDS_PER_SECOND;
+  auto avg_latency = stats.wakeups > 0 ? stats.wakeup_latency / stats.wakeups : 0;
+  SPDLOG_INFO("wait strategy {} used {:.1f}% cpu, idle polls {}, yields {}, sleeps {}, wakeups {} in avg {}us max {}us",
+              get_wait_strategy_name(io_device_->get_wait_strategy()), cpu_ns * 100 / wall_ns, stats.idle_polls,
+              stats.yields, stats.sleeps, stats.wakeups, avg_latency / time_unit::NANOSECONDS_PER_MICROSECOND,
+              stats.max_wakeup_latency / time_unit::NANOSECONDS_PER_MICROSECOND);
+}
+
 void hero::delegate_produce(hero *instance, const rx::subscriber<event_ptr> &subscriber) {
 #ifdef _WINDOWS
   __try {
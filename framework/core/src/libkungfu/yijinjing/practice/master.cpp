@@ -154,19 +154,19 @@ void master::register_app(const event_ptr &event) {
   registry_.erase(app_location_uid);
   reader_->disjoin(app_location_uid);
   writers_.erase(app_location_uid);
-  timer_tasks_.erase(app_location_uid);
+  cancel_timer_tasks(app_location_uid);
   get_writer(location::PUBLIC)->write(trigger_time, location->to<Deregister>());
 }
 
 [[maybe_unused]] void master::publish_trading_day() { write_trading_day(0, get_writer(location::PUBLIC)); }
 
 void master::react() {
-  events_ | is(RequestWriteTo::tag) | $$(on_request_write_to(event));
-  events_ | is(RequestWriteToBand::tag) | $$(on_request_write_to_band(event));
-  events_ | is(RequestReadFrom::tag) | $$(on_request_read_from(event));
-  events_ | is(RequestReadFrom::tag) | $$(check_cached_ready_to_read(event));
-  events_ | is(RequestReadFromPublic::tag) | $$(on_request_read_from_public(event));
-  events_ | is(RequestReadFromSync::tag) | $$(on_request_read_from_sync(event));
+  handle(RequestWriteTo::tag, [&](const event_ptr &event) { on_request_write_to(event); });
+  handle(RequestWriteToBand::tag, [&](const event_ptr &event) { on_request_write_to_band(event); });
+  handle(RequestReadFrom::tag, [&](const event_ptr &event) { on_request_read_from(event); });
+  handle(RequestReadFrom::tag, [&](const event_ptr &event) { check_cached_ready_to_read(event); });
+  handle(RequestReadFromPublic::tag, [&](const event_ptr &event) { on_request_read_from_public(event); });
+  handle(RequestReadFromSync::tag, [&](const event_ptr &event) { on_request_read_from_sync(event); });
   // for watcher request stop master in widnows
   events_ | is(RequestStop::tag) | filter([&](const event_ptr &event) {
     auto dest = event->dest();
@@ -178,12 +178,12 @@ void master::react() {
     }
     return false;
   }) | $$(signal_stop());
-  events_ | is(ChannelRequest::tag) | $$(on_channel_request(event));
-  events_ | is(TimeRequest::tag) | $$(on_time_request(event));
-  events_ | is(Location::tag) | $$(on_new_location(event));
-  events_ | is(Register::tag) | $$(register_app(event));
-  events_ | is(RequestCachedDone::tag) | $$(on_request_cached_done(event));
-  events_ | is(Ping::tag) | $$(pong(event));
+  handle(ChannelRequest::tag, [&](const event_ptr &event) { on_channel_request(event); });
+  handle(TimeRequest::tag, [&](const event_ptr &event) { on_time_request(event); });
+  handle(Location::tag, [&](const event_ptr &event) { on_new_location(event); });
+  handle(Register::tag, [&](const event_ptr &event) { register_app(event); });
+  handle(RequestCachedDone::tag, [&](const event_ptr &event) { on_request_cached_done(event); });
+  handle(Ping::tag, [&](const event_ptr &event) { pong(event); });
   events_ | instanceof <journal::frame>() | $$(feed(event));
 }
 
@@ -191,32 +191,34 @@ void master::on_active() {
   auto now = time::now_in_nano();
   if (last_check_ + time_unit::NANOSECONDS_PER_SECOND < now) {
     on_interval_check(now);
+    session_builder_.flush();
     last_check_ = now;
   }
-  on_frame();
 }
 
-void master::on_frame() { handle_timer_tasks(); }
+void master::on_frame() {}
 
-void master::handle_timer_tasks() {
-  auto now = time::now_in_nano();
-  for (auto &app : timer_tasks_) {
-    uint32_t app_id = app.first;
-    auto &app_tasks = app.second;
-    for (auto it = app_tasks.begin(); it != app_tasks.end();) {
-      auto &task = it->second;
-      if (task.checkpoint <= now) {
-        get_writer(app_id)->mark(0, Time::tag);
-        task.checkpoint += task.duration;
-        task.repeat_count++;
-        if (task.repeat_count >= task.repeat_limit) {
-          it = app_tasks.erase(it);
-          continue;
-        }
-      }
-      it++;
+void master::schedule_timer_task(uint32_t app_id, int32_t task_id, int64_t deadline, int64_t duration,
+                                 int64_t repeat) {
+  timer_tasks_[app_id][task_id] = timers_.add(deadline, [this, app_id, task_id, duration, repeat](int64_t deadline) {
+    get_writer(app_id)->mark(0, Time::tag);
+    if (repeat > 1) {
+      schedule_timer_task(app_id, task_id, deadline + duration, duration, repeat - 1);
+    } else {
+      timer_tasks_[app_id].erase(task_id);
     }
+  });
+}
+
+void master::cancel_timer_tasks(uint32_t app_id) {
+  auto it = timer_tasks_.find(app_id);
+  if (it == timer_tasks_.end()) {
+    return;
+  }
+  for (auto &task : it->second) {
+    timers_.cancel(task.second);
   }
+  timer_tasks_.erase(it);
 }
 
 void master::try_add_location(int64_t trigger_time, const location_ptr &app_location) {
@@ -241,8 +243,6 @@ void master::check_cached_ready_to_read(const event_ptr &event) {
 }
 
 void master::feed(const event_ptr &event) {
-  handle_timer_tasks();
-
   if (registry_.find(event->source()) == registry_.end()) {
     return;
   }
@@ -353,14 +353,12 @@ void master::on_channel_request(const event_ptr &event) {
 
 void master::on_time_request(const event_ptr &event) {
   const TimeRequest &request = event->data<TimeRequest>();
-  timer_tasks_.try_emplace(event->source());
-  auto &app_tasks = timer_tasks_.at(event->source());
-  app_tasks.try_emplace(request.id);
-  auto &task = app_tasks.at(request.id);
-  task.checkpoint = time::now_in_nano() + request.duration;
-  task.duration = request.duration;
-  task.repeat_count = 0;
-  task.repeat_limit = request.repeat;
+  auto &app_tasks = timer_tasks_[event->source()];
+  auto it = app_tasks.find(request.id);
+  if (it != app_tasks.end()) {
+    timers_.cancel(it->second);
+  }
+  schedule_timer_task(event->source(), request.id, now() + request.duration, request.duration, request.repeat);
 }
 
 void master::on_new_location(const event_ptr &event) {
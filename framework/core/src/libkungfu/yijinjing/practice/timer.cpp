@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <bit>
+
+#include <kungfu/yijinjing/practice/timer.h>
+
+namespace kungfu::yijinjing::practice {
+
+timer_wheel::timer_wheel(int tick_bits) : tick_bits_(tick_bits) {}
+
+uint64_t timer_wheel::add(int64_t deadline, timer_callback callback) {
+  uint32_t index;
+  if (free_.empty()) {
+    index = nodes_.size();
+    nodes_.emplace_back();
+  } else {
+    index = free_.back();
+    free_.pop_back();
+  }
+  auto &n = nodes_[index];
+  n.deadline = deadline;
+  n.tick = std::max(to_tick(deadline), current_ + 1); // the current tick has been processed
+  n.callback = std::move(callback);
+  place(index);
+  count_++;
+  return uint64_t(n.generation) << 32u | index;
+}
+
+bool timer_wheel::cancel(uint64_t id) {
+  auto index = uint32_t(id);
+  if (index >= nodes_.size() or nodes_[index].generation != uint32_t(id >> 32u) or nodes_[index].level < 0) {
+    return false;
+  }
+  unlink(index);
+  release(index);
+  return true;
+}
+
+void timer_wheel::advance(int64_t now) {
+  auto target = now >> tick_bits_;
+  while (current_ < target) {
+    auto next = count_ == 0 ? INT64_MAX : next_tick();
+    if (next > target) {
+      current_ = target; // nothing to do in between
+      return;
+    }
+    current_ = next;
+    // higher levels first, they may drop timers into the slots of lower levels reached at the same tick
+    int aligned = 1;
+    while (aligned < LEVELS and (current_ & ((int64_t(1) << (SLOT_BITS * aligned)) - 1)) == 0) {
+      aligned++;
+    }
+    for (int l = aligned - 1; l > 0; l--) {
+      cascade(l, int(current_ >> (SLOT_BITS * l)) & SLOT_MASK);
+    }
+    expire(int(current_) & SLOT_MASK);
+  }
+}
+
+int64_t timer_wheel::to_tick(int64_t deadline) const {
+  auto mask = (int64_t(1) << tick_bits_) - 1;
+  return deadline > INT64_MAX - mask ? INT64_MAX >> tick_bits_ : (deadline + mask) >> tick_bits_;
+}
+
+int64_t timer_wheel::next_tick() const {
+  int64_t next = INT64_MAX;
+  for (int l = 0; l < LEVELS; l++) {
+    auto &lv = levels_[l];
+    if (lv.count == 0) {
+      continue;
+    }
+    auto base = current_ >> (SLOT_BITS * l);
+    auto from = int(base) & SLOT_MASK;
+    // distance to the first occupied slot after from, going round to from itself last
+    for (int distance = 1; distance <= SLOTS;) {
+      auto slot = (from + distance) & SLOT_MASK;
+      auto bits = lv.occupied[slot / 64] >> (slot % 64);
+      if (bits != 0) {
+        distance += std::countr_zero(bits);
+        next = std::min(next, (base + distance) << (SLOT_BITS * l));
+        break;
+      }
+      distance += 64 - slot % 64;
+    }
+  }
+  return next;
+}
+
+void timer_wheel::place(uint32_t index) {
+  auto &n = nodes_[index];
+  auto delta = uint64_t(n.tick - current_);
+  // level l holds ticks less than 2^(8 * (l + 1)) ahead, those even further wait at the top and get placed again
+  auto l = delta < SLOTS ? 0 : std::min(LEVELS - 1, int(std::bit_width(delta) - 1) / SLOT_BITS);
+  auto slot = int(n.tick >> (SLOT_BITS * l)) & SLOT_MASK;
+  auto &lv = levels_[l];
+  auto &list = lv.slots[slot];
+  n.level = l;
+  n.slot = slot;
+  n.prev = list.tail;
+  n.next = NIL;
+  if (list.tail == NIL) {
+    list.head = index;
+    lv.occupied[slot / 64] |= uint64_t(1) << (slot % 64);
+  } else {
+    nodes_[list.tail].next = index;
+  }
+  list.tail = index;
+  lv.count++;
+}
+
+void timer_wheel::unlink(uint32_t index) {
+  auto &n = nodes_[index];
+  auto &lv = levels_[n.level];
+  auto &list = lv.slots[n.slot];
+  if (n.prev == NIL) {
+    list.head = n.next;
+  } else {
+    nodes_[n.prev].next = n.next;
+  }
+  if (n.next == NIL) {
+    list.tail = n.prev;
+  } else {
+    nodes_[n.next].prev = n.prev;
+  }
+  if (list.head == NIL) {
+    lv.occupied[n.slot / 64] &= ~(uint64_t(1) << (n.slot % 64));
+  }
+  lv.count--;
+  n.level = -1;
+  n.prev = NIL;
+  n.next = NIL;
+}
+
+void timer_wheel::release(uint32_t index) {
+  auto &n = nodes_[index];
+  n.callback = {};
+  n.generation++; // ids handed out before no longer match
+  free_.push_back(index);
+  count_--;
+}
+
+void timer_wheel::cascade(int level, int slot) {
+  auto &lv = levels_[level];
+  auto index = lv.slots[slot].head;
+  if (index == NIL) {
+    return;
+  }
+  // detach the whole slot first, timers beyond the top level may land in it again
+  size_t detached = 0;
+  for (auto i = index; i != NIL; i = nodes_[i].next) {
+    detached++;
+  }
+  lv.slots[slot] = {};
+  lv.occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+  lv.count -= detached;
+  while (index != NIL) {
+    auto next = nodes_[index].next;
+    place(index);
+    index = next;
+  }
+}
+
+void timer_wheel::expire(int slot) {
+  auto &list = levels_[0].slots[slot];
+  while (list.head != NIL) {
+    auto index = list.head;
+    unlink(index);
+    auto deadline = nodes_[index].deadline;
+    auto callback = std::move(nodes_[index].callback);
+    release(index);
+    callback(deadline);
+  }
+}
+} // namespace kungfu::yijinjing::practice
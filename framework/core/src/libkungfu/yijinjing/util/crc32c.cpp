@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <array>
+#include <cstring>
+
+#include <kungfu/yijinjing/util/util.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define KF_CRC32C_SSE42
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__ARM_FEATURE_CRC32)
+#define KF_CRC32C_ARMV8
+#include <arm_acle.h>
+#endif
+
+namespace kungfu::yijinjing::util {
+namespace {
+constexpr uint32_t CRC32C_POLYNOMIAL = 0x82f63b78; // reversed 0x1edc6f41
+
+constexpr std::array<uint32_t, 256> CRC32C_TABLE = []() {
+  std::array<uint32_t, 256> table = {};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = crc & 1u ? (crc >> 1u) ^ CRC32C_POLYNOMIAL : crc >> 1u;
+    }
+    table[i] = crc;
+  }
+  return table;
+}();
+
+uint32_t crc32c_table(const uint8_t *data, size_t length, uint32_t crc) {
+  for (size_t i = 0; i < length; i++) {
+    crc = CRC32C_TABLE[(crc ^ data[i]) & 0xffu] ^ (crc >> 8u);
+  }
+  return crc;
+}
+
+#ifdef KF_CRC32C_SSE42
+#ifndef _MSC_VER
+__attribute__((target("sse4.2")))
+#endif
+uint32_t crc32c_sse42(const uint8_t *data, size_t length, uint32_t crc) {
+  uint64_t crc64 = crc;
+  for (; length >= sizeof(uint64_t); data += sizeof(uint64_t), length -= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = static_cast<uint32_t>(crc64);
+  for (; length > 0; data++, length--) {
+    crc = _mm_crc32_u8(crc, *data);
+  }
+  return crc;
+}
+
+bool has_sse42() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 20)) != 0;
+#else
+  return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+const auto crc32c_impl = has_sse42() ? crc32c_sse42 : crc32c_table;
+#elif defined(KF_CRC32C_ARMV8)
+uint32_t crc32c_armv8(const uint8_t *data, size_t length, uint32_t crc) {
+  for (; length >= sizeof(uint64_t); data += sizeof(uint64_t), length -= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc = __crc32cd(crc, word);
+  }
+  for (; length > 0; data++, length--) {
+    crc = __crc32cb(crc, *data);
+  }
+  return crc;
+}
+
+const auto crc32c_impl = crc32c_armv8;
+#else
+const auto crc32c_impl = crc32c_table;
+#endif
+} // namespace
+
+uint32_t crc32c(const void *data, size_t length, uint32_t crc) {
+  return ~crc32c_impl(static_cast<const uint8_t *>(data), length, ~crc);
+}
+} // namespace kungfu::yijinjing::util
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifdef __linux__
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // __linux__
+
+#include <kungfu/yijinjing/util/os.h>
+
+namespace kungfu::yijinjing::os {
+
+#ifdef __linux__
+bool futex_supported() { return true; }
+
+bool futex_wait(uint32_t *address, uint32_t expected, int timeout_ms) {
+  struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+  // not FUTEX_PRIVATE_FLAG, the word is mapped by several processes
+  return syscall(SYS_futex, address, FUTEX_WAIT, expected, &timeout, nullptr, 0) == 0 or errno == EAGAIN;
+}
+
+void futex_wake(uint32_t *address) { syscall(SYS_futex, address, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0); }
+#else
+bool futex_supported() { return false; }
+
+bool futex_wait([[maybe_unused]] uint32_t *address, [[maybe_unused]] uint32_t expected,
+                [[maybe_unused]] int timeout_ms) {
+  return false;
+}
+
+void futex_wake([[maybe_unused]] uint32_t *address) {}
+#endif // __linux__
+
+} // namespace kungfu::yijinjing::os
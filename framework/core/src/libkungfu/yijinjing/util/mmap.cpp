@@ -24,7 +24,23 @@ using namespace kungfu::yijinjing::journal;
 
 namespace kungfu::yijinjing::os {
 
-uintptr_t load_mmap_buffer(const std::string &path, size_t size, bool is_writing, bool lazy) {
+#ifndef _WINDOWS
+static int to_madvise(mmap_advice advice) {
+  switch (advice) {
+  case mmap_advice::random:
+    return MADV_RANDOM;
+  case mmap_advice::sequential:
+    return MADV_SEQUENTIAL;
+  case mmap_advice::willneed:
+    return MADV_WILLNEED;
+  default:
+    return MADV_NORMAL;
+  }
+}
+#endif // _WINDOWS
+
+uintptr_t load_mmap_buffer(const std::string &path, size_t size, bool is_writing, bool lazy, bool populate,
+                           const mmap_options &options) {
 #ifdef _WINDOWS
   bool master = is_writing || !lazy;
   HANDLE dumpFileDescriptor = CreateFileA(path.c_str(), (master) ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
@@ -59,7 +75,23 @@ uintptr_t load_mmap_buffer(const std::string &path, size_t size, bool is_writing
     throw journal_error("failed to open file for page " + path);
   }
 
-  if (master) {
+#ifdef __linux__
+  bool hugetlb = options.hugepage == mmap_hugepage::hugetlb;
+  // reserve blocks up front so that writes into the mapping never have to allocate
+  bool allocated = master and populate and posix_fallocate(fd, 0, size) == 0;
+#else
+  bool hugetlb = false;
+  bool allocated = false;
+#endif // __linux__
+
+  if (master and not allocated and hugetlb) {
+    // hugetlbfs takes no write(), the file can only be sized by ftruncate
+    struct stat st = {};
+    if (fstat(fd, &st) == 0 and static_cast<size_t>(st.st_size) < size and ftruncate(fd, size) != 0) {
+      close(fd);
+      throw journal_error("failed to stretch for page " + path);
+    }
+  } else if (master and not allocated) {
     if (lseek(fd, size - 1, SEEK_SET) == -1) {
       close(fd);
       throw journal_error("failed to stretch for page " + path);
@@ -77,14 +109,41 @@ uintptr_t load_mmap_buffer(const std::string &path, size_t size, bool is_writing
    * races where it might get reassigned to something else if you first released the old resource then attempted to
    * regain it for the new resource.
    */
-  void *buffer = mmap(0, size, master ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+  int flags = MAP_SHARED;
+#ifdef __linux__
+  flags |= populate ? MAP_POPULATE : 0;
+  flags |= hugetlb ? MAP_HUGETLB : 0;
+#endif // __linux__
+  void *buffer = mmap(0, size, master ? (PROT_READ | PROT_WRITE) : PROT_READ, flags, fd, 0);
 
   if (buffer == MAP_FAILED) {
     close(fd);
+    if (hugetlb) {
+      throw journal_error("failed to map huge pages for page " + path + ", it has to be on a hugetlbfs mount");
+    }
     throw journal_error("Error mapping file to buffer");
   }
 
-  if (!lazy && madvise(buffer, size, MADV_RANDOM) != 0 && mlock(buffer, size) != 0) {
+#ifndef __linux__
+  if (populate) {
+    auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t offset = 0; offset < size; offset += page_size) {
+      [[maybe_unused]] volatile char touch = reinterpret_cast<volatile char *>(buffer)[offset];
+    }
+  }
+#endif // __linux__
+
+#ifdef __linux__
+  if (options.hugepage == mmap_hugepage::transparent and madvise(buffer, size, MADV_HUGEPAGE) != 0) {
+    SPDLOG_DEBUG("transparent huge pages not taken for {}", path); // only some file systems support THP
+  }
+#endif // __linux__
+
+  if (options.advice != mmap_advice::none and madvise(buffer, size, to_madvise(options.advice)) != 0) {
+    SPDLOG_WARN("failed to advise access pattern for {}", path);
+  }
+
+  if (options.lock and mlock(buffer, size) != 0) {
     munmap(buffer, size);
     close(fd);
     throw journal_error("failed to lock memory for page " + path);
@@ -114,4 +173,27 @@ bool release_mmap_buffer(uintptr_t address, [[maybe_unused]] size_t size, bool l
   return true;
 }
 
+uintptr_t load_anonymous_buffer(size_t size) {
+#ifdef _WINDOWS
+  void *buffer = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  if (buffer == nullptr) {
+    throw journal_error("failed to allocate buffer, VirtualAlloc Error " + std::to_string(GetLastError()));
+  }
+#else
+  void *buffer = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffer == MAP_FAILED) {
+    throw journal_error("failed to allocate buffer");
+  }
+#endif // _WINDOWS
+  return reinterpret_cast<uintptr_t>(buffer);
+}
+
+bool release_anonymous_buffer(uintptr_t address, [[maybe_unused]] size_t size) {
+  void *buffer = reinterpret_cast<void *>(address);
+#ifdef _WINDOWS
+  return VirtualFree(buffer, 0, MEM_RELEASE) != 0;
+#else
+  return munmap(buffer, size) == 0;
+#endif // _WINDOWS
+}
 } // namespace kungfu::yijinjing::os
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif // __linux__
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) or defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include <kungfu/yijinjing/common.h>
+#include <kungfu/yijinjing/util/os.h>
+
+namespace kungfu::yijinjing::os {
+
+static std::vector<int> parse_cpu_list(const std::string &cpus) {
+  std::vector<int> result = {};
+  std::stringstream ss(cpus);
+  std::string item;
+  try {
+    while (std::getline(ss, item, ',')) {
+      if (item.empty()) {
+        continue;
+      }
+      auto dash = item.find('-');
+      auto first = std::stoi(item.substr(0, dash));
+      auto last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+      if (first < 0 or last < first) {
+        throw std::invalid_argument(item);
+      }
+      for (int cpu = first; cpu <= last; cpu++) {
+        result.push_back(cpu);
+      }
+    }
+  } catch (const std::logic_error &e) {
+    throw yijinjing_error(fmt::format("invalid cpu list {}", cpus));
+  }
+  return result;
+}
+
+#ifdef __linux__
+bool set_cpu_affinity(const std::string &cpus) {
+  auto cpu_list = parse_cpu_list(cpus);
+  if (cpu_list.empty()) {
+    return true;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpu_list) {
+    if (cpu >= CPU_SETSIZE) {
+      throw yijinjing_error(fmt::format("invalid cpu list {}", cpus));
+    }
+    CPU_SET(cpu, &set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool set_scheduler(const std::string &policy) {
+  static const std::unordered_map<std::string, int> policies = {
+      {"other", SCHED_OTHER}, {"batch", SCHED_BATCH}, {"idle", SCHED_IDLE}, {"fifo", SCHED_FIFO}, {"rr", SCHED_RR}};
+  auto colon = policy.find(':');
+  auto name = policy.substr(0, colon);
+  if (policies.find(name) == policies.end()) {
+    throw yijinjing_error(fmt::format("unknown scheduler policy {}", policy));
+  }
+  auto sched_policy = policies.at(name);
+  struct sched_param param = {};
+  if (colon != std::string::npos) {
+    try {
+      param.sched_priority = std::stoi(policy.substr(colon + 1));
+    } catch (const std::logic_error &e) {
+      throw yijinjing_error(fmt::format("invalid scheduler priority {}", policy));
+    }
+  } else if (sched_policy == SCHED_FIFO or sched_policy == SCHED_RR) {
+    param.sched_priority = sched_get_priority_min(sched_policy);
+  }
+  return pthread_setschedparam(pthread_self(), sched_policy, &param) == 0;
+}
+#else
+bool set_cpu_affinity(const std::string &cpus) {
+  parse_cpu_list(cpus);
+  return false;
+}
+
+bool set_scheduler([[maybe_unused]] const std::string &policy) { return false; }
+#endif // __linux__
+
+void cpu_pause() {
+#if defined(_MSC_VER) or defined(__x86_64__) or defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__) or defined(__arm__)
+  asm volatile("yield");
+#endif
+}
+
+} // namespace kungfu::yijinjing::os
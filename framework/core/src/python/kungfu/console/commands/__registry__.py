@@ -5,5 +5,6 @@ from . import journal
 from . import run
 from . import cli
 from . import assemble
+from . import backtest
 
-__all__ = ["engage", "journal", "run", "cli", "assemble"]
+__all__ = ["engage", "journal", "run", "cli", "assemble", "backtest"]
@@ -0,0 +1,100 @@
+#  SPDX-License-Identifier: Apache-2.0
+
+import click
+import os
+
+from tabulate import tabulate
+
+from kungfu.console.commands import kfc
+from kungfu.wingchun import backtest as kfb
+
+
+@kfc.command(help_priority=2)
+@click.option("-g", "--group", required=True, type=str, help="strategy group")
+@click.option("-n", "--name", required=True, type=str, help="strategy name")
+@click.argument("reference", type=str)
+@click.option("-a", "--arguments", type=str, required=False)
+@click.option(
+    "-b", "--begin", required=True, type=str, help="first trading day, YYYYMMDD"
+)
+@click.option("-e", "--end", required=True, type=str, help="last trading day, YYYYMMDD")
+@click.option(
+    "-s",
+    "--source",
+    required=True,
+    type=str,
+    help="market data location, group or group/name",
+)
+@click.option(
+    "-m",
+    "--source-mode",
+    default="live",
+    type=click.Choice(["live", "data", "backtest"]),
+    help="mode of the market data journal",
+)
+@click.option(
+    "-d",
+    "--data-dir",
+    type=click.Path(exists=True, file_okay=False),
+    help="root of the market data journals, defaults to runtime dir",
+)
+@click.option(
+    "-w", "--workers", default=os.cpu_count(), type=int, help="number of processes"
+)
+@click.option(
+    "-c",
+    "--carry",
+    is_flag=True,
+    help="seed each day with the end of day books of the day before, days run in order",
+)
+@click.option("-o", "--output", default=".", type=str, help="directory of the reports")
+@click.option("-k", "--keep", is_flag=True, help="keep the runtime dir of every day")
+@kfc.pass_context()
+def backtest(
+    ctx,
+    group,
+    name,
+    reference,
+    arguments,
+    begin,
+    end,
+    source,
+    source_mode,
+    data_dir,
+    workers,
+    carry,
+    output,
+    keep,
+):
+    ctx.group = group
+    ctx.name = name
+    ctx.path = reference
+    ctx.arguments = arguments
+    source_group, _, source_name = source.partition("/")
+    job = kfb.make_job(
+        ctx,
+        data_dir=os.path.abspath(data_dir if data_dir else ctx.runtime_dir),
+        source_group=source_group,
+        source_name=source_name if source_name else source_group,
+        source_mode=source_mode,
+        work_dir=os.path.join(ctx.home, "backtest", group, name),
+        workers=workers,
+        carry=carry,
+        keep=keep,
+    )
+    days = kfb.trading_days(begin, end)
+    if not days:
+        click.echo(f"no trading day from {begin} to {end}")
+        return
+
+    report = kfb.run_backtest(job, days)
+
+    os.makedirs(output, exist_ok=True)
+    for table, df in report.items():
+        df.to_csv(
+            os.path.join(output, f"{group}_{name}_{begin}_{end}_{table}.csv"),
+            index=False,
+        )
+    if "pnl" in report:
+        pnl = report["pnl"]
+        click.echo(tabulate(pnl.values, headers=pnl.columns, tablefmt="simple"))
@@ -3,10 +3,12 @@
 import click
 import functools
 import glob
+import json
 import kungfu
 import platform
 import os
 import shutil
+import time
 import zipfile
 
 from collections import deque
@@ -14,7 +16,7 @@ from datetime import datetime, timedelta
 from tabulate import tabulate
 
 from kungfu.console.commands import kfc, PrioritizedCommandGroup
-from kungfu.yijinjing import LOG_PATTERN, ARCHIVE_PREFIX
+from kungfu.yijinjing import LOG_PATTERN, ARCHIVE_PREFIX, glob_journal_pages
 from kungfu.yijinjing import journal as kfj
 from kungfu.yijinjing import time as kft
 from kungfu.yijinjing.log import create_logger
@@ -112,15 +114,213 @@ def sessions(ctx, sortby, ascending, tablefmt):
 
 
 @journal.command()
+@click.option(
+    "--full", is_flag=True, help="rebuild from scratch instead of indexing new frames"
+)
 @journal_command_context
-def rebuild_index(ctx):
+def rebuild_index(ctx, full):
     io_device = yjj.io_device(ctx.console_location)
     session_builder = yjj.session_builder(io_device)
     click.echo("rebuild sqlite db")
-    session_builder.rebuild_index_db()
+    session_builder.rebuild_index_db(full)
+    click.echo("done")
+
+
+@journal.command()
+@journal_command_context
+def rebuild_page_index(ctx):
+    locations = ctx.runtime_locator.list_locations(
+        ctx.category, ctx.group, ctx.name, ctx.mode
+    )
+    for location in locations:
+        for dest_id in ctx.runtime_locator.list_location_dest(location):
+            count = yjj.rebuild_page_index(location, dest_id)
+            click.echo(f"{location.uname}/{dest_id:08x}: {count} checkpoints")
     click.echo("done")
 
 
+@journal.command()
+@click.option("-t", "--data-type", default="Quote", help="fixed size longfist type")
+@click.option("-r", "--repeat", type=int, default=3, help="rounds of each path")
+@journal_command_context
+def time_read(ctx, data_type, repeat):
+    data = getattr(lf.types, data_type, None)
+    if data is None:
+        raise click.BadParameter(f"no such type {data_type}", param_hint="--data-type")
+
+    def best_of(read):
+        elapsed = []
+        for _ in range(max(repeat, 1)):
+            asb = yjj.assemble(
+                [ctx.runtime_locator], ctx.mode, ctx.category, ctx.group, ctx.name
+            )
+            start = time.perf_counter_ns()
+            count = len(read(asb))
+            elapsed.append(time.perf_counter_ns() - start)
+        return count, min(elapsed)
+
+    try:
+        array_count, array_ns = best_of(lambda asb: asb.read_array(data()))
+    except TypeError:
+        raise click.BadParameter(
+            f"{data_type} is not fixed size", param_hint="--data-type"
+        )
+    frame_count, frame_ns = best_of(lambda asb: asb.read_all(data()))
+    table = [
+        ["read_all", frame_count, frame_ns / 1e6, frame_ns / max(frame_count, 1)],
+        ["read_array", array_count, array_ns / 1e6, array_ns / max(array_count, 1)],
+    ]
+    click.echo(
+        tabulate(
+            table, headers=["path", "frames", "best ms", "ns/frame"], floatfmt=".1f"
+        )
+    )
+
+
+@journal.command()
+@click.option(
+    "-b",
+    "--before",
+    type=str,
+    default=None,
+    help="archive pages ending before this time, %Y-%m-%d %H:%M:%S, defaults to now",
+)
+@journal_command_context
+def archive_pages(ctx, before):
+    before_time = (
+        kft.strptime(before, SESSION_DATETIME_FORMAT) if before else yjj.now_in_nano()
+    )
+    locations = ctx.runtime_locator.list_locations(
+        ctx.category, ctx.group, ctx.name, ctx.mode
+    )
+    table = []
+    for location in locations:
+        for dest_id in ctx.runtime_locator.list_location_dest(location):
+            stats = yjj.archive_pages(location, dest_id, before_time)
+            if stats.pages > 0:
+                table.append(
+                    [
+                        f"{location.uname}/{dest_id:08x}",
+                        stats.pages,
+                        stats.page_bytes >> 20,
+                        stats.archived_bytes >> 20,
+                        f"{stats.ratio:.1f}",
+                        f"{stats.read_throughput / (1 << 20):.0f}",
+                    ]
+                )
+    headers = ["journal", "pages", "page MB", "archived MB", "ratio", "read MB/s"]
+    click.echo(tabulate(table, headers=headers, tablefmt="simple"))
+
+
+@journal.command()
+@click.option(
+    "-r",
+    "--repair",
+    is_flag=True,
+    help="truncate damaged pages at their last good frame, stop writers first",
+)
+@click.option("-a", "--all", "show_all", is_flag=True, help="list good pages too")
+@journal_command_context
+def scan_pages(ctx, repair, show_all):
+    locations = ctx.runtime_locator.list_locations(
+        ctx.category, ctx.group, ctx.name, ctx.mode
+    )
+    table = []
+    for location in locations:
+        for dest_id in ctx.runtime_locator.list_location_dest(location):
+            for scan in yjj.scan_pages(location, dest_id, repair):
+                if scan.damaged or show_all:
+                    table.append(
+                        [
+                            f"{location.uname}/{dest_id:08x}.{scan.page_id}",
+                            scan.frames,
+                            scan.end_position,
+                            "sealed" if scan.sealed else "open",
+                            "repaired" if scan.repaired else scan.damaged,
+                            scan.error,
+                        ]
+                    )
+    headers = ["page", "frames", "end", "state", "damaged", "error"]
+    click.echo(tabulate(table, headers=headers, tablefmt="simple"))
+
+
+@journal.command()
+@click.option(
+    "-k", "--key", type=str, default=None, help="category, or category/group/name"
+)
+@click.option(
+    "-s", "--page-size", type=str, default=None, help="bytes, or with KB, MB or GB"
+)
+@click.option(
+    "--hugepage",
+    type=click.Choice(["none", "transparent", "hugetlb"]),
+    default=None,
+    help="transparent needs tmpfs or THP for files, hugetlb needs a hugetlbfs mount",
+)
+@click.option("--lock/--no-lock", default=None, help="mlock pages of writers")
+@click.option(
+    "--advice",
+    type=click.Choice(["none", "normal", "random", "sequential", "willneed"]),
+    default=None,
+    help="access pattern told to the kernel",
+)
+@click.option("--unset", is_flag=True, help="remove the setting of key")
+@journal_command_context
+def page_policy(ctx, key, page_size, hugepage, lock, advice, unset):
+    profile = yjj.profile(ctx.runtime_locator)
+    config_location = yjj.get_page_policy_location(ctx.runtime_locator)
+    configs = [
+        config
+        for config in profile.get_all(lf.types.Config())
+        if config.location_uid == config_location.uid
+    ]
+    setting = json.loads(configs[0].value) if configs else {}
+    if key:
+        entry = setting.pop(key, {})
+        fields = {
+            "page_size": page_size,
+            "hugepage": hugepage,
+            "lock": lock,
+            "advice": advice,
+        }
+        entry.update({k: v for k, v in fields.items() if v is not None})
+        if not unset:
+            setting[key] = entry
+            yjj.check_page_policy(json.dumps(setting))
+        config = lf.types.Config()
+        config.location_uid = config_location.uid
+        config.category = config_location.category
+        config.group = config_location.group
+        config.name = config_location.name
+        config.mode = config_location.mode
+        config.value = json.dumps(setting)
+        profile.set(config)
+        yjj.reload_page_policy()
+    if "KF_JOURNAL_POLICY" in os.environ:
+        click.echo("KF_JOURNAL_POLICY is set, it takes over the profile")
+    click.echo(json.dumps(setting, indent=2))
+
+    locations = ctx.runtime_locator.list_locations(
+        ctx.category, ctx.group, ctx.name, ctx.mode
+    )
+    table = []
+    for location in locations:
+        for dest_id in ctx.runtime_locator.list_location_dest(location):
+            policy = yjj.find_page_policy(location, dest_id)
+            fields = json.loads(policy.to_string())
+            table.append(
+                [
+                    f"{location.uname}/{dest_id:08x}",
+                    fields["page_size"] >> 10,
+                    fields["hugepage"],
+                    fields["lock"],
+                    fields["advice"],
+                ]
+            )
+    headers = ["journal", "page KB", "hugepage", "lock", "advice"]
+    click.echo(tabulate(table, headers=headers, tablefmt="simple"))
+
+
 @journal.command()
 @click.option("-i", "--session_id", type=int, required=True, help="session id")
 @click.option(
@@ -156,10 +356,9 @@ def trace(ctx, session_id, io_type, csv):
 @click.option("-D", "--dry", is_flag=True, help="dry run")
 @journal_command_context
 def clean(ctx, archive, dry):
-    search_path = os.path.join(
-        ctx.runtime_dir, "*", "*", "*", "journal", "*", "*.journal"
-    )
-    journal_files = glob.glob(search_path)
+    search_dir = os.path.join(ctx.runtime_dir, "*", "*", "*", "journal", "*")
+    journal_files = glob_journal_pages(search_dir)
+    index_files = glob.glob(os.path.join(search_dir, "*.index"))
     if dry:
         for journal_file in journal_files:
             click.echo(f"rm {journal_file}")
@@ -173,7 +372,7 @@ def clean(ctx, archive, dry):
         for journal_file in journal_files:
             archive_zip.write(journal_file)
         click.echo(f"archived to {archive_path}")
-    for journal_file in journal_files:
+    for journal_file in journal_files + index_files:
         os.remove(journal_file)
     click.echo(f"cleaned {len(journal_files)} journal files")
 
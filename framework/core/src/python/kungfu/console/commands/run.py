@@ -104,20 +104,60 @@ def ledger(ctx, replay, session_id):
     "-s",
     "--source",
     required=True,
-    help="data source",
+    help="data sources, comma separated",
 )
 @click.option(
     "-t",
     "--time-interval",
     default="1m",
     type=str,
-    help="bar time interval, s/m/h/d, s=Second m=Minute h=Hour d=Day",
+    help="bar time intervals, comma separated, s/m/h/d, s=Second m=Minute h=Hour d=Day",
+)
+@click.option(
+    "-i",
+    "--instruments",
+    type=click.Path(exists=True),
+    help="json file of instruments to make bars of, each with optional source and time_interval",
 )
 @service_command_context
-def bar(ctx, source, time_interval):
+def bar(ctx, source, time_interval, instruments):
     ctx.mode = lf.enums.mode.LIVE
     args = {"source": source, "time_interval": time_interval}
+    if instruments:
+        with open(instruments) as instruments_json:
+            args["instruments"] = json.load(instruments_json)
     instance = wc.BarGenerator(
         ctx.runtime_locator, ctx.mode, ctx.low_latency, json.dumps(args)
     )
     instance.run()
+
+
+@service.command()
+@click.option(
+    "-s",
+    "--source",
+    required=True,
+    help="data source",
+)
+@click.option(
+    "-t",
+    "--time-interval",
+    default="1s",
+    type=str,
+    help="tree publish interval, s/m/h/d, 0s to publish every change",
+)
+@click.option(
+    "-c",
+    "--capacity",
+    default=8192,
+    type=int,
+    help="max number of instruments in the depth snapshot",
+)
+@service_command_context
+def depth(ctx, source, time_interval, capacity):
+    ctx.mode = lf.enums.mode.LIVE
+    args = {"source": source, "time_interval": time_interval, "capacity": capacity}
+    instance = wc.DepthService(
+        ctx.runtime_locator, ctx.mode, ctx.low_latency, json.dumps(args)
+    )
+    instance.run()
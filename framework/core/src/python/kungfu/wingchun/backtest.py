@@ -0,0 +1,226 @@
+#  SPDX-License-Identifier: Apache-2.0
+
+import datetime
+import kungfu
+import multiprocessing
+import os
+import pandas
+import shutil
+import sys
+
+from concurrent.futures import ProcessPoolExecutor
+from types import SimpleNamespace
+
+from kungfu.console import site
+from kungfu.yijinjing import time as kft
+from kungfu.yijinjing.log import find_logger
+from kungfu.yijinjing.practice.coloop import KungfuEventLoop
+from kungfu.wingchun.calendar import Calendar
+from kungfu.wingchun.strategy import Runner, Strategy
+
+lf = kungfu.__binding__.longfist
+yjj = kungfu.__binding__.yijinjing
+
+# trading days switch at this hour of the calendar day before, same as Calendar
+TRADING_DAY_SWITCH_HOUR = 18
+
+
+def trading_days(begin, end):
+    """Trading days from begin to end inclusive, dates as YYYYMMDD strings."""
+    calendar = Calendar(None)
+    day = datetime.datetime.strptime(begin, "%Y%m%d").date()
+    last = datetime.datetime.strptime(end, "%Y%m%d").date()
+    days = []
+    while day <= last:
+        if calendar.is_trading_day(day):
+            days.append(day.strftime("%Y%m%d"))
+        day = day + datetime.timedelta(days=1)
+    return days
+
+
+def trading_day_span(trading_day):
+    """Nanotime span [begin, end) of frames of trading_day, night sessions included."""
+    calendar = Calendar(None)
+    day = datetime.datetime.strptime(trading_day, "%Y%m%d")
+    previous = day - datetime.timedelta(days=1)
+    while not calendar.is_trading_day(previous.date()):
+        previous = previous - datetime.timedelta(days=1)
+    switch = datetime.timedelta(hours=TRADING_DAY_SWITCH_HOUR)
+    to_nano = lambda t: int((t - kft.EPOCH).total_seconds() * kft.NANO_PER_SECOND)
+    return to_nano(previous + switch), to_nano(day + switch)
+
+
+def link_market_data(job, root):
+    """Link the source market data journal as the BACKTEST md journal under root."""
+    source = os.path.join(
+        job.data_dir,
+        "md",
+        job.source_group,
+        job.source_name,
+        "journal",
+        job.source_mode,
+    )
+    target = os.path.join(root, "md", job.group, job.name, "journal", "backtest")
+    os.makedirs(os.path.dirname(target), exist_ok=True)
+    try:
+        os.symlink(source, target, target_is_directory=True)
+    except OSError:
+        # no symlink privilege on windows, hard links of the pages are as cheap
+        shutil.copytree(source, target, copy_function=os.link)
+
+
+def as_dict(data):
+    """Fields of a longfist object, enums as their names, to pass between processes."""
+    fields = {}
+    for field in dir(data):
+        if not field.startswith("_"):
+            value = getattr(data, field)
+            plain = isinstance(value, (bool, int, float, str))
+            fields[field] = value if plain else str(value)
+    return fields
+
+
+class DayRun:
+    """One trading day of a backtest, a BACKTEST mode Runner in its own runtime dir."""
+
+    def __init__(self, job, trading_day, carried_books):
+        self.job = job
+        self.trading_day = trading_day
+        self.carried_books = carried_books
+        self.root = os.path.join(job.work_dir, trading_day)
+        if os.path.exists(self.root):
+            shutil.rmtree(self.root)
+        os.makedirs(self.root)
+        link_market_data(job, self.root)
+
+        ctx = SimpleNamespace(**vars(job))
+        ctx.mode = "backtest"
+        ctx.low_latency = True
+        ctx.runtime_dir = self.root
+        # have to keep locator alive from python side
+        ctx.runtime_locator = yjj.locator(self.root)
+        ctx.location = yjj.location(
+            lf.enums.mode.BACKTEST,
+            lf.enums.category.STRATEGY,
+            job.group,
+            job.name,
+            ctx.runtime_locator,
+        )
+        ctx.logger = find_logger(ctx.location, job.log_level)
+        self.ctx = ctx
+
+    def run(self):
+        ctx = self.ctx
+        begin_time, end_time = trading_day_span(self.trading_day)
+        ctx.runner = Runner(ctx, lf.enums.mode.BACKTEST)
+        ctx.runner.set_begin_time(begin_time)
+        ctx.runner.set_end_time(end_time - 1)
+        ctx.strategy = CarryingStrategy(ctx, self.carried_books, begin_time)
+        ctx.runner.add_strategy(ctx.strategy)
+        ctx.loop = KungfuEventLoop(ctx, ctx.runner)
+        ctx.loop.run_forever()
+        books = ctx.runner.context.bookkeeper.get_books()
+        return {uid: book for uid, book in books.items()}
+
+    def report(self, books):
+        strategy_uid = yjj.location(
+            lf.enums.mode.LIVE,
+            lf.enums.category.STRATEGY,
+            self.job.group,
+            self.job.name,
+            self.ctx.runtime_locator,
+        ).uid
+        result = {"assets": [], "positions": [], "trades": []}
+        for uid, book in books.items():
+            holder = "strategy" if uid == strategy_uid else f"{uid:08x}"
+            tag = {"trading_day": self.trading_day, "holder": holder}
+            result["assets"].append({**tag, **as_dict(book.asset)})
+            for positions in (book.long_positions, book.short_positions):
+                for position in positions.values():
+                    if position.volume != 0 or position.realized_pnl != 0:
+                        result["positions"].append({**tag, **as_dict(position)})
+            for trade in book.list_trades():
+                result["trades"].append({**tag, **as_dict(trade)})
+        return result
+
+
+class CarryingStrategy(Strategy):
+    """Strategy seeded with the end of day books of the day before."""
+
+    def __init__(self, ctx, carried_books, daytime):
+        Strategy.__init__(self, ctx)
+        self._carried_books = carried_books
+        self._daytime = daytime
+
+    def post_start(self, wc_context):
+        for book in self._carried_books.values():
+            wc_context.bookkeeper.carry_over(book, self._daytime)
+        Strategy.post_start(self, wc_context)
+
+
+def setup_worker(job):
+    site.setup(os.path.dirname(job.path))
+    sys.path.insert(0, os.path.dirname(job.path))
+    os.environ["KF_STG_GROUP"] = job.group
+    os.environ["KF_STG_NAME"] = job.name
+
+
+def run_days(job, days):
+    """Run days in order in this worker, seeding each from the day before if carrying."""
+    results = []
+    previous, books = None, {}
+    for trading_day in days:
+        day = DayRun(job, trading_day, books if job.carry else {})
+        day_books = day.run()
+        results.append(day.report(day_books))
+        # books refer to instruments of their bookkeeper, keep the day until carried
+        stale, previous, books = previous, day, day_books
+        if stale is not None and not job.keep:
+            shutil.rmtree(stale.root, ignore_errors=True)
+    if previous is not None and not job.keep:
+        shutil.rmtree(previous.root, ignore_errors=True)
+    return results
+
+
+def run_backtest(job, days):
+    """
+    Run the strategy over days on a pool of job.workers processes, merge the results.
+    Days are independent unless job.carry is set, then they run in order on one worker.
+    """
+    shards = [days] if job.carry else [[day] for day in days]
+    workers = max(1, min(job.workers, len(shards)))
+    # spawn to start workers without the parent's journals, sockets and loggers
+    mp_context = multiprocessing.get_context("spawn")
+    with ProcessPoolExecutor(
+        max_workers=workers,
+        mp_context=mp_context,
+        initializer=setup_worker,
+        initargs=(job,),
+    ) as pool:
+        futures = [pool.submit(run_days, job, shard) for shard in shards]
+        results = [result for future in futures for result in future.result()]
+
+    report = {}
+    for table in ("assets", "positions", "trades"):
+        rows = [row for result in results for row in result[table]]
+        report[table] = pandas.DataFrame(rows)
+    assets = report["assets"]
+    if not assets.empty:
+        report["pnl"] = (
+            assets.assign(pnl=assets["realized_pnl"] + assets["unrealized_pnl"])
+            .pivot_table(index="trading_day", columns="holder", values="pnl")
+            .reset_index()
+        )
+    return report
+
+
+def make_job(ctx, **kwargs):
+    """Picklable settings of a backtest, taken from the console context and options."""
+    return SimpleNamespace(
+        path=os.path.abspath(ctx.path),
+        group=ctx.group,
+        name=ctx.name,
+        arguments=ctx.arguments if ctx.arguments else "",
+        log_level=ctx.log_level,
+        **kwargs,
+    )
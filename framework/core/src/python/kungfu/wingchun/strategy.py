@@ -125,11 +125,7 @@ class Strategy(wc.Strategy):
     def __call_proxy(self, func, *args):
         if inspect.iscoroutinefunction(func):
 
-            async def wrap():
-                await func(*args)
-                self.ctx.loop._current = None
-
-            asyncio.ensure_future(wrap())
+            asyncio.ensure_future(func(*args))
         else:
             func(*args)
 
@@ -199,7 +195,7 @@ class Strategy(wc.Strategy):
             side,
         )
         await AsyncOrderAction(self.ctx, order_id, status_set)
-        return self.ctx.book.orders[order_id]
+        return self.ctx.book.find_order(order_id)
 
     def pre_start(self, wc_context):
         self.ctx.wc_context = wc_context
@@ -318,23 +314,17 @@ class AsyncOrderAction:
         self.order_id = order_id
         self.status_set = status_set
         self.future = ctx.loop.create_future()
+        if not self.poll():
+            ctx.loop.add_poller(self.poll)
+
+    def poll(self):
+        if self.future.done():
+            return True
+        order = self.ctx.book.find_order(self.order_id)  # finished orders may be archived already
+        if order is not None and order.status in self.status_set:
+            self.future.set_result(None)
+            return True
+        return False
 
     def __await__(self):
-        return AsyncOrderActionIter(self.ctx, self)
-
-
-class AsyncOrderActionIter:
-    def __init__(self, ctx, action):
-        self.ctx = ctx
-        self.action = action
-        self.book = ctx.book
-
-    def __iter__(self):
-        return self
-
-    def __next__(self):
-        if self.action.order_id in self.book.orders:
-            order = self.book.orders[self.action.order_id]
-            if order.status in self.action.status_set:
-                raise StopIteration
-        return next(iter(self.action.future))
+        return self.future.__await__()
@@ -1,5 +1,6 @@
 #  SPDX-License-Identifier: Apache-2.0
 
+import glob
 import kungfu
 import os
 import re
@@ -52,6 +53,16 @@ JOURNAL_PAGE_REGEX = "{}{}{}{}{}{}{}{}{}{}{}".format(
 )
 JOURNAL_PAGE_PATTERN = re.compile(JOURNAL_PAGE_REGEX)
 
+# pages sealed and compressed by archive-pages keep their name with this suffix
+JOURNAL_ARCHIVE_SUFFIX = ".lz4"
+
+
+def glob_journal_pages(search_dir, prefix="*"):
+    """Page files in search_dir, archived or not, search_dir may contain wildcards."""
+    pattern = os.path.join(search_dir, prefix + ".journal")
+    return glob.glob(pattern) + glob.glob(pattern + JOURNAL_ARCHIVE_SUFFIX)
+
+
 LOG_REGEX = "{}{}{}{}{}{}{}{}{}{}{}".format(
     r"(.*)",
     os_sep,  # category
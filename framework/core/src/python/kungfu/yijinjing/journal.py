@@ -19,10 +19,9 @@ def collect_journal_locations(ctx):
         ctx.name,
         "journal",
         ctx.mode,
-        "*.journal",
     )
     locations = {}
-    for journal in glob.glob(search_path):
+    for journal in glob_journal_pages(search_path):
         match = JOURNAL_PAGE_PATTERN.match(journal[len(ctx.runtime_dir) + 1 :])
         if match:
             category = match.group(1)
@@ -66,18 +66,15 @@ class Locator(yjj.locator):
             return file
 
     def list_page_id(self, location, dest_id):
-        page_ids = []
-        for journal in glob.glob(
-            os.path.join(
-                self.layout_dir(location, lf.enums.layout.JOURNAL),
-                hex(dest_id)[2:] + ".*.journal",
-            )
+        page_ids = set()
+        for journal in glob_journal_pages(
+            self.layout_dir(location, lf.enums.layout.JOURNAL), hex(dest_id)[2:] + ".*"
         ):
             match = JOURNAL_PAGE_PATTERN.match(journal[len(self._root) + 1 :])
             if match:
                 page_id = match.group(6)
-                page_ids.append(int(page_id))
-        return page_ids
+                page_ids.add(int(page_id))
+        return sorted(page_ids)
 
     def list_locations(self, category, group, name, mode):
         search_path = os.path.join(self._root, category, group, name, "journal", mode)
@@ -103,10 +100,9 @@ class Locator(yjj.locator):
             location.name,
             "journal",
             lf.enums.get_mode_name(location.mode),
-            "*.journal",
         )
         readers = {}
-        for journal in glob.glob(search_path):
+        for journal in glob_journal_pages(search_path):
             match = JOURNAL_PAGE_PATTERN.match(journal[len(self._root) + 1 :])
             if match:
                 dest = match.group(5)
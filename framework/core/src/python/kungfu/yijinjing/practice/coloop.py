@@ -7,6 +7,12 @@ import subprocess
 
 from collections import deque
 
+# rebuild the timer heap without cancelled handles once they are this many and
+# more than half of it
+MIN_CANCELLED_TO_PURGE = 100
+
+NANOSECONDS_PER_MILLISECOND = int(1e6)
+
 
 class KungfuEventLoop(asyncio.AbstractEventLoop):
     def __init__(self, ctx, hero):
@@ -14,11 +20,14 @@ class KungfuEventLoop(asyncio.AbstractEventLoop):
         self._running = False
         self._immediate = deque()
         self._scheduled = []
+        self._cancelled_count = 0
+        self._pollers = []
+        self._timeout = None
         self._exception = None
-        self._current = None
         self._ctx = ctx
         self._hero = hero
         self._hero.setup()
+        self._observer = self._hero.io_device.observer
         asyncio.set_event_loop(self)
 
     def get_debug(self):
@@ -32,40 +41,87 @@ class KungfuEventLoop(asyncio.AbstractEventLoop):
         self._ctx.logger.info(
             "[{:08x}] {} running".format(self._hero.home.uid, self._hero.home.uname)
         )
+        # asyncio.sleep and wait_for look for the running loop
+        asyncio._set_running_loop(self)
         while self._hero.live:
+            self._set_timeout()
             self._hero.step()
 
-            ready = deque()
-            while self._immediate:
-                ready.append(self._immediate.popleft())
-
-            if self._scheduled:
-                scheduled = []
-                while self._scheduled:
-                    handle = heapq.heappop(self._scheduled)
-                    if handle._when < self._hero.now():
-                        handle._scheduled = False
-                        ready.append(handle)
-                    else:
-                        heapq.heappush(scheduled, handle)
-                self._scheduled = scheduled
+            if self._pollers:
+                self._pollers = [poll for poll in self._pollers if not poll()]
+
+            ready = self._immediate
+            self._immediate = deque()
+            self._pop_due(ready)
 
             while ready:
-                self._current = ready.popleft()
-                if not self._current._cancelled:
-                    self._current._run()
-                if self._current:
-                    self._immediate.append(self._current)
+                handle = ready.popleft()
+                if not handle._cancelled:
+                    handle._run()
 
             if self._exception is not None:
+                asyncio._set_running_loop(None)
                 raise self._exception
+        asyncio._set_running_loop(None)
         self._hero.on_exit()
         self._ctx.logger.info(
             "[{:08x}] {} done".format(self._hero.home.uid, self._hero.home.uname)
         )
 
+    def add_poller(self, poll):
+        """
+        Call poll after every hero step until it returns True, for futures that wait
+        on states the hero updates rather than on callbacks.
+        """
+        self._pollers.append(poll)
+
+    def _pop_due(self, ready):
+        now = self._hero.now()
+        while self._scheduled and (
+            self._scheduled[0]._cancelled or self._scheduled[0]._when < now
+        ):
+            handle = heapq.heappop(self._scheduled)
+            handle._scheduled = False
+            if handle._cancelled:
+                self._cancelled_count -= 1
+            else:
+                ready.append(handle)
+
+    def _set_timeout(self):
+        """
+        Keep the hero from sleeping past the next deadline: no sleep while handles
+        are ready, sleep until the first timer is due otherwise. Due time is still
+        told by hero time, so replays run the same.
+        """
+        if self._immediate:
+            timeout = 0
+        elif self._scheduled:
+            delay = self._scheduled[0]._when - self._hero.now()
+            timeout = max(0, -(-delay // NANOSECONDS_PER_MILLISECOND))
+        else:
+            timeout = -1
+        if timeout != self._timeout:
+            self._observer.set_timeout(timeout)
+            self._timeout = timeout
+
     def _timer_handle_cancelled(self, handle):
-        pass
+        # called by TimerHandle.cancel before the handle is marked cancelled
+        if not handle._scheduled:
+            return
+        self._cancelled_count += 1
+        if (
+            self._cancelled_count > MIN_CANCELLED_TO_PURGE
+            and self._cancelled_count * 2 > len(self._scheduled)
+        ):
+            scheduled = []
+            for h in self._scheduled:
+                if h._cancelled or h is handle:
+                    h._scheduled = False
+                else:
+                    scheduled.append(h)
+            heapq.heapify(scheduled)
+            self._scheduled = scheduled
+            self._cancelled_count = 0
 
     def is_running(self):
         return self._hero.live
@@ -94,7 +150,7 @@ class KungfuEventLoop(asyncio.AbstractEventLoop):
         if delay < 0:
             raise Exception("Can't schedule in the past")
         return self.call_at(
-            self._hero.now() + delay * int(1e9), callback, args, context=context
+            self._hero.now() + int(delay * 1e9), callback, *args, context=context
         )
 
     def call_at(self, when, callback, *args, context=None):
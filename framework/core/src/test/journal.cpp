@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include "test.h"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+
+#include <kungfu/yijinjing/journal/page.h>
+#include <kungfu/yijinjing/journal/page_archive.h>
+
+using namespace kungfu::longfist::enums;
+using namespace kungfu::longfist::types;
+using namespace kungfu::yijinjing;
+using namespace kungfu::yijinjing::journal;
+
+namespace kungfu::test {
+namespace {
+constexpr int FRAME_SIZE = 1024;
+constexpr int FRAME_COUNT = 4096; // about 4MB, spans a few of the 1MB pages of system dest 0
+
+std::vector<char> make_content(int i) {
+  std::vector<char> data(FRAME_SIZE, char(i % 251));
+  memcpy(data.data(), &i, sizeof(i));
+  return data;
+}
+
+frame_ptr next_of_type(reader &r, int32_t msg_type) {
+  while (r.data_available() and r.current_frame()->msg_type() != msg_type) {
+    r.next();
+  }
+  return r.data_available() ? r.current_frame() : frame_ptr{};
+}
+} // namespace
+
+TEST(journal, batch_uids_are_shrunk_to_elements_written) {
+  temp_home home;
+  auto w = make_writer(home.make_location(category::TD, "test", "batch"), 1);
+  std::vector<uint64_t> uids = {};
+  auto inputs = w->open_array<OrderInput>(0, OrderInputBatch::tag, 4);
+  uint32_t size = 0;
+  for (int i = 0; i < 4; i++) {
+    if (i == 1) {
+      continue; // left out as an input of unknown instrument would be
+    }
+    inputs[size] = {};
+    inputs[size].order_id = w->current_element_uid(size);
+    inputs[size].volume = 100 * (i + 1);
+    uids.push_back(inputs[size].order_id);
+    size++;
+  }
+  w->close_frame(sizeof(OrderInput) * size);
+  auto &next = w->open_data<OrderInput>(0);
+  next = {};
+  next.order_id = w->current_frame_uid();
+  w->close_data();
+  uids.push_back(next.order_id);
+  EXPECT_EQ(std::set<uint64_t>(uids.begin(), uids.end()).size(), uids.size());
+
+  reader r(true);
+  r.join(w->get_location(), 1, 0);
+  auto batch = next_of_type(r, OrderInputBatch::tag);
+  ASSERT_TRUE(batch);
+  EXPECT_EQ(batch->uid_count(), size);
+  ASSERT_EQ(batch->data_length(), sizeof(OrderInput) * size);
+  auto elements = reinterpret_cast<const OrderInput *>(batch->data_address());
+  for (uint32_t i = 0; i < size; i++) {
+    EXPECT_EQ(elements[i].order_id, uids[i]);
+  }
+  r.next();
+  auto single = next_of_type(r, OrderInput::tag);
+  ASSERT_TRUE(single);
+  EXPECT_EQ(single->data<OrderInput>().order_id, uids.back());
+}
+
+TEST(journal, archived_pages_read_back) {
+  temp_home home;
+  auto location = home.make_location(category::SYSTEM, "test", "archive");
+  auto w = make_writer(location, 0);
+  for (int i = 0; i < FRAME_COUNT; i++) {
+    auto data = make_content(i);
+    w->write_raw(0, TEST_MSG_TYPE, reinterpret_cast<uintptr_t>(data.data()), data.size());
+  }
+  auto last_page_id = w->get_current_page()->get_page_id();
+  ASSERT_GT(last_page_id, 2u);
+
+  auto stats = page_archive::archive_before(location, 0, INT64_MAX);
+  EXPECT_EQ(stats.pages, last_page_id - 1); // the page being written stays in place
+  EXPECT_GT(stats.archived_bytes, 0u);
+  EXPECT_LT(stats.archived_bytes, stats.content_bytes);
+  for (uint32_t page_id = 1; page_id < last_page_id; page_id++) {
+    EXPECT_FALSE(std::filesystem::exists(page::get_page_path(location, 0, page_id)));
+    EXPECT_TRUE(std::filesystem::exists(page_archive::get_archive_path(location, 0, page_id)));
+    EXPECT_TRUE(page::exists(location, 0, page_id));
+  }
+
+  std::vector<int64_t> gen_times = {};
+  reader r(true);
+  r.join(location, 0, 0);
+  for (int i = 0; i < FRAME_COUNT; i++) {
+    auto frame = next_of_type(r, TEST_MSG_TYPE);
+    ASSERT_TRUE(frame) << "frame " << i << " missing";
+    ASSERT_EQ(frame->data_length(), uint32_t(FRAME_SIZE));
+    auto expected = make_content(i);
+    ASSERT_EQ(memcmp(frame->data_address(), expected.data(), FRAME_SIZE), 0) << "frame " << i << " differs";
+    gen_times.push_back(frame->gen_time());
+    r.next();
+  }
+  EXPECT_FALSE(next_of_type(r, TEST_MSG_TYPE));
+
+  // seeking by time goes through the page index into archived pages
+  auto from = FRAME_COUNT / 3;
+  auto expected_index = std::upper_bound(gen_times.begin(), gen_times.end(), gen_times[from]) - gen_times.begin();
+  reader seeker(true);
+  seeker.join(location, 0, gen_times[from]);
+  auto frame = next_of_type(seeker, TEST_MSG_TYPE);
+  ASSERT_TRUE(frame);
+  auto expected = make_content(int(expected_index));
+  EXPECT_EQ(memcmp(frame->data_address(), expected.data(), FRAME_SIZE), 0);
+}
+} // namespace kungfu::test
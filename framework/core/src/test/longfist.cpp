@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include "test.h"
+
+using namespace kungfu::longfist::enums;
+using namespace kungfu::longfist::types;
+using namespace kungfu::yijinjing;
+using namespace kungfu::yijinjing::journal;
+
+namespace kungfu::test {
+namespace {
+Config make_config() {
+  Config config = {};
+  config.location_uid = 0x12345678;
+  config.category = category::TD;
+  config.group = "sim";
+  config.name = std::string("with\0nul", 8);
+  config.mode = mode::BACKTEST;
+  config.value = R"({"account_id": "123", "ratio": 0.5})";
+  return config;
+}
+
+void expect_same(const Config &restored, const Config &config) {
+  EXPECT_EQ(restored.location_uid, config.location_uid);
+  EXPECT_EQ(restored.category, config.category);
+  EXPECT_EQ(restored.group, config.group);
+  EXPECT_EQ(restored.name, config.name);
+  EXPECT_EQ(restored.mode, config.mode);
+  EXPECT_EQ(restored.value, config.value);
+}
+} // namespace
+
+TEST(longfist, bytes_round_trip) {
+  auto config = make_config();
+  auto bytes = config.to_bytes();
+  EXPECT_EQ(bytes.length(), config.bytes_length());
+  expect_same(Config(bytes.data(), bytes.length()), config);
+
+  Config empty = {};
+  auto empty_bytes = empty.to_bytes();
+  expect_same(Config(empty_bytes.data(), empty_bytes.length()), empty);
+}
+
+TEST(longfist, json_still_parsed) {
+  auto config = make_config();
+  config.name = "plain"; // JSON text keeps strings up to the first nul
+  auto text = config.to_string();
+  expect_same(Config(text.c_str(), text.length()), config);
+}
+
+TEST(longfist, truncated_bytes_throw) {
+  auto bytes = make_config().to_bytes();
+  EXPECT_THROW(Config(bytes.data(), bytes.length() - 1), std::runtime_error);
+  EXPECT_THROW(Config(bytes.data(), 3), std::runtime_error);
+}
+
+TEST(longfist, bytes_round_trip_through_journal) {
+  temp_home home;
+  auto w = make_writer(home.make_location(category::SYSTEM, "test", "codec"), 0);
+  auto config = make_config();
+  w->write(0, config);
+
+  reader r(true);
+  r.join(w->get_location(), 0, 0);
+  while (r.data_available() and r.current_frame()->msg_type() != Config::tag) {
+    r.next();
+  }
+  ASSERT_TRUE(r.data_available());
+  EXPECT_EQ(r.current_frame()->data_length(), config.bytes_length());
+  expect_same(r.current_frame()->data<Config>(), config);
+}
+} // namespace kungfu::test
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef KUNGFU_TEST_H
+#define KUNGFU_TEST_H
+
+#include <filesystem>
+#include <gtest/gtest.h>
+
+#include <kungfu/yijinjing/journal/journal.h>
+
+namespace kungfu::test {
+constexpr int32_t TEST_MSG_TYPE = 10001;
+
+/**
+ * Journals, indices and logs of one test under a fresh directory in system temp, removed on destruction.
+ */
+class temp_home {
+public:
+  temp_home() : root_(make_root()), locator_(std::make_shared<yijinjing::data::locator>(root_.string())) {}
+
+  ~temp_home() {
+    std::error_code ec;
+    std::filesystem::remove_all(root_, ec);
+  }
+
+  [[nodiscard]] const yijinjing::data::locator_ptr &get_locator() const { return locator_; }
+
+  [[nodiscard]] yijinjing::data::location_ptr make_location(longfist::enums::category c, const std::string &group,
+                                                            const std::string &name) const {
+    return yijinjing::data::location::make_shared(longfist::enums::mode::LIVE, c, group, name, locator_);
+  }
+
+private:
+  const std::filesystem::path root_;
+  const yijinjing::data::locator_ptr locator_;
+
+  static std::filesystem::path make_root() {
+    static int count = 0;
+    auto name = fmt::format("kungfu-test-{}-{}", yijinjing::time::now_in_nano(), count++);
+    auto root = std::filesystem::temp_directory_path() / name;
+    std::filesystem::create_directories(root);
+    return root;
+  }
+};
+
+/**
+ * Publisher for writers with no observer to wake up.
+ */
+class null_publisher : public yijinjing::publisher {
+public:
+  bool is_usable() override { return true; }
+
+  void setup() override {}
+
+  int notify() override { return 0; }
+
+  int publish(const std::string &json_message, int flags) override { return 0; }
+};
+
+inline yijinjing::journal::writer_ptr make_writer(const yijinjing::data::location_ptr &location, uint32_t dest_id) {
+  return std::make_shared<yijinjing::journal::writer>(location, dest_id, true, std::make_shared<null_publisher>());
+}
+} // namespace kungfu::test
+
+#endif // KUNGFU_TEST_H
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include "test.h"
+
+#include <kungfu/wingchun/backtest/matchengine.h>
+#include <kungfu/wingchun/service/depth.h>
+#include <kungfu/wingchun/service/orderbook.h>
+
+using namespace kungfu::longfist::enums;
+using namespace kungfu::longfist::types;
+using namespace kungfu::wingchun::backtest;
+using namespace kungfu::wingchun::service;
+
+namespace kungfu::test {
+namespace {
+Quote make_quote(double price, int64_t volume) {
+  Quote quote = {};
+  quote.instrument_id = "600000";
+  quote.exchange_id = "SSE";
+  quote.instrument_type = InstrumentType::Stock;
+  quote.last_price = price;
+  quote.volume = volume;
+  for (int level = 0; level < 10; level++) {
+    quote.bid_price[level] = price - 0.01 * (level + 1);
+    quote.ask_price[level] = price + 0.01 * (level + 1);
+    quote.bid_volume[level] = 1000;
+    quote.ask_volume[level] = 1000;
+  }
+  return quote;
+}
+
+OrderInput make_input(uint64_t order_id, Side side, double limit_price, int64_t volume) {
+  OrderInput input = {};
+  input.order_id = order_id;
+  input.instrument_id = "600000";
+  input.exchange_id = "SSE";
+  input.instrument_type = InstrumentType::Stock;
+  input.price_type = PriceType::Limit;
+  input.side = side;
+  input.limit_price = limit_price;
+  input.volume = volume;
+  return input;
+}
+
+/**
+ * Orders and trades reported by a match engine, in the order they were sunk.
+ */
+struct match_record {
+  std::vector<Order> orders = {};
+  std::vector<Trade> trades = {};
+
+  MatchEngine::Sink sink() {
+    return [this](const event_ptr &event) {
+      if (event->msg_type() == Order::tag) {
+        orders.push_back(event->data<Order>());
+      }
+      if (event->msg_type() == Trade::tag) {
+        trades.push_back(event->data<Trade>());
+      }
+    };
+  }
+};
+
+Entrust make_entrust(int64_t seq, Side side, double price, int64_t volume) {
+  Entrust entrust = {};
+  entrust.instrument_id = "000001";
+  entrust.exchange_id = "SZE";
+  entrust.seq = seq;
+  entrust.side = side;
+  entrust.price_type = PriceType::Limit;
+  entrust.price = price;
+  entrust.volume = volume;
+  return entrust;
+}
+
+Transaction make_transaction(int64_t bid_no, int64_t ask_no, double price, int64_t volume, ExecType exec_type) {
+  Transaction transaction = {};
+  transaction.instrument_id = "000001";
+  transaction.exchange_id = "SZE";
+  transaction.bid_no = bid_no;
+  transaction.ask_no = ask_no;
+  transaction.price = price;
+  transaction.volume = volume;
+  transaction.exec_type = exec_type;
+  return transaction;
+}
+
+OrderBook make_book() {
+  OrderBook book("SZE", "000001");
+  book.apply(make_entrust(1, Side::Buy, 10.00, 500));
+  book.apply(make_entrust(2, Side::Buy, 9.99, 300));
+  book.apply(make_entrust(3, Side::Sell, 10.02, 400));
+  book.apply(make_entrust(4, Side::Sell, 10.03, 200));
+  book.apply(make_entrust(5, Side::Buy, 10.00, 100));
+  book.apply(make_transaction(1, 6, 10.00, 200, ExecType::Trade)); // seller 6 took liquidity, never rested
+  book.apply(make_transaction(2, 0, 0, 300, ExecType::Cancel));
+  return book;
+}
+} // namespace
+
+TEST(match_engine, limit_order_walks_depth_then_rests) {
+  match_record record;
+  MatchEngine engine({}, record.sink());
+  engine.on_quote(0, make_quote(10.5, 0));
+  engine.insert_order(1, 1, 2, make_input(1, Side::Buy, 10.52, 2500));
+  engine.advance(1);
+
+  ASSERT_EQ(record.trades.size(), 2u);
+  EXPECT_DOUBLE_EQ(record.trades[0].price, 10.51);
+  EXPECT_EQ(record.trades[0].volume, 1000);
+  EXPECT_DOUBLE_EQ(record.trades[1].price, 10.52);
+  EXPECT_EQ(record.trades[1].volume, 1000);
+  ASSERT_FALSE(record.orders.empty());
+  EXPECT_EQ(record.orders.back().status, OrderStatus::PartialFilledActive);
+  EXPECT_EQ(record.orders.back().volume_left, 500);
+
+  // market trades 300 at the limit price with asks moved away, nothing was shown ahead at 10.52 on the bid side
+  engine.on_quote(2, make_quote(10.52, 300));
+  ASSERT_EQ(record.trades.size(), 3u);
+  EXPECT_DOUBLE_EQ(record.trades[2].price, 10.52);
+  EXPECT_EQ(record.trades[2].volume, 300);
+  EXPECT_EQ(record.orders.back().volume_left, 200);
+
+  OrderAction action = {};
+  action.order_id = 1;
+  engine.cancel_order(3, 1, 2, action);
+  engine.advance(3);
+  EXPECT_EQ(record.orders.back().status, OrderStatus::PartialFilledNotActive);
+  EXPECT_EQ(record.orders.back().volume_left, 200);
+  EXPECT_EQ(record.trades.size(), 3u);
+}
+
+TEST(match_engine, fully_filled_across_levels) {
+  match_record record;
+  MatchEngine engine({}, record.sink());
+  engine.on_quote(0, make_quote(10.5, 0));
+  engine.insert_order(1, 1, 2, make_input(1, Side::Sell, 10.48, 1500));
+  engine.advance(1);
+
+  ASSERT_EQ(record.trades.size(), 2u);
+  EXPECT_DOUBLE_EQ(record.trades[0].price, 10.49);
+  EXPECT_EQ(record.trades[0].volume, 1000);
+  EXPECT_DOUBLE_EQ(record.trades[1].price, 10.48);
+  EXPECT_EQ(record.trades[1].volume, 500);
+  EXPECT_EQ(record.orders.back().status, OrderStatus::Filled);
+  EXPECT_EQ(record.orders.back().volume_left, 0);
+}
+
+TEST(match_engine, resting_order_waits_behind_shown_volume) {
+  match_record record;
+  MatchEngine engine({}, record.sink());
+  engine.on_quote(0, make_quote(10.5, 0));
+  engine.insert_order(1, 1, 2, make_input(1, Side::Sell, 10.51, 100));
+  engine.advance(1);
+  EXPECT_TRUE(record.trades.empty());
+  EXPECT_EQ(record.orders.back().status, OrderStatus::Submitted);
+
+  // 1000 shown at 10.51 when accepted trades first
+  engine.on_quote(2, make_quote(10.51, 600));
+  EXPECT_TRUE(record.trades.empty());
+  engine.on_quote(3, make_quote(10.51, 1200));
+  ASSERT_EQ(record.trades.size(), 1u);
+  EXPECT_EQ(record.trades[0].volume, 100);
+  EXPECT_EQ(record.orders.back().status, OrderStatus::Filled);
+}
+
+TEST(match_engine, invalid_input_rejected) {
+  match_record record;
+  MatchEngine engine({}, record.sink());
+  engine.on_quote(0, make_quote(10.5, 0));
+  engine.insert_order(1, 1, 2, make_input(1, Side::Buy, 10.52, 0));
+  engine.advance(1);
+  EXPECT_TRUE(record.trades.empty());
+  ASSERT_EQ(record.orders.size(), 1u);
+  EXPECT_EQ(record.orders[0].status, OrderStatus::Error);
+}
+
+TEST(order_book, rebuilt_from_entrusts_and_transactions) {
+  auto book = make_book();
+  auto &tree = book.snapshot();
+  EXPECT_EQ(book.order_count(), 4u);
+  EXPECT_EQ(tree.bid_depth, 1);
+  EXPECT_DOUBLE_EQ(tree.bid_price[0], 10.00);
+  EXPECT_EQ(tree.bid_volume[0], 400);
+  EXPECT_EQ(tree.bid_volume[1], 0);
+  EXPECT_EQ(tree.ask_depth, 2);
+  EXPECT_DOUBLE_EQ(tree.ask_price[0], 10.02);
+  EXPECT_EQ(tree.ask_volume[0], 400);
+  EXPECT_DOUBLE_EQ(tree.ask_price[1], 10.03);
+  EXPECT_EQ(tree.ask_volume[1], 200);
+  EXPECT_DOUBLE_EQ(tree.last_price, 10.00);
+  EXPECT_EQ(tree.volume, 200);
+  EXPECT_EQ(tree.trade_num, 1);
+  EXPECT_EQ(tree.total_bid_volume, 400);
+  EXPECT_EQ(tree.total_ask_volume, 600);
+}
+
+TEST(order_book, snapshot_read_back) {
+  temp_home home;
+  auto path = DepthService::get_snapshot_path(home.get_locator(), mode::BACKTEST);
+  auto book = make_book();
+  DepthSnapshot writer(path, true, 16);
+  writer.write(book.snapshot());
+
+  DepthSnapshot reader(path, false);
+  EXPECT_EQ(reader.size(), 1u);
+  auto tree = reader.read("SZE", "000001");
+  ASSERT_TRUE(tree.has_value());
+  EXPECT_EQ(tree->bid_volume[0], 400);
+  EXPECT_DOUBLE_EQ(tree->ask_price[1], 10.03);
+  EXPECT_EQ(tree->volume, 200);
+  EXPECT_FALSE(reader.read("SZE", "000002").has_value());
+}
+} // namespace kungfu::test